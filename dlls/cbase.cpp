@@ -399,6 +399,8 @@ extern "C" EXPORT int GetEntityAPI2(DLL_FUNCTIONS *pFunctionTable, int *interfac
 
 void OnFreeEntPrivateData(edict_t *pEnt)
 {
+	EntityClassStats_OnFree(pEnt);
+
 	CBaseEntity *pEntity = CBaseEntity::Instance(pEnt);
 
 	if (!pEntity)
@@ -20,34 +20,139 @@ GNU General Public License for more details.
 #include "cbase_entity_factory.h"
 #include "cbase_typelist.h"
 
-#include <unordered_map>
+#include <vector>
+#include <deque>
 #include <string>
+#include <cstring>
+#include <initializer_list>
 
 namespace sv {
 
-using MapType = std::unordered_map<std::string, EntityMetaData>;
-
-namespace detail
+struct EntityFactoryEntry
+{
+	uint32_t Hash;
+	const char* ClassName; // nullptr for an empty slot
+	void(*GetClassPtr)(entvars_t*); // nullptr for Lua-only classes
+	bool LuaOverride;
+};
+
+// open addressing, kept at most half full so probes stay short
+class EntityFactoryTable
 {
-	template<class...MdTypes>
-	MapType WeaponEntityFindList_CreateImpl(const MdTypes&...mds)
+public:
+	template<class...Types>
+	explicit EntityFactoryTable(TypeList<Types...>) : m_Slots(64), m_Count(0), m_NumLuaOverrides(0)
 	{
-		return { { mds.ClassName, mds }... };
+		for (const EntityMetaData& md : { GetEntityMetaDataFor(type_identity<Types>())... })
+		{
+			EntityFactoryEntry& entry = Insert(md.ClassName, EntityClassHash(md.ClassName));
+			if (!entry.GetClassPtr)
+				entry.GetClassPtr = md.GetClassPtr;
+		}
 	}
 
-	template<class...Types>
-	MapType WeaponEntityFindList_Create(TypeList<Types...>)
+	EntityFactoryEntry* Find(const char* szName, uint32_t hash)
 	{
-		return WeaponEntityFindList_CreateImpl(GetEntityMetaDataFor(type_identity<Types>())...);
+		const size_t mask = m_Slots.size() - 1;
+		for (size_t i = hash & mask; m_Slots[i].ClassName; i = (i + 1) & mask)
+		{
+			if (m_Slots[i].Hash == hash && !strcmp(m_Slots[i].ClassName, szName))
+				return &m_Slots[i];
+		}
+		return nullptr;
 	}
-}
-	
-static const MapType &MapSingleton()
+
+	// szName has to outlive the table
+	EntityFactoryEntry& Insert(const char* szName, uint32_t hash)
+	{
+		if (EntityFactoryEntry* entry = Find(szName, hash))
+			return *entry;
+
+		if ((m_Count + 1) * 2 > m_Slots.size())
+			Grow();
+
+		const size_t mask = m_Slots.size() - 1;
+		size_t i = hash & mask;
+		while (m_Slots[i].ClassName)
+			i = (i + 1) & mask;
+
+		m_Slots[i] = { hash, szName, nullptr, false };
+		++m_Count;
+		return m_Slots[i];
+	}
+
+	void RegisterLua(const char* szName)
+	{
+		const uint32_t hash = EntityClassHash(szName);
+		EntityFactoryEntry* entry = Find(szName, hash);
+		if (!entry)
+		{
+			m_LuaNames.emplace_back(szName);
+			entry = &Insert(m_LuaNames.back().c_str(), hash);
+		}
+
+		if (!entry->LuaOverride)
+		{
+			entry->LuaOverride = true;
+			++m_NumLuaOverrides;
+		}
+	}
+
+	void ClearLua()
+	{
+		for (EntityFactoryEntry& entry : m_Slots)
+			entry.LuaOverride = false;
+		m_NumLuaOverrides = 0;
+	}
+
+	size_t NumLuaOverrides() const { return m_NumLuaOverrides; }
+
+private:
+	void Grow()
+	{
+		std::vector<EntityFactoryEntry> old(m_Slots.size() * 2);
+		old.swap(m_Slots);
+		m_Count = 0;
+		for (const EntityFactoryEntry& entry : old)
+		{
+			if (entry.ClassName)
+				Insert(entry.ClassName, entry.Hash) = entry;
+		}
+	}
+
+	std::vector<EntityFactoryEntry> m_Slots; // power of two
+	std::deque<std::string> m_LuaNames; // deque never moves its elements
+	size_t m_Count;
+	size_t m_NumLuaOverrides;
+};
+
+static EntityFactoryTable &TableSingleton()
 {
-	static const MapType x = detail::WeaponEntityFindList_Create(AllEntityTypeList());
+	static EntityFactoryTable x(AllEntityTypeList{});
 	return x;
 }
 
+void MoE_RegisterLuaEntity(const char* szName)
+{
+	if (szName && szName[0])
+		TableSingleton().RegisterLua(szName);
+}
+
+void MoE_ClearLuaEntities()
+{
+	TableSingleton().ClearLua();
+}
+
+bool MoE_IsLuaEntity(const char* szName, uint32_t hash)
+{
+	auto &table = TableSingleton();
+	if (!table.NumLuaOverrides())
+		return false;
+
+	EntityFactoryEntry* entry = table.Find(szName, hash);
+	return entry && entry->LuaOverride;
+}
+
 int MoE_EntityFactory(edict_t *pent, const char *szName )
 {
 	if(!szName || !szName[0])
@@ -55,18 +160,19 @@ int MoE_EntityFactory(edict_t *pent, const char *szName )
 
 	entvars_t* pev = &pent->v;
 
-	if (LuaGetClassPtr(szName, pev))
-		return 1;
-
-	auto &sfmap = MapSingleton();
-	auto iter = sfmap.find(std::string(szName));
-	if(iter != sfmap.end())
+	EntityFactoryEntry* entry = TableSingleton().Find(szName, EntityClassHash(szName));
+	if (entry)
 	{
-		(*iter->second.GetClassPtr)(pev);
-		return 0; // OK
+		if (entry->LuaOverride && LuaGetClassPtr(szName, pev))
+			return 1;
+
+		if (entry->GetClassPtr)
+		{
+			(*entry->GetClassPtr)(pev);
+			return 0; // OK
+		}
 	}
 
-
 	ALERT(at_warning, "MoE_EntityFactory() : Unrecognized entity %s \n", szName);
 	return -1; // NOT FOUND
 }
@@ -17,6 +17,8 @@ GNU General Public License for more details.
 
 #include "meta/TypeIdentity.h"
 
+#include <cstdint>
+
 #ifndef CLIENT_DLL
 typedef struct edict_s edict_t;
 typedef struct entvars_s entvars_t;
@@ -40,6 +42,20 @@ bool LuaGetClassPtr(const char* pevClassName, entvars_t* pev);
 namespace sv {
 int MoE_EntityFactory(edict_t* pent, const char* szName);
 
+// FNV-1a, usable on string literals at compile time
+constexpr uint32_t EntityClassHash(const char* szName)
+{
+	uint32_t hash = 2166136261u;
+	while (*szName)
+		hash = (hash ^ (unsigned char)*szName++) * 16777619u;
+	return hash;
+}
+
+// Lua classes registered with LINK_ENTITY_TO_CLASS override the C++ ones
+void MoE_RegisterLuaEntity(const char* szName);
+void MoE_ClearLuaEntities();
+bool MoE_IsLuaEntity(const char* szName, uint32_t hash);
+
 struct EntityMetaData
 {
 	int DeclearLine;
@@ -75,7 +91,7 @@ bool LuaGetClassPtr(const char* pevClassName, entvars_t* pev);
 	DECLEAR_ENTITY_CLASS_REMINDER(DLLClassName); \
 	extern EntityMetaData GetEntityMetaDataFor(TypeIdentity<DLLClassName>);
 #define LINK_ENTITY_TO_CLASS(mapClassName, DLLClassName) \
-	extern "C" EXPORT void mapClassName(entvars_t *pev) { LuaGetClassPtr(#mapClassName, pev) || (GetClassPtr<DLLClassName>(pev), true); } \
+	extern "C" EXPORT void mapClassName(entvars_t *pev) { (MoE_IsLuaEntity(#mapClassName, std::integral_constant<uint32_t, EntityClassHash(#mapClassName)>::value) && LuaGetClassPtr(#mapClassName, pev)) || (GetClassPtr<DLLClassName>(pev), true); } \
 	LINK_ENTITY_TO_REMINDER(DLLClassName) \
 	EntityMetaData GetEntityMetaDataFor(TypeIdentity<DLLClassName>) { return { REMEMBER_TO_ADD_IN_cbase_typelist_h_<DLLClassName>(), #mapClassName, &mapClassName }; }
 #endif
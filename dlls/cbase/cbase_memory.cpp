@@ -5,6 +5,8 @@
 #include <algorithm>
 #include <mutex>
 #include <atomic>
+#include <deque>
+#include <vector>
 
 namespace sv {
 
@@ -99,4 +101,68 @@ void CBaseEntity::operator delete(void *pMem)
 	g_RemoveEntityLock.unlock();
 }
 
+static std::deque<EntityClassStats> g_EntityClassStats; // deque keeps the pointers stable
+static std::vector<EntityClassStats *> g_EdictClassStats; // by entity index
+
+EntityClassStats *RegisterEntityClassStats(std::string className, size_t size)
+{
+	g_EntityClassStats.push_back({ std::move(className), size, 0, 0, 0 });
+	return &g_EntityClassStats.back();
+}
+
+void EntityClassStats_OnCreate(EntityClassStats *stats, entvars_t *pev)
+{
+	const int index = ENTINDEX(ENT(pev));
+
+	if (index >= (int)g_EdictClassStats.size())
+		g_EdictClassStats.resize(std::max(index + 1, gpGlobals->maxEntities));
+
+	// private data replaced without being freed
+	if (EntityClassStats *old = g_EdictClassStats[index])
+		--old->Live;
+
+	g_EdictClassStats[index] = stats;
+	++stats->Total;
+	stats->Peak = std::max(stats->Peak, ++stats->Live);
+}
+
+void EntityClassStats_OnFree(edict_t *pEdict)
+{
+	const int index = ENTINDEX(pEdict);
+
+	if (index < 0 || index >= (int)g_EdictClassStats.size())
+		return;
+
+	if (EntityClassStats *stats = g_EdictClassStats[index])
+	{
+		--stats->Live;
+		g_EdictClassStats[index] = nullptr;
+	}
+}
+
+void EntityClassStats_Dump()
+{
+	std::vector<const EntityClassStats *> sorted;
+	size_t liveBytes = 0, peakBytes = 0;
+
+	for (const EntityClassStats &stats : g_EntityClassStats)
+	{
+		if (stats.Total)
+			sorted.push_back(&stats);
+	}
+
+	std::sort(sorted.begin(), sorted.end(), [](const EntityClassStats *a, const EntityClassStats *b) {
+		return a->Peak * a->Size > b->Peak * b->Size;
+	});
+
+	ALERT(at_console, "%-32s %6s %6s %6s %8s\n", "class", "size", "live", "peak", "total");
+	for (const EntityClassStats *stats : sorted)
+	{
+		ALERT(at_console, "%-32s %6d %6d %6d %8d\n", stats->ClassName.c_str(), (int)stats->Size, stats->Live, stats->Peak, stats->Total);
+		liveBytes += stats->Live * stats->Size;
+		peakBytes += stats->Peak * stats->Size;
+	}
+	ALERT(at_console, "%d classes, %d KB live, %d KB at peak\n", (int)sorted.size(), (int)(liveBytes / 1024), (int)(peakBytes / 1024));
+}
+
 }
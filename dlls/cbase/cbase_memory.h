@@ -14,6 +14,27 @@
 #ifndef CLIENT_DLL
 namespace sv {
 void LuaNotifyCppEntityCreate(const char *cppClassName, CBaseEntity* ptr);
+
+// per class live / peak counters, see entity_classstats
+struct EntityClassStats
+{
+	std::string ClassName;
+	size_t Size;
+	int Live;
+	int Peak;
+	int Total;
+};
+EntityClassStats *RegisterEntityClassStats(std::string className, size_t size);
+void EntityClassStats_OnCreate(EntityClassStats *stats, entvars_t *pev);
+void EntityClassStats_OnFree(edict_t *pEdict);
+void EntityClassStats_Dump();
+
+template<class T>
+EntityClassStats *GetEntityClassStats()
+{
+	static EntityClassStats *const stats = RegisterEntityClassStats(std::string(nameof::nameof_short_type<T>()), sizeof(T));
+	return stats;
+}
 //
 // Converts a entvars_t * to a class pointer
 // It will allocate the class and entity if necessary
@@ -35,6 +56,8 @@ auto GetClassPtr(entvars_t *pev) noexcept -> typename std::enable_if<std::is_bas
 		// a->pev = pev;
 		assert(a->pev == pev);
 
+		EntityClassStats_OnCreate(GetEntityClassStats<T>(), pev);
+
 		// call lua
 		LuaNotifyCppEntityCreate(std::string(nameof::nameof_short_type<T>()).c_str(), a);
 	}
@@ -40,7 +40,10 @@
 #include "newmenus.h"
 #include "client/admin.h"
 
+#include <algorithm>
 #include <tuple>
+#include <string_view>
+#include <unordered_map>
 
 namespace sv {
 
@@ -86,6 +89,28 @@ static entity_field_alias_t custom_entity_field_alias[] =
 static int g_serveractive = 0;
 
 PLAYERPVSSTATUS g_PVSStatus[MAX_CLIENTS];
+
+// host state for the entities packed to one client, see SetupFullPackHost
+#define MAX_FULLPACK_ALWAYS_SEND 4
+
+struct FULLPACKHOST
+{
+	const edict_t *host;
+	int hostnum;
+	WeaponIdType activeWeapon;
+	int numAlwaysSend;
+	const edict_t *alwaysSend[MAX_FULLPACK_ALWAYS_SEND];
+};
+
+static FULLPACKHOST g_FullPackHost;
+
+static struct
+{
+	bool enabled;
+	unsigned int calls;
+	unsigned int sent;
+	std::chrono::nanoseconds time;
+} g_FullPackProfile;
 unsigned short m_usResetDecals;
 unsigned short g_iShadowSprite;
 
@@ -2330,6 +2355,208 @@ NOXREF int CountPlayersInServer()
 	return count;
 }
 
+// Client command table
+// Every command ClientCommand and the buy / radio alias handlers compare against is
+// listed once here and looked up with a single hash, the handlers then switch on the id.
+
+#define CLIENT_COMMANDS(X) \
+	X(SAY, "say") \
+	X(INSPECT, "inspect") \
+	X(CHANGEMODEL, "changemodel") \
+	X(SAY_TEAM, "say_team") \
+	X(FULLUPDATE, "fullupdate") \
+	X(VOTE, "vote") \
+	X(LISTMAPS, "listmaps") \
+	X(VOTEMAP, "votemap") \
+	X(TIMELEFT, "timeleft") \
+	X(LISTPLAYERS, "listplayers") \
+	X(CLIENT_BUY_OPEN, "client_buy_open") \
+	X(CLIENT_BUY_CLOSE, "client_buy_close") \
+	X(MENUSELECT, "menuselect") \
+	X(CHOOSETEAM, "chooseteam") \
+	X(SHOWBRIEFING, "showbriefing") \
+	X(IGNOREMSG, "ignoremsg") \
+	X(IGNORERAD, "ignorerad") \
+	X(BECOME_VIP, "become_vip") \
+	X(SPECTATE, "spectate") \
+	X(SPECMODE, "specmode") \
+	X(SPEC_SET_AD, "spec_set_ad") \
+	X(FOLLOWNEXT, "follownext") \
+	X(FOLLOW, "follow") \
+	X(MP_DEBUG, "mp_debug") \
+	X(JOINTEAM, "jointeam") \
+	X(JOINCLASS, "joinclass") \
+	X(NIGHTVISION, "nightvision") \
+	X(RADIO1, "radio1") \
+	X(RADIO2, "radio2") \
+	X(RADIO3, "radio3") \
+	X(DROP, "drop") \
+	X(FOV, "fov") \
+	X(USE, "use") \
+	X(WEAPON_KNIFE, "weapon_knife") \
+	X(LASTINV, "lastinv") \
+	X(BUYAMMO1, "buyammo1") \
+	X(BUYAMMO2, "buyammo2") \
+	X(BUYEQUIP, "buyequip") \
+	X(BUY, "buy") \
+	X(CL_SETAUTOBUY, "cl_setautobuy") \
+	X(CL_SETREBUY, "cl_setrebuy") \
+	X(CL_AUTOBUY, "cl_autobuy") \
+	X(CL_REBUY, "cl_rebuy") \
+	X(SMARTRADIO, "smartradio") \
+	X(MOE_BUY, "moe_buy") \
+	X(MOE_ADMIN, "moe_admin") \
+	/* buy aliases */ \
+	X(PRIMAMMO, "primammo") \
+	X(SECAMMO, "secammo") \
+	X(VEST, "vest") \
+	X(VESTHELM, "vesthelm") \
+	X(FLASH, "flash") \
+	X(HEGREN, "hegren") \
+	X(SGREN, "sgren") \
+	X(NVGS, "nvgs") \
+	X(DEFUSER, "defuser") \
+	X(SHIELD, "shield") \
+	/* radio aliases, in menu order */ \
+	X(COVERME, "coverme") \
+	X(TAKEPOINT, "takepoint") \
+	X(HOLDPOS, "holdpos") \
+	X(REGROUP, "regroup") \
+	X(FOLLOWME, "followme") \
+	X(TAKINGFIRE, "takingfire") \
+	X(GO, "go") \
+	X(FALLBACK, "fallback") \
+	X(STICKTOG, "sticktog") \
+	X(GETINPOS, "getinpos") \
+	X(STORMFRONT, "stormfront") \
+	X(REPORT, "report") \
+	X(ROGER, "roger") \
+	X(ENEMYSPOT, "enemyspot") \
+	X(NEEDBACKUP, "needbackup") \
+	X(SECTORCLEAR, "sectorclear") \
+	X(INPOSITION, "inposition") \
+	X(REPORTINGIN, "reportingin") \
+	X(GETOUT, "getout") \
+	X(NEGATIVE, "negative") \
+	X(ENEMYDOWN, "enemydown")
+
+enum ClientCommandId
+{
+	CLCMD_UNKNOWN = 0,	// anything else, left to the game rules and mod strategy
+#define CLIENT_COMMAND_ID(id, name) CLCMD_##id,
+	CLIENT_COMMANDS(CLIENT_COMMAND_ID)
+#undef CLIENT_COMMAND_ID
+	CLCMD_COUNT
+};
+
+static const char *const g_szClientCommands[CLCMD_COUNT] =
+{
+	"(other)",
+#define CLIENT_COMMAND_NAME(id, name) name,
+	CLIENT_COMMANDS(CLIENT_COMMAND_NAME)
+#undef CLIENT_COMMAND_NAME
+};
+
+// per client token bucket, refilled at mp_clientcmdrate up to mp_clientcmdburst
+struct ClientCommandRate
+{
+	float tokens;
+	std::chrono::steady_clock::time_point last;
+	bool flooding;
+};
+
+static struct
+{
+	unsigned int calls[CLCMD_COUNT];
+	unsigned int dropped;
+	ClientCommandRate rate[MAX_CLIENTS + 1];
+} g_ClientCommandStats;
+
+static ClientCommandId ClientCommand_Lookup(const char *pcmd)
+{
+	static const std::unordered_map<std::string_view, ClientCommandId> table = []()
+	{
+		std::unordered_map<std::string_view, ClientCommandId> commands;
+
+		for (int i = CLCMD_UNKNOWN + 1; i < CLCMD_COUNT; i++)
+			commands.emplace(g_szClientCommands[i], (ClientCommandId)i);
+
+		return commands;
+	}();
+
+	auto it = table.find(pcmd);
+	return (it != table.end()) ? it->second : CLCMD_UNKNOWN;
+}
+
+// Returns false if the client ran out of commands and this one has to be dropped
+static bool ClientCommand_CheckRate(CBasePlayer *player)
+{
+	float rate = clientcmdrate.value;
+	float burst = Q_max(clientcmdburst.value, 1.0f);
+	int index = player->entindex();
+
+	if (rate <= 0 || (player->pev->flags & FL_FAKECLIENT) || index < 1 || index > MAX_CLIENTS)
+		return true;
+
+	ClientCommandRate &bucket = g_ClientCommandStats.rate[index];
+	auto now = std::chrono::steady_clock::now();
+
+	if (bucket.last == std::chrono::steady_clock::time_point())
+		bucket.tokens = burst;
+	else
+		bucket.tokens = Q_min(burst, bucket.tokens + rate * std::chrono::duration<float>(now - bucket.last).count());
+
+	bucket.last = now;
+
+	if (bucket.tokens < 1.0f)
+	{
+		if (!bucket.flooding)
+		{
+			bucket.flooding = true;
+			UTIL_LogPrintf("\"%s<%i><%s>\" is flooding commands, dropping them\n", STRING(player->pev->netname), GETPLAYERUSERID(player->edict()), GETPLAYERAUTHID(player->edict()));
+		}
+
+		g_ClientCommandStats.dropped++;
+		return false;
+	}
+
+	bucket.tokens -= 1.0f;
+	bucket.flooding = false;
+	return true;
+}
+
+void ClientCommandStats()
+{
+	int order[CLCMD_COUNT];
+	unsigned int total = 0;
+
+	if (CMD_ARGC() > 1)
+	{
+		if (Q_stricmp(CMD_ARGV(1), "reset"))
+		{
+			ALERT(at_console, "usage: clientcmd_stats [reset]\n");
+			return;
+		}
+
+		Q_memset(g_ClientCommandStats.calls, 0, sizeof(g_ClientCommandStats.calls));
+		g_ClientCommandStats.dropped = 0;
+		return;
+	}
+
+	for (int i = 0; i < CLCMD_COUNT; i++)
+	{
+		order[i] = i;
+		total += g_ClientCommandStats.calls[i];
+	}
+
+	std::sort(order, order + CLCMD_COUNT, [](int a, int b) { return g_ClientCommandStats.calls[a] > g_ClientCommandStats.calls[b]; });
+
+	for (int i = 0; i < CLCMD_COUNT && g_ClientCommandStats.calls[order[i]]; i++)
+		ALERT(at_console, "%-18s %u\n", g_szClientCommands[order[i]], g_ClientCommandStats.calls[order[i]]);
+
+	ALERT(at_console, "%u commands, %u dropped by mp_clientcmdrate\n", total, g_ClientCommandStats.dropped);
+}
+
 // Handles the special "buy" alias commands we're creating to accommodate the buy
 // scripts players use (now that we've rearranged the buy menus and broken the scripts)
 // ** Returns TRUE if we've handled the command **
@@ -2362,8 +2589,10 @@ BOOL HandleBuyAliasCommands(CBasePlayer *pPlayer, const char *pszCommand)
 			}
 		}
 	} else {
+		ClientCommandId cmd = ClientCommand_Lookup(pszCommand);
+
 		// primary ammo
-		if (FStrEq(pszCommand, "primammo")) {
+		if (cmd == CLCMD_PRIMAMMO) {
 			bRetVal = TRUE;
 
 			// Buy as much primary ammo as possible
@@ -2378,7 +2607,7 @@ BOOL HandleBuyAliasCommands(CBasePlayer *pPlayer, const char *pszCommand)
 			}
 		}
 			// secondary ammo
-		else if (FStrEq(pszCommand, "secammo")) {
+		else if (cmd == CLCMD_SECAMMO) {
 			bRetVal = TRUE;
 
 			// Buy as much secondary ammo as possible
@@ -2393,25 +2622,25 @@ BOOL HandleBuyAliasCommands(CBasePlayer *pPlayer, const char *pszCommand)
 			}
 		}
 			// equipment
-		else if (FStrEq(pszCommand, "vest")) {
+		else if (cmd == CLCMD_VEST) {
 			bRetVal = TRUE;
 			BuyItem(pPlayer, MENU_SLOT_ITEM_VEST);
-		} else if (FStrEq(pszCommand, "vesthelm")) {
+		} else if (cmd == CLCMD_VESTHELM) {
 			bRetVal = TRUE;
 			BuyItem(pPlayer, MENU_SLOT_ITEM_VESTHELM);
-		} else if (FStrEq(pszCommand, "flash")) {
+		} else if (cmd == CLCMD_FLASH) {
 			bRetVal = TRUE;
 			BuyItem(pPlayer, MENU_SLOT_ITEM_FLASHGREN);
-		} else if (FStrEq(pszCommand, "hegren")) {
+		} else if (cmd == CLCMD_HEGREN) {
 			bRetVal = TRUE;
 			BuyItem(pPlayer, MENU_SLOT_ITEM_HEGREN);
-		} else if (FStrEq(pszCommand, "sgren")) {
+		} else if (cmd == CLCMD_SGREN) {
 			bRetVal = TRUE;
 			BuyItem(pPlayer, MENU_SLOT_ITEM_SMOKEGREN);
-		} else if (FStrEq(pszCommand, "nvgs")) {
+		} else if (cmd == CLCMD_NVGS) {
 			bRetVal = TRUE;
 			BuyItem(pPlayer, MENU_SLOT_ITEM_NVG);
-		} else if (FStrEq(pszCommand, "defuser")) {
+		} else if (cmd == CLCMD_DEFUSER) {
 			bRetVal = TRUE;
 			if (pPlayer->m_iTeam == CT) {
 				BuyItem(pPlayer, MENU_SLOT_ITEM_DEFUSEKIT);
@@ -2419,7 +2648,7 @@ BOOL HandleBuyAliasCommands(CBasePlayer *pPlayer, const char *pszCommand)
 				// fail gracefully
 				pszFailItem = "#Bomb_Defusal_Kit";
 			}
-		} else if (FStrEq(pszCommand, "shield")) {
+		} else if (cmd == CLCMD_SHIELD) {
 			bRetVal = TRUE;
 			if (pPlayer->m_iTeam == CT) {
 				BuyItem(pPlayer, MENU_SLOT_ITEM_SHIELD);
@@ -2440,74 +2669,18 @@ BOOL HandleBuyAliasCommands(CBasePlayer *pPlayer, const char *pszCommand)
 
 BOOL HandleRadioAliasCommands(CBasePlayer *pPlayer, const char *pszCommand)
 {
-	BOOL bRetVal = FALSE;
-
-	if (FStrEq(pszCommand, "coverme")) {
-		bRetVal = TRUE;
-		Radio1(pPlayer, 1);
-	} else if (FStrEq(pszCommand, "takepoint")) {
-		bRetVal = TRUE;
-		Radio1(pPlayer, 2);
-	} else if (FStrEq(pszCommand, "holdpos")) {
-		bRetVal = TRUE;
-		Radio1(pPlayer, 3);
-	} else if (FStrEq(pszCommand, "regroup")) {
-		bRetVal = TRUE;
-		Radio1(pPlayer, 4);
-	} else if (FStrEq(pszCommand, "followme")) {
-		bRetVal = TRUE;
-		Radio1(pPlayer, 5);
-	} else if (FStrEq(pszCommand, "takingfire")) {
-		bRetVal = TRUE;
-		Radio1(pPlayer, 6);
-	} else if (FStrEq(pszCommand, "go")) {
-		bRetVal = TRUE;
-		Radio2(pPlayer, 1);
-	} else if (FStrEq(pszCommand, "fallback")) {
-		bRetVal = TRUE;
-		Radio2(pPlayer, 2);
-	} else if (FStrEq(pszCommand, "sticktog")) {
-		bRetVal = TRUE;
-		Radio2(pPlayer, 3);
-	} else if (FStrEq(pszCommand, "getinpos")) {
-		bRetVal = TRUE;
-		Radio2(pPlayer, 4);
-	} else if (FStrEq(pszCommand, "stormfront")) {
-		bRetVal = TRUE;
-		Radio2(pPlayer, 5);
-	} else if (FStrEq(pszCommand, "report")) {
-		bRetVal = TRUE;
-		Radio2(pPlayer, 6);
-	} else if (FStrEq(pszCommand, "roger")) {
-		bRetVal = TRUE;
-		Radio3(pPlayer, 1);
-	} else if (FStrEq(pszCommand, "enemyspot")) {
-		bRetVal = TRUE;
-		Radio3(pPlayer, 2);
-	} else if (FStrEq(pszCommand, "needbackup")) {
-		bRetVal = TRUE;
-		Radio3(pPlayer, 3);
-	} else if (FStrEq(pszCommand, "sectorclear")) {
-		bRetVal = TRUE;
-		Radio3(pPlayer, 4);
-	} else if (FStrEq(pszCommand, "inposition")) {
-		bRetVal = TRUE;
-		Radio3(pPlayer, 5);
-	} else if (FStrEq(pszCommand, "reportingin")) {
-		bRetVal = TRUE;
-		Radio3(pPlayer, 6);
-	} else if (FStrEq(pszCommand, "getout")) {
-		bRetVal = TRUE;
-		Radio3(pPlayer, 7);
-	} else if (FStrEq(pszCommand, "negative")) {
-		bRetVal = TRUE;
-		Radio3(pPlayer, 8);
-	} else if (FStrEq(pszCommand, "enemydown")) {
-		bRetVal = TRUE;
-		Radio3(pPlayer, 9);
-	}
+	ClientCommandId cmd = ClientCommand_Lookup(pszCommand);
+
+	if (cmd >= CLCMD_COVERME && cmd <= CLCMD_TAKINGFIRE)
+		Radio1(pPlayer, cmd - CLCMD_COVERME + 1);
+	else if (cmd >= CLCMD_GO && cmd <= CLCMD_REPORT)
+		Radio2(pPlayer, cmd - CLCMD_GO + 1);
+	else if (cmd >= CLCMD_ROGER && cmd <= CLCMD_ENEMYDOWN)
+		Radio3(pPlayer, cmd - CLCMD_ROGER + 1);
+	else
+		return FALSE;
 
-	return bRetVal;
+	return TRUE;
 }
 
 // Use CMD_ARGV,  CMD_ARGV, and CMD_ARGC to get pointers the character string command.
@@ -2525,7 +2698,13 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 	entvars_t *pev = &pEntity->v;
 	CBasePlayer *player = GetClassPtr<CBasePlayer>(pev);
 
-	if (FStrEq(pcmd, "say"))
+	if (!ClientCommand_CheckRate(player))
+		return;
+
+	ClientCommandId cmd = ClientCommand_Lookup(pcmd);
+	g_ClientCommandStats.calls[cmd]++;
+
+	if (cmd == CLCMD_SAY)
 	{
 		if (gpGlobals->time >= player->m_flLastCommandTime[0])
 		{
@@ -2533,7 +2712,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 			Host_Say(pEntity, 0);
 		}
 	}
-	else if (FStrEq(pcmd, "inspect"))
+	else if (cmd == CLCMD_INSPECT)
 	{
 		if ((int)CVAR_GET_FLOAT("mp_csgoinspect"))
 		{
@@ -2548,7 +2727,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 			}
 		}
 	}
-	else if (FStrEq(pcmd, "changemodel"))
+	else if (cmd == CLCMD_CHANGEMODEL)
 	{
 		if ((int)CVAR_GET_FLOAT("mp_csgoinspect"))
 		{
@@ -2562,7 +2741,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 			}
 		}
 	}
-	else if (FStrEq(pcmd, "say_team"))
+	else if (cmd == CLCMD_SAY_TEAM)
 	{
 		if (gpGlobals->time >= player->m_flLastCommandTime[1])
 		{
@@ -2570,7 +2749,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 			Host_Say(pEntity, 1);
 		}
 	}
-	else if (FStrEq(pcmd, "fullupdate"))
+	else if (cmd == CLCMD_FULLUPDATE)
 	{
 		if (gpGlobals->time >= player->m_flLastCommandTime[2])
 		{
@@ -2578,7 +2757,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 			player->ForceClientDllUpdate();
 		}
 	}
-	else if (FStrEq(pcmd, "vote"))
+	else if (cmd == CLCMD_VOTE)
 	{
 		if (gpGlobals->time >= player->m_flLastCommandTime[3])
 		{
@@ -2653,7 +2832,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 			}
 		}
 	}
-	else if (FStrEq(pcmd, "listmaps"))
+	else if (cmd == CLCMD_LISTMAPS)
 	{
 		if (gpGlobals->time >= player->m_flLastCommandTime[5])
 		{
@@ -2661,7 +2840,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 			mp->DisplayMaps(player, 0);
 		}
 	}
-	else if (FStrEq(pcmd, "votemap"))
+	else if (cmd == CLCMD_VOTEMAP)
 	{
 		if (gpGlobals->time >= player->m_flLastCommandTime[4])
 		{
@@ -2733,7 +2912,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 			}
 		}
 	}
-	else if (FStrEq(pcmd, "timeleft"))
+	else if (cmd == CLCMD_TIMELEFT)
 	{
 		if (gpGlobals->time > player->m_iTimeCheckAllowed)
 		{
@@ -2772,7 +2951,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 			ClientPrint(player->pev, HUD_PRINTTALK, "#Game_timelimit", UTIL_dtos1(iSeconds), secs);
 		}
 	}
-	else if (FStrEq(pcmd, "listplayers"))
+	else if (cmd == CLCMD_LISTPLAYERS)
 	{
 		if (gpGlobals->time >= player->m_flLastCommandTime[6])
 		{
@@ -2780,7 +2959,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 			ListPlayers(player);
 		}
 	}
-	else if (FStrEq(pcmd, "client_buy_open"))
+	else if (cmd == CLCMD_CLIENT_BUY_OPEN)
 	{
 		if (player->m_iMenu == Menu_OFF)
 		{
@@ -2800,14 +2979,14 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 			MESSAGE_END();
 		}
 	}
-	else if (FStrEq(pcmd, "client_buy_close"))
+	else if (cmd == CLCMD_CLIENT_BUY_CLOSE)
 	{
 		if (player->m_iMenu == Menu_ClientBuy)
 		{
 			player->m_iMenu = Menu_OFF;
 		}
 	}
-	else if (FStrEq(pcmd, "menuselect"))
+	else if (cmd == CLCMD_MENUSELECT)
 	{
 		int slot = Q_atoi(CMD_ARGV_(1));
 
@@ -3129,7 +3308,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 				break;
 		}
 	}
-	else if (FStrEq(pcmd, "chooseteam"))
+	else if (cmd == CLCMD_CHOOSETEAM)
 	{
 		if (player->m_iMenu == Menu_ChooseAppearance)
 		{
@@ -3165,7 +3344,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 			player->m_iMenu = Menu_ChooseTeam;
 		}
 	}
-	else if (FStrEq(pcmd, "showbriefing"))
+	else if (cmd == CLCMD_SHOWBRIEFING)
 	{
 		if (player->m_iMenu == Menu_OFF)
 		{
@@ -3179,7 +3358,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 			}
 		}
 	}
-	else if (FStrEq(pcmd, "ignoremsg"))
+	else if (cmd == CLCMD_IGNOREMSG)
 	{
 		if (player->m_iIgnoreGlobalChat == IGNOREMSG_NONE)
 		{
@@ -3197,12 +3376,12 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 			ClientPrint(player->pev, HUD_PRINTCENTER, "#Accept_All_Messages");
 		}
 	}
-	else if (FStrEq(pcmd, "ignorerad"))
+	else if (cmd == CLCMD_IGNORERAD)
 	{
 		player->m_bIgnoreRadio = !player->m_bIgnoreRadio;
 		ClientPrint(player->pev, HUD_PRINTCENTER, player->m_bIgnoreRadio ? "#Ignore_Radio" : "#Accept_Radio");
 	}
-	else if (FStrEq(pcmd, "become_vip"))
+	else if (cmd == CLCMD_BECOME_VIP)
 	{
 		if (player->m_iJoiningState != JOINED || player->m_iTeam != CT)
 		{
@@ -3212,12 +3391,12 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 
 		mp->AddToVIPQueue(player);
 	}
-	else if (FStrEq(pcmd, "spectate") && (player->pev->flags & FL_PROXY)) // always allow proxies to become a spectator
+	else if (cmd == CLCMD_SPECTATE && (player->pev->flags & FL_PROXY)) // always allow proxies to become a spectator
 	{
 		// clients wants to become a spectator
 		HandleMenu_ChooseTeam(player, MENU_SLOT_TEAM_SPECT);
 	}
-	else if (FStrEq(pcmd, "specmode"))
+	else if (cmd == CLCMD_SPECMODE)
 	{
 		// new spectator mode
 		int mode = Q_atoi(CMD_ARGV_(1));
@@ -3233,12 +3412,12 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 			MESSAGE_END();
 		}
 	}
-	else if (FStrEq(pcmd, "spec_set_ad"))
+	else if (cmd == CLCMD_SPEC_SET_AD)
 	{
 		float val = Q_atof(CMD_ARGV_(1));
 		player->SetObserverAutoDirector(val > 0.0f);
 	}
-	else if (FStrEq(pcmd, "follownext"))
+	else if (cmd == CLCMD_FOLLOWNEXT)
 	{
 		// follow next player
 		int arg = Q_atoi(CMD_ARGV_(1));
@@ -3248,7 +3427,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 			player->Observer_FindNextPlayer(arg != 0);
 		}
 	}
-	else if (FStrEq(pcmd, "follow"))
+	else if (cmd == CLCMD_FOLLOW)
 	{
 		if (player->IsObserver() && player->CanSwitchObserverModes())
 		{
@@ -3266,11 +3445,11 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 				return;
 		}
 
-		if (FStrEq(pcmd, "mp_debug"))
+		if (cmd == CLCMD_MP_DEBUG)
 		{
 			UTIL_SetDprintfFlags(CMD_ARGV_(1));
 		}
-		else if (FStrEq(pcmd, "jointeam"))
+		else if (cmd == CLCMD_JOINTEAM)
 		{
 			if (player->m_iMenu == Menu_ChooseAppearance)
 			{
@@ -3298,7 +3477,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 				player->m_iMenu = Menu_ChooseTeam;
 			}
 		}
-		else if (FStrEq(pcmd, "joinclass"))
+		else if (cmd == CLCMD_JOINCLASS)
 		{
 			int slot = Q_atoi(CMD_ARGV_(1));
 
@@ -3312,7 +3491,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 		}
 		else if (player->pev->deadflag == DEAD_NO)
 		{
-			if (FStrEq(pcmd, "nightvision"))
+			if (cmd == CLCMD_NIGHTVISION)
 			{
 				if (gpGlobals->time >= player->m_flLastCommandTime[7])
 				{
@@ -3375,23 +3554,23 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 					}
 				}
 			}
-			else if (FStrEq(pcmd, "radio1"))
+			else if (cmd == CLCMD_RADIO1)
 			{
 				ShowMenu(player, (MENU_KEY_1 | MENU_KEY_2 | MENU_KEY_3 | MENU_KEY_4 | MENU_KEY_5 | MENU_KEY_6 | MENU_KEY_0), -1, FALSE, "#RadioA");
 				player->m_iMenu = Menu_Radio1;
 			}
-			else if (FStrEq(pcmd, "radio2"))
+			else if (cmd == CLCMD_RADIO2)
 			{
 				ShowMenu(player, (MENU_KEY_1 | MENU_KEY_2 | MENU_KEY_3 | MENU_KEY_4 | MENU_KEY_5 | MENU_KEY_6 | MENU_KEY_0), -1, FALSE, "#RadioB");
 				player->m_iMenu = Menu_Radio2;
 				return;
 			}
-			else if (FStrEq(pcmd, "radio3"))
+			else if (cmd == CLCMD_RADIO3)
 			{
 				ShowMenu(player, (MENU_KEY_1 | MENU_KEY_2 | MENU_KEY_3 | MENU_KEY_4 | MENU_KEY_5 | MENU_KEY_6 | MENU_KEY_7 | MENU_KEY_8 | MENU_KEY_9 | MENU_KEY_0), -1, FALSE, "#RadioC");
 				player->m_iMenu = Menu_Radio3;
 			}
-			else if (FStrEq(pcmd, "drop"))
+			else if (cmd == CLCMD_DROP)
 			{
 				// player is dropping an item.
 				if (g_pGameRules->ClientCommand(player, "BTE_ZombieSkill1") || player->m_pModStrategy->ClientCommand("BTE_ZombieSkill1"))
@@ -3412,7 +3591,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 				else
 					player->DropPlayerItem(CMD_ARGV_(1));
 			}
-			else if (FStrEq(pcmd, "fov"))
+			else if (cmd == CLCMD_FOV)
 			{
 #if 0
 				if (g_flWeaponCheat && CMD_ARGC() > 1)
@@ -3421,11 +3600,11 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 					CLIENT_PRINTF(pEntity, print_console, UTIL_VarArgs("\"fov\" is \"%d\"\n", (int)GetClassPtr<CBasePlayer>(pev)->m_iFOV));
 #endif
 			}
-			else if (FStrEq(pcmd, "use"))
+			else if (cmd == CLCMD_USE)
 			{
 				GetClassPtr<CBasePlayer>(pev)->SelectItem(CMD_ARGV_(1));
 			}
-			else if (FStrEq(pcmd, "weapon_knife"))
+			else if (cmd == CLCMD_WEAPON_KNIFE)
 			{
 				if (!player->CanHolster())
 					return;
@@ -3455,11 +3634,11 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 			{
 				GetClassPtr<CBasePlayer>(pev)->SelectItem(pcmd);
 			}
-			else if (FStrEq(pcmd, "lastinv"))
+			else if (cmd == CLCMD_LASTINV)
 			{
 				GetClassPtr<CBasePlayer>(pev)->SelectLastItem();
 			}
-			else if (FStrEq(pcmd, "buyammo1"))
+			else if (cmd == CLCMD_BUYAMMO1)
 			{
 				if (player->m_signals.GetState() & SIGNAL_BUY)
 				{
@@ -3472,7 +3651,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 					}
 				}
 			}
-			else if (FStrEq(pcmd, "buyammo2"))
+			else if (cmd == CLCMD_BUYAMMO2)
 			{
 				if (player->m_signals.GetState() & SIGNAL_BUY)
 				{
@@ -3485,7 +3664,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 					}
 				}
 			}
-			else if (FStrEq(pcmd, "buyequip"))
+			else if (cmd == CLCMD_BUYEQUIP)
 			{
 				if (player->m_signals.GetState() & SIGNAL_BUY)
 				{
@@ -3507,7 +3686,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 					player->m_iMenu = Menu_BuyItem;
 				}
 			}
-			else if (FStrEq(pcmd, "buy"))
+			else if (cmd == CLCMD_BUY)
 			{
 				if (player->m_signals.GetState() & SIGNAL_BUY)
 				{
@@ -3523,7 +3702,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 					}
 				}
 			}
-			else if (FStrEq(pcmd, "cl_setautobuy"))
+			else if (cmd == CLCMD_CL_SETAUTOBUY)
 			{
 				player->ClearAutoBuyData();
 
@@ -3537,7 +3716,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 				player->AutoBuy();
 				g_bClientPrintEnable = oldval;
 			}
-			else if (FStrEq(pcmd, "cl_setrebuy"))
+			else if (cmd == CLCMD_CL_SETREBUY)
 			{
 				if (CMD_ARGC_() == 2)
 				{
@@ -3549,7 +3728,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 					g_bClientPrintEnable = oldval;
 				}
 			}
-			else if (FStrEq(pcmd, "cl_autobuy"))
+			else if (cmd == CLCMD_CL_AUTOBUY)
 			{
 				if (player->m_signals.GetState() & SIGNAL_BUY)
 				{
@@ -3559,7 +3738,7 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 					g_bClientPrintEnable = oldval;
 				}
 			}
-			else if (FStrEq(pcmd, "cl_rebuy"))
+			else if (cmd == CLCMD_CL_REBUY)
 			{
 				if (player->m_signals.GetState() & SIGNAL_BUY)
 				{
@@ -3569,16 +3748,16 @@ void EXT_FUNC ClientCommand(edict_t *pEntity)
 					g_bClientPrintEnable = oldval;
 				}
 			}
-			else if (FStrEq(pcmd, "smartradio"))
+			else if (cmd == CLCMD_SMARTRADIO)
 			{
 				player->SmartRadio();
 			}
-			else if (FStrEq(pcmd, "moe_buy"))
+			else if (cmd == CLCMD_MOE_BUY)
 			{
 				MoE_HandleBuyCommands(player, CMD_ARGV_(1));
 			}
 #ifdef XASH_DEDICATED
-			else if (FStrEq(pcmd, "moe_admin"))
+			else if (cmd == CLCMD_MOE_ADMIN)
 			{
 				if (!strcmp(CMD_ARGV_(1), "CPlayerModStrategy_ZB3"))
 					admin::ShowAdminMenu(player);
@@ -4334,10 +4513,75 @@ void EXT_FUNC SpectatorThink(edict_t *pEntity)
 	}
 }
 
+// The engine calls SetupVisibility once per client and then AddToFullPack for every
+// entity, so anything that only depends on the host is worked out here.
+static void SetupFullPackHost(edict_t *host)
+{
+	FULLPACKHOST *fp = &g_FullPackHost;
+
+	fp->host = host;
+	fp->hostnum = ENTINDEX(host) - 1;
+	fp->activeWeapon = WEAPON_NONE;
+	fp->numAlwaysSend = 0;
+
+	if (CheckPlayerPVSLeafChanged(host, fp->hostnum))
+		ResetPlayerPVS(host, fp->hostnum);
+
+	CBasePlayer *pPlayer = (CBasePlayer *)GET_PRIVATE(host);
+
+	if (!pPlayer || !pPlayer->IsPlayer() || !pPlayer->m_pActiveItem)
+		return;
+
+	fp->activeWeapon = pPlayer->m_pActiveItem->m_iId;
+
+	if (fp->activeWeapon == WEAPON_CANNONEX)
+	{
+		CCannonEX *pWeapon = (CCannonEX *)pPlayer->m_pActiveItem;
+
+		// the dragon is sent wherever it is
+		if (pWeapon->m_pDragon)
+			fp->alwaysSend[fp->numAlwaysSend++] = pWeapon->m_pDragon->edict();
+	}
+}
+
+void FullPackStats()
+{
+	if (CMD_ARGC() > 1)
+	{
+		const char *arg = CMD_ARGV(1);
+
+		if (!Q_stricmp(arg, "on"))
+			g_FullPackProfile.enabled = true;
+		else if (!Q_stricmp(arg, "off"))
+			g_FullPackProfile.enabled = false;
+		else if (Q_stricmp(arg, "reset"))
+		{
+			ALERT(at_console, "usage: fullpack_stats [on|off|reset]\n");
+			return;
+		}
+
+		g_FullPackProfile.calls = g_FullPackProfile.sent = 0;
+		g_FullPackProfile.time = {};
+		return;
+	}
+
+	if (!g_FullPackProfile.calls)
+	{
+		ALERT(at_console, "AddToFullPack profiling is %s, no calls recorded\n", g_FullPackProfile.enabled ? "on" : "off");
+		return;
+	}
+
+	ALERT(at_console, "AddToFullPack: %u calls, %u sent (%.1f%%), %.1f ns/call\n",
+		g_FullPackProfile.calls, g_FullPackProfile.sent, g_FullPackProfile.sent * 100.0 / g_FullPackProfile.calls,
+		(double)g_FullPackProfile.time.count() / g_FullPackProfile.calls);
+}
+
 void EXT_FUNC SetupVisibility(edict_t *pViewEntity, edict_t *pClient, unsigned char **pvs, unsigned char **pas)
 {
 	edict_t *pView = pClient;
 
+	SetupFullPackHost(pClient);
+
 	// Find the client's PVS
 	if (pViewEntity)
 	{
@@ -4427,7 +4671,7 @@ bool CheckEntityRecentlyInPVS(int clientnum, int entitynum, time_point_t current
 	return false;
 }
 
-int EXT_FUNC AddToFullPack (struct entity_state_s *state, int e, edict_t *ent, edict_t *host, int hostflags, int player, unsigned char *pSet)
+static int AddToFullPack_Internal(struct entity_state_s *state, int e, edict_t *ent, edict_t *host, int hostflags, int player, unsigned char *pSet)
 {
    if ((ent->v.effects & EF_NODRAW) == EF_NODRAW && ent != host)
       return 0;
@@ -4439,30 +4683,21 @@ int EXT_FUNC AddToFullPack (struct entity_state_s *state, int e, edict_t *ent, e
       return 0;
 
    int i;
-   int hostnum = ENTINDEX (host) - 1;
 
-   if (CheckPlayerPVSLeafChanged (host, hostnum))
-      ResetPlayerPVS (host, hostnum);
+   if (g_FullPackHost.host != host)
+      SetupFullPackHost (host);
 
-   CBasePlayer* pPlayer = (CBasePlayer*)GET_PRIVATE(host);
+   const int hostnum = g_FullPackHost.hostnum;
 
-   if (pPlayer && pPlayer->IsPlayer())
+   for (i = 0; i < g_FullPackHost.numAlwaysSend; ++i)
    {
-	   if (pPlayer->m_pActiveItem)
-	   {
-		   if (!Q_strcmp(STRING(pPlayer->m_pActiveItem->pev->classname), "weapon_cannonex"))
-		   {
-			   CCannonEX* pWeapon = (CCannonEX*)pPlayer->m_pActiveItem;
-
-			   if (pWeapon && pWeapon->m_pDragon)
-			   {
-				   if (GET_PRIVATE(ent) == pWeapon->m_pDragon)
-					   goto SEND_ENTITY;
-			   }
-		   }
-	   }
+      if (g_FullPackHost.alwaysSend[i] == ent)
+         goto SEND_ENTITY;
    }
 
+   if ((ent->v.flags & FL_SKIPLOCALHOST) == FL_SKIPLOCALHOST && (hostflags & 1) && ent->v.owner == host)
+      return 0;
+
    if (ent != host)
    {
       if (!CheckEntityRecentlyInPVS (hostnum, e, gpGlobals->time))
@@ -4477,9 +4712,6 @@ int EXT_FUNC AddToFullPack (struct entity_state_s *state, int e, edict_t *ent, e
       }
    }
 
-   if ((ent->v.flags & FL_SKIPLOCALHOST) == FL_SKIPLOCALHOST && (hostflags & 1) && ent->v.owner == host)
-      return 0;
-
    if (host->v.groupinfo)
    {
       UTIL_SetGroupTrace (host->v.groupinfo, GROUP_OP_AND);
@@ -4589,6 +4821,21 @@ int EXT_FUNC AddToFullPack (struct entity_state_s *state, int e, edict_t *ent, e
    return 1;
 }
 
+int EXT_FUNC AddToFullPack(struct entity_state_s *state, int e, edict_t *ent, edict_t *host, int hostflags, int player, unsigned char *pSet)
+{
+	if (!g_FullPackProfile.enabled)
+		return AddToFullPack_Internal(state, e, ent, host, hostflags, player, pSet);
+
+	auto start = std::chrono::steady_clock::now();
+	int result = AddToFullPack_Internal(state, e, ent, host, hostflags, player, pSet);
+
+	g_FullPackProfile.time += std::chrono::steady_clock::now() - start;
+	g_FullPackProfile.calls++;
+	g_FullPackProfile.sent += result;
+
+	return result;
+}
+
 // Creates baselines used for network encoding, especially for player data since players are not spawned until connect time.
 
 void EXT_FUNC CreateBaseline(int player, int eindex, struct entity_state_s *baseline, struct edict_s *entity, int playermodelindex, Vector player_mins, Vector player_maxs)
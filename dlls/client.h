@@ -180,6 +180,8 @@ void ResetPlayerPVS(edict_t *client, int clientnum);
 bool CheckPlayerPVSLeafChanged(edict_t *client, int clientnum);
 void MarkEntityInPVS(int clientnum, int entitynum, time_point_t time, bool inpvs);
 bool CheckEntityRecentlyInPVS(int clientnum, int entitynum, float currenttime);
+void FullPackStats();
+void ClientCommandStats();
 int AddToFullPack(struct entity_state_s *state, int e, edict_t *ent, edict_t *host, int hostflags, int player,
                   unsigned char *pSet);
 void
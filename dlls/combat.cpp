@@ -1072,6 +1072,14 @@ static float CalculateDamageRate(Vector vecSrc, CBaseEntity* pOther)
 	return rate;
 }
 
+// RadiusDamage_Hit - blast damage on one victim, inflicted together with the rest of the blast
+static void RadiusDamage_Hit(CBaseEntity *pEntity, entvars_t *pevInflictor, entvars_t *pevAttacker, float flDamage, int bitsDamageType)
+{
+	ClearMultiDamage();
+	AddMultiDamage(pevAttacker, pEntity, flDamage, bitsDamageType);
+	ApplyMultiDamage(pevInflictor, pevAttacker);
+}
+
 void RadiusDamage(Vector vecSrc, entvars_t *pevInflictor, entvars_t *pevAttacker, float flDamage, float flRadius,
                   int iClassIgnore, int bitsDamageType)
 {
@@ -1093,6 +1101,9 @@ void RadiusDamage(Vector vecSrc, entvars_t *pevInflictor, entvars_t *pevAttacker
 	if (!pevAttacker)
 		pevAttacker = pevInflictor;
 
+	// victims take the blast once the sweep is done
+	BeginMultiDamageBatch();
+
 	// iterate on all entities in the vicinity.
 	while ((pEntity = UTIL_FindEntityInSphere(pEntity, vecSrc, flRadius)) != NULL) {
 		if (pEntity->pev->takedamage != DAMAGE_NO) {
@@ -1132,9 +1143,11 @@ void RadiusDamage(Vector vecSrc, entvars_t *pevInflictor, entvars_t *pevAttacker
 			if (flAdjustedDamage < 0)
 				flAdjustedDamage = 0;
 
-			pEntity->TakeDamage(pevInflictor, pevAttacker, flAdjustedDamage, bitsDamageType);
+			RadiusDamage_Hit(pEntity, pevInflictor, pevAttacker, flAdjustedDamage, bitsDamageType);
 		}
 	}
+
+	EndMultiDamageBatch();
 }
 
 void RadiusDamage2(Vector vecSrc, entvars_t *pevInflictor, entvars_t *pevAttacker, float flDamage, float flRadius,
@@ -1157,6 +1170,8 @@ void RadiusDamage2(Vector vecSrc, entvars_t *pevInflictor, entvars_t *pevAttacke
 	if (!pevAttacker)
 		pevAttacker = pevInflictor;
 
+	BeginMultiDamageBatch();
+
 	while ((pEntity = UTIL_FindEntityInSphere(pEntity, vecSrc, flRadius)) != NULL) {
 		if (pEntity->pev->takedamage != DAMAGE_NO) {
 			if (iClassIgnore != CLASS_NONE && pEntity->Classify() == iClassIgnore)
@@ -1186,7 +1201,7 @@ void RadiusDamage2(Vector vecSrc, entvars_t *pevInflictor, entvars_t *pevAttacke
 					flAdjustedDamage = 75;
 
 				if (tr.flFraction == 1.0f)
-					pEntity->TakeDamage(pevInflictor, pevAttacker, flAdjustedDamage, bitsDamageType);
+					RadiusDamage_Hit(pEntity, pevInflictor, pevAttacker, flAdjustedDamage, bitsDamageType);
 
 				else {
 					ClearMultiDamage();
@@ -1197,6 +1212,8 @@ void RadiusDamage2(Vector vecSrc, entvars_t *pevInflictor, entvars_t *pevAttacke
 			}
 		}
 	}
+
+	EndMultiDamageBatch();
 }
 
 void AddKickRate(CBaseEntity* pEntity, Vector vecSrc, float amount, float boost)		//can be zs npc
@@ -1230,6 +1247,10 @@ void RadiusDamage3(Vector vecSrc, entvars_t* pevInflictor, entvars_t* pevAttacke
 	if (!pevAttacker)
 		pevAttacker = pevInflictor;
 
+	// knockback below must follow the damage of its own victim
+	if (!ExtraKnockBack)
+		BeginMultiDamageBatch();
+
 	// iterate on all entities in the vicinity.
 	while ((pEntity = UTIL_FindEntityInSphere(pEntity, vecSrc, flRadius)) != NULL) {
 		if (pEntity->pev->takedamage != DAMAGE_NO) {
@@ -1294,7 +1315,7 @@ void RadiusDamage3(Vector vecSrc, entvars_t* pevInflictor, entvars_t* pevAttacke
 						ApplyMultiDamage(pevInflictor, pevAttacker);
 					}
 					else if(canheadshot == -1)	//like balrog11cannon
-						pEntity->TakeDamage(pevInflictor, pevAttacker, flAdjustedDamage, bitsDamageType);
+						RadiusDamage_Hit(pEntity, pevInflictor, pevAttacker, flAdjustedDamage, bitsDamageType);
 					else
 					{
 						//can headshot with traceline like knife_lance
@@ -1389,6 +1410,9 @@ void RadiusDamage3(Vector vecSrc, entvars_t* pevInflictor, entvars_t* pevAttacke
 			}
 		}
 	}
+
+	if (!ExtraKnockBack)
+		EndMultiDamageBatch();
 }
 
 bool RadiusDamage4(Vector vecSrc, entvars_t* pevInflictor, entvars_t* pevAttacker, float flDamage, float flRadius, int iClassIgnore, int bitsDamageType)
@@ -2157,8 +2181,10 @@ CBaseEntity::FireBullets3(Vector vecSrc, Vector vecDirShooting, float vecSpread,
 
 	float flDamageModifier = 0.5;
 
+	// every victim along the bullet path is damaged once it stops
+	ClearMultiDamage();
+
 	while (iPenetration != 0) {
-		ClearMultiDamage();
 		UTIL_TraceLine(vecSrc, vecEnd, dont_ignore_monsters, ENT(pev), &tr);
 
 		if (TheBots != NULL && tr.flFraction != 1.0f) {
@@ -2312,10 +2338,10 @@ CBaseEntity::FireBullets3(Vector vecSrc, Vector vecDirShooting, float vecSpread,
 			iCurrentDamage *= flDamageModifier;
 		} else
 			iPenetration = 0;
-
-		ApplyMultiDamage(pev, pevAttacker);
 	}
 
+	ApplyMultiDamage(pev, pevAttacker);
+
 	return Vector(x * vecSpread, y * vecSpread, 0);
 }
 
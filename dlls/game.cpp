@@ -107,6 +107,9 @@ cvar_t votemap_enabled = { "mp_votemap_enabled", "1", FCVAR_SERVER, 0.0f, NULL }
 cvar_t votemap_tally_delay_time = { "mp_votemap_tally_delay_time", "15", FCVAR_SERVER, 0.0f, NULL }; // Delay between when vote starts and when votes are tallied. (Default: 15)
 cvar_t votemap_type = { "mp_votemap_type", "0", FCVAR_SERVER, 0.0f, NULL }; // 0-default 1-extend
 
+cvar_t clientcmdrate = { "mp_clientcmdrate", "40", 0, 0.0f, NULL }; // commands per second a client may send, 0 disables the limit
+cvar_t clientcmdburst = { "mp_clientcmdburst", "120", 0, 0.0f, NULL }; // commands a client may send at once (buy scripts)
+
 extern void Bot_RegisterCvars();
 extern void Tutor_RegisterCVars();
 extern void Hostage_RegisterCVars();
@@ -174,6 +177,9 @@ void EXT_FUNC GameDLLInit()
 	CVAR_REGISTER(&votemap_tally_delay_time);
 	CVAR_REGISTER(&votemap_type);
 
+	CVAR_REGISTER(&clientcmdrate);
+	CVAR_REGISTER(&clientcmdburst);
+
 	Bot_RegisterCvars();
 	Tutor_RegisterCVars();
 	Hostage_RegisterCVars();
@@ -140,6 +140,9 @@ extern cvar_t votemap_enabled;
 extern cvar_t votemap_tally_delay_time;
 extern cvar_t votemap_type;
 
+extern cvar_t clientcmdrate;
+extern cvar_t clientcmdburst;
+
 void GameDLLInit();
 
 }
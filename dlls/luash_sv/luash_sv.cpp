@@ -34,6 +34,9 @@ namespace sv
 
 	void LuaSV_Init()
 	{
+		// overrides from a previous state are gone with it
+		MoE_ClearLuaEntities();
+
 		L = luaL_newstate();
         luaL_openlibs(L);
 
@@ -37,6 +37,9 @@ namespace cl {
 		lua_pushvalue(L, 2); // #4 = #2
 		assert(!lua_isnil(L, 2));
 		lua_setfield(L, -2, classname); // #3
+#ifndef CLIENT_DLL
+		MoE_RegisterLuaEntity(classname);
+#endif
 		return 0;
 	}
 
@@ -844,6 +844,10 @@ CHalfLifeMultiplay::CHalfLifeMultiplay()
 		}
 		ADD_SERVER_COMMAND("perf_test", loopPerformance);
 		ADD_SERVER_COMMAND("print_ent", printEntities);
+		ADD_SERVER_COMMAND("entity_classstats", EntityClassStats_Dump);
+		ADD_SERVER_COMMAND("fullpack_stats", FullPackStats);
+		ADD_SERVER_COMMAND("clientcmd_stats", ClientCommandStats);
+		ADD_SERVER_COMMAND("multidamage_bench", MultiDamage_Benchmark);
 
 #ifdef XASH_DEDICATED
 		ADD_SERVER_COMMAND("update_tips", SV_Update_Tips_f);
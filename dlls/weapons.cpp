@@ -15,6 +15,9 @@
 #include "bot_include.h"
 #include "player/player_mod_strategy.h"
 
+#include <chrono>
+#include <vector>
+
 namespace sv {
 
 /*
@@ -115,45 +118,262 @@ int MaxAmmoCarry(int iszName)
 }
 
 // ClearMultiDamage - resets the global multi damage accumulator
+// victims already applied inside a batch are kept
 
 void ClearMultiDamage()
 {
+	gMultiDamage.count = gMultiDamage.applied;
 	gMultiDamage.pEntity = NULL;
 	gMultiDamage.amount = 0;
 	gMultiDamage.type = 0;
 }
 
-// ApplyMultiDamage - inflicts contents of global multi damage register on gMultiDamage.pEntity
+// MultiDamage_Flush - inflicts every applied victim, in the order they were first hit
+
+static void MultiDamage_Flush()
+{
+	MULTIDAMAGEVICTIM victims[MAX_MULTIDAMAGE_VICTIMS];
+	int count = gMultiDamage.applied;
+	int i;
+
+	// TakeDamage may start a new multi damage of its own (explosions on death)
+	for (i = 0; i < count; i++)
+		victims[i] = gMultiDamage.victims[i];
+
+	for (i = count; i < gMultiDamage.count; i++)
+		gMultiDamage.victims[i - count] = gMultiDamage.victims[i];
+
+	gMultiDamage.count -= count;
+	gMultiDamage.applied = 0;
+
+	for (i = 0; i < count; i++)
+	{
+		CBaseEntity *pEntity = victims[i].hEntity;
+
+		if (!pEntity)
+			continue;
+
+		pEntity->m_LastHitGroup = victims[i].hitgroup;
+		gMultiDamage.takedamage++;
+		pEntity->TakeDamage(victims[i].pevInflictor, victims[i].pevAttacker, victims[i].amount, victims[i].type);
+	}
+}
+
+// ApplyMultiDamage - inflicts contents of global multi damage register on every victim,
+// or holds them until EndMultiDamageBatch, merged with earlier hits of the same attacker
 
 void ApplyMultiDamage(entvars_t *pevInflictor, entvars_t *pevAttacker)
 {
-	//Vector vecSpot1;//where blood comes from
-	//Vector vecDir;//direction blood should go
-	//TraceResult tr;
+	int applied = gMultiDamage.applied;
 
-	if (!gMultiDamage.pEntity)
-		return;
+	for (int i = gMultiDamage.applied; i < gMultiDamage.count; i++)
+	{
+		MULTIDAMAGEVICTIM *victim = &gMultiDamage.victims[i];
+		int j;
+
+		victim->pevInflictor = pevInflictor;
+		victim->pevAttacker = pevAttacker;
+		victim->type |= gMultiDamage.type;
+
+		for (j = 0; j < applied; j++)
+		{
+			MULTIDAMAGEVICTIM *other = &gMultiDamage.victims[j];
+
+			if (other->hEntity.Get() == victim->hEntity.Get() && other->pevInflictor == pevInflictor && other->pevAttacker == pevAttacker)
+			{
+				other->amount += victim->amount;
+				other->type |= victim->type;
+				other->hitgroup = victim->hitgroup;
+				break;
+			}
+		}
 
-	gMultiDamage.pEntity->TakeDamage(pevInflictor, pevAttacker, gMultiDamage.amount, gMultiDamage.type);
+		if (j == applied)
+			gMultiDamage.victims[applied++] = *victim;
+	}
 
+	gMultiDamage.count = gMultiDamage.applied = applied;
+
+	if (!gMultiDamage.batch)
+		MultiDamage_Flush();
 }
 
 void AddMultiDamage(entvars_t *pevInflictor, CBaseEntity *pEntity, float flDamage, int bitsDamageType)
 {
+	MULTIDAMAGEVICTIM *victim = NULL;
+
 	if (!pEntity)
 		return;
 
 	gMultiDamage.type |= bitsDamageType;
+	gMultiDamage.hits++;
+
+	for (int i = gMultiDamage.applied; i < gMultiDamage.count; i++)
+	{
+		if (gMultiDamage.victims[i].hEntity == pEntity)
+		{
+			victim = &gMultiDamage.victims[i];
+			break;
+		}
+	}
 
-	if (pEntity != gMultiDamage.pEntity)
+	if (!victim)
 	{
-		// UNDONE: wrong attacker!
-		ApplyMultiDamage(pevInflictor, pevInflictor);
-		gMultiDamage.pEntity = pEntity;
-		gMultiDamage.amount = 0;
+		if (gMultiDamage.count == MAX_MULTIDAMAGE_VICTIMS)
+		{
+			// register is full
+			// UNDONE: wrong attacker!
+			ApplyMultiDamage(pevInflictor, pevInflictor);
+			MultiDamage_Flush();
+		}
+
+		victim = &gMultiDamage.victims[gMultiDamage.count++];
+		victim->hEntity = pEntity;
+		victim->pevInflictor = victim->pevAttacker = NULL;
+		victim->amount = 0;
+		victim->type = 0;
+	}
+
+	victim->amount += flDamage;
+	victim->type |= bitsDamageType;
+	victim->hitgroup = pEntity->m_LastHitGroup;
+
+	gMultiDamage.pEntity = pEntity;
+	gMultiDamage.amount = victim->amount;
+}
+
+// BeginMultiDamageBatch - holds applied damage until the matching EndMultiDamageBatch,
+// so a victim hit by many pellets or blasts takes it as a single TakeDamage
+
+void BeginMultiDamageBatch()
+{
+	gMultiDamage.batch++;
+}
+
+void EndMultiDamageBatch()
+{
+	if (gMultiDamage.batch > 0 && !--gMultiDamage.batch)
+		MultiDamage_Flush();
+}
+
+// MultiDamage_Benchmark - multidamage_bench [shooters] [targets] [pellets] [rounds]
+// hits a crowd of targets with shotgun volleys and grenades:
+// - "old rule" replays the single victim register, a victim change inflicts the previous one
+// - "per volley" applies once per volley, as FireBullets3 does without a batch
+// - "batched" holds every volley of a round in one batch
+// - "RadiusDamage" throws a grenade per shooter through the real blast code
+
+#define MULTIDAMAGE_BENCH_PASSES	4
+
+static const char *s_szMultiDamageBenchPass[MULTIDAMAGE_BENCH_PASSES] = { "old rule", "per volley", "batched", "RadiusDamage" };
+
+void MultiDamage_Benchmark()
+{
+	int shooters = (CMD_ARGC() > 1) ? Q_atoi(CMD_ARGV(1)) : 32;
+	int targets = (CMD_ARGC() > 2) ? Q_atoi(CMD_ARGV(2)) : 64;
+	int pellets = (CMD_ARGC() > 3) ? Q_atoi(CMD_ARGV(3)) : 9;
+	int rounds = (CMD_ARGC() > 4) ? Q_atoi(CMD_ARGV(4)) : 100;
+	std::vector<CBaseEntity *> crowd;
+	TraceResult tr;
+
+	// far below any playable area, so the grenades can't reach real players
+	const Vector vecCrowd(0, 0, -8000);
+	const float flBlastRadius = 64;
+
+	if (shooters <= 0 || targets <= 0 || pellets <= 0 || rounds <= 0 || gMultiDamage.batch)
+	{
+		ALERT(at_console, "usage: multidamage_bench [shooters] [targets] [pellets] [rounds]\n");
+		return;
+	}
+
+	for (int i = 0; i < targets; i++)
+	{
+		CBaseEntity *pTarget = CBaseEntity::Create("info_target", g_vecZero, g_vecZero);
+
+		if (!pTarget)
+			break;
+
+		// packed inside the blast radius
+		UTIL_SetOrigin(pTarget->pev, vecCrowd + Vector(i % 4 * 8, i / 4 % 4 * 8, i / 16 * 8 % 32));
+		crowd.push_back(pTarget);
+	}
+
+	if (crowd.empty())
+		return;
+
+	Q_memset(&tr, 0, sizeof(tr));
+
+	for (int pass = 0; pass < MULTIDAMAGE_BENCH_PASSES; pass++)
+	{
+		// nobody may die during the run, a dead target stops taking damage
+		for (CBaseEntity *pTarget : crowd)
+		{
+			pTarget->pev->health = 1e9f;
+			pTarget->pev->takedamage = DAMAGE_YES;
+			pTarget->pev->deadflag = DEAD_NO;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+
+		gMultiDamage.hits = gMultiDamage.takedamage = 0;
+
+		for (int round = 0; round < rounds; round++)
+		{
+			if (pass == 2)
+				BeginMultiDamageBatch();
+
+			for (int shooter = 0; shooter < shooters; shooter++)
+			{
+				entvars_t *pevShooter = crowd[shooter % crowd.size()]->pev;
+				CBaseEntity *pLast = NULL;
+
+				if (pass == 3)
+				{
+					RadiusDamage(vecCrowd, pevShooter, pevShooter, 100, flBlastRadius, CLASS_NONE, DMG_BLAST);
+					continue;
+				}
+
+				ClearMultiDamage();
+
+				// a volley spreads over a few neighbours
+				for (int pellet = 0; pellet < pellets; pellet++)
+				{
+					CBaseEntity *pTarget = crowd[(shooter * 2 + pellet % 3) % crowd.size()];
+
+					// the old register held one victim, hitting another one inflicted it
+					if (pass == 0 && pLast && pTarget != pLast)
+					{
+						ApplyMultiDamage(pevShooter, pevShooter);
+						ClearMultiDamage();
+					}
+
+					tr.pHit = pTarget->edict();
+					tr.iHitgroup = HITGROUP_HEAD + pellet % 7;
+					pTarget->TraceAttack(pevShooter, 1, g_vecZero, &tr, DMG_BULLET);
+					pLast = pTarget;
+				}
+
+				ApplyMultiDamage(pevShooter, pevShooter);
+			}
+
+			if (pass == 2)
+				EndMultiDamageBatch();
+		}
+
+		auto time = std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(std::chrono::steady_clock::now() - start);
+
+		if (!gMultiDamage.hits)
+		{
+			ALERT(at_console, "%s: no hits, the targets can't take damage\n", s_szMultiDamageBenchPass[pass]);
+			break;
+		}
+
+		ALERT(at_console, "%s: %d hits, %d TakeDamage calls, %.1f us per round\n", s_szMultiDamageBenchPass[pass],
+			gMultiDamage.hits, gMultiDamage.takedamage, time.count() / rounds);
 	}
 
-	gMultiDamage.amount += flDamage;
+	for (CBaseEntity *pTarget : crowd)
+		UTIL_Remove(pTarget);
 }
 
 void SpawnBlood(Vector vecSpot, int bloodColor, float flDamage)
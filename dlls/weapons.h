@@ -134,11 +134,32 @@ struct AmmoInfo
 #ifndef CLIENT_DLL
 namespace sv {
 
-struct MULTIDAMAGE
+#define MAX_MULTIDAMAGE_VICTIMS	64
+
+// one victim waiting in the multi damage register
+struct MULTIDAMAGEVICTIM
 {
-	CBaseEntity *pEntity;
+	EHANDLE hEntity;
+	entvars_t *pevInflictor;	// NULL until ApplyMultiDamage
+	entvars_t *pevAttacker;
 	float amount;
 	int type;
+	int hitgroup;
+};
+
+struct MULTIDAMAGE
+{
+	CBaseEntity *pEntity;	// victim of the last AddMultiDamage
+	float amount;		// accumulated on pEntity
+	int type;
+
+	int count;
+	int applied;	// victims before this one wait for EndMultiDamageBatch
+	int batch;	// BeginMultiDamageBatch depth
+	MULTIDAMAGEVICTIM victims[MAX_MULTIDAMAGE_VICTIMS];
+
+	int hits;	// AddMultiDamage calls, see multidamage_bench
+	int takedamage;	// TakeDamage calls
 };
 
 template<> struct PrivateData<class CArmoury, CBaseEntity>
@@ -1158,6 +1179,9 @@ BOOL CanAttack(float attack_time, float curtime, BOOL isPredicted);
 extern void ClearMultiDamage(void);
 extern void ApplyMultiDamage(entvars_t *pevInflictor, entvars_t *pevAttacker);
 extern void AddMultiDamage(entvars_t *pevInflictor, CBaseEntity *pEntity, float flDamage, int bitsDamageType);
+extern void BeginMultiDamageBatch(void);
+extern void EndMultiDamageBatch(void);
+extern void MultiDamage_Benchmark(void);
 extern void DecalGunshot(TraceResult *pTrace, int iBulletType, bool ClientOnly, entvars_t *pShooter, bool bHitMetal);
 extern void SpawnBlood(Vector vecSpot, int bloodColor, float flDamage);
 extern int DamageDecal(CBaseEntity *pEntity, int bitsDamageType);
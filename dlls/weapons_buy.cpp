@@ -7,6 +7,10 @@
 #include "client.h"
 #include "weapons_moe_buy.h"
 
+#include <cctype>
+#include <string>
+#include <unordered_map>
+
 namespace sv {
 
 /*
@@ -601,33 +605,53 @@ DLL_GLOBAL WeaponInfoStruct weaponInfo[] =
 	{ 0,			0,			0,			0,			0,			0,			-1,			NULL }
 };
 
-// Given an alias, return the associated weapon ID
-DLL_GLOBAL WeaponIdType AliasToWeaponID(const char *alias)
+static std::string WeaponAliasKey(const char *alias)
+{
+	std::string key(alias);
+
+	for (char &c : key)
+		c = (char)tolower((unsigned char)c);
+
+	return key;
+}
+
+// The alias tables are searched for every buy command and autobuy entry, index
+// each one once by lowercase alias. The first entry wins, as the linear search did.
+template<typename T>
+static const T *FindWeaponAlias(const T *table, const char *alias)
 {
-	if (alias != NULL)
+	static const std::unordered_map<std::string, const T *> index = [table]()
 	{
-		for (int i = 0; weaponAliasInfo[i].alias != NULL; ++i)
-		{
-			if (!Q_stricmp(weaponAliasInfo[i].alias, alias))
-				return weaponAliasInfo[i].id;
-		}
-	}
+		std::unordered_map<std::string, const T *> aliases;
+
+		for (int i = 0; table[i].alias != NULL; ++i)
+			aliases.emplace(WeaponAliasKey(table[i].alias), &table[i]);
 
-	return WEAPON_NONE;
+		return aliases;
+	}();
+
+	if (alias == NULL)
+		return NULL;
+
+	auto it = index.find(WeaponAliasKey(alias));
+	return (it != index.end()) ? it->second : NULL;
+}
+
+// Given an alias, return the associated weapon ID
+DLL_GLOBAL WeaponIdType AliasToWeaponID(const char *alias)
+{
+	const WeaponAliasInfo *info = FindWeaponAlias(weaponAliasInfo, alias);
+	return info ? info->id : WEAPON_NONE;
 }
 
 const char *BuyAliasToWeaponID(const char *alias, WeaponIdType &id)
 {
-	if (alias)
+	const WeaponBuyAliasInfo *info = FindWeaponAlias(weaponBuyAliasInfo, alias);
+
+	if (info)
 	{
-		for (int i = 0; weaponBuyAliasInfo[i].alias != NULL; ++i)
-		{
-			if (!Q_stricmp(weaponBuyAliasInfo[i].alias, alias))
-			{
-				id = weaponBuyAliasInfo[i].id;
-				return weaponBuyAliasInfo[i].failName;
-			}
-		}
+		id = info->id;
+		return info->failName;
 	}
 
 	id = WEAPON_NONE;
@@ -649,16 +673,8 @@ const char *WeaponIDToAlias(int id)
 
 WeaponClassType AliasToWeaponClass(const char *alias)
 {
-	if (alias != NULL)
-	{
-		for (int i = 0; weaponClassAliasInfo[i].alias != NULL; ++i)
-		{
-			if (!Q_stricmp(weaponClassAliasInfo[i].alias, alias))
-				return weaponClassAliasInfo[i].id;
-		}
-	}
-
-	return WEAPONCLASS_NONE;
+	const WeaponClassAliasInfo *info = FindWeaponAlias(weaponClassAliasInfo, alias);
+	return info ? info->id : WEAPONCLASS_NONE;
 }
 
 WeaponClassType WeaponIDToWeaponClass(int id)
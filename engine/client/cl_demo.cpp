@@ -80,8 +80,36 @@ struct
 	float		starttime;
 	float		realstarttime;
 	int		entryIndex;
+
+	float		*sectionlength;	// per directory entry, set by CL_DemoMeasureSections
+	float		seektime;		// fast-forward until this section time
+	double		seekstart;	// Sys_DoubleTime() when the seek began
+	int		seekframes;
+	int		timedemoframe;	// cls.framecount of last message read in timedemo
 } demo;
 
+static const char *timedemo_names[TD_STATS] =
+{
+	"parse",
+	"predict",
+	"entities",
+	"tempents",
+	"particles",
+	"bones",
+	"render",
+	"frame",
+};
+
+// per frame samples, in milliseconds
+static struct
+{
+	float		*samples[TD_STATS];
+	float		frame[TD_STATS];
+	int		numframes;
+	int		maxframes;
+	qboolean		headless;
+} timedemo;
+
 /*
 ====================
 CL_StartupDemoHeader
@@ -695,7 +723,8 @@ qboolean CL_DemoReadMessage( byte *buffer, size_t *length )
 	if( !cls.netchan.remote_address.type )
 		cls.netchan.remote_address.type = NA_LOOPBACK;
 
-	if(( !cl.background && ( cl.refdef.paused || cls.key_dest != key_game )) || cls.key_dest == key_console )
+	// seeking and timedemo must not stall behind an open console
+	if( demo.seektime <= 0.0f && !cls.timedemo && (( !cl.background && ( cl.refdef.paused || cls.key_dest != key_game )) || cls.key_dest == key_console ))
 	{
 		demo.starttime += host.frametime;
 		return false; // paused
@@ -713,6 +742,29 @@ qboolean CL_DemoReadMessage( byte *buffer, size_t *length )
 		fElapsedTime = CL_GetDemoPlaybackClock() - demo.starttime;
 		bSkipMessage = (f >= fElapsedTime) ? true : false;
 
+		if( demo.seektime > 0.0f )
+		{
+			// fast-forward: swallow everything until we reach the target
+			bSkipMessage = false;
+
+			if( demo.entryIndex && f >= demo.seektime && cmd == dem_read )
+			{
+				demo.starttime = CL_GetDemoPlaybackClock() - f;
+				demo.seektime = 0.0f;
+
+				// drop the sounds started by every skipped message at once
+				S_StopAllSounds();
+
+				MsgDev( D_INFO, "demo_seek: %.2f sec reached in %.1f msec (%i messages)\n",
+					f, ( Sys_DoubleTime() - demo.seekstart ) * 1000.0, demo.seekframes );
+			}
+		}
+		else if( cls.timedemo )
+		{
+			// timedemo: exactly one message per client frame, clock ignored
+			bSkipMessage = ( demo.timedemoframe == cls.framecount ) ? true : false;
+		}
+
 		if( cls.changelevel )
 			demo.framecount = 1;
 
@@ -775,11 +827,124 @@ qboolean CL_DemoReadMessage( byte *buffer, size_t *length )
 	}
 
 	demo.framecount++;
+	demo.timedemoframe = cls.framecount;
+	if( demo.seektime > 0.0f ) demo.seekframes++;
 	CL_ReadDemoSequence( false );
 
 	return CL_ReadRawNetworkData( buffer, length );
 }
 
+/*
+=================
+CL_TimeDemoSample
+
+accumulate subsystem time of current frame
+=================
+*/
+void CL_TimeDemoSample( int stat, double start )
+{
+	if( !cls.timedemo ) return;
+
+	timedemo.frame[stat] += ( Sys_DoubleTime() - start ) * 1000.0;
+}
+
+/*
+=================
+CL_TimeDemoEndFrame
+
+store the frame samples, signon frames are not counted
+=================
+*/
+void CL_TimeDemoEndFrame( double start )
+{
+	int	i;
+
+	if( !cls.timedemo ) return;
+
+	if( cls.state == ca_active && demo.entryIndex )
+	{
+		timedemo.frame[TD_FRAME] = ( Sys_DoubleTime() - start ) * 1000.0;
+
+		if( timedemo.numframes == timedemo.maxframes )
+		{
+			timedemo.maxframes = max( timedemo.maxframes * 2, 1024 );
+
+			for( i = 0; i < TD_STATS; i++ )
+				timedemo.samples[i] = (float *)Mem_Realloc( cls.mempool, timedemo.samples[i], sizeof( float ) * timedemo.maxframes );
+		}
+
+		for( i = 0; i < TD_STATS; i++ )
+			timedemo.samples[i][timedemo.numframes] = timedemo.frame[i];
+		timedemo.numframes++;
+	}
+
+	Q_memset( timedemo.frame, 0, sizeof( timedemo.frame ));
+}
+
+/*
+=================
+CL_TimeDemoHeadless
+
+skip the renderer, simulate only
+=================
+*/
+qboolean CL_TimeDemoHeadless( void )
+{
+	return ( cls.timedemo && timedemo.headless && cls.state == ca_active );
+}
+
+static int CL_TimeDemoCompare( const void *a, const void *b )
+{
+	float	fa = *(const float *)a;
+	float	fb = *(const float *)b;
+
+	return ( fa > fb ) - ( fa < fb );
+}
+
+/*
+=================
+CL_TimeDemoReport
+
+print per subsystem percentiles and free the samples
+=================
+*/
+static void CL_TimeDemoReport( void )
+{
+	float	*s, total = 0.0f;
+	int	i, n = timedemo.numframes;
+
+	if( n )
+	{
+		for( i = 0; i < n; i++ )
+			total += timedemo.samples[TD_FRAME][i];
+
+		Msg( "timedemo: %i frames %.2f seconds %.1f fps%s\n", n, total * 0.001f,
+			total > 0.0f ? n * 1000.0f / total : 0.0f, timedemo.headless ? " (headless)" : "" );
+		Msg( "subsystem       p50      p90      p99      max (msec)\n" );
+
+		for( i = 0; i < TD_STATS; i++ )
+		{
+			s = timedemo.samples[i];
+			qsort( s, n, sizeof( float ), CL_TimeDemoCompare );
+
+			// not measured in this mode
+			if( s[n-1] <= 0.0f ) continue;
+
+			Msg( "%-10s %8.3f %8.3f %8.3f %8.3f\n", timedemo_names[i],
+				s[(n-1)*50/100], s[(n-1)*90/100], s[(n-1)*99/100], s[n-1] );
+		}
+	}
+	else Msg( "timedemo: no frames\n" );
+
+	for( i = 0; i < TD_STATS; i++ )
+	{
+		if( timedemo.samples[i] )
+			Mem_Free( timedemo.samples[i] );
+	}
+
+	Q_memset( &timedemo, 0, sizeof( timedemo ));
+}
+
 /*
 ==============
 CL_StopPlayback
@@ -803,6 +968,16 @@ void CL_StopPlayback( void )
 	demo.directory.entries = NULL;
 	demo.entry = NULL;
 
+	if( demo.sectionlength ) Mem_Free( demo.sectionlength );
+	demo.sectionlength = NULL;
+	demo.seektime = 0.0f;
+
+	if( cls.timedemo )
+	{
+		CL_TimeDemoReport();
+		cls.timedemo = false;
+	}
+
 	cls.demoname[0] = '\0';	// clear demoname too
 	menu.globals->demoname[0] = '\0';
 
@@ -1026,23 +1201,102 @@ void CL_Record_f( void )
 
 /*
 ====================
-CL_PlayDemo_f
+CL_DemoSectionLength
 
-playdemo <demoname>
+time of the last message in the given section
 ====================
 */
-void CL_PlayDemo_f( void )
+static float CL_DemoSectionLength( int entryIndex )
 {
-	string	filename;
-	string	demoname;
-	int	i;
+	if( !demo.sectionlength || entryIndex < 0 || entryIndex >= demo.directory.numentries )
+		return 0.0f;
 
-	if( Cmd_Argc() != 2 )
+	return demo.sectionlength[entryIndex];
+}
+
+/*
+====================
+CL_DemoMeasureSections
+
+walk the command headers of every playback section
+and remember the time of its last message
+====================
+*/
+static void CL_DemoMeasureSections( void )
+{
+	int	i, size;
+	float	f, last;
+	double	start = Sys_DoubleTime();
+	word	bytes;
+	byte	cmd;
+
+	demo.sectionlength = (float *)Mem_Alloc( cls.mempool, sizeof( float ) * demo.directory.numentries );
+
+	for( i = 0; i < demo.directory.numentries; i++ )
 	{
-		Msg( "Usage: playdemo <demoname>\n" );
-		return;
+		demo.sectionlength[i] = 0.0f;
+
+		if( demo.directory.entries[i].entrytype == DEMO_STARTUP )
+			continue;
+
+		FS_Seek( cls.demofile, demo.directory.entries[i].offset, SEEK_SET );
+		last = 0.0f;
+
+		while( 1 )
+		{
+			if( FS_Read( cls.demofile, &cmd, sizeof( byte )) != sizeof( byte ))
+				break;
+			if( FS_Read( cls.demofile, &f, sizeof( float )) != sizeof( float ))
+				break;
+
+			if( cmd < 1 || cmd > dem_lastcmd || cmd == dem_stop )
+				break;
+
+			if( cmd == dem_norewind || cmd == dem_read )
+			{
+				// skip netchan sequences
+				FS_Seek( cls.demofile, sizeof( int ) * 7, SEEK_CUR );
+				if( FS_Read( cls.demofile, &size, sizeof( int )) != sizeof( int ))
+					break;
+				if( size < 0 || size > NET_MAX_PAYLOAD )
+					break;
+				FS_Seek( cls.demofile, size, SEEK_CUR );
+			}
+			else if( cmd == dem_usercmd )
+			{
+				FS_Seek( cls.demofile, sizeof( int ) * 2, SEEK_CUR );
+				if( FS_Read( cls.demofile, &bytes, sizeof( short )) != sizeof( short ))
+					break;
+				FS_Seek( cls.demofile, bytes, SEEK_CUR );
+			}
+			else if( cmd == dem_userdata )
+			{
+				if( FS_Read( cls.demofile, &size, sizeof( int )) != sizeof( int ) || size < 0 )
+					break;
+				FS_Seek( cls.demofile, size, SEEK_CUR );
+			}
+
+			last = max( last, f );
+		}
+
+		demo.sectionlength[i] = last;
 	}
 
+	MsgDev( D_INFO, "demo length: %.1f seconds, measured in %.1f msec\n",
+		CL_DemoSectionLength( 1 ), ( Sys_DoubleTime() - start ) * 1000.0 );
+}
+
+/*
+====================
+CL_PlayDemo
+====================
+*/
+static void CL_PlayDemo( const char *name )
+{
+	string	filename;
+	string	demoname;
+	int	i;
+
 	if( cls.demoplayback )
 	{
 		CL_StopPlayback();
@@ -1054,7 +1308,7 @@ void CL_PlayDemo_f( void )
 		return;
 	}
 
-	Q_strncpy( demoname, Cmd_Argv( 1 ), sizeof( demoname ) - 1 );
+	Q_strncpy( demoname, name, sizeof( demoname ) - 1 );
 	Q_snprintf( filename, sizeof( filename ), "demos/%s.dem", demoname );
 
 	if( !FS_FileExists( filename, true ))
@@ -1137,6 +1391,8 @@ void CL_PlayDemo_f( void )
 		FS_Read( cls.demofile, &demo.directory.entries[i], sizeof( demoentry_t ));
 	}
 
+	CL_DemoMeasureSections();
+
 	demo.entryIndex = 0;
 	demo.entry = &demo.directory.entries[demo.entryIndex];
 
@@ -1160,6 +1416,129 @@ void CL_PlayDemo_f( void )
 	// begin a playback demo
 }
 
+/*
+====================
+CL_PlayDemo_f
+
+playdemo <demoname>
+====================
+*/
+void CL_PlayDemo_f( void )
+{
+	if( Cmd_Argc() != 2 )
+	{
+		Msg( "Usage: playdemo <demoname>\n" );
+		return;
+	}
+
+	CL_PlayDemo( Cmd_Argv( 1 ));
+}
+
+/*
+====================
+CL_TimeDemo_f
+
+timedemo <demoname> [headless]
+====================
+*/
+void CL_TimeDemo_f( void )
+{
+	if( Cmd_Argc() < 2 || Cmd_Argc() > 3 )
+	{
+		Msg( "Usage: timedemo <demoname> [headless]\n" );
+		return;
+	}
+
+	CL_PlayDemo( Cmd_Argv( 1 ));
+
+	if( !cls.demoplayback )
+		return;
+
+	Q_memset( &timedemo, 0, sizeof( timedemo ));
+	timedemo.headless = ( Cmd_Argc() == 3 && !Q_stricmp( Cmd_Argv( 2 ), "headless" ));
+	demo.timedemoframe = -1;
+	cls.timedemo = true;
+}
+
+/*
+====================
+CL_DemoSeek
+
+moves playback to the section time, client state can only
+be rebuilt by replaying deltas from the signon, so going back
+restarts the demo and both ways fast-forward to the target
+====================
+*/
+static void CL_DemoSeek( float target )
+{
+	int	entryIndex = max( demo.entryIndex, 1 );
+	float	current;
+
+	target = bound( 0.0f, target, CL_DemoSectionLength( entryIndex ));
+	current = demo.entryIndex ? CL_GetDemoPlaybackClock() - demo.starttime : 0.0f;
+
+	if( demo.entryIndex && target < current )
+	{
+		Cbuf_AddText( va( "playdemo %s\ndemo_seek %g\n", cls.demoname, target ));
+		return;
+	}
+
+	demo.seektime = max( target, 0.001f );
+	demo.seekstart = Sys_DoubleTime();
+	demo.seekframes = 0;
+}
+
+/*
+====================
+CL_DemoSeek_f
+
+demo_seek <seconds>
+====================
+*/
+void CL_DemoSeek_f( void )
+{
+	if( Cmd_Argc() != 2 )
+	{
+		Msg( "Usage: demo_seek <seconds>\n" );
+		return;
+	}
+
+	if( !cls.demoplayback || cls.timedemo )
+	{
+		Msg( "demo_seek: not playing a demo\n" );
+		return;
+	}
+
+	CL_DemoSeek( Q_atof( Cmd_Argv( 1 )));
+}
+
+/*
+====================
+CL_DemoSkip_f
+
+demo_skip <seconds>, negative goes back
+====================
+*/
+void CL_DemoSkip_f( void )
+{
+	float	current;
+
+	if( Cmd_Argc() != 2 )
+	{
+		Msg( "Usage: demo_skip <seconds>\n" );
+		return;
+	}
+
+	if( !cls.demoplayback || cls.timedemo )
+	{
+		Msg( "demo_skip: not playing a demo\n" );
+		return;
+	}
+
+	current = demo.entryIndex ? CL_GetDemoPlaybackClock() - demo.starttime : 0.0f;
+	CL_DemoSeek( current + Q_atof( Cmd_Argv( 1 )));
+}
+
 /*
 ==================
 CL_StartDemos_f
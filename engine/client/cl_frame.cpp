@@ -260,8 +260,8 @@ qboolean CL_InterpolateModel( cl_entity_t *e )
 	VectorCopy( e->curstate.origin, e->origin );
 	VectorCopy( e->curstate.angles, e->angles );
 
-	// disable interpolating in singleplayer
-	if( cls.timedemo || NET_IsLocalAddress( cls.netchan.remote_address ) )
+	// disable interpolating in singleplayer and timedemo, headless timedemo measures it
+	if(( cls.timedemo && !CL_TimeDemoHeadless( )) || NET_IsLocalAddress( cls.netchan.remote_address ))
 		return true;
 
 	// disable interpolating non-moving entities
@@ -1381,6 +1381,47 @@ void CL_AddEntities( void )
 	CL_TestLights();
 }
 
+/*
+===============
+CL_SimulateEntities
+
+headless timedemo replacement of the scene update,
+runs everything V_RenderView would run except drawing
+===============
+*/
+void CL_SimulateEntities( void )
+{
+	double	start;
+
+	if( cls.state != ca_active )
+		return;
+
+	start = Sys_DoubleTime();
+
+	R_ClearScene();
+	cl.num_custombeams = 0;
+
+	CL_SetIdealPitch ();
+	clgame.dllFuncs.CAM_Think ();
+
+	CL_AddPacketEntities( &cl.frame );
+	clgame.dllFuncs.pfnCreateEntities();
+	CL_TimeDemoSample( TD_ENTITIES, start );
+
+	start = Sys_DoubleTime();
+	CL_FireEvents();
+	CL_AddTempEnts();
+	CL_TimeDemoSample( TD_TEMPENTS, start );
+
+	start = Sys_DoubleTime();
+	CL_SimulateParticles();
+	CL_TimeDemoSample( TD_PARTICLES, start );
+
+	start = Sys_DoubleTime();
+	R_StudioSetupSceneBones();
+	CL_TimeDemoSample( TD_BONES, start );
+}
+
 //
 // sound engine implementation
 //
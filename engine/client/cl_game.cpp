@@ -1156,18 +1156,70 @@ void CL_DrawHUD( int state )
 #endif
 }
 
-static void CL_ClearUserMessage( char *pszName, int svc_num )
+/*
+=============
+CL_FindUserMessage
+
+=============
+*/
+cl_user_message_t *CL_FindUserMessage( const char *pszName )
+{
+	cl_user_message_t	*msg;
+
+	for( msg = clgame.msghash[Com_HashKey( pszName, MAX_USER_MSG_HASH )]; msg; msg = msg->hashNext )
+	{
+		if( !Q_strcmp( msg->name, pszName ))
+			return msg;
+	}
+	return NULL;
+}
+
+/*
+=============
+CL_AllocUserMessage
+
+=============
+*/
+static cl_user_message_t *CL_AllocUserMessage( const char *pszName )
+{
+	cl_user_message_t	*msg;
+	uint		hash;
+
+	if( clgame.nummsgs == MAX_USER_MESSAGES )
+		return NULL;
+
+	msg = &clgame.msg[clgame.nummsgs++];
+	Q_strncpy( msg->name, pszName, sizeof( msg->name ));
+
+	// link it in
+	hash = Com_HashKey( msg->name, MAX_USER_MSG_HASH );
+	msg->hashNext = clgame.msghash[hash];
+	clgame.msghash[hash] = msg;
+
+	// HACKHACK: hl1 doesn't have call END_SECTION
+	if( !Q_stricmp( msg->name, "HudText" ) && !Q_stricmp( GI->gamefolder, "valve" ))
+		clgame.credits = msg;
+
+	return msg;
+}
+
+static void CL_ClearUserMessage( cl_user_message_t *msg, int svc_num )
 {
-	int i;
+	cl_user_message_t	**slot = &clgame.msgindex[svc_num - svc_lastmsg];
+
+	// forget the number this message was linked before
+	if( msg->number >= svc_lastmsg && clgame.msgindex[msg->number - svc_lastmsg] == msg )
+		clgame.msgindex[msg->number - svc_lastmsg] = NULL;
 
-	for( i = 0; i < MAX_USER_MESSAGES && clgame.msg[i].name[0]; i++ )
-		if( ( clgame.msg[i].number == svc_num ) && Q_strcmp( clgame.msg[i].name, pszName ) )
-			clgame.msg[i].number = 0;
+	// and the message which was linked to this number
+	if( *slot && *slot != msg )
+		(*slot)->number = 0;
+	*slot = msg;
 }
 
 void CL_LinkUserMessage( char *pszName, const int svc_num, int iSize )
 {
-	int	i;
+	cl_user_message_t	*msg;
 
 	if( !pszName || !*pszName )
 		Host_Error( "CL_LinkUserMessage: bad message name\n" );
@@ -1175,30 +1227,28 @@ void CL_LinkUserMessage( char *pszName, const int svc_num, int iSize )
 	if( svc_num < svc_lastmsg )
 		Host_Error( "CL_LinkUserMessage: tried to hook a system message \"%s\"\n", svc_strings[svc_num] );	
 
+	if( svc_num >= svc_lastmsg + MAX_USER_MESSAGES )
+		Host_Error( "CL_LinkUserMessage: message \"%s\" out of range (%i)\n", pszName, svc_num );
+
 	// see if already hooked
-	for( i = 0; i < MAX_USER_MESSAGES && clgame.msg[i].name[0]; i++ )
+	// NOTE: no check for DispatchFunc, check only name
+	msg = CL_FindUserMessage( pszName );
+
+	if( !msg )
 	{
-		// NOTE: no check for DispatchFunc, check only name
-		if( !Q_strcmp( clgame.msg[i].name, pszName ))
+		// register new message without DispatchFunc, so we should parse it properly
+		msg = CL_AllocUserMessage( pszName );
+
+		if( !msg )
 		{
-			clgame.msg[i].number = svc_num;
-			clgame.msg[i].size = iSize;
-			CL_ClearUserMessage( pszName, svc_num );
+			Host_Error( "CL_LinkUserMessage: MAX_USER_MESSAGES hit!\n" );
 			return;
 		}
 	}
 
-	if( i == MAX_USER_MESSAGES ) 
-	{
-		Host_Error( "CL_LinkUserMessage: MAX_USER_MESSAGES hit!\n" );
-		return;
-	}
-
-	// register new message without DispatchFunc, so we should parse it properly
-	Q_strncpy( clgame.msg[i].name, pszName, sizeof( clgame.msg[i].name ));
-	clgame.msg[i].number = svc_num;
-	clgame.msg[i].size = iSize;
-	CL_ClearUserMessage( pszName, svc_num );
+	CL_ClearUserMessage( msg, svc_num );
+	msg->number = svc_num;
+	msg->size = iSize;
 }
 
 void CL_FreeEntity( cl_entity_t *pEdict )
@@ -1275,6 +1325,75 @@ void CL_ClearEdicts( void )
 
 ===============================================================================
 */
+/*
+=========
+CL_FindSpriteSlot
+
+=========
+*/
+static int CL_FindSpriteSlot( const char *name )
+{
+	cl_sprite_registry_t	*reg = &clgame.sprreg;
+	int			i;
+
+	reg->lookups++;
+
+	for( i = reg->hash[Com_HashKey( name, MAX_IMAGES_HASH )]; i; i = reg->next[i] )
+	{
+		if( !Q_stricmp( clgame.sprites[i].name, name ))
+			return i;
+	}
+	return 0;
+}
+
+/*
+=========
+CL_AllocSpriteSlot
+
+slots may be emptied behind our back (Mod_UnloadSpriteModel,
+R_Shutdown) so the free list is rebuilt when it runs dry
+=========
+*/
+static int CL_AllocSpriteSlot( const char *name )
+{
+	cl_sprite_registry_t	*reg = &clgame.sprreg;
+	word			*link;
+	int			i;
+
+	for( i = 0; !i; )
+	{
+		if( !reg->numfree )
+		{
+			for( i = MAX_IMAGES - 1; i > 0; i-- )
+			{
+				if( !clgame.sprites[i].name[0] )
+					reg->free[reg->numfree++] = i;
+			}
+			if( !reg->numfree ) return 0;
+		}
+
+		i = reg->free[--reg->numfree];
+		if( clgame.sprites[i].name[0] )
+			i = 0; // already taken
+	}
+
+	// unlink from the chain of the sprite this slot held before
+	for( link = &reg->hash[reg->key[i]]; *link; link = &reg->next[*link] )
+	{
+		if( *link == i )
+		{
+			*link = reg->next[i];
+			break;
+		}
+	}
+
+	reg->key[i] = Com_HashKey( name, MAX_IMAGES_HASH );
+	reg->next[i] = reg->hash[reg->key[i]];
+	reg->hash[reg->key[i]] = i;
+
+	return i;
+}
+
 static qboolean CL_LoadHudSprite( const char *szSpriteName, model_t *m_pSprite, qboolean mapSprite, uint texFlags )
 {
 	byte	*buf;
@@ -1311,6 +1430,8 @@ pfnSPR_LoadExt
 HSPRITE pfnSPR_LoadExt( const char *szPicName, uint texFlags )
 {
 	char	name[64];
+	qboolean	loaded;
+	double	start;
 	int	i;
 
 	if( !szPicName || !*szPicName )
@@ -1322,32 +1443,27 @@ HSPRITE pfnSPR_LoadExt( const char *szPicName, uint texFlags )
 	Q_strncpy( name, szPicName, sizeof( name ));
 	COM_FixSlashes( name );
 
-	// slot 0 isn't used
-	for( i = 1; i < MAX_IMAGES; i++ )
+	if(( i = CL_FindSpriteSlot( name )) != 0 )
 	{
-		if( !Q_stricmp( clgame.sprites[i].name, name ))
-		{
-			// prolonge registration
-			clgame.sprites[i].needload = clgame.load_sequence;
-			return i;
-		}
+		// prolonge registration
+		clgame.sprites[i].needload = clgame.load_sequence;
+		return i;
 	}
 
 	// find a free model slot spot
-	for( i = 1; i < MAX_IMAGES; i++ )
-	{
-		if( !clgame.sprites[i].name[0] )
-			break; // this is a valid spot
-	}
-
-	if( i >= MAX_IMAGES ) 
+	if(( i = CL_AllocSpriteSlot( name )) == 0 )
 	{
 		MsgDev( D_ERROR, "SPR_Load: can't load %s, MAX_HSPRITES limit exceeded\n", szPicName );
 		return 0;
 	}
 
 	// load new model
-	if( CL_LoadHudSprite( name, &clgame.sprites[i], false, texFlags ))
+	start = Sys_DoubleTime();
+	loaded = CL_LoadHudSprite( name, &clgame.sprites[i], false, texFlags );
+	clgame.sprreg.loadtime += Sys_DoubleTime() - start;
+	clgame.sprreg.loaded++;
+
+	if( loaded )
 	{
 		if( i < MAX_IMAGES - 1 )
 		{
@@ -1373,6 +1489,27 @@ HSPRITE GAME_EXPORT pfnSPR_Load( const char *szPicName )
 	return pfnSPR_LoadExt( szPicName, texFlags );
 }
 
+/*
+=========
+CL_VidInitHud
+
+calls HUD_VidInit and reports how long the sprite registration took
+=========
+*/
+void CL_VidInitHud( void )
+{
+	double	start;
+
+	clgame.sprreg.lookups = clgame.sprreg.loaded = 0;
+	clgame.sprreg.loadtime = 0.0;
+
+	start = Sys_DoubleTime();
+	clgame.dllFuncs.pfnVidInit();
+
+	MsgDev( D_INFO, "HUD_VidInit: %.2f ms, %i sprite lookups, %i loaded in %.2f ms\n", ( Sys_DoubleTime() - start ) * 1000.0,
+		clgame.sprreg.lookups, clgame.sprreg.loaded, clgame.sprreg.loadtime * 1000.0 );
+}
+
 /*
 =============
 CL_GetSpritePointer
@@ -1668,28 +1805,26 @@ pfnHookUserMsg
 */
 static int GAME_EXPORT pfnHookUserMsg( const char *pszName, pfnUserMsgHook pfn )
 {
-	int	i;
+	cl_user_message_t	*msg;
 
 	// ignore blank names or invalid callbacks
 	if( !pszName || !*pszName || !pfn )
 		return 0;	
 
-	for( i = 0; i < MAX_USER_MESSAGES && clgame.msg[i].name[0]; i++ )
-	{
-		// see if already hooked
-		if( !Q_strcmp( clgame.msg[i].name, pszName ))
-			return 1;
-	}
+	// see if already hooked
+	if( CL_FindUserMessage( pszName ))
+		return 1;
 
-	if( i == MAX_USER_MESSAGES ) 
+	msg = CL_AllocUserMessage( pszName );
+
+	if( !msg )
 	{
 		Host_Error( "HookUserMsg: MAX_USER_MESSAGES hit!\n" );
 		return 0;
 	}
 
 	// hook new message
-	Q_strncpy( clgame.msg[i].name, pszName, sizeof( clgame.msg[i].name ));
-	clgame.msg[i].func = pfn;
+	msg->func = pfn;
 
 	return 1;
 }
@@ -2707,25 +2842,15 @@ static model_t *GAME_EXPORT pfnLoadMapSprite( const char *filename )
             Q_strcpy(name, name2);
     }
 
-	// slot 0 isn't used
-	for( i = 1; i < MAX_IMAGES; i++ )
+	if(( i = CL_FindSpriteSlot( name )) != 0 )
 	{
-		if( !Q_stricmp( clgame.sprites[i].name, name ))
-		{
-			// prolonge registration
-			clgame.sprites[i].needload = clgame.load_sequence;
-			return &clgame.sprites[i];
-		}
+		// prolonge registration
+		clgame.sprites[i].needload = clgame.load_sequence;
+		return &clgame.sprites[i];
 	}
 
 	// find a free model slot spot
-	for( i = 1; i < MAX_IMAGES; i++ )
-	{
-		if( !clgame.sprites[i].name[0] )
-			break; // this is a valid spot
-	}
-
-	if( i == MAX_IMAGES ) 
+	if(( i = CL_AllocSpriteSlot( name )) == 0 )
 	{
 		MsgDev( D_ERROR, "LoadMapSprite: can't load %s, MAX_HSPRITES limit exceeded\n", filename );
 		return NULL;
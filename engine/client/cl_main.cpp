@@ -836,7 +836,12 @@ void CL_SendConnectPacket( void )
 	{
 		qboolean huff = Cvar_VariableInteger( "cl_enable_compress" );
 		if( huff )
+		{
+			// old servers ignore the deflate bit and answer with Huffman
 			extensions |= NET_EXT_HUFF;
+			if( Cvar_VariableInteger( "cl_enable_deflate" ))
+				extensions |= NET_EXT_DEFLATE;
+		}
 
 		if( Cvar_VariableInteger( "cl_enable_split" ) )
 		{
@@ -873,6 +878,8 @@ void CL_SendConnectPacket( void )
 	Info_SetValueForKey( useragent, "o", Q_buildos(), sizeof( useragent ) );
 	Info_SetValueForKey( useragent, "a", Q_buildarch(), sizeof( useragent ) );
 	Info_SetValueForKey( useragent, "i", ID_GetMD5(), sizeof( useragent ) );
+	if( extensions & NET_EXT_DEFLATE )
+		Info_SetValueForKey( useragent, "z", va( "%u", Net_DictionaryCRC() ), sizeof( useragent ) );
 
 	Netchan_OutOfBandPrint( NS_CLIENT, adr, "connect %i %i %i \"%s\" %d %s\n", PROTOCOL_VERSION, port, cls.challenge, Cvar_Userinfo( ), extensions, useragent );
 }
@@ -1620,7 +1627,7 @@ boost::asio::awaitable<void> CL_PrepVideo( void )
 		co_return;
 
 	// must be called after lightmap loading!
-	clgame.dllFuncs.pfnVidInit();
+	CL_VidInitHud();
 #ifdef XASH_VGUI2
     extern int VGui2_VidInit();
     VGui2_VidInit();
@@ -1745,7 +1752,7 @@ void CL_ConnectionlessPacket( netadr_t from, sizebuf_t *msg )
 		}
 
 		Netchan_Setup( NS_CLIENT, &cls.netchan, from, net_qport->integer );
-		cls.splitcompress = false;
+		cls.splitcompress = NET_CODEC_NONE;
 
 		if( extensions & NET_EXT_SPLIT )
 		{
@@ -1762,15 +1769,20 @@ void CL_ConnectionlessPacket( netadr_t from, sizebuf_t *msg )
 			if( extensions & NET_EXT_SPLITHUFF )
 			{
 				MsgDev( D_INFO, "^2NET_EXT_SPLITHUFF enabled^7\n");
-				cls.splitcompress = true;
+				cls.splitcompress = NET_CODEC_HUFF;
 			}
 		}
 
-		if( extensions & NET_EXT_HUFF )
+		if( extensions & NET_EXT_DEFLATE )
+		{
+			cls.netchan.compress = ( extensions & NET_EXT_DEFLATEDICT ) ? NET_CODEC_DEFLATEDICT : NET_CODEC_DEFLATE;
+			MsgDev( D_INFO, "^2NET_EXT_DEFLATE enabled^7 (%s)\n", Net_CodecName( cls.netchan.compress ));
+		}
+		else if( extensions & NET_EXT_HUFF )
 		{
 			MsgDev( D_INFO, "^2NET_EXT_HUFF enabled\n" );
 
-			cls.netchan.compress = true;
+			cls.netchan.compress = NET_CODEC_HUFF;
 		}
 
 		BF_WriteByte( &cls.netchan.message, clc_stringcmd );
@@ -2246,6 +2258,7 @@ void CL_InitLocal( void )
 	Cvar_Get( "cl_background", "0", CVAR_READ_ONLY, "indicates that background map is running" );
 
 	Cvar_Get( "cl_enable_compress", "0", CVAR_ARCHIVE, "request huffman compression from server" );
+	Cvar_Get( "cl_enable_deflate", "1", CVAR_ARCHIVE, "prefer deflate over huffman when compression is enabled" );
 	Cvar_Get( "cl_enable_split", "1", CVAR_ARCHIVE, "request packet split from server" );
 	Cvar_Get( "cl_enable_splitcompress", "0", CVAR_ARCHIVE, "request compressing all splitpackets" );
 
@@ -2286,6 +2299,9 @@ void CL_InitLocal( void )
 	Cmd_AddCommand ("disconnect", CL_Disconnect_f, "disconnect from server" );
 	Cmd_AddCommand ("record", CL_Record_f, "record a demo" );
 	Cmd_AddCommand ("playdemo", CL_PlayDemo_f, "play a demo" );
+	Cmd_AddCommand ("timedemo", CL_TimeDemo_f, "play a demo as fast as possible and show frame time percentiles: timedemo <demoname> [headless]" );
+	Cmd_AddCommand ("demo_seek", CL_DemoSeek_f, "move demo playback to the specified time: demo_seek <seconds>" );
+	Cmd_AddCommand ("demo_skip", CL_DemoSkip_f, "fast-forward or rewind the demo playback: demo_skip <seconds>" );
 	Cmd_AddCommand ("killdemo", CL_DeleteDemo_f, "delete a specified demo file and demoshot" );
 	Cmd_AddCommand ("startdemos", CL_StartDemos_f, "start playing back the selected demos sequentially" );
 	Cmd_AddCommand ("demos", CL_Demos_f, "restart looping demos defined by the last startdemos command" );
@@ -2295,6 +2311,9 @@ void CL_InitLocal( void )
 	Cmd_AddCommand ("escape", CL_Escape_f, "escape from game to menu" );
 	Cmd_AddCommand ("pointfile", CL_ReadPointFile_f, "show leaks on a map (if present of course)" );
 	Cmd_AddCommand ("linefile", CL_ReadLineFile_f, "show leaks on a map (if present of course)" );
+	Cmd_AddCommand ("partbench", CL_ParticleBench_f, "simulate batched particles without rendering: partbench [count] [frames]" );
+	Cmd_AddCommand ("cl_tentstats", CL_TempEntStats_f, "show temp entities pool usage and per-frame counters" );
+	Cmd_AddCommand ("cl_usermsgstats", CL_UserMsgStats_f, "show per user message counters and hook time: cl_usermsgstats [reset]" );
 
 	Cmd_AddCommand ("quit", CL_Quit_f, "quit from game" );
 	Cmd_AddCommand ("exit", CL_Quit_f, "quit from game" );
@@ -2370,6 +2389,9 @@ Host_ClientFrame
 */
 void Host_ClientFrame( void )
 {
+	double	framestart = Sys_DoubleTime();
+	double	start;
+
 	// if client is not active, skip render functions
 
 	// decide the simulation time
@@ -2393,7 +2415,9 @@ void Host_ClientFrame( void )
 		clgame.dllFuncs.pfnFrame( host.frametime );
 
 		// fetch results from server
+		start = Sys_DoubleTime();
 		CL_ReadPackets();
+		CL_TimeDemoSample( TD_PARSE, start );
 
         // update voice
         Voice_Idle( host.frametime );
@@ -2413,12 +2437,23 @@ void Host_ClientFrame( void )
 			CL_SendCommand();
 
 			// predict all unacknowledged movements
+			start = Sys_DoubleTime();
 			CL_PredictMovement();
+			CL_TimeDemoSample( TD_PREDICT, start );
 		}
 	}
 
 	// update the screen
-	SCR_UpdateScreen ();
+	if( CL_TimeDemoHeadless( ))
+	{
+		CL_SimulateEntities();
+	}
+	else
+	{
+		start = Sys_DoubleTime();
+		SCR_UpdateScreen ();
+		CL_TimeDemoSample( TD_RENDER, start );
+	}
 
 	if( cls.initialized )
 	{
@@ -2433,6 +2468,8 @@ void Host_ClientFrame( void )
 
 	Con_RunConsole();
 
+	CL_TimeDemoEndFrame( framestart );
+
 	cls.framecount++;
 }
 
@@ -127,16 +127,9 @@ const char *CL_MsgInfo( int cmd )
 	}
 	else if( cmd >= svc_lastmsg && cmd < ( svc_lastmsg + MAX_USER_MESSAGES ))
 	{
-		int	i;
+		cl_user_message_t	*msg = clgame.msgindex[cmd - svc_lastmsg];
 
-		for( i = 0; i < MAX_USER_MESSAGES; i++ )
-		{
-			if( clgame.msg[i].number == cmd )
-			{
-				Q_strncpy( sz, clgame.msg[i].name, sizeof( sz ));
-				break;
-			}
-		}
+		if( msg ) Q_strncpy( sz, msg->name, sizeof( sz ));
 	}
 	return sz;
 }
@@ -1405,32 +1398,28 @@ Dispatch user message by engine request
 */
 qboolean CL_DispatchUserMessage( const char *pszName, int iSize, void *pbuf )
 {
-	int	i;
+	cl_user_message_t	*msg_t;
 
 	if( !pszName || !*pszName )
 		return false;
 
-	for( i = 0; i < MAX_USER_MESSAGES; i++ )
-	{
-		// search for user message
-		if( !Q_strcmp( clgame.msg[i].name, pszName ))
-			break;
-	}
+	// search for user message
+	msg_t = CL_FindUserMessage( pszName );
 
-	if( i == MAX_USER_MESSAGES )
+	if( !msg_t )
 	{
 		MsgDev( D_ERROR, "CL_DispatchUserMessage: bad message %s\n", pszName );
 		return false;
 	}
 
-	if( clgame.msg[i].func )
+	if( msg_t->func )
 	{
-		clgame.msg[i].func( pszName, iSize, pbuf );
+		msg_t->func( pszName, iSize, pbuf );
 	}
 	else
 	{
 		MsgDev( D_ERROR, "CL_DispatchUserMessage: %s not hooked\n", pszName );
-		clgame.msg[i].func = CL_UserMsgStub; // throw warning only once
+		msg_t->func = CL_UserMsgStub; // throw warning only once
 	}
 	return true;
 }
@@ -1444,8 +1433,11 @@ handles all user messages
 */
 void CL_ParseUserMessage( sizebuf_t *msg, int svc_num )
 {
-	int	i, iSize;
-	byte	pbuf[256]; // message can't be larger than 255 bytes
+	cl_user_message_t	*msg_t;
+	int		iSize;
+	byte		*pdata;
+	byte		pbuf[256]; // message can't be larger than 255 bytes
+	double		start;
 
 	// NOTE: any user message parse on engine, not in client.dll
 	if( svc_num < svc_lastmsg || svc_num >= ( MAX_USER_MESSAGES + svc_lastmsg ))
@@ -1455,53 +1447,107 @@ void CL_ParseUserMessage( sizebuf_t *msg, int svc_num )
 		return;
 	}
 
-	for( i = 0; i < MAX_USER_MESSAGES; i++ )
-	{
-		// search for user message
-		if( clgame.msg[i].number == svc_num )
-			break;
-	}
+	msg_t = clgame.msgindex[svc_num - svc_lastmsg];
 
-	if( i == MAX_USER_MESSAGES ) // probably unregistered
+	if( !msg_t ) // probably unregistered
 	{
 		MsgDev( D_ERROR, "CL_ParseUserMessage: illegible server message %d (probably unregistered)\n", svc_num );
 		return;
 	}
 
-	iSize = clgame.msg[i].size;
+	iSize = msg_t->size;
 
 	// message with variable sizes receive an actual size as first byte
 	if( iSize == -1 ) iSize = BF_ReadByte( msg );
 
-	// parse user message into buffer
-	BF_ReadBytes( msg, pbuf, iSize );
+	if( !( msg->iCurBit & 7 ) && iSize <= BF_GetNumBytesLeft( msg ))
+	{
+		// byte aligned, hand the net buffer to the hook as is
+		pdata = BF_GetData( msg ) + ( msg->iCurBit >> 3 );
+		BF_SeekToBit( msg, msg->iCurBit + ( iSize << 3 ));
+	}
+	else
+	{
+		// parse user message into buffer
+		BF_ReadBytes( msg, pbuf, iSize );
+		pdata = pbuf;
+		msg_t->copies++;
+	}
+
+	msg_t->count++;
+	msg_t->bytes += iSize;
 
 	if( cl_trace_messages->integer )
 	{
 		MsgDev( D_INFO, "^3USERMSG %s SIZE %i SVC_NUM %i\n",
-			clgame.msg[i].name, iSize, clgame.msg[i].number );
+			msg_t->name, iSize, msg_t->number );
 	}
 
-	if( clgame.msg[i].func )
+	if( msg_t->func )
 	{
-		clgame.msg[i].func( clgame.msg[i].name, iSize, pbuf );
+		start = Sys_DoubleTime();
+		msg_t->func( msg_t->name, iSize, pdata );
+		msg_t->time += Sys_DoubleTime() - start;
 
 		// HACKHACK: run final credits for Half-Life
 		// because hl1 doesn't have call END_SECTION
-		if( !Q_stricmp( clgame.msg[i].name, "HudText" ) && !Q_stricmp( GI->gamefolder, "valve" ))
+		if( msg_t == clgame.credits )
 		{
 			// it's a end, so we should run credits
-			if( !Q_strcmp( (char *)pbuf, "END3" ))
+			if( iSize >= 5 && !Q_memcmp( pdata, "END3", 5 ))
 				Host_Credits();
 		}
 	}
 	else
 	{
-		MsgDev( D_ERROR, "CL_ParseUserMessage: %s not hooked\n", clgame.msg[i].name );
-		clgame.msg[i].func = CL_UserMsgStub; // throw warning only once
+		MsgDev( D_ERROR, "CL_ParseUserMessage: %s not hooked\n", msg_t->name );
+		msg_t->func = CL_UserMsgStub; // throw warning only once
 	}
 }
 
+/*
+==============
+CL_UserMsgStats_f
+
+show per-message counters, "cl_usermsgstats reset" clears them
+==============
+*/
+void CL_UserMsgStats_f( void )
+{
+	cl_user_message_t	*msg_t;
+	uint		count = 0, bytes = 0;
+	double		time = 0.0;
+	int		i;
+
+	if( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ))
+	{
+		for( i = 0; i < clgame.nummsgs; i++ )
+		{
+			msg_t = &clgame.msg[i];
+			msg_t->count = msg_t->bytes = msg_t->copies = 0;
+			msg_t->time = 0.0;
+		}
+		Msg( "user message counters cleared\n" );
+		return;
+	}
+
+	Msg( "svc  name                 count      bytes copies    time ms   us/msg\n" );
+
+	for( i = 0; i < clgame.nummsgs; i++ )
+	{
+		msg_t = &clgame.msg[i];
+		if( !msg_t->count ) continue;
+
+		Msg( "%3i  %-20s %6u %10u %6u %10.3f %8.2f\n", msg_t->number, msg_t->name, msg_t->count,
+			msg_t->bytes, msg_t->copies, msg_t->time * 1000.0, msg_t->time * 1000000.0 / msg_t->count );
+		count += msg_t->count;
+		bytes += msg_t->bytes;
+		time += msg_t->time;
+	}
+
+	Msg( "%i messages registered, %u received, %u bytes, %.3f ms in hooks\n", clgame.nummsgs, count, bytes, time * 1000.0 );
+}
+
 struct stufftexttable_s
 {
 const char *command;
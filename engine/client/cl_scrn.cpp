@@ -192,8 +192,8 @@ void SCR_NetSpeeds( void )
 	case 1:
 		if( cls.netchan.compress )
 		{
-			Q_snprintf( msg, sizeof( msg ), "Game Time: %02d:%02d\nTotal received from server:\n Huffman %s\nUncompressed %s\nSplit %s\n",
-			(int)(time / 60.0f ), (int)fmod( time, 60.0f ), Q_memprint( cls.netchan.total_received ), Q_memprint( cls.netchan.total_received_uncompressed ),
+			Q_snprintf( msg, sizeof( msg ), "Game Time: %02d:%02d\nTotal received from server:\n %s %s\nUncompressed %s\nSplit %s\n",
+			(int)(time / 60.0f ), (int)fmod( time, 60.0f ), Net_CodecName( cls.netchan.compress ), Q_memprint( cls.netchan.total_received ), Q_memprint( cls.netchan.total_received_uncompressed ),
 						Q_memprint( cls.netchan.netsplit.total_received ) );
 		}
 		else
@@ -207,8 +207,8 @@ void SCR_NetSpeeds( void )
 	case 2:
 		if( cls.netchan.compress )
 		{
-			Q_snprintf( msg, sizeof( msg ), "Game Time: %02d:%02d\nTotal sended to server:\nHuffman %s\nUncompressed %s\n",
-			(int)(time / 60.0f ), (int)fmod( time, 60.0f ), Q_memprint( cls.netchan.total_sended ), Q_memprint( cls.netchan.total_sended_uncompressed ));
+			Q_snprintf( msg, sizeof( msg ), "Game Time: %02d:%02d\nTotal sended to server:\n%s %s\nUncompressed %s\n",
+			(int)(time / 60.0f ), (int)fmod( time, 60.0f ), Net_CodecName( cls.netchan.compress ), Q_memprint( cls.netchan.total_sended ), Q_memprint( cls.netchan.total_sended_uncompressed ));
 		}
 		else
 		{
@@ -671,7 +671,7 @@ void SCR_VidInit( void )
 	
 	// vid_state has changed
 	if( menu.hInstance ) menu.dllFuncs.pfnVidInit();
-	if( clgame.hInstance ) clgame.dllFuncs.pfnVidInit();
+	if( clgame.hInstance ) CL_VidInitHud();
 #ifdef XASH_VGUI2
     extern int VGui2_VidInit();
     if( clgame.hInstance ) VGui2_VidInit();
@@ -41,11 +41,269 @@ TEMPENTS MANAGEMENT
 #define SHARD_VOLUME		12.0f	// on shard ever n^3 units
 #define SF_FUNNEL_REVERSE		1
 
+#define MAX_TENT_BLOCKS		8
+#define MIN_TENT_BLOCK		64
+
+// lifetime buckets, low priority tents are evicted from the shortest one first
+enum
+{
+	TENTBUCKET_NONE = -1,	// free
+	TENTBUCKET_PENDING = 0,	// allocated this frame, not classified yet
+	TENTBUCKET_SHORT,		// less than second to live
+	TENTBUCKET_MEDIUM,		// less than four seconds to live
+	TENTBUCKET_LONG,
+	TENTBUCKET_HIGH,		// high priority, never evicted
+	TENTBUCKET_COUNT
+};
+
+typedef struct tentinfo_s
+{
+	TEMPENTITY		*tent;
+	struct tentinfo_s	*prev, *next;		// bucket list
+	struct tentinfo_s	*ownerprev, *ownernext;	// attached tents of one entity
+	int			bucket;
+	int			owner;		// entity index, 0 if not in owner list
+	int			id;		// unique over the whole pool
+} tentinfo_t;
+
+typedef struct
+{
+	tentinfo_t	*head;
+	tentinfo_t	*tail;
+} tentlist_t;
+
+typedef struct
+{
+	TEMPENTITY	*tents;
+	tentinfo_t	*info;
+	int		count;
+} tentblock_t;
+
+typedef struct
+{
+	int		allocs;
+	int		evictions;
+	int		overflows;
+} tentcounters_t;
+
+typedef struct
+{
+	tentcounters_t	total;
+	tentcounters_t	frame;		// current frame
+	tentcounters_t	lastframe;
+	int		active;
+	int		peak;
+} tentstats_t;
+
 TEMPENTITY	*cl_active_tents;
 TEMPENTITY	*cl_free_tents;
-TEMPENTITY	*cl_tempents = NULL;		// entities pool
 int		cl_muzzleflash[MAX_MUZZLEFLASH];	// muzzle flashes
 
+static tentblock_t	cl_tentblocks[MAX_TENT_BLOCKS];
+static int	cl_numtentblocks;
+static int	cl_numtents;			// pool size over all blocks
+static tentlist_t	cl_tentbuckets[TENTBUCKET_COUNT];
+static tentinfo_t	*cl_tentowners[MAX_EDICTS];
+static tentstats_t	cl_tentstats;
+static convar_t	*cl_tempents_max;
+
+/*
+================
+CL_TEntInfo
+
+find bookkeeping for tempent
+================
+*/
+static tentinfo_t *CL_TEntInfo( TEMPENTITY *pTemp )
+{
+	int	i;
+
+	for( i = 0; i < cl_numtentblocks; i++ )
+	{
+		tentblock_t *block = &cl_tentblocks[i];
+
+		if( pTemp >= block->tents && pTemp < block->tents + block->count )
+			return &block->info[pTemp - block->tents];
+	}
+
+	return NULL;
+}
+
+static void CL_TEntUnlink( tentinfo_t *info )
+{
+	if( info->bucket != TENTBUCKET_NONE )
+	{
+		tentlist_t *list = &cl_tentbuckets[info->bucket];
+
+		if( info->prev ) info->prev->next = info->next;
+		else list->head = info->next;
+		if( info->next ) info->next->prev = info->prev;
+		else list->tail = info->prev;
+
+		info->prev = info->next = NULL;
+		info->bucket = TENTBUCKET_NONE;
+	}
+
+	if( info->owner )
+	{
+		if( info->ownerprev ) info->ownerprev->ownernext = info->ownernext;
+		else cl_tentowners[info->owner] = info->ownernext;
+		if( info->ownernext ) info->ownernext->ownerprev = info->ownerprev;
+
+		info->ownerprev = info->ownernext = NULL;
+		info->owner = 0;
+	}
+}
+
+static void CL_TEntLinkBucket( tentinfo_t *info, int bucket )
+{
+	tentlist_t *list = &cl_tentbuckets[bucket];
+
+	// append to tail, so every bucket is oldest first
+	info->bucket = bucket;
+	info->next = NULL;
+	info->prev = list->tail;
+	if( list->tail ) list->tail->next = info;
+	else list->head = info;
+	list->tail = info;
+}
+
+/*
+================
+CL_TEntClassifyPending
+
+tent fields are filled by caller after allocation,
+so buckets and owners are assigned lazily
+================
+*/
+static void CL_TEntClassifyPending( void )
+{
+	tentinfo_t	*info;
+	TEMPENTITY	*pTemp;
+	float		life;
+	int		bucket;
+
+	while(( info = cl_tentbuckets[TENTBUCKET_PENDING].head ) != NULL )
+	{
+		pTemp = info->tent;
+		life = pTemp->die - cl.time;
+
+		CL_TEntUnlink( info );
+
+		if( pTemp->priority == TENTPRIORITY_HIGH )
+			bucket = TENTBUCKET_HIGH;
+		else if( life < 1.0f )
+			bucket = TENTBUCKET_SHORT;
+		else if( life < 4.0f )
+			bucket = TENTBUCKET_MEDIUM;
+		else bucket = TENTBUCKET_LONG;
+
+		CL_TEntLinkBucket( info, bucket );
+
+		if( ( pTemp->flags & FTENT_PLYRATTACHMENT ) && pTemp->clientIndex > 0 && pTemp->clientIndex < MAX_EDICTS )
+		{
+			info->owner = pTemp->clientIndex;
+			info->ownerprev = NULL;
+			info->ownernext = cl_tentowners[info->owner];
+			if( info->ownernext ) info->ownernext->ownerprev = info;
+			cl_tentowners[info->owner] = info;
+		}
+	}
+}
+
+/*
+================
+CL_TEntReleaseFreed
+
+client dll moves dead tents to the head of free list,
+drop bookkeeping for everything in front of previous head
+================
+*/
+static void CL_TEntReleaseFreed( TEMPENTITY *oldFreeHead )
+{
+	TEMPENTITY	*pTemp;
+	tentinfo_t	*info;
+
+	for( pTemp = cl_free_tents; pTemp && pTemp != oldFreeHead; pTemp = pTemp->next )
+	{
+		info = CL_TEntInfo( pTemp );
+
+		if( info && info->bucket != TENTBUCKET_NONE )
+		{
+			CL_TEntUnlink( info );
+			cl_tentstats.active--;
+		}
+	}
+}
+
+/*
+================
+CL_TEntGrowPool
+
+add a block of tents to the free list
+================
+*/
+static qboolean CL_TEntGrowPool( int count )
+{
+	tentblock_t	*block;
+	int		i;
+
+	if( cl_numtentblocks >= MAX_TENT_BLOCKS || count <= 0 )
+		return false;
+
+	block = &cl_tentblocks[cl_numtentblocks];
+	block->tents = (TEMPENTITY *)Mem_AlignedAlloc( cls.mempool, sizeof( TEMPENTITY ) * count, alignof( TEMPENTITY ));
+	block->info = (tentinfo_t *)Mem_ZeroAlloc( cls.mempool, sizeof( tentinfo_t ) * count );
+	block->count = count;
+
+	for( i = 0; i < count; i++ )
+	{
+		block->info[i].tent = &block->tents[i];
+		block->info[i].bucket = TENTBUCKET_NONE;
+		block->info[i].id = cl_numtents + i;
+		block->tents[i].entity.trivial_accept = INVALID_HANDLE;
+		block->tents[i].next = ( i < count - 1 ) ? &block->tents[i+1] : cl_free_tents;
+	}
+
+	cl_free_tents = block->tents;
+	cl_numtents += count;
+	cl_numtentblocks++;
+
+	return true;
+}
+
+static qboolean CL_TEntTryGrow( void )
+{
+	int	limit = max( cl_tempents_max->integer, GI->max_tents );
+
+	if( cl_numtents >= limit )
+		return false;
+
+	return CL_TEntGrowPool( min( max( GI->max_tents / 2, MIN_TENT_BLOCK ), limit - cl_numtents ));
+}
+
+/*
+================
+CL_TEntEvictCandidate
+
+oldest low priority tent from the shortest lifetime bucket
+================
+*/
+static tentinfo_t *CL_TEntEvictCandidate( void )
+{
+	int	i;
+
+	CL_TEntClassifyPending();
+
+	for( i = TENTBUCKET_SHORT; i <= TENTBUCKET_LONG; i++ )
+	{
+		if( cl_tentbuckets[i].head )
+			return cl_tentbuckets[i].head;
+	}
+
+	return NULL;
+}
+
 /*
 ================
 CL_InitTempents
@@ -54,7 +312,8 @@ CL_InitTempents
 */
 void CL_InitTempEnts( void )
 {
-	cl_tempents = (TEMPENTITY*)Mem_AlignedAlloc( cls.mempool, sizeof( TEMPENTITY ) * GI->max_tents, alignof(TEMPENTITY) );
+	cl_tempents_max = Cvar_Get( "cl_tempents_max", "2048", CVAR_ARCHIVE, "temp entities pool can grow up to this size" );
+	CL_TEntGrowPool( GI->max_tents );
 	CL_ClearTempEnts();
 }
 
@@ -90,19 +349,36 @@ CL_ClearTempEnts
 */
 void CL_ClearTempEnts( void )
 {
-	int	i;
+	int	i, j;
+
+	if( !cl_numtentblocks ) return;
 
-	if( !cl_tempents ) return;
+	cl_free_tents = NULL;
+	cl_active_tents = NULL;
 
-	for( i = 0; i < GI->max_tents - 1; i++ )
+	for( i = 0; i < cl_numtentblocks; i++ )
 	{
-		cl_tempents[i].next = &cl_tempents[i+1];
-		cl_tempents[i].entity.trivial_accept = INVALID_HANDLE;
+		tentblock_t *block = &cl_tentblocks[i];
+
+		for( j = 0; j < block->count; j++ )
+		{
+			tentinfo_t *info = &block->info[j];
+
+			info->prev = info->next = NULL;
+			info->ownerprev = info->ownernext = NULL;
+			info->bucket = TENTBUCKET_NONE;
+			info->owner = 0;
+
+			block->tents[j].entity.trivial_accept = INVALID_HANDLE;
+			block->tents[j].next = ( j < block->count - 1 ) ? &block->tents[j+1] : cl_free_tents;
+		}
+
+		cl_free_tents = block->tents;
 	}
 
-	cl_tempents[GI->max_tents-1].next = NULL;
-	cl_free_tents = cl_tempents;
-	cl_active_tents = NULL;
+	memset( cl_tentbuckets, 0, sizeof( cl_tentbuckets ));
+	memset( cl_tentowners, 0, sizeof( cl_tentowners ));
+	cl_tentstats.active = 0;
 }
 
 /*
@@ -113,9 +389,53 @@ CL_FreeTempEnts
 */
 void CL_FreeTempEnts( void )
 {
-	if( cl_tempents )
-		Mem_Free( cl_tempents );
-	cl_tempents = NULL;
+	int	i;
+
+	for( i = 0; i < cl_numtentblocks; i++ )
+	{
+		Mem_Free( cl_tentblocks[i].tents );
+		Mem_Free( cl_tentblocks[i].info );
+	}
+
+	memset( cl_tentblocks, 0, sizeof( cl_tentblocks ));
+	memset( cl_tentbuckets, 0, sizeof( cl_tentbuckets ));
+	memset( cl_tentowners, 0, sizeof( cl_tentowners ));
+	cl_numtentblocks = 0;
+	cl_numtents = 0;
+	cl_free_tents = NULL;
+	cl_active_tents = NULL;
+	cl_tentstats.active = 0;
+}
+
+/*
+================
+CL_TempEntStats_f
+
+================
+*/
+void CL_TempEntStats_f( void )
+{
+	int	i, buckets[TENTBUCKET_COUNT];
+
+	CL_TEntClassifyPending();
+
+	for( i = 0; i < TENTBUCKET_COUNT; i++ )
+	{
+		tentinfo_t *info;
+
+		buckets[i] = 0;
+		for( info = cl_tentbuckets[i].head; info; info = info->next )
+			buckets[i]++;
+	}
+
+	Msg( "tempents: %i active, %i peak, %i pool in %i blocks (limit %i)\n", cl_tentstats.active, cl_tentstats.peak,
+		cl_numtents, cl_numtentblocks, max( cl_tempents_max->integer, GI->max_tents ));
+	Msg( "buckets: %i short, %i medium, %i long, %i high\n", buckets[TENTBUCKET_SHORT],
+		buckets[TENTBUCKET_MEDIUM], buckets[TENTBUCKET_LONG], buckets[TENTBUCKET_HIGH] );
+	Msg( "last frame: %i allocs, %i evictions, %i overflows\n", cl_tentstats.lastframe.allocs,
+		cl_tentstats.lastframe.evictions, cl_tentstats.lastframe.overflows );
+	Msg( "total: %i allocs, %i evictions, %i overflows\n", cl_tentstats.total.allocs,
+		cl_tentstats.total.evictions, cl_tentstats.total.overflows );
 }
 
 /*
@@ -235,6 +555,7 @@ void CL_TEntPlaySound( TEMPENTITY *pTemp, float damp )
 	{
 		int	pitch;
 		sound_t	handle;
+		tentinfo_t	*info = CL_TEntInfo( pTemp );
 		
 		if( isshellcasing )
 			fvol *= min ( 1.0f, ((float)zvel) / 350.0f ); 
@@ -245,7 +566,7 @@ void CL_TEntPlaySound( TEMPENTITY *pTemp, float damp )
 		else pitch = PITCH_NORM;
 
 		handle = S_RegisterSound( soundname );
-		S_StartSound( pTemp->entity.origin, -(pTemp - cl_tempents), CHAN_BODY, handle, fvol, ATTN_NORM, pitch, SND_STOP_LOOPING );
+		S_StartSound( pTemp->entity.origin, info ? -info->id : 0, CHAN_BODY, handle, fvol, ATTN_NORM, pitch, SND_STOP_LOOPING );
 	}
 }
 
@@ -267,35 +588,88 @@ int CL_TEntAddEntity( cl_entity_t *pEntity )
 
 /*
 ==============
-CL_TEntAddEntity
+CL_FreeLowPriorityTempEnt
 
-free the first low priority tempent it finds.
+kill the oldest short-living low priority tempent.
 ==============
 */
 qboolean CL_FreeLowPriorityTempEnt( void )
 {
-	TEMPENTITY	*pActive = cl_active_tents;
-	TEMPENTITY	*pPrev = NULL;
+	tentinfo_t	*info = CL_TEntEvictCandidate();
+
+	if( !info ) return false;
 
-	while( pActive )
+	// client dll will move it to the free list on next update
+	CL_TEntUnlink( info );
+	info->tent->flags &= ~FTENT_FADEOUT;
+	info->tent->die = cl.time - 1.0f;
+	cl_tentstats.active--;
+	cl_tentstats.frame.evictions++;
+	cl_tentstats.total.evictions++;
+
+	return true;
+}
+
+/*
+==============
+CL_TempEntAllocInternal
+
+take tent from the free list, grow the pool or
+reuse a low priority tent in place
+==============
+*/
+static TEMPENTITY *CL_TempEntAllocInternal( const vec3_t org, model_t *pmodel, int priority )
+{
+	TEMPENTITY	*pTemp, *pNext;
+	tentinfo_t	*info;
+
+	if( !cl_free_tents )
+		CL_TEntTryGrow();
+
+	if( cl_free_tents )
 	{
-		if( pActive->priority == TENTPRIORITY_LOW )
-		{
-			// remove from the active list.
-			if( pPrev ) pPrev->next = pActive->next;
-			else cl_active_tents = pActive->next;
+		pTemp = cl_free_tents;
+		cl_free_tents = pTemp->next;
 
-			// add to the free list.
-			pActive->next = cl_free_tents;
-			cl_free_tents = pActive;
+		CL_PrepareTEnt( pTemp, pmodel );
 
-			return true;
-		}
+		pTemp->next = cl_active_tents;
+		cl_active_tents = pTemp;
+
+		cl_tentstats.active++;
+		cl_tentstats.peak = max( cl_tentstats.peak, cl_tentstats.active );
+	}
+	else if( priority == TENTPRIORITY_HIGH && ( info = CL_TEntEvictCandidate( )) != NULL )
+	{
+		// no temporary ents free, so overwrite the oldest low-priority one.
+		// it stays at the same place in the active list
+		pTemp = info->tent;
+		pNext = pTemp->next;
+
+		CL_PrepareTEnt( pTemp, pmodel );
+		pTemp->next = pNext;
 
-		pPrev = pActive;
-		pActive = pActive->next;
+		cl_tentstats.frame.evictions++;
+		cl_tentstats.total.evictions++;
 	}
-	return false;
+	else
+	{
+		cl_tentstats.frame.overflows++;
+		cl_tentstats.total.overflows++;
+		return NULL;
+	}
+
+	info = CL_TEntInfo( pTemp );
+	CL_TEntUnlink( info );
+	CL_TEntLinkBucket( info, TENTBUCKET_PENDING );
+
+	pTemp->priority = priority;
+	if( org ) VectorCopy( org, pTemp->entity.origin );
+
+	cl_tentstats.frame.allocs++;
+	cl_tentstats.total.allocs++;
+
+	return pTemp;
 }
 
 
@@ -311,6 +685,10 @@ void CL_AddTempEnts( void )
 {
 	double	ft = cl.time - cl.oldtime;
 	float	gravity = clgame.movevars.gravity;
+	TEMPENTITY	*pOldFree;
+
+	cl_tentstats.lastframe = cl_tentstats.frame;
+	memset( &cl_tentstats.frame, 0, sizeof( cl_tentstats.frame ));
 
 #ifdef XASH_RAGDOLL
 	if (cls.state >= ca_connected && physics::gPhysicsManager.HasRagdolls())
@@ -320,7 +698,12 @@ void CL_AddTempEnts( void )
 		physics::gPhysicsManager.StepSimulation(ft);
 	}
 #endif
+	CL_TEntClassifyPending();
+	pOldFree = cl_free_tents;
+
 	clgame.dllFuncs.pfnTempEntUpdate( ft, cl.time, gravity, &cl_free_tents, &cl_active_tents, CL_TEntAddEntity, CL_TEntPlaySound );	// callbacks
+
+	CL_TEntReleaseFreed( pOldFree );
 }
 
 /*
@@ -332,24 +715,10 @@ alloc normal\low priority tempentity
 */
 TEMPENTITY *GAME_EXPORT CL_TempEntAlloc( const vec3_t org, model_t *pmodel )
 {
-	TEMPENTITY	*pTemp;
+	TEMPENTITY	*pTemp = CL_TempEntAllocInternal( org, pmodel, TENTPRIORITY_LOW );
 
-	if( !cl_free_tents )
-	{
-		MsgDev( D_NOTE, "Overflow %d temporary ents!\n", GI->max_tents );
-		return NULL;
-	}
-
-	pTemp = cl_free_tents;
-	cl_free_tents = pTemp->next;
-
-	CL_PrepareTEnt( pTemp, pmodel );
-
-	pTemp->priority = TENTPRIORITY_LOW;
-	if( org ) VectorCopy( org, pTemp->entity.origin );
-
-	pTemp->next = cl_active_tents;
-	cl_active_tents = pTemp;
+	if( !pTemp )
+		MsgDev( D_NOTE, "Overflow %d temporary ents!\n", cl_numtents );
 
 	return pTemp;
 }
@@ -363,35 +732,14 @@ alloc high priority tempentity
 */
 TEMPENTITY *GAME_EXPORT CL_TempEntAllocHigh( const vec3_t org, model_t *pmodel )
 {
-	TEMPENTITY	*pTemp;
-
-	if( !cl_free_tents )
-	{
-		// no temporary ents free, so find the first active low-priority temp ent 
-		// and overwrite it.
-		CL_FreeLowPriorityTempEnt();
-	}
+	TEMPENTITY	*pTemp = CL_TempEntAllocInternal( org, pmodel, TENTPRIORITY_HIGH );
 
-	if( !cl_free_tents )
+	if( !pTemp )
 	{
-		// didn't find anything? The tent list is either full of high-priority tents
-		// or all tents in the list are still due to live for > 10 seconds. 
+		// didn't find anything? The tent list is full of high-priority tents
 		MsgDev( D_INFO, "Couldn't alloc a high priority TENT!\n" );
-		return NULL;
 	}
 
-	// Move out of the free list and into the active list.
-	pTemp = cl_free_tents;
-	cl_free_tents = pTemp->next;
-
-	CL_PrepareTEnt( pTemp, pmodel );
-
-	pTemp->priority = TENTPRIORITY_HIGH;
-	if( org ) VectorCopy( org, pTemp->entity.origin );
-
-	pTemp->next = cl_active_tents;
-	cl_active_tents = pTemp;
-
 	return pTemp;
 }
 
@@ -682,28 +1030,13 @@ Detach entity from player
 */
 void GAME_EXPORT CL_KillAttachedTents( int client )
 {
-	int	i;
-
 	if( client <= 0 || client > cl.maxclients )
 	{
 		MsgDev( D_ERROR, "Bad client %i in KillAttachedTents()!\n", client );
 		return;
 	}
 
-	for( i = 0; i < GI->max_tents; i++ )
-	{
-		TEMPENTITY *pTemp = &cl_tempents[i];
-
-		if( pTemp->flags & FTENT_PLYRATTACHMENT )
-		{
-			// this TEMPENTITY is player attached.
-			// if it is attached to this client, set it to die instantly.
-			if( pTemp->clientIndex == client )
-			{
-				pTemp->die = cl.time; // good enough, it will die on next tent update. 
-			}
-		}
-	}
+	CL_KillAttachedTentsFromEntity( client );
 }
 
 /*
@@ -715,21 +1048,21 @@ Detach entity from entity
 */
 void GAME_EXPORT CL_KillAttachedTentsFromEntity(int entity)
 {
-	int	i;
+	tentinfo_t	*info;
 
-	for (i = 0; i < GI->max_tents; i++)
+	if( entity <= 0 || entity >= MAX_EDICTS )
+		return;
+
+	CL_TEntClassifyPending();
+
+	for( info = cl_tentowners[entity]; info; info = info->ownernext )
 	{
-		TEMPENTITY* pTemp = &cl_tempents[i];
+		TEMPENTITY *pTemp = info->tent;
 
-		if (pTemp->flags & FTENT_PLYRATTACHMENT)
-		{
-			// this TEMPENTITY is entity attached.
-			// if it is attached to this entity, set it to die instantly.
-			if (pTemp->clientIndex == entity)
-			{
-				pTemp->die = cl.time; // good enough, it will die on next tent update. 
-			}
-		}
+		// this TEMPENTITY is entity attached.
+		// if it is still attached to this entity, set it to die instantly.
+		if( ( pTemp->flags & FTENT_PLYRATTACHMENT ) && pTemp->clientIndex == entity )
+			pTemp->die = cl.time; // good enough, it will die on next tent update.
 	}
 }
 
@@ -253,14 +253,40 @@ typedef enum
 	CL_CHANGELEVEL,	// draw 'loading' during changelevel
 } scrstate_t;
 
-typedef struct
+#define MAX_USER_MSG_HASH	(MAX_USER_MESSAGES >> 2)
+
+typedef struct cl_user_message_s
 {
 	char		name[32];
 	int		number;	// svc_ number
 	int		size;	// if size == -1, size come from first byte after svcnum
 	pfnUserMsgHook	func;	// user-defined function	
+	struct cl_user_message_s *hashNext;	// next message with the same name hash
+
+	// cl_usermsgstats counters
+	uint		count;
+	uint		bytes;
+	uint		copies;	// unaligned messages copied out of the net buffer
+	double		time;	// seconds spent in the hook
 } cl_user_message_t;
 
+#define MAX_IMAGES_HASH	(MAX_IMAGES >> 2)
+
+// name lookup for clgame.sprites, slot 0 is never used so it ends a chain
+typedef struct
+{
+	word		hash[MAX_IMAGES_HASH];	// first slot with this name hash
+	word		next[MAX_IMAGES];	// next slot in the same chain
+	word		key[MAX_IMAGES];	// chain the slot was linked into
+	word		free[MAX_IMAGES];	// empty slots, lowest on top
+	int		numfree;
+
+	// HUD_VidInit counters
+	int		lookups;
+	int		loaded;
+	double		loadtime;
+} cl_sprite_registry_t;
+
 typedef void (*pfnEventHook)( event_args_t *args );
 
 typedef struct
@@ -394,11 +420,16 @@ typedef struct
 	vec3_t               player_maxs[MAX_MAP_HULLS]; // 4 hulls allowed
 
 	cl_user_message_t    msg[MAX_USER_MESSAGES];     // keep static to avoid fragment memory
+	cl_user_message_t    *msgindex[MAX_USER_MESSAGES];       // by svc_num - svc_lastmsg, filled by CL_LinkUserMessage
+	cl_user_message_t    *msghash[MAX_USER_MSG_HASH];        // by name
+	int                  nummsgs;
+	cl_user_message_t    *credits;                   // Half-Life "HudText", may run final credits
 	cl_user_event_t      *events[MAX_EVENTS];
 
 	string               cdtracks[MAX_CDTRACKS];     // 32 cd-tracks read from cdaudio.txt
 
 	model_t              sprites[MAX_IMAGES];        // client spritetextures
+	cl_sprite_registry_t sprreg;                     // sprites by name
 	int                  load_sequence;              // for unloading unneeded sprites
 
 	client_draw_t        ds;                         // draw2d stuff (hud, weaponmenu etc)
@@ -526,7 +557,7 @@ typedef struct
 	file_t		*demofile;
 	file_t		*demoheader;		// contain demo startup info in case we record a demo on this level
 	qboolean keybind_changed;
-	qboolean splitcompress;			// enabled only on server->client netchan
+	int	splitcompress;			// NET_CODEC_*, enabled only on server->client netchan
 	qboolean need_save_config;
 	qboolean internetservers_wait;	// internetservers is waiting for dns request
 	qboolean internetservers_pending;	// internetservers is waiting for dns request
@@ -595,6 +626,7 @@ void CL_SetLightstyle( int style, const char* s, float f );
 void CL_RunLightStyles( void );
 
 void CL_AddEntities( void );
+void CL_SimulateEntities( void );
 void CL_DecayLights( void );
 
 //=================================================
@@ -631,6 +663,19 @@ void CL_ClearState( void );
 //
 // cl_demo.c
 //
+enum
+{
+	TD_PARSE = 0,	// CL_ReadPackets
+	TD_PREDICT,	// CL_PredictMovement
+	TD_ENTITIES,	// packet entities interpolation and client.dll entities
+	TD_TEMPENTS,	// events and temp entities
+	TD_PARTICLES,	// particles simulation
+	TD_BONES,		// studio bone setup
+	TD_RENDER,	// SCR_UpdateScreen (not headless only)
+	TD_FRAME,		// whole client frame
+	TD_STATS
+};
+
 void CL_StartupDemoHeader( void );
 void CL_DrawDemoRecording( void );
 void CL_WriteDemoUserCmd( int cmdnumber );
@@ -648,6 +693,12 @@ void CL_DeleteDemo_f( void );
 void CL_Record_f( void );
 void CL_Stop_f( void );
 void CL_FreeDemo( void );
+void CL_TimeDemo_f( void );
+void CL_DemoSeek_f( void );
+void CL_DemoSkip_f( void );
+qboolean CL_TimeDemoHeadless( void );
+void CL_TimeDemoSample( int stat, double start );
+void CL_TimeDemoEndFrame( double start );
 
 //
 // cl_events.c
@@ -670,7 +721,9 @@ void CL_FireEvents( void );
 void CL_UnloadProgs( void );
 qboolean CL_LoadProgs( const char *name );
 void CL_ParseUserMessage( sizebuf_t *msg, int svc_num );
+void CL_UserMsgStats_f( void );
 void CL_LinkUserMessage( char *pszName, const int svc_num, int iSize );
+cl_user_message_t *CL_FindUserMessage( const char *pszName );
 void CL_ParseTextMessage( sizebuf_t *msg );
 void CL_DrawHUD( int state );
 void CL_GetMousePosition ( int *x, int *y );
@@ -687,6 +740,7 @@ int pfnIndexFromTrace( struct pmtrace_s *pTrace );
 int CL_FindModelIndex( const char *m );
 HSPRITE pfnSPR_Load( const char *szPicName );
 HSPRITE pfnSPR_LoadExt( const char *szPicName, uint texFlags );
+void CL_VidInitHud( void );
 void SPR_AdjustSize( float *x, float *y, float *w, float *h );
 void TextAdjustSize( int *x, int *y, int *w, int *h );
 void TextAdjustSizeReverse( int *x, int *y, int *w, int *h );
@@ -823,10 +877,13 @@ void CL_InitParticles( void );
 void CL_ClearParticles( void );
 void CL_FreeParticles( void );
 void CL_DrawParticles( void );
+void CL_SimulateParticles( void );
+void CL_ParticleBench_f( void );
 void CL_InitTempEnts( void );
 void CL_ClearTempEnts( void );
 void CL_FreeTempEnts( void );
 void CL_AddTempEnts( void );
+void CL_TempEntStats_f( void );
 void CL_InitViewBeams( void );
 void CL_ClearViewBeams( void );
 void CL_FreeViewBeams( void );
@@ -1871,45 +1871,6 @@ namespace xe {
 			MsgDev(D_INFO, "TexLru : load external texture %s\n", src.path.c_str());
 			return std::shared_ptr<gltexture_t>{ tex, TexLru_ReleaseTexture };
 		}
-		std::shared_ptr<gltexture_t> operator()(texlru_src_internal_s &src) const
-		{
-			byte *buf = FS_LoadFile( src.model_name.c_str(), NULL, false );
-			if(!buf)
-			{
-				MsgDev(D_ERROR, "TexLru : fail to load internal texture %s from %s\n", src.texture.name, src.model_name.c_str());
-				return {}; // couldn't loading image
-			}
-
-			Mod_DecryptModel(src.model_name.c_str(), buf);
-			byte *buf2 = Mod_LoadExtendSeq(src.model_name.c_str(), buf);
-			studiohdr_t *phdr = (studiohdr_t *)buf2;
-
-			Image_SetMDLPointer((byte *)phdr + src.texture.index);
-
-			int flags = tex->flags;
-			// hack : expected mstudiotexture_t* as buffer
-			auto pic = FS_LoadImage( src.texture_name.c_str(), (byte *)&src.texture, src.size );
-			if( !pic )
-			{
-				Mem_Free( buf );
-				MsgDev(D_ERROR, "TexLru : fail to load internal texture %s from %s\n", src.texture.name, src.model_name.c_str());
-				return {}; // couldn't loading image
-			}
-
-			// force upload texture as RGB or RGBA (detail textures requires this)
-			if( flags & TF_FORCE_COLOR ) pic->flags |= IMAGE_HAS_COLOR;
-
-			GL_UploadTexture( pic, tex, false, filter );
-			GL_TexFilter( tex, false ); // update texture filter, wrap etc
-
-			if(!( flags & ( TF_KEEP_8BIT|TF_KEEP_RGBDATA )))
-				pic = nullptr; // release source texture
-
-			Mem_Free( buf );
-
-			MsgDev(D_INFO, "TexLru : load internal texture %s from %s\n", src.texture.name, src.model_name.c_str());
-			return std::shared_ptr<gltexture_t>{ tex, TexLru_ReleaseTexture };
-		}
 	};
 
 	template<class Key, class Value>
@@ -2036,6 +1997,93 @@ namespace xe {
 
 	static lru_cache<int, std::shared_ptr<gltexture_t>> textureCache(0);
 
+	/*
+	the first draw of a model texture reads and decrypts the whole .mdl,
+	so decode every other non resident texture of the model with the same
+	read, on all cores. only the GL upload stays on this thread
+	*/
+	static void TexLru_UploadModel( gltexture_t *first )
+	{
+		const std::string model_name = std::get<texlru_src_internal_s>(first->texlru_extdata->src).model_name;
+		size_t limit = r_texlru->integer > 0 ? r_texlru->integer : r_textures.size();
+		std::vector<gltexture_t *> texs;
+		std::vector<imgdecode_t> jobs;
+		size_t i;
+
+		for( i = 1; i < r_textures.size() && texs.size() + 1 < limit; i++ )
+		{
+			gltexture_t *tex = &r_textures[i];
+			if( tex == first || !tex->texlru_extdata || textureCache.contains( i ))
+				continue;
+
+			auto src = std::get_if<texlru_src_internal_s>(&tex->texlru_extdata->src);
+			if( src && src->model_name == model_name )
+				texs.push_back( tex );
+		}
+
+		// requested one goes last to be the most recently used
+		texs.push_back( first );
+
+		byte *buf = FS_LoadFile( model_name.c_str(), NULL, false );
+		if(!buf)
+		{
+			MsgDev(D_ERROR, "TexLru : fail to load internal textures from %s\n", model_name.c_str());
+			return; // couldn't loading image
+		}
+
+		Mod_DecryptModel(model_name.c_str(), buf);
+		byte *buf2 = Mod_LoadExtendSeq(model_name.c_str(), buf);
+		studiohdr_t *phdr = (studiohdr_t *)buf2;
+
+		jobs.resize( texs.size() );
+		for( i = 0; i < texs.size(); i++ )
+		{
+			auto &src = std::get<texlru_src_internal_s>(texs[i]->texlru_extdata->src);
+			imgdecode_t &job = jobs[i];
+
+			// hack : expected mstudiotexture_t* as buffer
+			job.name = src.texture_name.c_str();
+			job.buffer = (const byte *)&src.texture;
+			job.size = src.size;
+			job.mdltexdata = (byte *)phdr + src.texture.index;
+
+			if( texs[i]->flags & TF_NOFLIP_TGA )
+				job.force_flags |= IL_DONTFLIP_TGA;
+			if( texs[i]->flags & TF_KEEP_8BIT )
+				job.force_flags |= IL_KEEP_8BIT;
+
+			// expand the palette on the workers unless the indexed source is needed
+			if(!( texs[i]->flags & ( TF_KEEP_8BIT|TF_MAKELUMA )))
+				job.process_flags = IMAGE_FORCE_RGBA;
+		}
+
+		FS_LoadImageBatch( jobs.data(), (int)jobs.size() );
+
+		for( i = 0; i < texs.size(); i++ )
+		{
+			gltexture_t *tex = texs[i];
+			auto &src = std::get<texlru_src_internal_s>(tex->texlru_extdata->src);
+			image_ref pic = jobs[i].pic;
+
+			if( !pic )
+			{
+				MsgDev(D_ERROR, "TexLru : fail to load internal texture %s from %s\n", src.texture.name, model_name.c_str());
+				continue;
+			}
+
+			// force upload texture as RGB or RGBA (detail textures requires this)
+			if( tex->flags & TF_FORCE_COLOR ) pic->flags |= IMAGE_HAS_COLOR;
+
+			GL_UploadTexture( pic, tex, false, tex->texlru_extdata->filter );
+			GL_TexFilter( tex, false ); // update texture filter, wrap etc
+
+			MsgDev(D_INFO, "TexLru : load internal texture %s from %s\n", src.texture.name, model_name.c_str());
+			textureCache.insert( tex->texnum, std::shared_ptr<gltexture_t>{ tex, TexLru_ReleaseTexture } );
+		}
+
+		Mem_Free( buf );
+	}
+
 	void TexLru_Upload( mstudiotexture_t *ptexture )
 	{
 		int texnum = ptexture->index;
@@ -2055,7 +2103,13 @@ namespace xe {
 		textureCache.set_capacity(r_texlru->integer);
 
 		auto &lrudata = *tex->texlru_extdata;
-		auto deleter = std::visit(TexLru_Uploader{ tex, lrudata.filter, ptexture }, lrudata.src);
+		if (std::holds_alternative<texlru_src_internal_s>(lrudata.src))
+		{
+			TexLru_UploadModel(tex);
+			return;
+		}
+
+		auto deleter = TexLru_Uploader{ tex, lrudata.filter, ptexture }(std::get<texlru_src_external_s>(lrudata.src));
 		textureCache.insert((GLuint)texnum, std::move(deleter));
 	}
 
@@ -24,6 +24,7 @@ GNU General Public License for more details.
 #include "triangleapi.h"
 #include "cl_tent.h"
 #include "studio.h"
+#include "simd.h"
 
 /*
 ==============================================================
@@ -98,6 +99,7 @@ particle_t	*cl_active_particles;
 particle_t	*cl_free_particles;
 particle_t	*cl_particles = NULL;	// particle pool
 static vec3_t	cl_avelocities[NUMVERTEXNORMALS];
+static int	cl_numparticles;		// active list plus batched particles
 #define		COL_SUM( pal, clr )	(pal - clr) * (pal - clr)
 
 /*
@@ -146,6 +148,399 @@ void GAME_EXPORT CL_GetPackedColor( short *packed, short color )
 	if( packed ) *packed = 0;
 }
 
+/*
+==============================================================
+
+PARTICLE BATCHES
+
+built-in particles are moved from the particle_t list into
+per-type structure-of-arrays batches and updated by vector
+kernels. Particles with a callback or deathfunc stay on the list
+
+==============================================================
+*/
+#define PARTBATCH_TYPES	( pt_vox_grav + 1 )
+#define PARTBATCH_MIN	256
+
+typedef struct partbatch_s
+{
+	float		*org[3];
+	float		*vel[3];
+	float		*ramp;
+	float		*die;
+	short		*color;
+	int		count;
+	int		maxcount;		// always multiple of 4
+	void		*mem;
+} partbatch_t;
+
+static partbatch_t	cl_partbatch[PARTBATCH_TYPES];
+static short	cl_blobcolors[SPARK_COLORCOUNT];
+
+/*
+================
+CL_PartBatchReserve
+
+grow batch arrays, keeping 16-byte alignment
+================
+*/
+static qboolean CL_PartBatchReserve( partbatch_t *b, int count )
+{
+	int	i, newmax;
+	size_t	stride;
+	byte	*mem;
+
+	if( count <= b->maxcount )
+		return true;
+
+	newmax = max( max( b->maxcount * 2, count ), PARTBATCH_MIN );
+	newmax = ( newmax + 3 ) & ~3;
+	stride = newmax * sizeof( float );
+
+	mem = (byte *)Mem_AlignedAlloc( cls.mempool, stride * 8 + newmax * sizeof( short ), SIMD_ALIGN );
+	if( !mem ) return false;
+
+	for( i = 0; i < 3; i++ )
+	{
+		float	*org = (float *)( mem + stride * i );
+		float	*vel = (float *)( mem + stride * ( i + 3 ));
+
+		if( b->count )
+		{
+			memcpy( org, b->org[i], b->count * sizeof( float ));
+			memcpy( vel, b->vel[i], b->count * sizeof( float ));
+		}
+		b->org[i] = org;
+		b->vel[i] = vel;
+	}
+
+	if( b->count )
+	{
+		memcpy( mem + stride * 6, b->ramp, b->count * sizeof( float ));
+		memcpy( mem + stride * 7, b->die, b->count * sizeof( float ));
+		memcpy( mem + stride * 8, b->color, b->count * sizeof( short ));
+	}
+
+	b->ramp = (float *)( mem + stride * 6 );
+	b->die = (float *)( mem + stride * 7 );
+	b->color = (short *)( mem + stride * 8 );
+
+	if( b->mem ) Mem_Free( b->mem );
+	b->mem = mem;
+	b->maxcount = newmax;
+
+	return true;
+}
+
+static void CL_PartBatchFree( partbatch_t *b )
+{
+	if( b->mem ) Mem_Free( b->mem );
+	memset( b, 0, sizeof( *b ));
+}
+
+static qboolean CL_PartBatchPush( partbatch_t *b, const particle_t *p )
+{
+	int	i, n = b->count;
+
+	if( !CL_PartBatchReserve( b, n + 1 ))
+		return false;
+
+	for( i = 0; i < 3; i++ )
+	{
+		b->org[i][n] = p->org[i];
+		b->vel[i][n] = p->vel[i];
+	}
+
+	b->ramp[n] = p->ramp;
+	b->die[n] = p->die;
+	b->color[n] = p->color;
+	b->count++;
+
+	return true;
+}
+
+/*
+================
+CL_PartBatchCompact
+
+remove time-expired particles, return number of killed
+================
+*/
+static int CL_PartBatchCompact( partbatch_t *b, float time )
+{
+	int	i, j, last, killed = 0;
+
+	for( i = 0; i < b->count; )
+	{
+		if( b->die[i] >= time )
+		{
+			i++;
+			continue;
+		}
+
+		// move the last one into the hole
+		last = --b->count;
+
+		for( j = 0; j < 3; j++ )
+		{
+			b->org[j][i] = b->org[j][last];
+			b->vel[j][i] = b->vel[j][last];
+		}
+
+		b->ramp[i] = b->ramp[last];
+		b->die[i] = b->die[last];
+		b->color[i] = b->color[last];
+		killed++;
+	}
+
+	return killed;
+}
+
+/*
+================
+CL_PartKernel*
+
+batch arrays are aligned and padded to 4 elements
+================
+*/
+static void CL_PartKernelAdd( float *dst, int count, float add )
+{
+	int	i = 0;
+#ifdef XASH_SIMD_SSE2
+	__m128	vadd = _mm_set1_ps( add );
+
+	for( ; i + 4 <= count; i += 4 )
+		_mm_store_ps( dst + i, _mm_add_ps( _mm_load_ps( dst + i ), vadd ));
+#endif
+	for( ; i < count; i++ )
+		dst[i] += add;
+}
+
+static void CL_PartKernelScale( float *dst, int count, float scale )
+{
+	int	i = 0;
+#ifdef XASH_SIMD_SSE2
+	__m128	vscale = _mm_set1_ps( scale );
+
+	for( ; i + 4 <= count; i += 4 )
+		_mm_store_ps( dst + i, _mm_mul_ps( _mm_load_ps( dst + i ), vscale ));
+#endif
+	for( ; i < count; i++ )
+		dst[i] *= scale;
+}
+
+static void CL_PartKernelMA( float *dst, const float *src, int count, float scale )
+{
+	int	i = 0;
+#ifdef XASH_SIMD_SSE2
+	__m128	vscale = _mm_set1_ps( scale );
+
+	for( ; i + 4 <= count; i += 4 )
+		_mm_store_ps( dst + i, _mm_add_ps( _mm_load_ps( dst + i ), _mm_mul_ps( _mm_load_ps( src + i ), vscale )));
+#endif
+	for( ; i < count; i++ )
+		dst[i] += src[i] * scale;
+}
+
+// advance ramp and mark particles that ran out of ramp as dead
+static void CL_PartKernelRamp( float *ramp, float *die, int count, float add, float limit )
+{
+	int	i = 0;
+#ifdef XASH_SIMD_SSE2
+	__m128	vadd = _mm_set1_ps( add );
+	__m128	vlimit = _mm_set1_ps( limit );
+	__m128	vdead = _mm_set1_ps( -1.0f );
+
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128	r = _mm_add_ps( _mm_load_ps( ramp + i ), vadd );
+		__m128	mask = _mm_cmpge_ps( r, vlimit );
+		__m128	d = _mm_load_ps( die + i );
+
+		_mm_store_ps( ramp + i, r );
+		_mm_store_ps( die + i, _mm_or_ps( _mm_and_ps( mask, vdead ), _mm_andnot_ps( mask, d )));
+	}
+#endif
+	for( ; i < count; i++ )
+	{
+		ramp[i] += add;
+		if( ramp[i] >= limit ) die[i] = -1;
+	}
+}
+
+static void CL_PartBatchRampColors( partbatch_t *b, const int *colors, int numcolors )
+{
+	int	i;
+
+	for( i = 0; i < b->count; i++ )
+	{
+		if( b->ramp[i] < numcolors )
+			b->color[i] = colors[(int)b->ramp[i]];
+	}
+}
+
+static void CL_PartBatchBlobColors( partbatch_t *b )
+{
+	int	i, iRamp;
+
+	for( i = 0; i < b->count; i++ )
+	{
+		iRamp = (int)b->ramp[i] >> SIMSHIFT;
+
+		if( iRamp >= SPARK_COLORCOUNT )
+		{
+			b->ramp[i] = 0.0f;
+			iRamp = 0;
+		}
+
+		b->color[i] = cl_blobcolors[iRamp];
+	}
+}
+
+/*
+================
+CL_UpdateParticleBatch
+
+same as CL_UpdateParticle, for a whole batch of one type
+================
+*/
+static void CL_UpdateParticleBatch( partbatch_t *b, int type, float ft, float grav )
+{
+	int	i;
+
+	if( !b->count ) return;
+
+	switch( type )
+	{
+	case pt_static:
+		break;
+	case pt_fire:
+		CL_PartKernelRamp( b->ramp, b->die, b->count, 5.0f * ft, 6.0f );
+		CL_PartBatchRampColors( b, ramp3, 6 );
+		CL_PartKernelAdd( b->vel[2], b->count, grav );
+		break;
+	case pt_explode:
+		CL_PartKernelRamp( b->ramp, b->die, b->count, 10.0f * ft, 8.0f );
+		CL_PartBatchRampColors( b, ramp1, 8 );
+		for( i = 0; i < 3; i++ )
+			CL_PartKernelScale( b->vel[i], b->count, 1.0f + 4.0f * ft );
+		CL_PartKernelAdd( b->vel[2], b->count, -grav );
+		break;
+	case pt_explode2:
+		CL_PartKernelRamp( b->ramp, b->die, b->count, 15.0f * ft, 8.0f );
+		CL_PartBatchRampColors( b, ramp2, 8 );
+		for( i = 0; i < 3; i++ )
+			CL_PartKernelScale( b->vel[i], b->count, 1.0f - ft );
+		CL_PartKernelAdd( b->vel[2], b->count, -grav );
+		break;
+	case pt_blob:
+		CL_PartKernelAdd( b->ramp, b->count, 10.0f * ft );
+		CL_PartBatchBlobColors( b );
+		for( i = 0; i < 2; i++ )
+			CL_PartKernelScale( b->vel[i], b->count, 1.0f - 0.5f * ft );
+		CL_PartKernelAdd( b->vel[2], b->count, -grav * 5.0f );
+		break;
+	case pt_grav:
+		CL_PartKernelAdd( b->vel[2], b->count, -grav * 20.0f );
+		break;
+	case pt_slowgrav:
+		CL_PartKernelAdd( b->vel[2], b->count, -grav );
+		break;
+	case pt_vox_grav:
+		CL_PartKernelAdd( b->vel[2], b->count, -grav * 8.0f );
+		break;
+	case pt_vox_slowgrav:
+		CL_PartKernelAdd( b->vel[2], b->count, -grav * 4.0f );
+		break;
+	}
+}
+
+static void CL_MoveParticleBatch( partbatch_t *b, float ft )
+{
+	int	i;
+
+	for( i = 0; i < 3; i++ )
+		CL_PartKernelMA( b->org[i], b->vel[i], b->count, ft );
+}
+
+/*
+================
+CL_DrawParticleBatch
+
+render mode and texture must be already set
+================
+*/
+static void CL_DrawParticleBatch( partbatch_t *b, int type )
+{
+	vec3_t	right, up;
+	float	x, y, z;
+	byte	*color;
+	int	i;
+
+	if( !b->count ) return;
+
+	VectorScale( RI.vright, 1.5f, right );
+	VectorScale( RI.vup, 1.5f, up );
+
+	pglBegin( GL_QUADS );
+
+	for( i = 0; i < b->count; i++ )
+	{
+		// blobs are visible only at one frame of four
+		if( type == pt_blob && Com_RandomLong( 0, 3 ))
+			continue;
+
+		color = clgame.palette[bound( 0, b->color[i], 255 )];
+		x = b->org[0][i];
+		y = b->org[1][i];
+		z = b->org[2][i];
+
+		pglColor4ub( color[0], color[1], color[2], 255 );
+		pglTexCoord2f( 0.0f, 1.0f );
+		pglVertex3f( x - right[0] + up[0], y - right[1] + up[1], z - right[2] + up[2] );
+		pglTexCoord2f( 0.0f, 0.0f );
+		pglVertex3f( x + right[0] + up[0], y + right[1] + up[1], z + right[2] + up[2] );
+		pglTexCoord2f( 1.0f, 0.0f );
+		pglVertex3f( x + right[0] - up[0], y + right[1] - up[1], z + right[2] - up[2] );
+		pglTexCoord2f( 1.0f, 1.0f );
+		pglVertex3f( x - right[0] - up[0], y - right[1] - up[1], z - right[2] - up[2] );
+	}
+
+	pglEnd();
+
+	r_stats.c_particle_count += b->count;
+}
+
+/*
+================
+CL_ParticleBatchType
+
+returns batch index or -1 if particle must stay on the list
+================
+*/
+static int CL_ParticleBatchType( const particle_t *p )
+{
+	if( p->callback || p->deathfunc )
+		return -1;
+
+	if( p->type < pt_static || p->type > pt_vox_grav )
+		return -1;
+
+	// blob2 is only a visibility flag for blob
+	if( p->type == pt_blob2 )
+		return pt_blob;
+
+	return p->type;
+}
+
+static void CL_BuildBlobColors( void )
+{
+	int	i;
+
+	for( i = 0; i < SPARK_COLORCOUNT; i++ )
+		cl_blobcolors[i] = CL_LookupColor( gSparkRamp[i][0], gSparkRamp[i][1], gSparkRamp[i][2] );
+}
+
 /*
 ================
 CL_InitParticles
@@ -195,6 +590,10 @@ void CL_ClearParticles( void )
 		cl_particles[i].next = &cl_particles[i+1];
 
 	cl_particles[GI->max_particles-1].next = NULL;
+
+	for( i = 0; i < PARTBATCH_TYPES; i++ )
+		cl_partbatch[i].count = 0;
+	cl_numparticles = 0;
 }
 
 /*
@@ -205,9 +604,15 @@ CL_FreeParticles
 */
 void CL_FreeParticles( void )
 {
+	int	i;
+
 	if( cl_particles )
 		Mem_Free( cl_particles );
 	cl_particles = NULL;
+
+	for( i = 0; i < PARTBATCH_TYPES; i++ )
+		CL_PartBatchFree( &cl_partbatch[i] );
+	cl_numparticles = 0;
 }
 
 /*
@@ -227,6 +632,7 @@ void CL_FreeParticle( particle_t *p )
 
 	p->next = cl_free_particles;
 	cl_free_particles = p;
+	cl_numparticles--;
 }
 
 /*
@@ -246,7 +652,7 @@ particle_t *GAME_EXPORT CL_AllocParticle( void (*callback)( particle_t*, float )
 	// never alloc particles when we not in game
 	if( !CL_IsInGame( )) return NULL;
 
-	if( !cl_free_particles )
+	if( !cl_free_particles || cl_numparticles >= GI->max_particles )
 	{
 		MsgDev( D_NOTE, "Overflow %d particles\n", GI->max_particles );
 		return NULL;
@@ -256,6 +662,7 @@ particle_t *GAME_EXPORT CL_AllocParticle( void (*callback)( particle_t*, float )
 	cl_free_particles = p->next;
 	p->next = cl_active_particles;
 	cl_active_particles = p;
+	cl_numparticles++;
 
 	// clear old particle
 	p->type = pt_static;
@@ -529,11 +936,48 @@ void CL_UpdateParticle( particle_t *p, float ft )
 	}
 }
 
+/*
+================
+CL_GatherParticles
+
+free time-expired particles and move built-in ones into batches
+================
+*/
+static void CL_GatherParticles( void )
+{
+	particle_t	*p, **prev;
+	int		type;
+
+	for( prev = &cl_active_particles; ( p = *prev ) != NULL; )
+	{
+		if( p->die < cl.time )
+		{
+			*prev = p->next;
+			CL_FreeParticle( p );
+			continue;
+		}
+
+		type = CL_ParticleBatchType( p );
+
+		if( type != -1 && CL_PartBatchPush( &cl_partbatch[type], p ))
+		{
+			// still counted in cl_numparticles
+			*prev = p->next;
+			p->next = cl_free_particles;
+			cl_free_particles = p;
+			continue;
+		}
+
+		prev = &p->next;
+	}
+}
+
 void CL_DrawParticles( void )
 {
-	particle_t	*p, *kill;
-	float		frametime;
+	particle_t	*p;
+	float		frametime, grav;
 	static int	framecount = -1;
+	int		i;
 
 	if( !cl_draw_particles->integer )
 		return;
@@ -555,35 +999,144 @@ void CL_DrawParticles( void )
 		tracerred->modified = tracergreen->modified = tracerblue->modified = false;
 	}
 
-	while( 1 ) 
+	CL_GatherParticles();
+
+	grav = frametime * clgame.movevars.gravity * 0.05f;
+
+	if( cl_partbatch[pt_blob].count )
+		CL_BuildBlobColors();
+
+	GL_SetRenderMode( kRenderTransTexture );
+
+	if( r_oldparticles->integer == 1 )
+		GL_Bind( XASH_TEXTURE0, cls.oldParticleImage );
+	else
+		GL_Bind( XASH_TEXTURE0, cls.particleImage );
+
+	for( i = 0; i < PARTBATCH_TYPES; i++ )
 	{
-		// free time-expired particles
-		kill = cl_active_particles;
-		if( kill && kill->die < cl.time )
-		{
-			cl_active_particles = kill->next;
-			CL_FreeParticle( kill );
-			continue;
-		}
-		break;
+		partbatch_t	*b = &cl_partbatch[i];
+
+		cl_numparticles -= CL_PartBatchCompact( b, cl.time );
+		CL_UpdateParticleBatch( b, i, frametime, grav );
+		CL_DrawParticleBatch( b, i );
+		CL_MoveParticleBatch( b, frametime );
+	}
+
+	for( p = cl_active_particles; p; p = p->next )
+		CL_UpdateParticle( p, frametime );
+}
+
+/*
+================
+CL_SimulateParticles
+
+CL_DrawParticles without the drawing, for headless timedemo.
+custom and tracer callbacks draw by themselves so these
+particles are only moved
+================
+*/
+void CL_SimulateParticles( void )
+{
+	particle_t	*p;
+	float		frametime, grav;
+	int		i;
+
+	if( !cl_draw_particles->integer )
+		return;
+
+	frametime = cl.time - cl.oldtime;
+
+	CL_GatherParticles();
+
+	grav = frametime * clgame.movevars.gravity * 0.05f;
+
+	if( cl_partbatch[pt_blob].count )
+		CL_BuildBlobColors();
+
+	for( i = 0; i < PARTBATCH_TYPES; i++ )
+	{
+		partbatch_t	*b = &cl_partbatch[i];
+
+		cl_numparticles -= CL_PartBatchCompact( b, cl.time );
+		CL_UpdateParticleBatch( b, i, frametime, grav );
+		CL_MoveParticleBatch( b, frametime );
 	}
 
 	for( p = cl_active_particles; p; p = p->next )
 	{
-		while( 1 )
+		if( p->type != pt_clientcustom )
+			VectorMA( p->org, frametime, p->vel, p->org );
+	}
+}
+
+/*
+================
+CL_ParticleBench_f
+
+simulate batched particles without rendering
+================
+*/
+void CL_ParticleBench_f( void )
+{
+	static const ptype_t types[] = { pt_grav, pt_slowgrav, pt_fire, pt_explode, pt_explode2, pt_blob };
+	partbatch_t	bench[PARTBATCH_TYPES];
+	int		i, j, count, frames, total = 0;
+	float		time = 0.0f, ft = 1.0f / 60.0f;
+	double		start, end;
+	particle_t	p;
+
+	count = ( Cmd_Argc() > 1 ) ? Q_atoi( Cmd_Argv( 1 )) : 32768;
+	frames = ( Cmd_Argc() > 2 ) ? Q_atoi( Cmd_Argv( 2 )) : 300;
+	count = max( count, 1 );
+	frames = max( frames, 1 );
+
+	memset( bench, 0, sizeof( bench ));
+	memset( &p, 0, sizeof( p ));
+	CL_BuildBlobColors();
+
+	start = Sys_DoubleTime();
+
+	for( i = 0; i < frames; i++, time += ft )
+	{
+		int	alive = 0;
+
+		for( j = 0; j < PARTBATCH_TYPES; j++ )
 		{
-			kill = p->next;
-			if( kill && kill->die < cl.time )
-			{
-				p->next = kill->next;
-				CL_FreeParticle( kill );
-				continue;
-			}
-			break;
+			CL_PartBatchCompact( &bench[j], time );
+			CL_UpdateParticleBatch( &bench[j], j, ft, ft * 800.0f * 0.05f );
+			CL_MoveParticleBatch( &bench[j], ft );
+			alive += bench[j].count;
 		}
 
-		CL_UpdateParticle( p, frametime );
+		total += alive;
+
+		// keep the pool full like a continuous emitter does
+		for( j = alive; j < count; j++ )
+		{
+			p.type = types[j % ARRAYSIZE( types )];
+			p.die = time + Com_RandomFloat( 0.5f, 5.0f );
+			p.ramp = rand() & 3;
+			p.color = ramp1[0];
+			VectorSet( p.org, Com_RandomFloat( -16, 16 ), Com_RandomFloat( -16, 16 ), Com_RandomFloat( -16, 16 ));
+			VectorSet( p.vel, Com_RandomFloat( -256, 256 ), Com_RandomFloat( -256, 256 ), Com_RandomFloat( -256, 256 ));
+			CL_PartBatchPush( &bench[CL_ParticleBatchType( &p )], &p );
+		}
 	}
+
+	end = Sys_DoubleTime();
+
+	for( j = 0; j < PARTBATCH_TYPES; j++ )
+		CL_PartBatchFree( &bench[j] );
+
+	Msg( "partbench: %i particles, %i frames, %.3f ms/frame, %.2f ns/particle (%s)\n",
+		count, frames, ( end - start ) * 1000.0 / frames,
+		total ? ( end - start ) * 1e9 / total : 0.0,
+#ifdef XASH_SIMD_SSE2
+		"simd" );
+#else
+		"scalar" );
+#endif
 }
 
 void CL_DrawParticlesExternal( const vec3_t vieworg, const vec3_t forward, const vec3_t right, const vec3_t up, uint clipFlags )
@@ -1769,6 +2322,7 @@ void CL_ReadPointFile_f( void )
 		cl_free_particles = p->next;
 		p->next = cl_active_particles;
 		cl_active_particles = p;
+		cl_numparticles++;
 
 		p->ramp = 0;		
 		p->die = 99999;
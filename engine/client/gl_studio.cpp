@@ -4070,6 +4070,50 @@ void R_RunViewmodelEvents( void )
 	RI.currentmodel = NULL;
 }
 
+/*
+=================
+R_StudioSetupSceneBones
+
+headless timedemo: set up bones of the visible
+studio entities without issuing any draw calls
+=================
+*/
+void R_StudioSetupSceneBones( void )
+{
+	cl_entity_t	*e;
+	int		i;
+
+	if( !pStudioDraw ) return;
+
+	for( i = 0; i < tr.num_solid_entities + tr.num_trans_entities; i++ )
+	{
+		if( i < tr.num_solid_entities )
+			e = tr.solid_entities[i];
+		else e = tr.trans_entities[i - tr.num_solid_entities];
+
+		if( !e->model || e->model->type != mod_studio )
+			continue;
+
+		if( !Mod_Extradata( e->model ))
+			continue;
+
+		if( r_studio_lerping->integer )
+			m_fDoInterp = (e->curstate.effects & EF_NOINTERP) ? false : true;
+		else m_fDoInterp = false;
+
+		RI.currententity = e;
+		RI.currentmodel = e->model;
+
+		// no STUDIO_RENDER and no STUDIO_EVENTS: bones only
+		if( e->player )
+			pStudioDraw->StudioDrawPlayer( 0, &e->curstate );
+		else pStudioDraw->StudioDrawModel( 0 );
+	}
+
+	RI.currententity = NULL;
+	RI.currentmodel = NULL;
+}
+
 /*
 =================
 R_DrawViewModel
@@ -15,11 +15,23 @@
 
 #include "physics.h"
 
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <LinearMath/btThreads.h>
+#include <boost/asio.hpp>
+#include <algorithm>
+
 convar_t *bv_debug;
 convar_t* bv_enable;
 convar_t *bv_simrate;
 convar_t* bv_scale;
 convar_t* bv_force_ragdoll_sequence;
+convar_t* bv_async;
+convar_t* bv_threads;
+convar_t* bv_lod_near;
+convar_t* bv_lod_far;
+convar_t* bv_ragdoll_max;
 
 extern model_t	cm_models[MAX_MODELS];
 extern int	cm_nummodels;
@@ -311,7 +323,8 @@ namespace physics
 
 	CPhysicsManager::CPhysicsManager()
 	{
-
+		m_solverPool = NULL;
+		m_numThreads = -1;
 	}
 
 	void BV_Reload_f(void)
@@ -320,6 +333,14 @@ namespace physics
 		gPhysicsManager.RemoveAllRagdolls();
 	}
 
+	void BV_Bench_f(void)
+	{
+		int count = Cmd_Argc() > 1 ? Q_atoi(Cmd_Argv(1)) : 40;
+		int frames = Cmd_Argc() > 2 ? Q_atoi(Cmd_Argv(2)) : 600;
+
+		gPhysicsManager.Benchmark(bound(1, count, 256), bound(1, frames, 100000));
+	}
+
 	void CPhysicsManager::Init(void)
 	{
 		bv_debug = Cvar_Get("bv_debug", "0", FCVAR_CLIENTDLL, "");
@@ -327,12 +348,36 @@ namespace physics
 		bv_scale = Cvar_Get("bv_scale", "0.25", FCVAR_CLIENTDLL | FCVAR_ARCHIVE, "");
 		bv_enable = Cvar_Get("bv_enable", "1", FCVAR_CLIENTDLL | FCVAR_ARCHIVE, "");
 		bv_force_ragdoll_sequence = Cvar_Get("bv_force_ragdoll_sequence", "0", FCVAR_CLIENTDLL, "");
+		bv_async = Cvar_Get("bv_async", "1", FCVAR_CLIENTDLL | FCVAR_ARCHIVE, "step ragdoll simulation on a worker thread");
+		bv_threads = Cvar_Get("bv_threads", "0", FCVAR_CLIENTDLL | FCVAR_ARCHIVE, "bullet task scheduler threads, 0 for all cores");
+		bv_lod_near = Cvar_Get("bv_lod_near", "1024", FCVAR_CLIENTDLL | FCVAR_ARCHIVE, "world is stepped at half rate when no ragdoll is closer than this, 0 to always step at full rate");
+		bv_lod_far = Cvar_Get("bv_lod_far", "3072", FCVAR_CLIENTDLL | FCVAR_ARCHIVE, "ragdolls farther than this are frozen, 0 to disable");
+		bv_ragdoll_max = Cvar_Get("bv_ragdoll_max", "32", FCVAR_CLIENTDLL | FCVAR_ARCHIVE, "max simulated dead ragdolls, oldest are evicted first, 0 for no limit");
 		Cmd_AddCommand("bv_reload", BV_Reload_f, "remove all rigbody and reload bullet cfg");
+		Cmd_AddCommand("bv_bench", BV_Bench_f, "drop ragdolls on the current map and time the simulation: bv_bench [count] [frames]");
+
+		gDeactivationTime = RAGDOLL_DEACTIVATION_TIME;
+#if BT_THREADSAFE
+		// solve ragdoll islands in parallel
+		btSetTaskScheduler(btCreateDefaultTaskScheduler());
+
+		btDefaultCollisionConstructionInfo cci;
+		cci.m_defaultMaxPersistentManifoldPoolSize = 8192;
+		cci.m_defaultMaxCollisionAlgorithmPoolSize = 8192;
+		m_collisionConfiguration = new btDefaultCollisionConfiguration(cci);
+		m_dispatcher = new btCollisionDispatcherMt(m_collisionConfiguration, 40);
+		m_overlappingPairCache = new btDbvtBroadphase();
+		m_solverPool = new btConstraintSolverPoolMt(BT_MAX_THREAD_COUNT);
+		m_solver = new btSequentialImpulseConstraintSolverMt;
+		m_dynamicsWorld = new btDiscreteDynamicsWorldMt(m_dispatcher, m_overlappingPairCache, m_solverPool, m_solver, m_collisionConfiguration);
+#else
 		m_collisionConfiguration = new btDefaultCollisionConfiguration();
 		m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
 		m_overlappingPairCache = new btDbvtBroadphase();
 		m_solver = new btSequentialImpulseConstraintSolver;
 		m_dynamicsWorld = new btDiscreteDynamicsWorld(m_dispatcher, m_overlappingPairCache, m_solver, m_collisionConfiguration);
+#endif
+		m_simWorker = std::make_unique<boost::asio::thread_pool>(1);
 
 		m_debugDraw = new CPhysicsDebugDraw;
 
@@ -342,6 +387,8 @@ namespace physics
 
 	void CPhysicsManager::NewMap(void)
 	{
+		WaitSimulation();
+
 		G2BScale = bv_scale->value;
 		B2GScale = 1 / bv_scale->value;
 
@@ -359,6 +406,8 @@ namespace physics
 
 	void CPhysicsManager::DebugDraw(void)
 	{
+		WaitSimulation();
+
 		if (bv_debug->value)
 		{
 			m_dynamicsWorld->debugDrawWorld();
@@ -579,6 +628,8 @@ namespace physics
 
 	void CPhysicsManager::CreateStatic(cl_entity_t* ent, vertexarray_t* vertexarray, indexarray_t* indexarray, bool kinematic)
 	{
+		WaitSimulation();
+
 		if (!indexarray->vIndiceBuffer.size())
 		{
 			auto staticbody = new CStaticBody;
@@ -718,6 +769,8 @@ namespace physics
 
 	void CPhysicsManager::CreateBrushModel(cl_entity_t* ent)
 	{
+		WaitSimulation();
+
 		int modelindex = EngineGetModelIndex(ent->model);
 		if (modelindex == -1)
 		{
@@ -1217,6 +1270,8 @@ namespace physics
 
 	void CPhysicsManager::UpdateTempEntity(TEMPENTITY** ppTempEntActive, double frame_time, double client_time)
 	{
+		WaitSimulation();
+
 		for (auto itor = m_ragdollMap.begin(); itor != m_ragdollMap.end();)
 		{
 			auto pRagdoll = itor->second;
@@ -1237,6 +1292,11 @@ namespace physics
 
 	void CPhysicsManager::StepSimulation(double frametime)
 	{
+		btScalar fixedTimeStep;
+		int maxSubSteps;
+
+		WaitSimulation();
+
 		if (bv_simrate->value < 32)
 		{
 			Cvar_SetFloat("bv_simrate", 32);
@@ -1245,11 +1305,400 @@ namespace physics
 		{
 			Cvar_SetFloat("bv_simrate", 128);
 		}
-		m_dynamicsWorld->stepSimulation(frametime, 16, 1.0f / bv_simrate->value);
+
+		SetThreadCount((int)bv_threads->value);
+
+		// nobody is close enough to notice, run the whole world at half rate
+		if (UpdateLevelOfDetail())
+		{
+			fixedTimeStep = 1.0f / bv_simrate->value;
+			maxSubSteps = 16;
+		}
+		else
+		{
+			fixedTimeStep = 2.0f / bv_simrate->value;
+			maxSubSteps = 8;
+		}
+
+		if (!bv_async->value || !m_simWorker)
+		{
+			m_dynamicsWorld->stepSimulation(frametime, maxSubSteps, fixedTimeStep);
+			return;
+		}
+
+		// the step runs while the client builds the rest of the frame,
+		// anything touching the world waits for it in WaitSimulation
+		std::packaged_task<void()> task([this, frametime, maxSubSteps, fixedTimeStep]() {
+			m_dynamicsWorld->stepSimulation(frametime, maxSubSteps, fixedTimeStep);
+		});
+		m_simPending = task.get_future();
+		boost::asio::post(*m_simWorker, std::move(task));
+	}
+
+	void CPhysicsManager::WaitSimulation(void)
+	{
+		if (m_simPending.valid())
+			m_simPending.get();
+	}
+
+	void CPhysicsManager::SetThreadCount(int threads)
+	{
+		if (threads == m_numThreads)
+			return;
+
+		m_numThreads = threads;
+#if BT_THREADSAFE
+		btITaskScheduler* scheduler = btGetTaskScheduler();
+
+		if (threads <= 0)
+			threads = scheduler->getMaxNumThreads();
+
+		scheduler->setNumThreads(bound(1, threads, scheduler->getMaxNumThreads()));
+		MsgDev(D_INFO, "Bullet: %s scheduler, %d threads\n", scheduler->getName(), scheduler->getNumThreads());
+#endif
+	}
+
+	void CPhysicsManager::FreezeRagdoll(CRagdollBody* ragdoll, bool freeze)
+	{
+		if (ragdoll->m_bFrozen == freeze)
+			return;
+
+		ragdoll->m_bFrozen = freeze;
+
+		for (auto& itor : ragdoll->m_rigbodyMap)
+		{
+			auto rigbody = itor.second->rigbody;
+
+			if (rigbody->isStaticOrKinematicObject())
+				continue;
+
+			if (freeze)
+			{
+				rigbody->setLinearVelocity(btVector3(0, 0, 0));
+				rigbody->setAngularVelocity(btVector3(0, 0, 0));
+				rigbody->setActivationState(ISLAND_SLEEPING);
+			}
+			else
+			{
+				rigbody->activate(true);
+			}
+		}
+	}
+
+	void CPhysicsManager::EvictRagdoll(CRagdollBody* ragdoll)
+	{
+		if (ragdoll->m_bEvicted)
+			return;
+
+		// bodies leave the simulation but stay allocated, the corpse keeps its last pose
+		for (auto p : ragdoll->m_constraintArray)
+		{
+			m_dynamicsWorld->removeConstraint(p);
+		}
+
+		for (auto& p : ragdoll->m_rigbodyMap)
+		{
+			m_dynamicsWorld->removeRigidBody(p.second->rigbody);
+		}
+
+		ragdoll->m_bEvicted = true;
+	}
+
+	void CPhysicsManager::RestoreRagdoll(CRagdollBody* ragdoll)
+	{
+		if (!ragdoll->m_bEvicted)
+			return;
+
+		for (auto& p : ragdoll->m_rigbodyMap)
+		{
+			m_dynamicsWorld->addRigidBody(p.second->rigbody);
+		}
+
+		for (auto p : ragdoll->m_constraintArray)
+		{
+			m_dynamicsWorld->addConstraint(p, true);
+		}
+
+		ragdoll->m_bEvicted = false;
+		ragdoll->m_bFrozen = false;
+	}
+
+	/*
+	==================
+	UpdateLevelOfDetail
+
+	Freezes dead ragdolls beyond bv_lod_far and evicts the oldest ones
+	over bv_ragdoll_max. Returns true if any simulated ragdoll is within
+	bv_lod_near, so the world has to be stepped at full rate.
+	==================
+	*/
+	bool CPhysicsManager::UpdateLevelOfDetail(void)
+	{
+		std::vector<CRagdollBody*> dynamic;
+		float nearDist, farDist;
+		bool anyNear = false;
+		vec3_t origin;
+
+		nearDist = bv_lod_near->value;
+		farDist = bv_lod_far->value;
+
+		for (auto& itor : m_ragdollMap)
+		{
+			auto ragdoll = itor.second;
+			bool isDynamic;
+			float dist;
+
+			if (ragdoll->m_bEvicted)
+				continue;
+
+			isDynamic = ragdoll->m_iActivityType > 0;
+
+			// held by a monster, has to keep moving with it
+			if (ragdoll->m_barnacleConstraintArray.size() || ragdoll->m_gargantuaConstraintArray.size())
+			{
+				FreezeRagdoll(ragdoll, false);
+				anyNear = true;
+				continue;
+			}
+
+			if (!GetRagdollOrigin(ragdoll, origin))
+			{
+				anyNear = true;
+				continue;
+			}
+
+			dist = (origin - cl.refdef.vieworg).Length();
+
+			if (nearDist <= 0 || dist < nearDist)
+				anyNear = true;
+
+			// living models are kinematic, only their jiggle bones care about the step rate
+			if (!isDynamic)
+				continue;
+
+			dynamic.push_back(ragdoll);
+			FreezeRagdoll(ragdoll, farDist > 0 && dist > farDist);
+		}
+
+		if (bv_ragdoll_max->value > 0 && dynamic.size() > (size_t)bv_ragdoll_max->value)
+		{
+			size_t excess = dynamic.size() - (size_t)bv_ragdoll_max->value;
+
+			std::partial_sort(dynamic.begin(), dynamic.begin() + excess, dynamic.end(), [](CRagdollBody* a, CRagdollBody* b) {
+				return a->m_flDeathTime < b->m_flDeathTime;
+			});
+
+			for (size_t i = 0; i < excess; ++i)
+				EvictRagdoll(dynamic[i]);
+		}
+
+		return anyNear;
+	}
+
+	/*
+	==================
+	Benchmark
+
+	Drops synthetic seven-capsule ragdolls onto the loaded map and times
+	the world step with one thread and with every scheduler thread.
+	Real ragdolls are taken out of the world for the duration.
+	==================
+	*/
+	void CPhysicsManager::Benchmark(int count, int frames)
+	{
+		struct benchpart_t { float radius, height, mass; int parent; vec3_c offset, pivot; };
+		static const benchpart_t parts[] =
+		{
+			// radius, height, mass, parent, offset from pelvis, joint pivot from pelvis
+			{ 7, 8, 10, -1, {   0, 0,   0 }, {   0, 0,   0 } },	// pelvis
+			{ 8, 14, 10, 0, {   0, 0,  18 }, {   0, 0,   8 } },	// spine
+			{ 6, 0, 4, 1, {   0, 0,  36 }, {   0, 0,  30 } },	// head
+			{ 4, 28, 6, 0, {  -5, 0, -22 }, {  -5, 0,  -4 } },	// left leg
+			{ 4, 28, 6, 0, {   5, 0, -22 }, {   5, 0,  -4 } },	// right leg
+			{ 3, 22, 3, 1, { -14, 0,  14 }, { -12, 0,  28 } },	// left arm
+			{ 3, 22, 3, 1, {  14, 0,  14 }, {  12, 0,  28 } },	// right arm
+		};
+		const int numParts = sizeof(parts) / sizeof(parts[0]);
+		std::vector<btCollisionShape*> shapes;
+		std::vector<btRigidBody*> bodies;
+		std::vector<btTypedConstraint*> constraints;
+		std::vector<CRagdollBody*> evicted;
+		int passThreads[2], numPasses, side;
+		float step;
+
+		if (!cl.worldmodel || m_staticMap.find(0) == m_staticMap.end())
+		{
+			Msg("bv_bench: no world collision, load a map first\n");
+			return;
+		}
+
+		WaitSimulation();
+
+		for (auto& itor : m_ragdollMap)
+		{
+			if (!itor.second->m_bEvicted)
+			{
+				EvictRagdoll(itor.second);
+				evicted.push_back(itor.second);
+			}
+		}
+
+		for (int i = 0; i < numParts; ++i)
+		{
+			if (parts[i].height > 0)
+				shapes.push_back(new btCapsuleShapeZ(parts[i].radius * G2BScale, parts[i].height * G2BScale));
+			else
+				shapes.push_back(new btSphereShape(parts[i].radius * G2BScale));
+		}
+
+		passThreads[0] = 1;
+		passThreads[1] = 0;
+		numPasses = 1;
+#if BT_THREADSAFE
+		if (btGetTaskScheduler()->getMaxNumThreads() > 1)
+			numPasses = 2;
+#endif
+		side = (int)ceil(sqrt((float)count));
+		step = 1.0f / bv_simrate->value;
+
+		Msg("bv_bench: %d ragdolls, %d bodies, %d frames at %g Hz\n", count, count * numParts, frames, bv_simrate->value);
+
+		for (int pass = 0; pass < numPasses; ++pass)
+		{
+			double total = 0, worst = 0;
+			int sleeping = 0, allAsleep = -1;
+			int threads = 1;
+
+			m_numThreads = -1;
+			SetThreadCount(passThreads[pass]);
+#if BT_THREADSAFE
+			threads = btGetTaskScheduler()->getNumThreads();
+#endif
+
+			// same seed every pass so the runs are comparable
+			srand(1);
+
+			for (int i = 0; i < count; ++i)
+			{
+				vec3_c base;
+				btRigidBody* rig[numParts];
+
+				base[0] = cl.refdef.vieworg[0] + ((i % side) - side * 0.5f) * 48;
+				base[1] = cl.refdef.vieworg[1] + ((i / side) - side * 0.5f) * 48;
+				base[2] = cl.refdef.vieworg[2] + 16;
+
+				for (int j = 0; j < numParts; ++j)
+				{
+					btVector3 localInertia(0, 0, 0);
+					btTransform trans;
+					vec3_c org;
+
+					VectorAdd(base, parts[j].offset, org);
+					Vec3GoldSrcToBullet(org);
+
+					trans.setIdentity();
+					trans.setOrigin(btVector3(org[0], org[1], org[2]));
+					shapes[j]->calculateLocalInertia(parts[j].mass, localInertia);
+
+					btRigidBody::btRigidBodyConstructionInfo info(parts[j].mass, new btDefaultMotionState(trans), shapes[j], localInertia);
+					info.m_friction = 1;
+					info.m_rollingFriction = 1;
+
+					rig[j] = new btRigidBody(info);
+					rig[j]->setSleepingThresholds(RAGDOLL_SLEEP_LINEAR * G2BScale, RAGDOLL_SLEEP_ANGULAR);
+					rig[j]->setCcdMotionThreshold(1e-7);
+					rig[j]->setCcdSweptSphereRadius(0.5);
+					// knock them over so they don't land standing
+					rig[j]->setLinearVelocity(btVector3((rand() % 200 - 100) * G2BScale, (rand() % 200 - 100) * G2BScale, 0));
+
+					m_dynamicsWorld->addRigidBody(rig[j]);
+					bodies.push_back(rig[j]);
+
+					if (parts[j].parent != -1)
+					{
+						btTransform frameA, frameB;
+						vec3_c pivotA, pivotB;
+
+						VectorSubtract(parts[j].pivot, parts[parts[j].parent].offset, pivotA);
+						VectorSubtract(parts[j].pivot, parts[j].offset, pivotB);
+						Vec3GoldSrcToBullet(pivotA);
+						Vec3GoldSrcToBullet(pivotB);
+
+						frameA.setIdentity();
+						frameA.setOrigin(btVector3(pivotA[0], pivotA[1], pivotA[2]));
+						frameB.setIdentity();
+						frameB.setOrigin(btVector3(pivotB[0], pivotB[1], pivotB[2]));
+
+						auto cst = new btConeTwistConstraint(*rig[parts[j].parent], *rig[j], frameA, frameB);
+						cst->setLimit(M_PI * 0.25f, M_PI * 0.25f, M_PI * 0.1f);
+
+						m_dynamicsWorld->addConstraint(cst, true);
+						constraints.push_back(cst);
+					}
+				}
+			}
+
+			for (int frame = 0; frame < frames; ++frame)
+			{
+				double start = Sys_DoubleTime();
+				double elapsed;
+
+				m_dynamicsWorld->stepSimulation(step, 1, step);
+
+				elapsed = Sys_DoubleTime() - start;
+				total += elapsed;
+				worst = max(worst, elapsed);
+
+				sleeping = 0;
+				for (auto body : bodies)
+				{
+					if (body->getActivationState() == ISLAND_SLEEPING)
+						sleeping++;
+				}
+
+				if (allAsleep == -1 && sleeping == (int)bodies.size())
+					allAsleep = frame;
+			}
+
+			Msg("%3d threads: avg %.3f ms, max %.3f ms, %d/%d bodies asleep",
+				threads, total * 1000.0 / frames, worst * 1000.0, sleeping, (int)bodies.size());
+
+			if (allAsleep != -1)
+				Msg(", all asleep at frame %d\n", allAsleep);
+			else
+				Msg("\n");
+
+			for (auto cst : constraints)
+			{
+				m_dynamicsWorld->removeConstraint(cst);
+				delete cst;
+			}
+
+			for (auto body : bodies)
+			{
+				m_dynamicsWorld->removeRigidBody(body);
+				delete body->getMotionState();
+				delete body;
+			}
+
+			constraints.clear();
+			bodies.clear();
+		}
+
+		for (auto shape : shapes)
+			delete shape;
+
+		for (auto ragdoll : evicted)
+			RestoreRagdoll(ragdoll);
+
+		m_numThreads = -1;
+		SetThreadCount((int)bv_threads->value);
 	}
 
 	void CPhysicsManager::SetGravity(float velocity)
 	{
+		WaitSimulation();
+
 		float goldsrc_velocity = -velocity;
 
 		FloatGoldSrcToBullet(&goldsrc_velocity);
@@ -2176,6 +2625,8 @@ namespace physics
 
 	void CPhysicsManager::RemoveAllStatics()
 	{
+		WaitSimulation();
+
 		for (auto p : m_staticMap)
 		{
 			auto staticBody = p.second;
@@ -2204,13 +2655,16 @@ namespace physics
 
 	void CPhysicsManager::RemoveAllRagdolls()
 	{
+		WaitSimulation();
+
 		for (auto rag : m_ragdollMap)
 		{
 			auto ragdoll = rag.second;
 
 			for (auto p : ragdoll->m_constraintArray)
 			{
-				m_dynamicsWorld->removeConstraint(p);
+				if (!ragdoll->m_bEvicted)
+					m_dynamicsWorld->removeConstraint(p);
 				delete p;
 			}
 
@@ -2230,7 +2684,8 @@ namespace physics
 
 			for (auto p : ragdoll->m_rigbodyMap)
 			{
-				m_dynamicsWorld->removeRigidBody(p.second->rigbody);
+				if (!ragdoll->m_bEvicted)
+					m_dynamicsWorld->removeRigidBody(p.second->rigbody);
 				delete p.second->rigbody;
 				delete p.second;
 			}
@@ -2246,11 +2701,14 @@ namespace physics
 	{
 		auto ragdoll = itor->second;
 
+		WaitSimulation();
+
 		//RagdollDestroyCallback(ragdoll->m_entindex);
 
 		for (auto p : ragdoll->m_constraintArray)
 		{
-			m_dynamicsWorld->removeConstraint(p);
+			if (!ragdoll->m_bEvicted)
+				m_dynamicsWorld->removeConstraint(p);
 			delete p;
 		}
 
@@ -2258,7 +2716,8 @@ namespace physics
 
 		for (auto p : ragdoll->m_rigbodyMap)
 		{
-			m_dynamicsWorld->removeRigidBody(p.second->rigbody);
+			if (!ragdoll->m_bEvicted)
+				m_dynamicsWorld->removeRigidBody(p.second->rigbody);
 			delete p.second;
 		}
 
@@ -2288,6 +2747,8 @@ namespace physics
 
 	void CPhysicsManager::MergeBarnacleBones(studiohdr_t* hdr, int entindex)
 	{
+		WaitSimulation();
+
 		auto itor = m_ragdollMap.find(entindex);
 
 		if (itor == m_ragdollMap.end())
@@ -2329,6 +2790,8 @@ namespace physics
 
 	bool CPhysicsManager::SetupJiggleBones(studiohdr_t* hdr, int entindex)
 	{
+		WaitSimulation();
+
 		auto itor = m_ragdollMap.find(entindex);
 
 		if (itor == m_ragdollMap.end())
@@ -2372,6 +2835,8 @@ namespace physics
 
 	bool CPhysicsManager::SetupBones(studiohdr_t* hdr, int entindex)
 	{
+		WaitSimulation();
+
 		auto itor = m_ragdollMap.find(entindex);
 
 		if (itor == m_ragdollMap.end())
@@ -2427,6 +2892,8 @@ namespace physics
 
 	ragdoll_itor CPhysicsManager::FindRagdollEx(int tentindex)
 	{
+		WaitSimulation();
+
 		return m_ragdollMap.find(tentindex);
 	}
 
@@ -2820,10 +3287,17 @@ namespace physics
 			}
 		}
 
+		if (ragdoll->m_iActivityType <= 0 && iActivityType > 0)
+			ragdoll->m_flDeathTime = cl.time;
+
 		ragdoll->m_iActivityType = iActivityType;
 
 	update_kinematic:
 
+		// revived or re-posed, it has to collide again
+		RestoreRagdoll(ragdoll);
+		ragdoll->m_bFrozen = false;
+
 		for (auto& itor : ragdoll->m_rigbodyMap)
 		{
 			auto rig = itor.second;
@@ -2872,6 +3346,8 @@ namespace physics
 		int iActivityType,
 		bool isplayer)
 	{
+		WaitSimulation();
+
 		auto ragdoll = new CRagdollBody();
 
 		mstudiobone_t* pbones = (mstudiobone_t*)((byte*)m_pStudioHeader + m_pStudioHeader->boneindex);
@@ -2917,6 +3393,7 @@ namespace physics
 				rig->rigbody->setRollingFriction(1);
 				rig->rigbody->setCcdMotionThreshold(1e-7);
 				rig->rigbody->setCcdSweptSphereRadius(0.5);
+				rig->rigbody->setSleepingThresholds(RAGDOLL_SLEEP_LINEAR * G2BScale, RAGDOLL_SLEEP_ANGULAR);
 
 				rig->oldActivitionState = rig->rigbody->getActivationState();
 				rig->oldCollisionFlags = rig->rigbody->getCollisionFlags();
@@ -2,6 +2,8 @@
 
 #include <unordered_map>
 #include <vector>
+#include <future>
+#include <memory>
 
 #include <btBulletDynamicsCommon.h>
 #include "xash3d_types.h"
@@ -13,6 +15,14 @@ extern convar_t* bv_enable;
 extern convar_t* bv_simrate;
 extern convar_t* bv_scale;
 extern convar_t* bv_force_ragdoll_sequence;
+extern convar_t* bv_async;
+extern convar_t* bv_threads;
+extern convar_t* bv_lod_near;
+extern convar_t* bv_lod_far;
+extern convar_t* bv_ragdoll_max;
+
+namespace boost { namespace asio { class thread_pool; } }
+class btConstraintSolverPoolMt;
 
 namespace physics {
 	int GetSequenceActivityType(model_t* mod, entity_state_t* entstate);
@@ -45,6 +55,11 @@ namespace physics {
 #define RIG_FL_JIGGLE 1
 #define RIG_FL_KINEMATIC 2
 
+// settled ragdolls go to sleep well before bullet's defaults would let them
+#define RAGDOLL_SLEEP_LINEAR	8.0f	// GoldSrc units per second
+#define RAGDOLL_SLEEP_ANGULAR	1.5f	// radians per second
+#define RAGDOLL_DEACTIVATION_TIME	0.5f	// seconds below the thresholds before sleeping
+
 	typedef struct ragdoll_cst_control_s
 	{
 		ragdoll_cst_control_s(const std::string& n, const std::string& n2, int t, int b1, int b2, float of1, float of2, float of3, float of4, float of5, float of6, float f1, float f2, float f3)
@@ -245,6 +260,9 @@ namespace physics {
 			m_iActivityType = -1;
 			m_flUpdateKinematicTime = 0;
 			m_bUpdateKinematic = false;
+			m_flDeathTime = 0;
+			m_bFrozen = false;
+			m_bEvicted = false;
 		}
 
 		int m_barnacleindex;
@@ -252,6 +270,9 @@ namespace physics {
 		int m_iActivityType;
 		float m_flUpdateKinematicTime;
 		float m_bUpdateKinematic;
+		double m_flDeathTime;	// client time the ragdoll went dynamic, for oldest-first eviction
+		bool m_bFrozen;		// put to sleep by distance LOD
+		bool m_bEvicted;	// bodies removed from the world by the ragdoll cap
 		bool m_isPlayer;
 		studiohdr_t* m_studiohdr;
 		CRigBody* m_pelvisRigBody;
@@ -430,6 +451,8 @@ namespace physics {
 		void GenerateIndexedArrayForBrush(model_t* mod, vertexarray_t* vertexarray, indexarray_t* indexarray);
 		void SetGravity(float velocity);
 		void StepSimulation(double framerate);
+		void WaitSimulation(void);
+		void Benchmark(int count, int frames);
 		void ReloadConfig(void);
 		ragdoll_config_t* LoadRagdollConfig(model_t* mod);
 		bool SetupBones(studiohdr_t* hdr, int entindex);
@@ -465,13 +488,22 @@ namespace physics {
 		btDiscreteDynamicsWorld* GetDynamicsWorld() const { return m_dynamicsWorld; }
 	private:
 		ragdoll_itor FreeRagdollInternal(ragdoll_itor& itor);
+		bool UpdateLevelOfDetail(void);
+		void FreezeRagdoll(CRagdollBody* ragdoll, bool freeze);
+		void EvictRagdoll(CRagdollBody* ragdoll);
+		void RestoreRagdoll(CRagdollBody* ragdoll);
+		void SetThreadCount(int threads);
 	private:
 		btDefaultCollisionConfiguration* m_collisionConfiguration;
 		btCollisionDispatcher* m_dispatcher;
 		btBroadphaseInterface* m_overlappingPairCache;
 		btSequentialImpulseConstraintSolver* m_solver;
 		btDiscreteDynamicsWorld* m_dynamicsWorld;
+		btConstraintSolverPoolMt* m_solverPool;
 		CPhysicsDebugDraw* m_debugDraw;
+		std::unique_ptr<boost::asio::thread_pool> m_simWorker;
+		std::future<void> m_simPending;
+		int m_numThreads;
 		std::unordered_map<int, CRagdollBody*> m_ragdollMap;
 		std::unordered_map<int, CStaticBody*> m_staticMap;
 		std::vector<ragdoll_config_t*> m_ragdoll_config;
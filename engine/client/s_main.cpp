@@ -36,6 +36,36 @@ int		soundtime;	// sample PAIRS
 int   		paintedtime; 	// sample PAIRS
 static int	trace_count = 0;
 static int	last_trace_chan = 0;
+static int	last_traced_chan = 0;
+static int	listener_leaf = 0;	// leaf of s_listener.origin, updated once per frame
+
+// obstruction results shared by all sources in the same leaf
+typedef struct
+{
+	int		listenerleaf;
+	int		sourceleaf;
+	int		radius;
+	float		gain;
+	double		time;		// host.realtime when traced, 0 if unused
+} obscurecache_t;
+
+static obscurecache_t	obscure_cache[SND_OBSCURE_CACHE_SIZE];
+
+// per-frame spatialization cost
+typedef struct
+{
+	int		spatialized;	// SND_Spatialize calls
+	int		culled_dist;	// skipped, beyond audible distance
+	int		culled_phs;	// skipped, not in PHS
+	int		traces;		// CL_TraceLine calls
+	int		cache_hits;
+	int		cache_misses;
+	int		deferred;		// wanted a trace but the budget was spent
+	double		time;		// seconds spent respatializing channels
+} sndstats_t;
+
+static sndstats_t	snd_frame_stats, snd_last_stats, snd_total_stats;
+static int	snd_stats_frames;
 
 convar_t		*s_volume;
 convar_t		*s_musicvolume;
@@ -57,6 +87,8 @@ convar_t		*s_cull;		// cull sounds by geometry
 convar_t		*s_test;		// cvar for testing new effects
 convar_t		*s_phs;
 convar_t		*s_reverse_channels;
+convar_t		*snd_mixthreads;
+convar_t		*snd_trace_budget;
 convar_t		*s_samplecount;
 /*
 =============================================================================
@@ -203,39 +235,31 @@ SND_ChannelOkToTrace
 
 All new sounds must traceline once,
 but cap the max number of tracelines performed per frame
-for longer or looping sounds to SND_TRACE_UPDATE_MAX.
+for longer or looping sounds to snd_trace_budget.
+Channels get the budget round-robin: a channel behind
+the cursor waits until every channel after it had a turn.
 =================
 */
 qboolean SND_ChannelOkToTrace( channel_t *ch )
 {
-	int 	i, j;
+	int	index = ch - channels;
 
 	// always trace first time sound is spatialized
 	if( ch->bfirstpass ) return true;
 
 	// if already traced max channels, return
-	if( trace_count >= SND_TRACE_UPDATE_MAX )
+	if( trace_count >= snd_trace_budget->integer )
 		return false;
 
-	// search through all channels starting at g_snd_last_trace_chan index
-	j = last_trace_chan;
+	// already had its turn in this cycle
+	if( index < last_trace_chan )
+		return false;
 
- 	for( i = 0; i < total_channels; i++ )
-	{
-		if( &( channels[j] ) == ch )
-		{
-			ch->bTraced = true;
-			trace_count++;
-			return true;
-		}
+	ch->bTraced = true;
+	last_traced_chan = index;
+	trace_count++;
 
-		// wrap channel index
-		if( ++j >= total_channels )
-			j = 0;
-	}
-	
-	// why didn't we find this channel?
-	return false;			
+	return true;
 }
 
 /*
@@ -249,13 +273,15 @@ void SND_ChannelTraceReset( void )
 {
 	int	i;
 
-	// reset search point - make sure we start counting from a new spot 
-	// in channel list each time
-	last_trace_chan += SND_TRACE_UPDATE_MAX;
-	
+	// if the budget was spent, continue after the last traced channel
+	// otherwise everyone had a turn and a new cycle starts from the beginning
+	if( trace_count >= snd_trace_budget->integer )
+		last_trace_chan = last_traced_chan + 1;
+	else last_trace_chan = 0;
+
 	// wrap at total_channels
 	if( last_trace_chan >= total_channels )
-		last_trace_chan = last_trace_chan - total_channels;
+		last_trace_chan = 0;
 
 	// reset traceline counter
 	trace_count = 0;
@@ -508,6 +534,42 @@ float SND_FadeToNewGain( channel_t *ch, float gain_new )
 	return ch->ob_gain;
 }
 
+/*
+=================
+SND_LookupObscured
+
+sources in the same leaf seen from the same listener leaf
+are obstructed alike, reuse a recent trace result
+=================
+*/
+static qboolean SND_LookupObscured( int sourceleaf, int radius, float *gain )
+{
+	obscurecache_t	*entry;
+
+	entry = &obscure_cache[(listener_leaf * 31 + sourceleaf * 131 + radius) & (SND_OBSCURE_CACHE_SIZE - 1)];
+
+	if( entry->time == 0.0 || host.realtime - entry->time > SND_OBSCURE_CACHE_TIME )
+		return false;
+
+	if( entry->listenerleaf != listener_leaf || entry->sourceleaf != sourceleaf || entry->radius != radius )
+		return false;
+
+	*gain = entry->gain;
+	return true;
+}
+
+static void SND_StoreObscured( int sourceleaf, int radius, float gain )
+{
+	obscurecache_t	*entry;
+
+	entry = &obscure_cache[(listener_leaf * 31 + sourceleaf * 131 + radius) & (SND_OBSCURE_CACHE_SIZE - 1)];
+	entry->listenerleaf = listener_leaf;
+	entry->sourceleaf = sourceleaf;
+	entry->radius = radius;
+	entry->gain = gain;
+	entry->time = host.realtime;
+}
+
 /*
 =================
 SND_GetGainObscured
@@ -521,6 +583,8 @@ float SND_GetGainObscured( channel_t *ch, qboolean fplayersound, qboolean floopi
 	float	gain = 1.0f;
 	vec3_t	endpoint;
 	int	count = 1;
+	int	sourceleaf, sndlvl;
+	float	radius;
 	pmtrace_t	tr;
 
 	if( fplayersound ) return gain; // unchanged
@@ -540,18 +604,33 @@ float SND_GetGainObscured( channel_t *ch, qboolean fplayersound, qboolean floopi
 		return gain;
 	}
 
+	// set up traceline from player eyes to sound emitting entity origin
+	VectorCopy( ch->origin, endpoint );
+	sourceleaf = Mod_PointLeafnum( endpoint );
+
+	// get radius
+	sndlvl = DIST_MULT_TO_SNDLVL( ch->dist_mult );
+	if( ch->radius > 0 ) radius = ch->radius;
+	else radius = dB_To_Radius( sndlvl ); // approximate radius from soundlevel
+
+	if( SND_LookupObscured( sourceleaf, (int)radius, &gain ))
+	{
+		snd_frame_stats.cache_hits++;
+		return SND_FadeToNewGain( ch, gain );
+	}
+
 	// if long or looping sound, process N channels per frame - set 'processed' flag, clear by
 	// cycling through all channels - this maintains a cap on traces per frame
 	if( !SND_ChannelOkToTrace( ch ))
 	{
 		// just keep updating fade to existing target gain - no new trace checking
+		snd_frame_stats.deferred++;
 		gain = SND_FadeToNewGain( ch, -1.0 );
 		return gain;
 	}
 
-	// set up traceline from player eyes to sound emitting entity origin
-	VectorCopy( ch->origin, endpoint );
-
+	snd_frame_stats.cache_misses++;
+	snd_frame_stats.traces++;
 	tr = CL_TraceLine( s_listener.origin, endpoint, PM_STUDIO_IGNORE );
 
 	if(( tr.fraction < 1.0f || tr.allsolid || tr.startsolid ) && tr.fraction < 0.99f )
@@ -561,17 +640,12 @@ float SND_GetGainObscured( channel_t *ch, qboolean fplayersound, qboolean floopi
 		// test to see how many extents are visible,
 		// drop gain by g_snd_obscured_loss_db per extent hidden
 		vec3_t	endpoints[4];
-		int	i, sndlvl = DIST_MULT_TO_SNDLVL( ch->dist_mult );
+		int	i;
 		vec3_t	vecl, vecr, vecl2, vecr2;
 		vec3_t	vsrc_forward;
 		vec3_t	vsrc_right;
 		vec3_t	vsrc_up;
-		float	radius;
 
-		// get radius
-		if( ch->radius > 0 ) radius = ch->radius;
-		else radius = dB_To_Radius( sndlvl ); // approximate radius from soundlevel
-		
 		// set up extent endpoints - on upward or downward diagonals, facing player
 		for( i = 0; i < 4; i++ ) VectorCopy( endpoint, endpoints[i] );
 
@@ -607,6 +681,7 @@ float SND_GetGainObscured( channel_t *ch, qboolean fplayersound, qboolean floopi
 		{
 			// UNDONE: some endpoints are in walls - in this case, trace from the wall hit location
 			tr = CL_TraceLine( s_listener.origin, endpoints[i], PM_STUDIO_IGNORE );
+			snd_frame_stats.traces++;
 
 			if(( tr.fraction < 1.0f || tr.allsolid || tr.startsolid ) && tr.fraction < 0.99f && !tr.startsolid )
 			{
@@ -616,6 +691,8 @@ float SND_GetGainObscured( channel_t *ch, qboolean fplayersound, qboolean floopi
 		}
 	}
 
+	SND_StoreObscured( sourceleaf, (int)radius, gain );
+
 	// crossfade to new gain
 	gain = SND_FadeToNewGain( ch, gain );
 
@@ -712,7 +789,7 @@ qboolean SND_CheckPHS( channel_t *ch )
 
 	if( mask )
 	{
-		leafnum = Mod_PointLeafnum( s_listener.origin ) - 1;
+		leafnum = listener_leaf - 1;
 
 		if( leafnum != -1 && (!(mask[leafnum>>3] & (1U << ( leafnum & 7 )))))
 			return false;
@@ -720,6 +797,38 @@ qboolean SND_CheckPHS( channel_t *ch )
 	return true;
 }
 
+/*
+=================
+SND_AudibleDistance
+
+distance past which both channel volumes always truncate to zero,
+0 if the channel is audible at any distance
+=================
+*/
+float SND_AudibleDistance( channel_t *ch )
+{
+	float	gain_min, relative_dist;
+
+	// no attenuation
+	if( ch->dist_mult <= 0.0f )
+		return 0.0f;
+
+	// volume scales with ( 1 - dist * dist_mult )
+	if( !s_cull->integer )
+		return 1.0f / ch->dist_mult;
+
+	gain_min = snd_gain_min->value;
+
+	if( gain_min <= 0.0f || snd_foliage_db_loss->value < 0.0f )
+		return 0.0f;
+
+	// SND_GetGain switches to the gain_min falloff once snd_gain / relative_dist < gain_min,
+	// which drops below 1/255 of master volume at the second distance
+	relative_dist = max( snd_gain->value / gain_min, ( 2.0f - 1.0f / ( 255.0f * gain_min )) / gain_min );
+
+	return relative_dist * 1.01f / ch->dist_mult;
+}
+
 /*
 =================
 S_SpatializeChannel
@@ -754,6 +863,7 @@ void SND_Spatialize( channel_t *ch )
 {
 	vec3_t	source_vec;
 	float	dist, dot, gain = 1.0f;
+	float	audible;
 	qboolean	fplayersound = false;
 	qboolean	looping = false;
 	wavdata_t	*pSource;
@@ -781,17 +891,37 @@ void SND_Spatialize( channel_t *ch )
 	}
 
 
-	if( !ch->staticsound )
+	snd_frame_stats.spatialized++;
+
+	if( !ch->staticsound && !CL_GetEntitySpatialization( ch ))
+	{
+		// origin is null and entity not exist on client
+		ch->leftvol = ch->rightvol = 0;
+		ch->bfirstpass = false;
+		return;
+	}
+
+	// too far away to be heard, skip gain and obstruction processing
+	if( !fplayersound && ( audible = SND_AudibleDistance( ch )) > 0.0f )
 	{
-		if( !CL_GetEntitySpatialization( ch ) || !SND_CheckPHS( ch ))
+		VectorSubtract( ch->origin, s_listener.origin, source_vec );
+
+		if( DotProduct( source_vec, source_vec ) >= audible * audible )
 		{
-			// origin is null and entity not exist on client
+			snd_frame_stats.culled_dist++;
 			ch->leftvol = ch->rightvol = 0;
-			ch->bfirstpass = false;
 			return;
 		}
 	}
 
+	if( !ch->staticsound && !SND_CheckPHS( ch ))
+	{
+		snd_frame_stats.culled_phs++;
+		ch->leftvol = ch->rightvol = 0;
+		ch->bfirstpass = false;
+		return;
+	}
+
 	// source_vec is vector from listener to sound source
 	// player sounds come from 1' in front of player
 	if( fplayersound ) VectorScale( s_listener.forward, 12.0f, source_vec );
@@ -1452,6 +1582,9 @@ void S_StopAllSounds( void )
 
 	// clear any remaining soundfade
 	Q_memset( &soundfade, 0, sizeof( soundfade ));
+
+	// leaf numbers may belong to another map now
+	Q_memset( obscure_cache, 0, sizeof( obscure_cache ));
 }
 
 //=============================================================================
@@ -1501,6 +1634,27 @@ void S_ExtraUpdate( void )
 	S_UpdateChannels ();
 }
 
+/*
+============
+SND_EndStatsFrame
+============
+*/
+static void SND_EndStatsFrame( void )
+{
+	snd_last_stats = snd_frame_stats;
+	snd_total_stats.spatialized += snd_frame_stats.spatialized;
+	snd_total_stats.culled_dist += snd_frame_stats.culled_dist;
+	snd_total_stats.culled_phs += snd_frame_stats.culled_phs;
+	snd_total_stats.traces += snd_frame_stats.traces;
+	snd_total_stats.cache_hits += snd_frame_stats.cache_hits;
+	snd_total_stats.cache_misses += snd_frame_stats.cache_misses;
+	snd_total_stats.deferred += snd_frame_stats.deferred;
+	snd_total_stats.time += snd_frame_stats.time;
+	snd_stats_frames++;
+
+	Q_memset( &snd_frame_stats, 0, sizeof( snd_frame_stats ));
+}
+
 /*
 ============
 S_RenderFrame
@@ -1513,6 +1667,7 @@ void S_RenderFrame( ref_params_t *fd )
 	int		i, j, total;
 	channel_t		*ch, *combine;
 	con_nprint_t	info;
+	double		start;
 
 	if( !dma.initialized ) return;
 	if( !fd ) return; // too early
@@ -1534,10 +1689,16 @@ void S_RenderFrame( ref_params_t *fd )
 	VectorCopy( fd->simvel, s_listener.velocity );
 	AngleVectors( fd->viewangles, s_listener.forward, s_listener.right, s_listener.up );
 
+	listener_leaf = Mod_PointLeafnum( s_listener.origin );
+
 	// update general area ambient sound sources
 	S_UpdateAmbientSounds();
 
 	combine = NULL;
+	start = Sys_DoubleTime();
+
+	// give the trace budget to the next channels in line
+	SND_ChannelTraceReset();
 
 	// update spatialization for static and dynamic sounds	
 	for( i = NUM_AMBIENTS, ch = channels + NUM_AMBIENTS; i < total_channels; i++, ch++ )
@@ -1589,6 +1750,9 @@ void S_RenderFrame( ref_params_t *fd )
 		}
 	}
 
+	snd_frame_stats.time = Sys_DoubleTime() - start;
+	SND_EndStatsFrame();
+
 	// debugging output
 	if( s_show->integer )
 	{
@@ -1764,6 +1928,33 @@ void S_StopSound_f( void )
 	S_StopAllSounds();
 }
 
+/*
+=================
+S_SoundStats_f
+=================
+*/
+void S_SoundStats_f( void )
+{
+	float	n = (float)max( snd_stats_frames, 1 );
+
+	if( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ))
+	{
+		Q_memset( &snd_total_stats, 0, sizeof( snd_total_stats ));
+		snd_stats_frames = 0;
+		return;
+	}
+
+	Msg( "sound spatialization: last frame, average of %i frames\n", snd_stats_frames );
+	Msg( "  spatialized  %5i %8.2f\n", snd_last_stats.spatialized, snd_total_stats.spatialized / n );
+	Msg( "  distance cull%5i %8.2f\n", snd_last_stats.culled_dist, snd_total_stats.culled_dist / n );
+	Msg( "  phs cull     %5i %8.2f\n", snd_last_stats.culled_phs, snd_total_stats.culled_phs / n );
+	Msg( "  traces       %5i %8.2f\n", snd_last_stats.traces, snd_total_stats.traces / n );
+	Msg( "  cache hits   %5i %8.2f\n", snd_last_stats.cache_hits, snd_total_stats.cache_hits / n );
+	Msg( "  cache misses %5i %8.2f\n", snd_last_stats.cache_misses, snd_total_stats.cache_misses / n );
+	Msg( "  deferred     %5i %8.2f\n", snd_last_stats.deferred, snd_total_stats.deferred / n );
+	Msg( "  time (us)    %5.0f %8.2f\n", snd_last_stats.time * 1000000.0, snd_total_stats.time * 1000000.0 / n );
+}
+
 /*
 =================
 S_SoundInfo_f
@@ -1837,6 +2028,8 @@ qboolean S_Init( void )
 	s_phs = Cvar_Get( "s_phs", "0", CVAR_ARCHIVE, "cull sounds by PHS" );
 	s_reverse_channels = Cvar_Get( "s_reverse_channels", "0", CVAR_ARCHIVE, "reverse left and right channels" );
 	s_samplecount = Cvar_Get( "s_samplecount", "0", CVAR_ARCHIVE, "sample count (0 for default value)" );
+	snd_trace_budget = Cvar_Get( "snd_trace_budget", "2", CVAR_ARCHIVE, "max number of channels re-checked for obstruction per frame" );
+	snd_mixthreads = Cvar_Get( "snd_mixthreads", "2", CVAR_ARCHIVE, "number of extra threads mixing channels (0 to mix on the main thread only)" );
 
 #if XASH_SOUND != SOUND_NULL
 	if( Sys_CheckParm( "-nosound" ))
@@ -1855,6 +2048,8 @@ qboolean S_Init( void )
 	Cmd_AddCommand( "-voicerecord", S_VoiceRecordStop_f, "stop voice recording" );
 	Cmd_AddCommand( "spk", S_SayReliable_f, "reliable play of a specified sentence" );
 	Cmd_AddCommand( "speak", S_Say_f, "play a specified sentence" );
+	Cmd_AddCommand( "snd_stats", S_SoundStats_f, "print sound spatialization cost, \"snd_stats reset\" to restart averaging" );
+	Cmd_AddCommand( "snd_mixbench", S_MixBench_f, "benchmark channel mixing: snd_mixbench [channels] [blocks] [threads]" );
 
 	if( !SNDDMA_Init( host.hWnd ))
 	{
@@ -1900,6 +2095,8 @@ void S_Shutdown( void )
 	Cmd_RemoveCommand( "-voicerecord" );
 	Cmd_RemoveCommand( "spk" );
 	Cmd_RemoveCommand( "speak" );
+	Cmd_RemoveCommand( "snd_stats" );
+	Cmd_RemoveCommand( "snd_mixbench" );
 
 	S_StopAllSounds ();
 	S_FreeSounds ();
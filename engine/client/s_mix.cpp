@@ -18,6 +18,11 @@ GNU General Public License for more details.
 #include "common.h"
 #include "sound.h"
 #include "client.h"
+#include "simd.h"
+
+#include <boost/asio.hpp>
+#include <future>
+#include <memory>
 
 #define IPAINTBUFFER	0
 #define IROOMBUFFER		1
@@ -33,6 +38,9 @@ GNU General Public License for more details.
 #define SND_SCALE_SHIFT	(8 - SND_SCALE_BITS)
 #define SND_SCALE_LEVELS	(1U << SND_SCALE_BITS)
 
+#define MIX_GATHER_SIZE	256	// resampled input is gathered in blocks of this many samples
+#define SND_MAX_MIXGROUPS	8	// calling thread + up to 7 mixer threads
+#define SND_MIXTHREAD_MIN_CHANNELS	24	// don't wake the mixer threads for fewer channels
 
 portable_samplepair_t	*g_curpaintbuffer;
 portable_samplepair_t	streambuffer[(PAINTBUFFER_SIZE+1)];
@@ -103,7 +111,24 @@ void S_TransferPaintBuffer( int endtime )
 		snd_linear_count <<= 1;
 
 		// write a linear blast of samples
-		for( i = 0; i < snd_linear_count; i += 2 )
+		i = 0;
+#if XASH_SIMD_SSE2
+		// saturating pack is the same clamp as below
+		for( ; i + 8 <= snd_linear_count; i += 8 )
+		{
+			__m128i	a = _mm_loadu_si128( (const __m128i *)( snd_p + i + 0 ));
+			__m128i	b = _mm_loadu_si128( (const __m128i *)( snd_p + i + 4 ));
+
+			if( ls )
+			{
+				a = _mm_shuffle_epi32( a, _MM_SHUFFLE( 2, 3, 0, 1 ));
+				b = _mm_shuffle_epi32( b, _MM_SHUFFLE( 2, 3, 0, 1 ));
+			}
+
+			_mm_storeu_si128( (__m128i *)( snd_out + i ), _mm_packs_epi32( a, b ));
+		}
+#endif
+		for( ; i < snd_linear_count; i += 2 )
 		{
 			val = ( snd_p[i + ls] * 256 ) >> 8;
 
@@ -210,8 +235,12 @@ _inline paintbuffer_t *MIX_GetPPaintFromIPaint( int ipaint )
 	return &paintbuffers[ipaint];
 }
 
+static void MIX_ShutdownMixThreads( void );
+
 void MIX_FreeAllPaintbuffers( void )
 {
+	MIX_ShutdownMixThreads();
+
 	// clear paintbuffer structs
 	Q_memset( paintbuffers, 0, CPAINTBUFFERS * sizeof( paintbuffer_t ));
 }
@@ -236,15 +265,90 @@ CHANNEL MIXING
 
 ===============================================================================
 */
+#if XASH_SIMD_SSE2
+// add 8 signed 16-bit values to 4 samplepairs
+_inline void S_MixAdd16( portable_samplepair_t *pbuf, __m128i v )
+{
+	__m128i	*out = (__m128i *)pbuf;
+	__m128i	lo = _mm_srai_epi32( _mm_unpacklo_epi16( v, v ), 16 );
+	__m128i	hi = _mm_srai_epi32( _mm_unpackhi_epi16( v, v ), 16 );
+
+	_mm_storeu_si128( out + 0, _mm_add_epi32( _mm_loadu_si128( out + 0 ), lo ));
+	_mm_storeu_si128( out + 1, _mm_add_epi32( _mm_loadu_si128( out + 1 ), hi ));
+}
+
+// add ( data * vol ) >> 8 for 8 signed 16-bit values to 4 samplepairs, with full 32-bit products
+_inline void S_MixMulAdd16( portable_samplepair_t *pbuf, __m128i data, __m128i vol )
+{
+	__m128i	*out = (__m128i *)pbuf;
+	__m128i	plo = _mm_mullo_epi16( data, vol );
+	__m128i	phi = _mm_mulhi_epi16( data, vol );
+	__m128i	lo = _mm_srai_epi32( _mm_unpacklo_epi16( plo, phi ), 8 );
+	__m128i	hi = _mm_srai_epi32( _mm_unpackhi_epi16( plo, phi ), 8 );
+
+	_mm_storeu_si128( out + 0, _mm_add_epi32( _mm_loadu_si128( out + 0 ), lo ));
+	_mm_storeu_si128( out + 1, _mm_add_epi32( _mm_loadu_si128( out + 1 ), hi ));
+}
+
+// snd_scaletable[vol >> 1][j] is (signed char)j * ((vol >> 1) << 1), which always fits in 16 bits
+_inline __m128i S_MixScale8( const int *volume )
+{
+	short	l = (short)(( volume[0] >> SND_SCALE_SHIFT ) << SND_SCALE_SHIFT );
+	short	r = (short)(( volume[1] >> SND_SCALE_SHIFT ) << SND_SCALE_SHIFT );
+
+	return _mm_set_epi16( r, l, r, l, r, l, r, l );
+}
+
+_inline __m128i S_MixScale16( const int *volume )
+{
+	short	l = (short)volume[0];
+	short	r = (short)volume[1];
+
+	return _mm_set_epi16( r, l, r, l, r, l, r, l );
+}
+
+// 32-bit low multiply, SSE2 has only the unsigned 32x32->64 form
+_inline __m128i S_MulLo32( __m128i a, __m128i b )
+{
+	__m128i	even = _mm_mul_epu32( a, b );
+	__m128i	odd = _mm_mul_epu32( _mm_srli_epi64( a, 32 ), _mm_srli_epi64( b, 32 ));
+
+	return _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 )), _mm_shuffle_epi32( odd, _MM_SHUFFLE( 0, 0, 2, 0 )));
+}
+
+_inline __m128i S_Clamp32( __m128i x, __m128i lo, __m128i hi )
+{
+	__m128i	mask;
+
+	mask = _mm_cmpgt_epi32( x, hi );
+	x = _mm_or_si128( _mm_and_si128( mask, hi ), _mm_andnot_si128( mask, x ));
+	mask = _mm_cmplt_epi32( x, lo );
+	return _mm_or_si128( _mm_and_si128( mask, lo ), _mm_andnot_si128( mask, x ));
+}
+#endif
+
 void S_PaintMonoFrom8( portable_samplepair_t *pbuf, int *volume, byte *pData, int outCount )
 {
-	int 	i, data;
+	int 	i = 0, data;
 	int	*lscale, *rscale;
 		
 	lscale = snd_scaletable[volume[0] >> SND_SCALE_SHIFT];
 	rscale = snd_scaletable[volume[1] >> SND_SCALE_SHIFT];
+#if XASH_SIMD_SSE2
+	{
+		__m128i	scale = S_MixScale8( volume );
+
+		for( ; i + 8 <= outCount; i += 8 )
+		{
+			__m128i	in = _mm_loadl_epi64( (const __m128i *)( pData + i ));
 
-	for( i = 0; i < outCount; i++ )
+			in = _mm_srai_epi16( _mm_unpacklo_epi8( in, in ), 8 );
+			S_MixAdd16( pbuf + i + 0, _mm_mullo_epi16( _mm_unpacklo_epi16( in, in ), scale ));
+			S_MixAdd16( pbuf + i + 4, _mm_mullo_epi16( _mm_unpackhi_epi16( in, in ), scale ));
+		}
+	}
+#endif
+	for( ; i < outCount; i++ )
 	{
 		data = pData[i];
 		pbuf[i].left += lscale[data];
@@ -257,13 +361,26 @@ void S_PaintStereoFrom8( portable_samplepair_t *pbuf, int *volume, byte *pData,
 	int	*lscale, *rscale;
 	uint	left, right;
 	word	*data;
-	int	i;
+	int	i = 0;
 
 	lscale = snd_scaletable[volume[0] >> SND_SCALE_SHIFT];
 	rscale = snd_scaletable[volume[1] >> SND_SCALE_SHIFT];
-	data = (word *)pData;
+#if XASH_SIMD_SSE2
+	{
+		__m128i	scale = S_MixScale8( volume );
+
+		for( ; i + 8 <= outCount; i += 8 )
+		{
+			__m128i	in = _mm_loadu_si128( (const __m128i *)( pData + i * 2 ));
+
+			S_MixAdd16( pbuf + i + 0, _mm_mullo_epi16( _mm_srai_epi16( _mm_unpacklo_epi8( in, in ), 8 ), scale ));
+			S_MixAdd16( pbuf + i + 4, _mm_mullo_epi16( _mm_srai_epi16( _mm_unpackhi_epi8( in, in ), 8 ), scale ));
+		}
+	}
+#endif
+	data = (word *)pData + i;
 
-	for( i = 0; i < outCount; i++, data++ )
+	for( ; i < outCount; i++, data++ )
 	{
 		left = (byte)(*data & 0x00FF);
 		right = (byte)((*data & 0xFF00) >> 8);
@@ -274,10 +391,20 @@ void S_PaintStereoFrom8( portable_samplepair_t *pbuf, int *volume, byte *pData,
 
 void S_PaintMonoFrom16( portable_samplepair_t *pbuf, int *volume, short *pData, int outCount )
 {
-	int	i, data;
+	int	i = 0, data;
 	int	left, right;
+#if XASH_SIMD_SSE2
+	__m128i	vol = S_MixScale16( volume );
 
-	for( i = 0; i < outCount; i++ )
+	for( ; i + 8 <= outCount; i += 8 )
+	{
+		__m128i	in = _mm_loadu_si128( (const __m128i *)( pData + i ));
+
+		S_MixMulAdd16( pbuf + i + 0, _mm_unpacklo_epi16( in, in ), vol );
+		S_MixMulAdd16( pbuf + i + 4, _mm_unpackhi_epi16( in, in ), vol );
+	}
+#endif
+	for( ; i < outCount; i++ )
 	{
 		data = pData[i];
 		left = ( data * volume[0]) >> 8;
@@ -291,11 +418,16 @@ void S_PaintStereoFrom16( portable_samplepair_t *pbuf, int *volume, short *pData
 {
 	uint	*data;
 	int	left, right;
-	int	i;
+	int	i = 0;
+#if XASH_SIMD_SSE2
+	__m128i	vol = S_MixScale16( volume );
 
-	data = (uint *)pData;
+	for( ; i + 4 <= outCount; i += 4 )
+		S_MixMulAdd16( pbuf + i, _mm_loadu_si128( (const __m128i *)( pData + i * 2 )), vol );
+#endif
+	data = (uint *)pData + i;
 		
-	for( i = 0; i < outCount; i++, data++ )
+	for( ; i < outCount; i++, data++ )
 	{
 		left = (signed short)(*data & 0x0000FFFF);
 		right = (signed short)((*data & 0xFFFF0000) >> 16);
@@ -308,11 +440,13 @@ void S_PaintStereoFrom16( portable_samplepair_t *pbuf, int *volume, short *pData
 	}
 }
 
+// pitch shifted channels are resampled into a small contiguous block first,
+// so the paint kernels above can run over the whole block
 void S_Mix8Mono( portable_samplepair_t *pbuf, int *volume, byte *pData, int inputOffset, uint rateScale, int outCount )
 {
-	int	i, sampleIndex = 0;
+	int	i, count, sampleIndex = 0;
 	uint	sampleFrac = inputOffset;
-	int	*lscale, *rscale;
+	byte	gather[MIX_GATHER_SIZE];
 
 	// Not using pitch shift?
 	if( rateScale == FIX( 1 ))
@@ -321,24 +455,29 @@ void S_Mix8Mono( portable_samplepair_t *pbuf, int *volume, byte *pData, int inpu
 		return;
 	}
 
-	lscale = snd_scaletable[volume[0] >> SND_SCALE_SHIFT];
-	rscale = snd_scaletable[volume[1] >> SND_SCALE_SHIFT];
-
-	for( i = 0; i < outCount; i++ )
+	while( outCount > 0 )
 	{
-		pbuf[i].left += lscale[pData[sampleIndex]];
-		pbuf[i].right += rscale[pData[sampleIndex]];
-		sampleFrac += rateScale;
-		sampleIndex += FIX_INTPART( sampleFrac );
-		sampleFrac = FIX_FRACPART( sampleFrac );
+		count = min( outCount, MIX_GATHER_SIZE );
+
+		for( i = 0; i < count; i++ )
+		{
+			gather[i] = pData[sampleIndex];
+			sampleFrac += rateScale;
+			sampleIndex += FIX_INTPART( sampleFrac );
+			sampleFrac = FIX_FRACPART( sampleFrac );
+		}
+
+		S_PaintMonoFrom8( pbuf, volume, gather, count );
+		pbuf += count;
+		outCount -= count;
 	}
 }
 
 void S_Mix8Stereo( portable_samplepair_t *pbuf, int *volume, byte *pData, int inputOffset, uint rateScale, int outCount )
 {
-	int	i, sampleIndex = 0;
+	int	i, count, sampleIndex = 0;
 	uint	sampleFrac = inputOffset;
-	int	*lscale, *rscale;
+	word	gather[MIX_GATHER_SIZE];
 
 	// Not using pitch shift?
 	if( rateScale == FIX( 1 ))
@@ -347,23 +486,29 @@ void S_Mix8Stereo( portable_samplepair_t *pbuf, int *volume, byte *pData, int in
 		return;
 	}
 
-	lscale = snd_scaletable[volume[0] >> SND_SCALE_SHIFT];
-	rscale = snd_scaletable[volume[1] >> SND_SCALE_SHIFT];
-
-	for( i = 0; i < outCount; i++ )
+	while( outCount > 0 )
 	{
-		pbuf[i].left += lscale[pData[sampleIndex+0]];
-		pbuf[i].right += rscale[pData[sampleIndex+1]];
-		sampleFrac += rateScale;
-		sampleIndex += FIX_INTPART( sampleFrac )<<1;
-		sampleFrac = FIX_FRACPART( sampleFrac );
+		count = min( outCount, MIX_GATHER_SIZE );
+
+		for( i = 0; i < count; i++ )
+		{
+			gather[i] = *(word *)( pData + sampleIndex );
+			sampleFrac += rateScale;
+			sampleIndex += FIX_INTPART( sampleFrac )<<1;
+			sampleFrac = FIX_FRACPART( sampleFrac );
+		}
+
+		S_PaintStereoFrom8( pbuf, volume, (byte *)gather, count );
+		pbuf += count;
+		outCount -= count;
 	}
 }
 
 void S_Mix16Mono( portable_samplepair_t *pbuf, int *volume, short *pData, int inputOffset, uint rateScale, int outCount )
 {
-	int	i, sampleIndex = 0;
+	int	i, count, sampleIndex = 0;
 	uint	sampleFrac = inputOffset;
+	short	gather[MIX_GATHER_SIZE];
 
 	// Not using pitch shift?
 	if( rateScale == FIX( 1 ))
@@ -372,20 +517,29 @@ void S_Mix16Mono( portable_samplepair_t *pbuf, int *volume, short *pData, int in
 		return;
 	}
 
-	for( i = 0; i < outCount; i++ )
+	while( outCount > 0 )
 	{
-		pbuf[i].left += (volume[0] * (int)( pData[sampleIndex] ))>>8;
-		pbuf[i].right += (volume[1] * (int)( pData[sampleIndex] ))>>8;
-		sampleFrac += rateScale;
-		sampleIndex += FIX_INTPART( sampleFrac );
-		sampleFrac = FIX_FRACPART( sampleFrac );
+		count = min( outCount, MIX_GATHER_SIZE );
+
+		for( i = 0; i < count; i++ )
+		{
+			gather[i] = pData[sampleIndex];
+			sampleFrac += rateScale;
+			sampleIndex += FIX_INTPART( sampleFrac );
+			sampleFrac = FIX_FRACPART( sampleFrac );
+		}
+
+		S_PaintMonoFrom16( pbuf, volume, gather, count );
+		pbuf += count;
+		outCount -= count;
 	}
 }
 
 void S_Mix16Stereo( portable_samplepair_t *pbuf, int *volume, short *pData, int inputOffset, uint rateScale, int outCount )
 {
-	int	i, sampleIndex = 0;
+	int	i, count, sampleIndex = 0;
 	uint	sampleFrac = inputOffset;
+	uint	gather[MIX_GATHER_SIZE];
 
 	// Not using pitch shift?
 	if( rateScale == FIX( 1 ))
@@ -394,28 +548,33 @@ void S_Mix16Stereo( portable_samplepair_t *pbuf, int *volume, short *pData, int
 		return;
 	}
 
-	for( i = 0; i < outCount; i++ )
+	while( outCount > 0 )
 	{
-		pbuf[i].left += (volume[0] * (int)( pData[sampleIndex+0] ))>>8;
-		pbuf[i].right += (volume[1] * (int)( pData[sampleIndex+1] ))>>8;
-		sampleFrac += rateScale;
-		sampleIndex += FIX_INTPART(sampleFrac)<<1;
-		sampleFrac = FIX_FRACPART(sampleFrac);
+		count = min( outCount, MIX_GATHER_SIZE );
+
+		for( i = 0; i < count; i++ )
+		{
+			gather[i] = *(uint *)( pData + sampleIndex );
+			sampleFrac += rateScale;
+			sampleIndex += FIX_INTPART(sampleFrac)<<1;
+			sampleFrac = FIX_FRACPART(sampleFrac);
+		}
+
+		S_PaintStereoFrom16( pbuf, volume, (short *)gather, count );
+		pbuf += count;
+		outCount -= count;
 	}
 }
 
-void S_MixChannel( channel_t *pChannel, void *pData, int outputOffset, int inputOffset, uint fracRate, int outCount )
+void S_MixChannel( channel_t *pChannel, portable_samplepair_t *pbuf, void *pData, int inputOffset, uint fracRate, int outCount )
 {
 	int			pvol[CCHANVOLUMES];
-	paintbuffer_t		*ppaint = MIX_GetCurrentPaintbufferPtr();
 	wavdata_t			*pSource = pChannel->sfx->cache;
-	portable_samplepair_t	*pbuf;
 
 	ASSERT( pSource != NULL );
 
 	pvol[0] = bound( 0, pChannel->leftvol, 255 );
 	pvol[1] = bound( 0, pChannel->rightvol, 255 );
-	pbuf = ppaint->pbuf + outputOffset;
 
 	if( pSource->channels == 1 )
 	{
@@ -431,7 +590,9 @@ void S_MixChannel( channel_t *pChannel, void *pData, int outputOffset, int input
 	}
 }
 
-int S_MixDataToDevice( channel_t *pChannel, int sampleCount, int outputRate, int outputOffset )
+// mix channel into the given output buffers. Touches nothing but the channel
+// mixer state and the outputs, so distinct channels may be mixed concurrently
+int S_MixDataToBuffers( channel_t *pChannel, int sampleCount, int outputRate, int outputOffset, portable_samplepair_t **pbufs, int numbufs )
 {
 	// save this to compute total output
 	int	startingOffset = outputOffset;
@@ -464,7 +625,7 @@ int S_MixDataToDevice( channel_t *pChannel, int sampleCount, int outputRate, int
 		wavdata_t	*pSource = pChannel->sfx->cache;
 		qboolean	use_loop = pChannel->use_loop;
 		char	*pData = NULL;
-		int	i, j;
+		int	i;
 
 		// compute number of input samples required
 		double	end = pChannel->pMixer.sample + rate * sampleCount;
@@ -490,29 +651,19 @@ int S_MixDataToDevice( channel_t *pChannel, int sampleCount, int outputRate, int
 		// Verify that we won't get a buffer overrun.
 		ASSERT( floor( sampleFraction + rate * ( outputSampleCount - 1 )) <= availableSamples );
 
-		// save current paintbuffer
-		j = MIX_GetCurrentPaintbufferIndex();
-
-		for( i = 0; i < CPAINTBUFFERS; i++ )
+		// mix chan into all requested buffers
+		for( i = 0; i < numbufs; i++ )
 		{
-			if( paintbuffers[i].factive )
-			{
-				// mix chan into all active paintbuffers
-				MIX_SetCurrentPaintbuffer( i );
-
-				S_MixChannel( 
-					pChannel,			// Channel.
-					pData,			// Input buffer.
-					outputOffset,		// Output position.
-					FIX_FLOAT( sampleFraction ),	// Iterators.
-					FIX_FLOAT( rate ), 
-					outputSampleCount	
-					);
-			}
+			S_MixChannel( 
+				pChannel,			// Channel.
+				pbufs[i] + outputOffset,	// Output position.
+				pData,			// Input buffer.
+				FIX_FLOAT( sampleFraction ),	// Iterators.
+				FIX_FLOAT( rate ), 
+				outputSampleCount	
+				);
 		}
 
-		MIX_SetCurrentPaintbuffer( j );
-
 		pChannel->pMixer.sample += outputSampleCount * rate;
 		outputOffset += outputSampleCount;
 		sampleCount -= outputSampleCount;
@@ -528,6 +679,152 @@ int S_MixDataToDevice( channel_t *pChannel, int sampleCount, int outputRate, int
 	return outputOffset - startingOffset;
 }
 
+// returns the number of active paintbuffers
+int MIX_GetActivePaintbuffers( portable_samplepair_t **pbufs )
+{
+	int	i, numbufs = 0;
+
+	for( i = 0; i < CPAINTBUFFERS; i++ )
+	{
+		if( paintbuffers[i].factive )
+			pbufs[numbufs++] = paintbuffers[i].pbuf;
+	}
+
+	return numbufs;
+}
+
+int S_MixDataToDevice( channel_t *pChannel, int sampleCount, int outputRate, int outputOffset )
+{
+	portable_samplepair_t	*pbufs[CPAINTBUFFERS];
+	int			numbufs;
+
+	// mix chan into all active paintbuffers
+	numbufs = MIX_GetActivePaintbuffers( pbufs );
+
+	return S_MixDataToBuffers( pChannel, sampleCount, outputRate, outputOffset, pbufs, numbufs );
+}
+
+/*
+===============================================================================
+
+PARALLEL CHANNEL MIXING
+
+channels are dealt round-robin into groups, the calling thread mixes group 0
+straight into the paintbuffers and every other group is mixed by a pool
+thread into private buffers that are summed afterwards. Integer sums don't
+depend on the order, so the output is identical to a serial mix.
+===============================================================================
+*/
+static std::unique_ptr<boost::asio::thread_pool>	s_mixpool;
+static int		s_mixpoolthreads;
+static portable_samplepair_t	s_mixgroupbuffers[SND_MAX_MIXGROUPS-1][CPAINTBUFFERS][PAINTBUFFER_SIZE+1];
+
+// (re)start the mixer threads, returns the number of mixing groups
+static int MIX_SetupMixThreads( int threads )
+{
+	threads = bound( 0, threads, SND_MAX_MIXGROUPS - 1 );
+
+	if( threads != s_mixpoolthreads )
+	{
+		if( s_mixpool )
+		{
+			s_mixpool->join();
+			s_mixpool.reset();
+		}
+
+		if( threads > 0 )
+			s_mixpool = std::make_unique<boost::asio::thread_pool>( threads );
+		s_mixpoolthreads = threads;
+	}
+
+	return threads + 1;
+}
+
+static void MIX_ShutdownMixThreads( void )
+{
+	MIX_SetupMixThreads( 0 );
+}
+
+static void MIX_MixChannelGroup( channel_t **list, int count, int group, int numgroups, int sampleCount, int outputRate, portable_samplepair_t **pbufs, int numbufs )
+{
+	int	i;
+
+	for( i = group; i < count; i += numgroups )
+		S_MixDataToBuffers( list[i], sampleCount, outputRate, 0, pbufs, numbufs );
+}
+
+// pdst += psrc
+static void MIX_AddBuffer( portable_samplepair_t *pdst, const portable_samplepair_t *psrc, int count )
+{
+	int	*dst = (int *)pdst;
+	const int	*src = (const int *)psrc;
+	int	i = 0;
+
+	count *= 2;
+#if XASH_SIMD_SSE2
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128i	a = _mm_loadu_si128( (const __m128i *)( dst + i ));
+		__m128i	b = _mm_loadu_si128( (const __m128i *)( src + i ));
+
+		_mm_storeu_si128( (__m128i *)( dst + i ), _mm_add_epi32( a, b ));
+	}
+#endif
+	for( ; i < count; i++ )
+		dst[i] += src[i];
+}
+
+void MIX_MixChannelList( channel_t **list, int count, int sampleCount, int outputRate, portable_samplepair_t **pbufs, int numbufs, int numgroups )
+{
+	portable_samplepair_t	*groupbufs[SND_MAX_MIXGROUPS][CPAINTBUFFERS];
+	std::future<void>		jobs[SND_MAX_MIXGROUPS];
+	int			i, j;
+
+	ASSERT( sampleCount <= PAINTBUFFER_SIZE );
+
+	numgroups = bound( 1, min( numgroups, count ), s_mixpoolthreads + 1 );
+
+	for( i = 1; i < numgroups; i++ )
+	{
+		portable_samplepair_t	**outbufs = groupbufs[i];
+
+		for( j = 0; j < numbufs; j++ )
+			outbufs[j] = s_mixgroupbuffers[i-1][j];
+
+		std::packaged_task<void()> task( [=]()
+		{
+			int	k;
+
+			for( k = 0; k < numbufs; k++ )
+				Q_memset( outbufs[k], 0, sampleCount * sizeof( portable_samplepair_t ));
+
+			MIX_MixChannelGroup( list, count, i, numgroups, sampleCount, outputRate, outbufs, numbufs );
+		});
+
+		jobs[i] = task.get_future();
+		boost::asio::post( *s_mixpool, std::move( task ));
+	}
+
+	MIX_MixChannelGroup( list, count, 0, numgroups, sampleCount, outputRate, pbufs, numbufs );
+
+	for( i = 1; i < numgroups; i++ )
+	{
+		jobs[i].wait();
+
+		for( j = 0; j < numbufs; j++ )
+			MIX_AddBuffer( pbufs[j], groupbufs[i][j], sampleCount );
+	}
+}
+
+// how many groups should mix this pass
+static int MIX_NumMixGroups( int numchannels )
+{
+	if( numchannels < SND_MIXTHREAD_MIN_CHANNELS )
+		return 1;
+
+	return MIX_SetupMixThreads( snd_mixthreads->integer );
+}
+
 qboolean S_ShouldContinueMixing( channel_t *ch )
 {
 	if( ch->isSentence )
@@ -551,9 +848,12 @@ qboolean S_ShouldContinueMixing( channel_t *ch )
 // we'll miss data if outputRate < SOUND_DMA_SPEED!
 void MIX_MixChannelsToPaintbuffer( int endtime, int rate, int outputRate )
 {
+	portable_samplepair_t	*pbufs[CPAINTBUFFERS];
+	channel_t	*mixlist[MAX_CHANNELS];
 	channel_t *ch;
 	wavdata_t	*pSource;
 	int	i, sampleCount;
+	int	nummix, numbufs;
 	qboolean	bZeroVolume;
 
 	// mix each channel into paintbuffer
@@ -570,6 +870,8 @@ void MIX_MixChannelsToPaintbuffer( int endtime, int rate, int outputRate )
 	
 	if( sampleCount <= 0 ) return;
 
+	nummix = 0;
+
 	for( i = 0; i < total_channels; i++, ch++ )
 	{
 		if( !ch->sfx ) continue;
@@ -647,13 +949,25 @@ void MIX_MixChannelsToPaintbuffer( int endtime, int rate, int outputRate )
 		// mix channel to all active paintbuffers.
 		// NOTE: must be called once per channel only - consecutive calls retrieve additional data.
 		if( ch->isSentence )
+		{
+			// sentences load their words while mixing, keep them on this thread
 			VOX_MixDataToDevice( ch, sampleCount, outputRate, 0 );
-		else S_MixDataToDevice( ch, sampleCount, outputRate, 0 );
 
-		if( !S_ShouldContinueMixing( ch ))
-		{
-			S_FreeChannel( ch );
+			if( !S_ShouldContinueMixing( ch ))
+				S_FreeChannel( ch );
 		}
+		else mixlist[nummix++] = ch;
+	}
+
+	if( !nummix ) return;
+
+	numbufs = MIX_GetActivePaintbuffers( pbufs );
+	MIX_MixChannelList( mixlist, nummix, sampleCount, outputRate, pbufs, numbufs, MIX_NumMixGroups( nummix ));
+
+	for( i = 0; i < nummix; i++ )
+	{
+		if( !S_ShouldContinueMixing( mixlist[i] ))
+			S_FreeChannel( mixlist[i] );
 	}
 }
 
@@ -670,19 +984,10 @@ _inline portable_samplepair_t *S_GetNextpFilter( int i, portable_samplepair_t *p
 	return (&(pbuffer[(i-2) * 2 + 1]));
 }
 
-// pass forward over passed in buffer and cubic interpolate all odd samples
-// pbuffer: buffer to filter (in place)
-// prevfilter:  filter memory. NOTE: this must match the filtertype ie: filtercubic[] for FILTERTYPE_CUBIC
-// if NULL then perform no filtering.
-// count: how many samples to upsample. will become count*2 samples in buffer, in place.
-
-void S_Interpolate2xCubic( portable_samplepair_t *pbuffer, portable_samplepair_t *pfiltermem, int cfltmem, int count )
-{
-
 // implement cubic interpolation on 2x upsampled buffer.   Effectively delays buffer contents by 2 samples.
 // pbuffer: contains samples at 0, 2, 4, 6...
 // temppaintbuffer is temp buffer, same size as paintbuffer, used to store processed values
-// count: number of samples to process in buffer ie: how many samples at 0, 2, 4, 6...
+// i, count: range of samples to process in buffer ie: how many samples at 0, 2, 4, 6...
 
 // finpos is the fractional, inpos the integer part.
 //		finpos = 0.5 for upsampling by 2x
@@ -696,21 +1001,19 @@ void S_Interpolate2xCubic( portable_samplepair_t *pbuffer, portable_samplepair_t
 //		b = 2*x1 + xm1 - (5*x0 + x2) / 2;
 //		c = (x1 - xm1) / 2;
 //		y [outpos] = (((a * finpos) + b) * finpos + c) * finpos + x0;
-
-	int i, upCount = count << 1;
+static void S_Interpolate2xCubicScalar( portable_samplepair_t *pbuffer, portable_samplepair_t *pfiltermem, int i, int count )
+{
 	int a, b, c;
 	int xm1, x0, x1, x2;
 	portable_samplepair_t *psamp0;
 	portable_samplepair_t *psamp1;
 	portable_samplepair_t *psamp2;
 	portable_samplepair_t *psamp3;
-	int outpos = 0;
-
-	ASSERT( upCount <= PAINTBUFFER_SIZE );
+	int outpos = i << 1;
 
 	// pfiltermem holds 6 samples from previous buffer pass
 	// process 'count' samples
-	for( i = 0; i < count; i++)
+	for( ; i < count; i++)
 	{
 		// get source sample pointer
 		psamp0 = S_GetNextpFilter( i-1, pbuffer, pfiltermem );
@@ -751,7 +1054,71 @@ void S_Interpolate2xCubic( portable_samplepair_t *pbuffer, portable_samplepair_t
 		
 		ASSERT( outpos <= ( sizeof( temppaintbuffer ) / sizeof( temppaintbuffer[0] )));
 	}
-	
+}
+
+#if XASH_SIMD_SSE2
+// signed division by 1 << k that rounds toward zero like the C operator
+#define S_DIVPOW2( x, k )	_mm_srai_epi32( _mm_add_epi32( x, _mm_srli_epi32( _mm_srai_epi32( x, 31 ), 32 - k )), k )
+
+// two windows per vector, returns the first sample left for the scalar loop
+static int S_Interpolate2xCubicSIMD( portable_samplepair_t *pbuffer, int i, int count )
+{
+	// sample k >= 2 sits at pbuffer[k*2-3] and sample k+1 right after it,
+	// so one load gives two neighbours. The windows starting below 3 read
+	// the filter memory and are done by the scalar loop
+	for( ; i + 2 <= count; i += 2 )
+	{
+		__m128i	xm1 = _mm_loadu_si128( (const __m128i *)( pbuffer + i * 2 - 5 ));
+		__m128i	x0 = _mm_loadu_si128( (const __m128i *)( pbuffer + i * 2 - 3 ));
+		__m128i	x1 = _mm_loadu_si128( (const __m128i *)( pbuffer + i * 2 - 1 ));
+		__m128i	x2 = _mm_loadu_si128( (const __m128i *)( pbuffer + i * 2 + 1 ));
+		__m128i	a, b, c, y, t;
+
+		// a = (3 * (x0-x1) - xm1 + x2) / 2
+		t = _mm_sub_epi32( x0, x1 );
+		t = _mm_add_epi32( _mm_add_epi32( t, t ), t );
+		t = _mm_add_epi32( _mm_sub_epi32( t, xm1 ), x2 );
+		a = S_DIVPOW2( t, 1 );
+
+		// b = 2*x1 + xm1 - (5*x0 + x2) / 2
+		t = _mm_add_epi32( _mm_add_epi32( _mm_slli_epi32( x0, 2 ), x0 ), x2 );
+		t = S_DIVPOW2( t, 1 );
+		b = _mm_sub_epi32( _mm_add_epi32( _mm_add_epi32( x1, x1 ), xm1 ), t );
+
+		// c = (x1 - xm1) / 2
+		t = _mm_sub_epi32( x1, xm1 );
+		c = S_DIVPOW2( t, 1 );
+
+		// y = a/8 + b/4 + c/2 + x0
+		y = _mm_add_epi32( S_DIVPOW2( a, 3 ), S_DIVPOW2( b, 2 ));
+		y = _mm_add_epi32( _mm_add_epi32( y, S_DIVPOW2( c, 1 )), x0 );
+
+		_mm_storeu_si128( (__m128i *)( temppaintbuffer + i * 2 + 0 ), _mm_unpacklo_epi64( x0, y ));
+		_mm_storeu_si128( (__m128i *)( temppaintbuffer + i * 2 + 2 ), _mm_unpackhi_epi64( x0, y ));
+	}
+
+	return i;
+}
+#endif
+
+// pass forward over passed in buffer and cubic interpolate all odd samples
+// pbuffer: buffer to filter (in place)
+// prevfilter:  filter memory. NOTE: this must match the filtertype ie: filtercubic[] for FILTERTYPE_CUBIC
+// if NULL then perform no filtering.
+// count: how many samples to upsample. will become count*2 samples in buffer, in place.
+
+void S_Interpolate2xCubic( portable_samplepair_t *pbuffer, portable_samplepair_t *pfiltermem, int cfltmem, int count )
+{
+	int i = 0, upCount = count << 1;
+
+	ASSERT( upCount <= PAINTBUFFER_SIZE );
+#if XASH_SIMD_SSE2
+	i = min( count, 3 );
+	S_Interpolate2xCubicScalar( pbuffer, pfiltermem, 0, i );
+	i = S_Interpolate2xCubicSIMD( pbuffer, i, count );
+#endif
+	S_Interpolate2xCubicScalar( pbuffer, pfiltermem, i, count );
+
 	ASSERT( cfltmem >= 3 );
 
 	// save last 3 samples from paintbuffer
@@ -760,8 +1127,7 @@ void S_Interpolate2xCubic( portable_samplepair_t *pbuffer, portable_samplepair_t
 	pfiltermem[2] = pbuffer[upCount - 1];
 
 	// copy temppaintbuffer back into paintbuffer
-	for( i = 0; i < upCount; i++ )
-		pbuffer[i] = temppaintbuffer[i];
+	Q_memcpy( pbuffer, temppaintbuffer, upCount * sizeof( portable_samplepair_t ));
 }
 
 // pass forward over passed in buffer and linearly interpolate all odd samples
@@ -876,8 +1242,25 @@ void MIX_MixPaintbuffers( int ibuf1, int ibuf2, int ibuf3, int count, float fgai
 	// pb1 2ch + pb2 (4ch->2ch)		-> pb3 2ch
 	// pb1 (4ch->2ch) + pb2 (4ch->2ch)	-> pb3 2ch
 
+	i = 0;
+#if XASH_SIMD_SSE2
+	{
+		__m128i	vgain = _mm_set1_epi32( gain );
+		int	*src1 = (int *)pbuf1, *src2 = (int *)pbuf2, *dst = (int *)pbuf3;
+
+		// 2 samplepairs per vector
+		for( ; i + 2 <= count; i += 2 )
+		{
+			__m128i	a = _mm_loadu_si128( (const __m128i *)( src1 + i * 2 ));
+			__m128i	b = _mm_loadu_si128( (const __m128i *)( src2 + i * 2 ));
+
+			b = _mm_srai_epi32( S_MulLo32( b, vgain ), 8 );
+			_mm_storeu_si128( (__m128i *)( dst + i * 2 ), _mm_add_epi32( a, b ));
+		}
+	}
+#endif
 	// mix front channels
-	for( i = 0; i < count; i++ )
+	for( ; i < count; i++ )
 	{
 		pbuf3[i].left = pbuf1[i].left;
 		pbuf3[i].right = pbuf1[i].right;
@@ -894,8 +1277,17 @@ void MIX_CompressPaintbuffer( int ipaint, int count )
 
 	ppaint = MIX_GetPPaintFromIPaint( ipaint );
 	pbuf = ppaint->pbuf;
-	
-	for( i = 0; i < count; i++, pbuf++ )
+	i = 0;
+#if XASH_SIMD_SSE2
+	{
+		__m128i	hi = _mm_set1_epi32( 32760 );
+		__m128i	lo = _mm_set1_epi32( -32760 );
+
+		for( ; i + 2 <= count; i += 2, pbuf += 2 )
+			_mm_storeu_si128( (__m128i *)pbuf, S_Clamp32( _mm_loadu_si128( (const __m128i *)pbuf ), lo, hi ));
+	}
+#endif
+	for( ; i < count; i++, pbuf++ )
 	{
 		pbuf->left = CLIP( pbuf->left );
 		pbuf->right = CLIP( pbuf->right );
@@ -1075,4 +1467,151 @@ void MIX_PaintChannels( int endtime )
 		paintedtime = end;
 	}
 }
+
+/*
+=================
+S_MixBench_f
+
+mix synthetic looping channels of every width, layout and rate
+serially and on the mixer threads, and compare the timings.
+the cubic upsampler is checked against its scalar loop
+=================
+*/
+void S_MixBench_f( void )
+{
+	static const int	rates[3] = { SOUND_11k, SOUND_22k, SOUND_44k };
+	portable_samplepair_t	*out, *pbufs[1], *in, *ref, filter[3], filtermem[3];
+	int			numchannels, blocks, threads, numgroups;
+	int			i, j, pass, samplesize;
+	uint			seed = 0x1234567, sum[2];
+	double			start, time[2];
+	channel_t			*chans, **list;
+	wavdata_t			*waves;
+	sfx_t			*sfxs;
+
+	numchannels = Cmd_Argc() > 1 ? Q_atoi( Cmd_Argv( 1 )) : 128;
+	blocks = Cmd_Argc() > 2 ? Q_atoi( Cmd_Argv( 2 )) : 500;
+	threads = Cmd_Argc() > 3 ? Q_atoi( Cmd_Argv( 3 )) : snd_mixthreads->integer;
+	numchannels = bound( 1, numchannels, MAX_CHANNELS );
+	blocks = max( blocks, 1 );
+
+	chans = (channel_t *)Mem_Alloc( sndpool, numchannels * sizeof( *chans ));
+	list = (channel_t **)Mem_Alloc( sndpool, numchannels * sizeof( *list ));
+	waves = (wavdata_t *)Mem_Alloc( sndpool, numchannels * sizeof( *waves ));
+	sfxs = (sfx_t *)Mem_Alloc( sndpool, numchannels * sizeof( *sfxs ));
+	out = (portable_samplepair_t *)Mem_Alloc( sndpool, ( PAINTBUFFER_SIZE + 1 ) * sizeof( *out ));
+	pbufs[0] = out;
+
+	for( i = 0; i < numchannels; i++ )
+	{
+		wavdata_t	*wav = &waves[i];
+
+		wav->width = ( i & 1 ) + 1;
+		wav->channels = (( i >> 1 ) & 1 ) + 1;
+		wav->rate = rates[i % 3];
+		wav->samples = wav->rate / 2 + i;
+		wav->loopStart = 0;
+		samplesize = wav->width * wav->channels;
+		wav->size = wav->samples * samplesize;
+		wav->buffer = (byte *)Mem_Alloc( sndpool, wav->size );
+
+		for( j = 0; j < (int)wav->size; j++ )
+		{
+			seed = seed * 1664525 + 1013904223;
+			wav->buffer[j] = seed >> 24;
+		}
+
+		Q_snprintf( sfxs[i].name, sizeof( sfxs[i].name ), "mixbench%i", i );
+		sfxs[i].cache = wav;
+		list[i] = &chans[i];
+	}
+
+	numgroups = MIX_SetupMixThreads( threads );
+
+	for( pass = 0; pass < 2; pass++ )
+	{
+		for( i = 0; i < numchannels; i++ )
+		{
+			channel_t	*ch = &chans[i];
+
+			Q_memset( ch, 0, sizeof( *ch ));
+			ch->sfx = &sfxs[i];
+			ch->leftvol = 32 + ( i * 37 ) % 224;
+			ch->rightvol = 32 + ( i * 91 ) % 224;
+			ch->pitch = ( i % 4 ) ? 1.0f : 0.85f + ( i % 7 ) * 0.05f;
+			ch->use_loop = true;
+		}
+
+		sum[pass] = 0;
+		start = Sys_DoubleTime();
+
+		for( i = 0; i < blocks; i++ )
+		{
+			Q_memset( out, 0, PAINTBUFFER_SIZE * sizeof( *out ));
+			MIX_MixChannelList( list, numchannels, PAINTBUFFER_SIZE, SOUND_DMA_SPEED, pbufs, 1, pass ? numgroups : 1 );
+
+			for( j = 0; j < PAINTBUFFER_SIZE; j++ )
+				sum[pass] = ( sum[pass] * 31 ) ^ ( out[j].left + out[j].right * 7 );
+		}
+
+		time[pass] = Sys_DoubleTime() - start;
+	}
+
+	Msg( "snd_mixbench: %i channels, %i blocks of %i samples (%.0f us of audio each)\n",
+		numchannels, blocks, PAINTBUFFER_SIZE, PAINTBUFFER_SIZE * 1000000.0 / SOUND_DMA_SPEED );
+	Msg( "   1 thread : %8.2f us/block\n", time[0] * 1000000.0 / blocks );
+	Msg( "  %2i threads: %8.2f us/block (%.2fx)\n", numgroups, time[1] * 1000000.0 / blocks, time[1] > 0.0 ? time[0] / time[1] : 0.0 );
+	if( sum[0] != sum[1] ) Msg( "^1snd_mixbench: threaded output differs from serial output\n" );
+
+	// cubic upsampler, scalar against the S_Interpolate2xCubic kernels
+	in = (portable_samplepair_t *)Mem_Alloc( sndpool, PAINTBUFFER_SIZE * sizeof( *in ));
+	ref = (portable_samplepair_t *)Mem_Alloc( sndpool, PAINTBUFFER_SIZE * sizeof( *ref ));
+
+	for( i = 0; i < PAINTBUFFER_SIZE; i += 2 )
+	{
+		seed = seed * 1664525 + 1013904223;
+		in[i].left = in[i+1].left = (int)( seed >> 12 ) - ( 1 << 19 );
+		seed = seed * 1664525 + 1013904223;
+		in[i].right = in[i+1].right = (int)( seed >> 12 ) - ( 1 << 19 );
+	}
+
+	for( i = 0; i < 3; i++ )
+		filter[i] = in[i * 2];
+
+	for( pass = 0; pass < 2; pass++ )
+	{
+		start = Sys_DoubleTime();
+
+		for( i = 0; i < blocks; i++ )
+		{
+			Q_memcpy( out, in, PAINTBUFFER_SIZE * sizeof( *out ));
+			Q_memcpy( filtermem, filter, sizeof( filtermem ));
+
+			if( pass ) S_Interpolate2xCubic( out, filtermem, 3, PAINTBUFFER_SIZE / 2 );
+			else S_Interpolate2xCubicScalar( out, filtermem, 0, PAINTBUFFER_SIZE / 2 );
+		}
+
+		time[pass] = Sys_DoubleTime() - start;
+		if( !pass ) Q_memcpy( ref, temppaintbuffer, PAINTBUFFER_SIZE * sizeof( *ref ));
+	}
+
+	Msg( "  cubic 2x  : %8.2f us/block scalar, %8.2f us/block (%.2fx)\n", time[0] * 1000000.0 / blocks,
+		time[1] * 1000000.0 / blocks, time[1] > 0.0 ? time[0] / time[1] : 0.0 );
+	if( Q_memcmp( ref, out, PAINTBUFFER_SIZE * sizeof( *out ))) Msg( "^1snd_mixbench: cubic upsampler output differs from scalar output\n" );
+
+	Mem_Free( ref );
+	Mem_Free( in );
+
+	for( i = 0; i < numchannels; i++ )
+		Mem_Free( waves[i].buffer );
+	Mem_Free( out );
+	Mem_Free( sfxs );
+	Mem_Free( waves );
+	Mem_Free( list );
+	Mem_Free( chans );
+
+	// back to the configured thread count
+	MIX_SetupMixThreads( snd_mixthreads->integer );
+}
+
 #endif // XASH_DEDICATED
@@ -33,7 +33,8 @@ extern mempool_t *sndpool;
 #define SOUND_48k		48000	// 48khz sample rate
 #define SOUND_DMA_SPEED	SOUND_44k	// hardware playback rate
 
-#define SND_TRACE_UPDATE_MAX  	2	// max of N channels may be checked for obscured source per frame
+#define SND_OBSCURE_CACHE_SIZE	256	// listener leaf / source leaf obstruction results, power of two
+#define SND_OBSCURE_CACHE_TIME	0.25f	// seconds an obstruction result stays valid
 #define SND_RADIUS_MAX		240.0f	// max sound source radius
 #define SND_RADIUS_MIN		24.0f	// min sound source radius
 #define SND_OBSCURED_LOSS_DB		-2.70f	// dB loss due to obscured sound source
@@ -263,6 +264,7 @@ extern convar_t	*s_phs;
 extern convar_t *s_reverse_channels;
 extern convar_t	*dsp_room;
 extern convar_t *s_samplecount;
+extern convar_t	*snd_mixthreads;
 extern portable_samplepair_t		s_rawsamples[MAX_RAW_SAMPLES];
 
 void S_InitScaletable( void );
@@ -281,6 +283,9 @@ void S_FreeChannel( channel_t *ch );
 // s_mix.c
 //
 int S_MixDataToDevice( channel_t *pChannel, int sampleCount, int outputRate, int outputOffset );
+int S_MixDataToBuffers( channel_t *pChannel, int sampleCount, int outputRate, int outputOffset, portable_samplepair_t **pbufs, int numbufs );
+void MIX_MixChannelList( channel_t **list, int count, int sampleCount, int outputRate, portable_samplepair_t **pbufs, int numbufs, int numgroups );
+void S_MixBench_f( void );
 void MIX_ClearAllPaintBuffers( int SampleCount, qboolean clearFilters );
 void MIX_InitAllPaintbuffers( void );
 void MIX_FreeAllPaintbuffers( void );
@@ -683,6 +683,22 @@ void Image_SetForceFlags( uint flags );	// set image force flags on loading
 size_t Image_DXTGetLinearSize( int type, int width, int height, int depth );
 void Image_SetMDLPointer(byte *p);
 
+typedef struct imgdecode_s
+{
+	const char	*name;		// image name with extension, '#' names are internal
+	const byte	*buffer;		// file or lump data, read from name when NULL
+	size_t		size;
+	byte		*mdltexdata;	// same as Image_SetMDLPointer for studio textures
+	uint		force_flags;	// same as Image_SetForceFlags
+	uint		process_flags;	// Image_Process flags, 0 keeps the decoded image
+	int		width;		// Image_Process parms
+	int		height;
+	float		gamma;
+	image_ref		pic;		// result, NULL on failure
+} imgdecode_t;
+
+void FS_LoadImageBatch( imgdecode_t *jobs, int count );
+
 /*
 ========================================================================
 
@@ -6,7 +6,10 @@
 #include "mod_extend_seq.h"
 
 #include <boost/asio.hpp>
+#include <openssl/md5.h>
+#include <atomic>
 #include <optional>
+#include <unordered_map>
 
 struct astcenc_context;
 astcenc_context *Image_SaveASTC_CreateContext(int thread_num);
@@ -14,33 +17,145 @@ void Image_SaveASTC_DestroyContext(astcenc_context *context);
 std::vector<byte> Image_SaveASTC_Worker(astcenc_context* context, byte *rgba, int width, int height, int size, int thread_id);
 int matchpattern( const char *in, const char *pattern, qboolean caseinsensitive );
 
+#define COOK_MANIFEST	"ddc/manifest.txt"
+#define COOK_WRITE_BATCH	32
+
+// bump when the encoder settings in img_astc.cpp change, every texture gets a new hash
+#define COOK_VERSION	"astc 8x8 medium 1"
+
 namespace xe {
+    struct CookResult {
+        std::string destpath;
+        std::string hash;
+        std::vector<byte> astc_tex;
+    };
+
     struct CookContext{
         boost::asio::io_context ioc_cook;
         boost::asio::thread_pool ioc_cook_worker;
+        boost::asio::thread_pool ioc_cook_writer{1};
         std::optional<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> ioc_cook_work_guard;
         std::optional<boost::asio::executor_work_guard<boost::asio::thread_pool::executor_type>> ioc_cook_worker_work_guard;
+        std::optional<boost::asio::executor_work_guard<boost::asio::thread_pool::executor_type>> ioc_cook_writer_work_guard;
         int cur_num = 0;
         int total_num = 0;
+        int cached_num = 0;
+        int failed_num = 0;
+        bool flushed = false;
+        size_t bytes_out = 0;
+        std::atomic<int> encoded_num = 0;
+        std::atomic<int64_t> encode_pixels = 0;
+        std::atomic<int64_t> encode_usec = 0;
+        std::vector<CookResult> write_batch; // writer thread only
+        std::unordered_map<std::string, std::string> manifest; // destpath -> source hash
         std::chrono::high_resolution_clock::time_point start_time;
+        std::chrono::high_resolution_clock::time_point report_time;
     };
     std::shared_ptr<CookContext> g_cook_ctx;
 
+    std::string Cook_Hash(const void *data, size_t size, const void *data2 = nullptr, size_t size2 = 0)
+    {
+        static const char hex[] = "0123456789abcdef";
+        byte digest[16];
+        MD5_CTX ctx;
+        std::string result;
+
+        MD5_Init( &ctx );
+        MD5_Update( &ctx, COOK_VERSION, sizeof( COOK_VERSION ));
+        MD5_Update( &ctx, data, size );
+        if( data2 ) MD5_Update( &ctx, data2, size2 );
+        MD5_Final( digest, &ctx );
+
+        for( int i = 0; i < 16; i++ )
+        {
+            result += hex[digest[i] >> 4];
+            result += hex[digest[i] & 15];
+        }
+        return result;
+    }
+
+    void Cook_LoadManifest(CookContext &cook_ctx)
+    {
+        char token[MAX_SYSPATH];
+        char *afile = (char *)FS_LoadFile( COOK_MANIFEST, nullptr, true );
+        if( !afile )
+            return;
+
+        char *pfile = afile;
+        while(( pfile = COM_ParseFile( pfile, token )) != nullptr )
+        {
+            std::string destpath = token;
+            if(( pfile = COM_ParseFile( pfile, token )) == nullptr )
+                break;
+            cook_ctx.manifest[destpath] = token;
+        }
+        Mem_Free( afile );
+
+        Msg( "Cook: loaded %d manifest entries\n", (int)cook_ctx.manifest.size() );
+    }
+
+    void Cook_SaveManifest(CookContext &cook_ctx)
+    {
+        file_t *f = FS_Open( COOK_MANIFEST, "w", false );
+        if( !f )
+        {
+            MsgDev( D_ERROR, "Cook: can't write %s\n", COOK_MANIFEST );
+            return;
+        }
+
+        for( auto &entry : cook_ctx.manifest )
+            FS_Printf( f, "\"%s\" %s\n", entry.first.c_str(), entry.second.c_str() );
+        FS_Close( f );
+    }
+
+    // texture is up to date when the manifest has the same source hash and the output is still there
+    bool Cook_IsCached(CookContext &cook_ctx, const std::string &destpath, const std::string &hash)
+    {
+        auto iter = cook_ctx.manifest.find(destpath);
+        if(iter == cook_ctx.manifest.end() || iter->second != hash)
+            return false;
+        return FS_FileExists( destpath.c_str(), true );
+    }
+
     void Cook_End()
     {
         auto used_time = std::chrono::high_resolution_clock::now() - g_cook_ctx->start_time;
+        double seconds = std::chrono::duration<double>(used_time).count();
+        double encode_seconds = g_cook_ctx->encode_usec / 1e6;
+        double mpix = g_cook_ctx->encode_pixels / 1e6;
+
+        // everything is written, let the pools go before the context dies on the main thread
+        g_cook_ctx->ioc_cook_worker_work_guard.reset();
+        g_cook_ctx->ioc_cook_writer_work_guard.reset();
+        g_cook_ctx->ioc_cook_worker.join();
+        g_cook_ctx->ioc_cook_writer.join();
+
+        Cook_SaveManifest(*g_cook_ctx);
 
         using namespace std::chrono_literals;
         Msg(  "Cook: finish cooking %d files for %d min %02d sec\n", g_cook_ctx->total_num, (int)(used_time / 1min), (int)(used_time / 1s) - (int)(used_time / 1min) * 60 );
+        Msg(  "Cook: %d up to date, %d encoded, %d failed, %.1f MB written\n", g_cook_ctx->cached_num, g_cook_ctx->total_num - g_cook_ctx->failed_num, g_cook_ctx->failed_num, g_cook_ctx->bytes_out / ( 1024.0 * 1024.0 ));
+        if( mpix > 0.0 )
+            Msg(  "Cook: encoded %.1f Mpix, %.2f Mpix/s wall, %.2f Mpix/s per worker\n", mpix, mpix / max( seconds, 0.001 ), mpix / max( encode_seconds, 0.001 ));
 
         g_cook_ctx = nullptr;
     }
 
+    void Cook_WriteBatch(std::shared_ptr<CookContext> cook_ctx);
+
     void Cook_Run()
     {
         if(g_cook_ctx)
         {
             g_cook_ctx->ioc_cook.poll();
+
+            // everything is encoded, push the last partial batch out
+            if(!g_cook_ctx->flushed && g_cook_ctx->encoded_num >= g_cook_ctx->total_num)
+            {
+                g_cook_ctx->flushed = true;
+                boost::asio::post(g_cook_ctx->ioc_cook_writer, std::bind(Cook_WriteBatch, g_cook_ctx));
+            }
+
             if(g_cook_ctx->cur_num >= g_cook_ctx->total_num)
             {
                 Cook_End();
@@ -48,37 +163,100 @@ namespace xe {
         }
     }
 
-    void Cook_WriteResult(std::shared_ptr<CookContext> cook_ctx, std::string destpath, std::vector<byte> astc_tex)
+    void Cook_BatchDone(std::shared_ptr<CookContext> cook_ctx, std::vector<CookResult> written)
     {
-        file_t *pfile = FS_Open( destpath.c_str(), "wb", false );
-        if( pfile )
+        for(auto &result : written)
         {
-            FS_Write(pfile, astc_tex.data(), astc_tex.size());
-            FS_Close(pfile);
+            if(!result.astc_tex.empty())
+            {
+                cook_ctx->manifest[result.destpath] = std::move(result.hash);
+                cook_ctx->bytes_out += result.astc_tex.size();
+            }
+            else
+            {
+                ++cook_ctx->failed_num;
+            }
+            ++cook_ctx->cur_num;
         }
-        ++cook_ctx->cur_num;
-        Msg("Cook: [%d/%d] %s\n", cook_ctx->cur_num, cook_ctx->total_num, destpath.c_str());
+
+        auto now = std::chrono::high_resolution_clock::now();
+        if(now - cook_ctx->report_time < std::chrono::seconds(1) && cook_ctx->cur_num < cook_ctx->total_num)
+            return;
+
+        cook_ctx->report_time = now;
+        double seconds = std::chrono::duration<double>(now - cook_ctx->start_time).count();
+        Msg("Cook: [%d/%d] %d up to date, %.2f Mpix/s\n", cook_ctx->cur_num, cook_ctx->total_num, cook_ctx->cached_num, cook_ctx->encode_pixels / 1e6 / max( seconds, 0.001 ));
     }
 
-    void Cook_ProcessTexture(std::shared_ptr<CookContext> cook_ctx, std::vector<byte> rgba, int width, int height, std::string destpath)
+    // writer thread: write-mode FS_Open goes straight to disk and does not walk the search paths
+    void Cook_WriteBatch(std::shared_ptr<CookContext> cook_ctx)
     {
-        std::shared_ptr<astcenc_context> context ( Image_SaveASTC_CreateContext(1), Image_SaveASTC_DestroyContext );
-        auto astc_tex = Image_SaveASTC_Worker(context.get(), rgba.data(), width, height, rgba.size(), 0);
+        std::vector<CookResult> written = std::move(cook_ctx->write_batch);
+        cook_ctx->write_batch.clear();
+
+        if(written.empty())
+            return;
+
+        for(auto &result : written)
+        {
+            if(result.astc_tex.empty())
+                continue;
+
+            file_t *pfile = FS_Open( result.destpath.c_str(), "wb", false );
+            if( !pfile )
+            {
+                result.astc_tex.clear();
+                continue;
+            }
+            FS_Write(pfile, result.astc_tex.data(), result.astc_tex.size());
+            FS_Close(pfile);
+        }
 
         // switch to main thread
-        boost::asio::dispatch(cook_ctx->ioc_cook, std::bind(Cook_WriteResult, cook_ctx, destpath, std::move(astc_tex)));
+        boost::asio::post(cook_ctx->ioc_cook, std::bind(Cook_BatchDone, cook_ctx, std::move(written)));
+    }
+
+    void Cook_QueueWrite(std::shared_ptr<CookContext> cook_ctx, CookResult &result)
+    {
+        cook_ctx->write_batch.push_back(std::move(result));
+        if(cook_ctx->write_batch.size() >= COOK_WRITE_BATCH)
+            Cook_WriteBatch(cook_ctx);
+    }
+
+    // one encoder per worker thread, created on its first texture
+    astcenc_context *Cook_WorkerContext()
+    {
+        thread_local std::unique_ptr<astcenc_context, void (*)(astcenc_context *)> context( Image_SaveASTC_CreateContext(1), Image_SaveASTC_DestroyContext );
+        return context.get();
+    }
+
+    void Cook_ProcessTexture(std::shared_ptr<CookContext> cook_ctx, std::vector<byte> rgba, int width, int height, std::string destpath, std::string hash)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        astcenc_context *context = Cook_WorkerContext();
+        CookResult result{ std::move(destpath), std::move(hash) };
+
+        if( context )
+            result.astc_tex = Image_SaveASTC_Worker(context, rgba.data(), width, height, rgba.size(), 0);
+
+        cook_ctx->encode_usec += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+        cook_ctx->encode_pixels += (int64_t)width * height;
+
+        boost::asio::post(cook_ctx->ioc_cook_writer, [cook_ctx, result = std::move(result)]() mutable { Cook_QueueWrite(cook_ctx, result); });
+
+        // count after queueing, so the final flush from Cook_Run lands behind this write
+        ++cook_ctx->encoded_num;
     }
 
-    void Cook_SubmitPic(std::shared_ptr<CookContext> cook_ctx, image_ref pic, std::string destpath)
+    void Cook_SubmitPic(std::shared_ptr<CookContext> cook_ctx, image_ref pic, std::string destpath, std::string hash)
     {
         std::vector<byte> mt_buffer(pic->size);
         memcpy(mt_buffer.data(), pic->buffer, pic->size);
 
         auto width = pic->width;
         auto height = pic->height;
-        auto size = pic->size;
 
-        boost::asio::dispatch(cook_ctx->ioc_cook_worker, std::bind(Cook_ProcessTexture, cook_ctx, std::move(mt_buffer), width, height, std::move(destpath)));
+        boost::asio::dispatch(cook_ctx->ioc_cook_worker, std::bind(Cook_ProcessTexture, cook_ctx, std::move(mt_buffer), width, height, std::move(destpath), std::move(hash)));
         ++cook_ctx->total_num;
     }
 
@@ -110,6 +288,20 @@ namespace xe {
                     char name[128];
                     FS_FileBase( ptexture[i].name, name );
 
+                    char destpath[128];
+                    Q_snprintf( destpath, sizeof( destpath ), "ddc/%s.mdl/%s", mdlname, name );
+                    FS_StripExtension( destpath );
+                    FS_DefaultExtension( destpath, ".astc" );
+
+                    // indexed pixels and palette are stored together, hash them with the texture header
+                    int header[3] = { (int)ptexture[i].flags, ptexture[i].width, ptexture[i].height };
+                    auto hash = Cook_Hash(header, sizeof( header ), (byte *)phdr + ptexture[i].index, ptexture[i].width * ptexture[i].height + 768);
+                    if(Cook_IsCached(*cook_ctx, destpath, hash))
+                    {
+                        ++cook_ctx->cached_num;
+                        continue;
+                    }
+
                     char texname[128];
                     Q_snprintf( texname, sizeof( texname ), "#%s/%s.mdl", mdlname, name );
                     auto size = sizeof( mstudiotexture_t ) + ptexture[i].width * ptexture[i].height + 768;
@@ -122,12 +314,7 @@ namespace xe {
                     }
 
                     // save file as astc
-                    char destpath[128];
-                    Q_snprintf( destpath, sizeof( destpath ), "ddc/%s.mdl/%s", mdlname, name );
-                    FS_StripExtension( destpath );
-                    FS_DefaultExtension( destpath, ".astc" );
-
-                    Cook_SubmitPic(cook_ctx, pic, destpath);
+                    Cook_SubmitPic(cook_ctx, pic, destpath, std::move(hash));
                 }
             }
         }
@@ -136,15 +323,29 @@ namespace xe {
 
     void Cook_SubmitTex(std::shared_ptr<CookContext> cook_ctx, std::string file)
     {
-        auto pic = FS_LoadImage( file.c_str(), nullptr, 0 );
-        if(pic)
+        fs_offset_t filesize;
+        auto buf = FS_LoadFile( file.c_str(), &filesize, false );
+        if(!buf)
+            return;
+
+        std::shared_ptr<void> free_helper(buf, [](void *buf) { Mem_Free(buf); });
+
+        char destpath[128];
+        Q_snprintf( destpath, sizeof( destpath ), "ddc/%s", file.c_str() );
+        FS_StripExtension( destpath );
+        FS_DefaultExtension( destpath, ".astc" );
+
+        auto hash = Cook_Hash(buf, filesize);
+        if(Cook_IsCached(*cook_ctx, destpath, hash))
         {
-            char destpath[128];
-            Q_snprintf( destpath, sizeof( destpath ), "ddc/%s", file.c_str() );
-            FS_StripExtension( destpath );
-            FS_DefaultExtension( destpath, ".astc" );
+            ++cook_ctx->cached_num;
+            return;
+        }
 
-            Cook_SubmitPic(cook_ctx, pic, destpath);
+        auto pic = FS_LoadImage( file.c_str(), buf, filesize );
+        if(pic)
+        {
+            Cook_SubmitPic(cook_ctx, pic, destpath, std::move(hash));
         }
 
     }
@@ -200,6 +401,8 @@ namespace xe {
 
             auto local_cook_ctx = g_cook_ctx;
             local_cook_ctx->start_time = std::chrono::high_resolution_clock::now();
+            local_cook_ctx->report_time = local_cook_ctx->start_time;
+            Cook_LoadManifest(*local_cook_ctx);
 
             for(auto mdl : mdl_files)
             {
@@ -210,6 +413,8 @@ namespace xe {
             {
                 Cook_SubmitTex(local_cook_ctx, file);
             }
+
+            Msg(  "Cook: %d textures up to date, %d to encode\n", local_cook_ctx->cached_num, local_cook_ctx->total_num );
         }
         catch(const std::exception &e)
         {
@@ -223,8 +428,16 @@ namespace xe {
         {
             g_cook_ctx->ioc_cook_work_guard.reset();
             g_cook_ctx->ioc_cook_worker_work_guard.reset();
-            g_cook_ctx->ioc_cook.stop();
+            g_cook_ctx->ioc_cook_writer_work_guard.reset();
             g_cook_ctx->ioc_cook_worker.stop();
+            g_cook_ctx->ioc_cook_worker.join();
+            g_cook_ctx->ioc_cook_writer.stop();
+            g_cook_ctx->ioc_cook_writer.join();
+
+            // keep what was written so far
+            g_cook_ctx->ioc_cook.poll();
+            g_cook_ctx->ioc_cook.stop();
+            Cook_SaveManifest(*g_cook_ctx);
         }
         g_cook_ctx = nullptr;
     }
@@ -235,6 +448,7 @@ namespace xe {
         g_cook_ctx = std::make_shared<CookContext>();
         g_cook_ctx->ioc_cook_work_guard.emplace(boost::asio::make_work_guard(g_cook_ctx->ioc_cook));
         g_cook_ctx->ioc_cook_worker_work_guard.emplace(boost::asio::make_work_guard(g_cook_ctx->ioc_cook_worker));
+        g_cook_ctx->ioc_cook_writer_work_guard.emplace(boost::asio::make_work_guard(g_cook_ctx->ioc_cook_writer));
         Cook_Initiate();
     }
 
@@ -6,6 +6,9 @@
 #include <SDL_cpuinfo.h>
 #endif
 
+#include "cpu.h"
+#include "simd.h"
+
 void Cpu_Init(void)
 {
 #ifdef XASH_CPUINFO
@@ -30,3 +33,28 @@ int Cpu_GetInstalledRamMegaBytes(void)
 	return 0;
 #endif
 }
+
+// can the XASH_SIMD_SSE2 code paths run on this cpu
+int Cpu_HasSIMD128(void)
+{
+#if !defined XASH_SIMD_SSE2
+	return 0;
+#elif defined XASH_CPUINFO
+	// may be called before Cpu_Init, initialize is reentrant
+	if (!cpuinfo_initialize())
+		return 1;
+#if XASH_SIMD_SSE2 == 1
+	return cpuinfo_has_x86_sse2();
+#else
+	return cpuinfo_has_arm_neon();
+#endif
+#elif defined XASH_SDL
+#if XASH_SIMD_SSE2 == 1
+	return SDL_HasSSE2();
+#else
+	return SDL_HasNEON();
+#endif
+#else
+	return 1; // compiled in, so the target baseline has it
+#endif
+}
@@ -2,4 +2,5 @@
 
 void Cpu_Init(void);
 const char* Cpu_GetName(void);
-int Cpu_GetInstalledRamMegaBytes(void);
\ No newline at end of file
+int Cpu_GetInstalledRamMegaBytes(void);
+int Cpu_HasSIMD128(void);
@@ -268,7 +268,9 @@ enum
 	PAL_HALFLIFE
 };
 
-extern imglib_t image;
+// every thread decodes into its own context, see Image_AttachThread
+extern thread_local imglib_t image;
+extern thread_local void *g_mdltexdata;
 
 void Image_RoundDimensions( int *scaled_width, int *scaled_height );
 byte *Image_ResampleInternal( const void *indata, int in_w, int in_h, int out_w, int out_h, int intype, qboolean *done );
@@ -326,6 +328,13 @@ image_ref Image_Quantize( image_ref pic );
 // img_utils.c
 //
 void Image_Reset( void );
+void Image_InitContext( void );
+void Image_FreeContext( void );
+void Image_AttachThread( void );
+void Image_Bench_f( void );
+void Image_SetupKernels( qboolean simd );
+void Image_ResampleTest_f( void );
+void Image_ResampleBench_f( void );
 image_ref ImagePack( void );
 byte *Image_Copy( size_t size );
 void Image_CopyParms( image_ref src );
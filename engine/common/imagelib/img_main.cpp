@@ -15,8 +15,17 @@ GNU General Public License for more details.
 
 #include "imagelib.h"
 
-// global image variables
-imglib_t	image;
+#include <boost/asio.hpp>
+#include <future>
+#include <thread>
+#include <vector>
+
+// image variables of the current thread
+thread_local imglib_t	image;
+
+// context of the thread that ran Image_Init, workers copy the setup from it
+static imglib_t		*image_main;
+static std::unique_ptr<boost::asio::thread_pool> image_pool;
 
 typedef struct suffix_s
 {
@@ -124,6 +133,52 @@ void Image_Reset( void )
 	image.size = 0;
 }
 
+/*
+================
+Image_InitContext
+
+called by Image_Init on the main thread
+================
+*/
+void Image_InitContext( void )
+{
+	image_main = &image;
+}
+
+/*
+================
+Image_FreeContext
+
+stop the decoding workers before the image pool goes away
+================
+*/
+void Image_FreeContext( void )
+{
+	if( image_pool )
+	{
+		image_pool->join();
+		image_pool.reset();
+	}
+}
+
+/*
+================
+Image_AttachThread
+
+worker threads start with an empty context, pick up
+the formats and flags installed on the main thread
+================
+*/
+void Image_AttachThread( void )
+{
+	if( !image_main || image_main == &image )
+		return;
+
+	image.loadformats = image_main->loadformats;
+	image.saveformats = image_main->saveformats;
+	image.cmd_flags = image_main->cmd_flags;
+}
+
 void FS_FreeImageInternal( rgbdata_t *pack );
 
 image_ref Image_NewTemp()
@@ -405,6 +460,234 @@ load_internal_ext:
 	return nullptr;
 }
 
+/*
+================
+Image_DecodeBuffer
+
+FS_LoadImage without the filesystem search,
+the only part of it that may run on any thread
+================
+*/
+static image_ref Image_DecodeBuffer( const char *filename, const byte *buffer, size_t size )
+{
+	const char	*ext = FS_FileExtension( filename );
+	const loadpixformat_t *format;
+	qboolean		anyformat = true;
+
+	Image_Reset();
+
+	for( format = image.loadformats; format && format->formatstring; format++ )
+	{
+		if( !Q_stricmp( format->ext, ext ))
+		{
+			anyformat = false;
+			break;
+		}
+	}
+
+	for( format = image.loadformats; buffer && size > 0 && format && format->formatstring; format++ )
+	{
+		if( anyformat || !Q_stricmp( ext, format->ext ))
+		{
+			image.hint = format->hint;
+			if( format->loadfunc( filename, buffer, size ))
+				return ImagePack(); // loaded
+		}
+	}
+
+	// clear any force flags
+	image.force_flags = 0;
+
+	return nullptr;
+}
+
+/*
+================
+Image_DecodeJob
+
+decode and process one image on the current thread
+================
+*/
+static void Image_DecodeJob( imgdecode_t *job )
+{
+	Image_AttachThread();
+
+	g_mdltexdata = job->mdltexdata;
+	image.force_flags = job->force_flags;
+	job->pic = Image_DecodeBuffer( job->name, job->buffer, job->size );
+
+	if( job->pic && job->process_flags )
+	{
+		image.force_flags = job->force_flags;
+		Image_Process( &job->pic, job->width, job->height, job->gamma, job->process_flags, NULL );
+	}
+}
+
+/*
+================
+Image_RunBatch
+
+files are read by the caller (filesystem is not reentrant),
+decoding and processing is spread over the pool
+================
+*/
+static void Image_RunBatch( imgdecode_t *jobs, int count, boost::asio::thread_pool *pool )
+{
+	std::vector<std::future<void>>	done;
+	std::vector<byte *>		files( count, (byte *)NULL );
+	fs_offset_t			filesize;
+	int				i;
+
+	for( i = 0; i < count; i++ )
+	{
+		if( jobs[i].buffer || jobs[i].name[0] == '#' )
+			continue;
+
+		files[i] = FS_LoadFile( jobs[i].name, &filesize, false );
+		jobs[i].buffer = files[i];
+		jobs[i].size = files[i] ? filesize : 0;
+	}
+
+	if( !pool || count == 1 )
+	{
+		for( i = 0; i < count; i++ )
+			Image_DecodeJob( &jobs[i] );
+	}
+	else
+	{
+		done.reserve( count );
+
+		for( i = 0; i < count; i++ )
+		{
+			std::packaged_task<void()> task( std::bind( Image_DecodeJob, &jobs[i] ));
+			done.push_back( task.get_future( ));
+			boost::asio::post( *pool, std::move( task ));
+		}
+
+		for( i = 0; i < count; i++ )
+			done[i].get();
+	}
+
+	for( i = 0; i < count; i++ )
+	{
+		if( !files[i] ) continue;
+		Mem_Free( files[i] );
+		jobs[i].buffer = NULL;
+		jobs[i].size = 0;
+	}
+}
+
+/*
+================
+FS_LoadImageBatch
+
+decode a set of images at once using all cores,
+results are returned in jobs[i].pic
+================
+*/
+void FS_LoadImageBatch( imgdecode_t *jobs, int count )
+{
+	int	threads;
+
+	if( count <= 0 ) return;
+
+	if( !image_pool )
+	{
+		threads = max( (int)std::thread::hardware_concurrency() - 1, 1 );
+		image_pool = std::make_unique<boost::asio::thread_pool>( threads );
+	}
+
+	Image_RunBatch( jobs, count, image_pool.get( ));
+}
+
+/*
+================
+Image_Bench_f
+
+decode throughput over a set of files
+================
+*/
+void Image_Bench_f( void )
+{
+	std::vector<imgdecode_t>	jobs;
+	double			start, serial, parallel;
+	size_t			bytes = 0, pixels = 0;
+	int			i, threads, decoded = 0;
+	fs_offset_t		filesize;
+	search_t			*t;
+
+	if( Cmd_Argc() < 2 )
+	{
+		Msg( "Usage: imagebench <wildcard> [threads]\n" );
+		return;
+	}
+
+	threads = ( Cmd_Argc() > 2 ) ? Q_atoi( Cmd_Argv( 2 )) : (int)std::thread::hardware_concurrency();
+	threads = max( threads, 1 );
+
+	t = FS_Search( Cmd_Argv( 1 ), true, false );
+	if( !t )
+	{
+		Msg( "imagebench: no files matching %s\n", Cmd_Argv( 1 ));
+		return;
+	}
+
+	// keep file reading out of the measurement
+	for( i = 0; i < t->numfilenames; i++ )
+	{
+		imgdecode_t	job = {};
+
+		job.name = t->filenames[i];
+		job.buffer = FS_LoadFile( job.name, &filesize, false );
+		if( !job.buffer ) continue;
+
+		job.size = filesize;
+		job.process_flags = IMAGE_FORCE_RGBA;
+		bytes += job.size;
+		jobs.push_back( job );
+	}
+
+	if( jobs.empty( ))
+	{
+		Mem_Free( t );
+		return;
+	}
+
+	start = Sys_DoubleTime();
+	Image_RunBatch( jobs.data(), (int)jobs.size(), NULL );
+	serial = Sys_DoubleTime() - start;
+
+	for( auto &job : jobs )
+	{
+		if( !job.pic ) continue;
+		pixels += job.pic->width * job.pic->height;
+		job.pic = nullptr;
+		decoded++;
+	}
+
+	{
+		boost::asio::thread_pool	pool( threads );
+
+		start = Sys_DoubleTime();
+		Image_RunBatch( jobs.data(), (int)jobs.size(), &pool );
+		parallel = Sys_DoubleTime() - start;
+		pool.join();
+	}
+
+	for( auto &job : jobs )
+	{
+		job.pic = nullptr;
+		Mem_Free( (byte *)job.buffer );
+	}
+
+	Msg( "imagebench: %i of %i images, %.2f MB in, %.2f Mpix out\n", decoded, (int)jobs.size(), bytes / ( 1024.0 * 1024.0 ), pixels / 1e6 );
+	Msg( "  serial:     %8.1f msec %8.1f MB/s %8.1f Mpix/s\n", serial * 1000.0, bytes / ( 1024.0 * 1024.0 ) / serial, pixels / 1e6 / serial );
+	Msg( "  %2i threads: %8.1f msec %8.1f MB/s %8.1f Mpix/s (x%.2f)\n", threads, parallel * 1000.0,
+		bytes / ( 1024.0 * 1024.0 ) / parallel, pixels / 1e6 / parallel, serial / parallel );
+
+	Mem_Free( t );
+}
+
 /*
 ================
 Image_Save
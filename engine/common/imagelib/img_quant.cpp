@@ -47,7 +47,7 @@ GNU General Public License for more details.
 // defs for decreasing alpha factor
 #define alphabiasshift	10			// alpha starts at 1.0
 #define initalpha		(1U << alphabiasshift)
-int			alphadec;			// biased by 10 bits
+static thread_local int	alphadec;			// biased by 10 bits
 
 // radbias and alpharadbias used for radpower calculation
 #define radbiasshift	8
@@ -56,14 +56,14 @@ int			alphadec;			// biased by 10 bits
 #define alpharadbias	(1U << alpharadbshift)
 
 // types and global variables
-static byte		*thepicture;		// the input image itself
-static int		lengthcount;		// lengthcount = H*W*3
-static int		samplefac;		// sampling factor 1..30
-static int		network[netsize][4];	// the network itself
-static int		netindex[256];		// for network lookup - really 256
-static int		bias[netsize];		// bias and freq arrays for learning
-static int		freq[netsize];
-static int		radpower[initrad];		// radpower for precomputation
+static thread_local byte		*thepicture;		// the input image itself
+static thread_local int		lengthcount;		// lengthcount = H*W*3
+static thread_local int		samplefac;		// sampling factor 1..30
+static thread_local int		network[netsize][4];	// the network itself
+static thread_local int		netindex[256];		// for network lookup - really 256
+static thread_local int		bias[netsize];		// bias and freq arrays for learning
+static thread_local int		freq[netsize];
+static thread_local int		radpower[initrad];		// radpower for precomputation
 
 void initnet( byte *thepic, int len, int sample )	
 {
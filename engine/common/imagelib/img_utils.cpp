@@ -17,15 +17,19 @@ GNU General Public License for more details.
 #include "mathlib.h"
 #include "mod_local.h"
 #include "gl_export.h"
+#include "simd.h"
+#include "cpu.h"
 
 convar_t *gl_round_down;
 
 #define LERPBYTE( i )	r = resamplerow1[i]; out[i] = (byte)(((( resamplerow2[i] - r ) * lerp)>>16 ) + r )
 #define FILTER_SIZE		5
 
+// shared palettes are built once by Image_Init,
+// custom ones belong to the decoding thread
 uint d_8toQ1table[256];
 uint d_8toHLtable[256];
-uint d_8to24table[256];
+thread_local uint d_8to24table[256];
 
 qboolean q1palette_init = false;
 qboolean hlpalette_init = false;
@@ -190,10 +194,25 @@ void Image_Init( void )
 	}
 
 	image.tempbuffer = NULL;
+
+	// build the shared palettes now, worker threads only read them
+	Image_GetPaletteQ1();
+	Image_GetPaletteHL();
+
+	Image_InitContext();
+	Image_SetupKernels( Cpu_HasSIMD128( ));
+
+	Cmd_AddCommand( "imagebench", Image_Bench_f, "decode images matching the wildcard serially and in parallel: imagebench <wildcard> [threads]" );
+	Cmd_AddCommand( "resampletest", Image_ResampleTest_f, "check SIMD resample kernels against the scalar ones" );
+	Cmd_AddCommand( "resamplebench", Image_ResampleBench_f, "time scalar and SIMD resample kernels: resamplebench [iterations]" );
 }
 
 void Image_Shutdown( void )
 {
+	Cmd_RemoveCommand( "imagebench" );
+	Cmd_RemoveCommand( "resampletest" );
+	Cmd_RemoveCommand( "resamplebench" );
+	Image_FreeContext();
 	Mem_FreePool( &host.imagepool );
 }
 
@@ -538,6 +557,209 @@ void Image_CopyParms( image_ref src )
 	Q_memcpy( image.fogParams, src->fogParams, sizeof( image.fogParams ));
 }
 
+/*
+=============================================================================
+
+RESAMPLE AND PALETTE KERNELS
+
+XASH_SIMD_SSE2 versions must give the same bytes as the scalar ones,
+Image_Init picks them when the cpu can run them, resampletest checks it
+=============================================================================
+*/
+static void Image_ClearLuma( byte *in, int count )
+{
+	int	i;
+
+	for( i = 0; i < count; i++ )
+		in[i] = in[i] < 224 ? in[i] : 0;
+}
+
+static void Image_LerpRows( const byte *resamplerow1, const byte *resamplerow2, byte *out, int count, int lerp )
+{
+	int	i, r;
+
+	for( i = 0; i + 4 <= count; i += 4 )
+	{
+		LERPBYTE( 0 );
+		LERPBYTE( 1 );
+		LERPBYTE( 2 );
+		LERPBYTE( 3 );
+		out += 4;
+		resamplerow1 += 4;
+		resamplerow2 += 4;
+	}
+
+	for( ; i < count; i++ )
+	{
+		LERPBYTE( 0 );
+		out++;
+		resamplerow1++;
+		resamplerow2++;
+	}
+}
+
+static void Image_Resample32LerpLine( const byte *in, byte *out, int inwidth, int outwidth )
+{
+	int	j, xi, oldx = 0, f, fstep, endx, lerp;
+
+	fstep = (int)(inwidth * 65536.0f / outwidth);
+	endx = (inwidth-1);
+
+	for( j = 0, f = 0; j < outwidth; j++, f += fstep )
+	{
+		xi = f>>16;
+		if( xi != oldx )
+		{
+			in += (xi - oldx) * 4;
+			oldx = xi;
+		}
+		if( xi < endx )
+		{
+			lerp = f & 0xFFFF;
+			*out++ = (byte)((((in[4] - in[0]) * lerp)>>16) + in[0]);
+			*out++ = (byte)((((in[5] - in[1]) * lerp)>>16) + in[1]);
+			*out++ = (byte)((((in[6] - in[2]) * lerp)>>16) + in[2]);
+			*out++ = (byte)((((in[7] - in[3]) * lerp)>>16) + in[3]);
+		}
+		else // last pixel of the line has no pixel to lerp to
+		{
+			*out++ = in[0];
+			*out++ = in[1];
+			*out++ = in[2];
+			*out++ = in[3];
+		}
+	}
+}
+
+#ifdef XASH_SIMD_SSE2
+static void Image_ClearLumaSIMD( byte *in, int count )
+{
+	__m128i	luma = _mm_set1_epi8( (char)224 );
+	int	i = 0;
+
+	for( ; i + 16 <= count; i += 16 )
+	{
+		__m128i	x = _mm_loadu_si128( (const __m128i *)( in + i ));
+		__m128i	mask = _mm_cmpeq_epi8( _mm_max_epu8( x, luma ), x ); // x >= 224
+
+		_mm_storeu_si128( (__m128i *)( in + i ), _mm_andnot_si128( mask, x ));
+	}
+
+	Image_ClearLuma( in + i, count - i );
+}
+
+// _mm_mulhi_epi16 reads lerp as signed, for lerp >= 0x8000 it returns
+// ((d * (lerp - 0x10000)) >> 16), exactly d less than the scalar product
+static inline __m128i Image_MulLerp( __m128i d, __m128i vlerp )
+{
+	__m128i	high = _mm_cmplt_epi16( vlerp, _mm_setzero_si128( ));
+
+	return _mm_add_epi16( _mm_mulhi_epi16( d, vlerp ), _mm_and_si128( d, high ));
+}
+
+static void Image_LerpRowsSIMD( const byte *row1, const byte *row2, byte *out, int count, int lerp )
+{
+	__m128i	zero = _mm_setzero_si128();
+	__m128i	vlerp = _mm_set1_epi16( (short)lerp );
+	int	i = 0;
+
+	for( ; i + 16 <= count; i += 16 )
+	{
+		__m128i	a = _mm_loadu_si128( (const __m128i *)( row1 + i ));
+		__m128i	b = _mm_loadu_si128( (const __m128i *)( row2 + i ));
+		__m128i	alo = _mm_unpacklo_epi8( a, zero );
+		__m128i	ahi = _mm_unpackhi_epi8( a, zero );
+		__m128i	dlo = _mm_sub_epi16( _mm_unpacklo_epi8( b, zero ), alo );
+		__m128i	dhi = _mm_sub_epi16( _mm_unpackhi_epi8( b, zero ), ahi );
+
+		dlo = _mm_add_epi16( Image_MulLerp( dlo, vlerp ), alo );
+		dhi = _mm_add_epi16( Image_MulLerp( dhi, vlerp ), ahi );
+		_mm_storeu_si128( (__m128i *)( out + i ), _mm_packus_epi16( dlo, dhi ));
+	}
+
+	Image_LerpRows( row1 + i, row2 + i, out + i, count - i, lerp );
+}
+
+// two output pixels per step, each one lerps between in[xi] and in[xi+1]
+static void Image_Resample32LerpLineSIMD( const byte *in, byte *out, int inwidth, int outwidth )
+{
+	__m128i	zero = _mm_setzero_si128();
+	int	j, f, x0, x1, l0, l1, fstep, endx;
+	const byte	*pix;
+
+	fstep = (int)(inwidth * 65536.0f / outwidth);
+	endx = (inwidth-1);
+
+	for( j = 0, f = 0; j + 2 <= outwidth; j += 2, f += fstep * 2 )
+	{
+		x0 = f >> 16;
+		x1 = ( f + fstep ) >> 16;
+		if( x1 >= endx ) break;
+
+		l0 = f & 0xFFFF;
+		l1 = ( f + fstep ) & 0xFFFF;
+
+		__m128i	p0 = _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i *)( in + x0 * 4 )), zero );
+		__m128i	p1 = _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i *)( in + x1 * 4 )), zero );
+		__m128i	a = _mm_unpacklo_epi64( p0, p1 );
+		__m128i	d = _mm_sub_epi16( _mm_unpackhi_epi64( p0, p1 ), a );
+		__m128i	vlerp = _mm_set_epi16( l1, l1, l1, l1, l0, l0, l0, l0 );
+
+		d = _mm_add_epi16( Image_MulLerp( d, vlerp ), a );
+		_mm_storel_epi64( (__m128i *)out, _mm_packus_epi16( d, zero ));
+		out += 8;
+	}
+
+	for( ; j < outwidth; j++, f += fstep )
+	{
+		pix = in + ( f >> 16 ) * 4;
+
+		if(( f >> 16 ) < endx )
+		{
+			l0 = f & 0xFFFF;
+			*out++ = (byte)((((pix[4] - pix[0]) * l0)>>16) + pix[0]);
+			*out++ = (byte)((((pix[5] - pix[1]) * l0)>>16) + pix[1]);
+			*out++ = (byte)((((pix[6] - pix[2]) * l0)>>16) + pix[2]);
+			*out++ = (byte)((((pix[7] - pix[3]) * l0)>>16) + pix[3]);
+		}
+		else // last pixel of the line has no pixel to lerp to
+		{
+			*out++ = pix[0];
+			*out++ = pix[1];
+			*out++ = pix[2];
+			*out++ = pix[3];
+		}
+	}
+}
+#endif
+
+static void (*pfnClearLuma)( byte *in, int count ) = Image_ClearLuma;
+static void (*pfnLerpRows)( const byte *row1, const byte *row2, byte *out, int count, int lerp ) = Image_LerpRows;
+static void (*pfnResample32LerpLine)( const byte *in, byte *out, int inwidth, int outwidth ) = Image_Resample32LerpLine;
+
+/*
+=================
+Image_SetupKernels
+
+scalar kernels stay as reference for resampletest
+=================
+*/
+void Image_SetupKernels( qboolean simd )
+{
+	pfnClearLuma = Image_ClearLuma;
+	pfnLerpRows = Image_LerpRows;
+	pfnResample32LerpLine = Image_Resample32LerpLine;
+
+#ifdef XASH_SIMD_SSE2
+	if( simd )
+	{
+		pfnClearLuma = Image_ClearLumaSIMD;
+		pfnLerpRows = Image_LerpRowsSIMD;
+		pfnResample32LerpLine = Image_Resample32LerpLineSIMD;
+	}
+#endif
+}
+
 /*
 ============
 Image_Copy8bitRGBA
@@ -566,10 +788,7 @@ qboolean Image_Copy8bitRGBA( const byte *in, byte *out, int pixels )
 
 	// this is a base image with luma - clear luma pixels
 	if( image.flags & IMAGE_HAS_LUMA )
-	{
-		for( i = 0; i < image.width * image.height; i++ )
-			fin[i] = fin[i] < 224 ? fin[i] : 0;
-	}
+		pfnClearLuma( fin, image.width * image.height );
 
 	// check for color
 	for( i = 0; i < 256; i++ )
@@ -624,39 +843,6 @@ qboolean Image_Copy8bitRGBA( const byte *in, byte *out, int pixels )
 	return true;
 }
 
-static void Image_Resample32LerpLine( const byte *in, byte *out, int inwidth, int outwidth )
-{
-	int	j, xi, oldx = 0, f, fstep, endx, lerp;
-
-	fstep = (int)(inwidth * 65536.0f / outwidth);
-	endx = (inwidth-1);
-
-	for( j = 0, f = 0; j < outwidth; j++, f += fstep )
-	{
-		xi = f>>16;
-		if( xi != oldx )
-		{
-			in += (xi - oldx) * 4;
-			oldx = xi;
-		}
-		if( xi < endx )
-		{
-			lerp = f & 0xFFFF;
-			*out++ = (byte)((((in[4] - in[0]) * lerp)>>16) + in[0]);
-			*out++ = (byte)((((in[5] - in[1]) * lerp)>>16) + in[1]);
-			*out++ = (byte)((((in[6] - in[2]) * lerp)>>16) + in[2]);
-			*out++ = (byte)((((in[7] - in[3]) * lerp)>>16) + in[3]);
-		}
-		else // last pixel of the line has no pixel to lerp to
-		{
-			*out++ = in[0];
-			*out++ = in[1];
-			*out++ = in[2];
-			*out++ = in[3];
-		}
-	}
-}
-
 static void Image_Resample24LerpLine( const byte *in, byte *out, int inwidth, int outwidth )
 {
 	int	j, xi, oldx = 0, f, fstep, endx, lerp;
@@ -693,7 +879,7 @@ static void Image_Resample24LerpLine( const byte *in, byte *out, int inwidth, in
 void Image_Resample32Lerp( const void *indata, int inwidth, int inheight, void *outdata, int outwidth, int outheight )
 {
 	const byte *inrow;
-	int	i, j, r, yi, oldy = 0, f, fstep, lerp, endy = (inheight - 1);
+	int	i, yi, oldy = 0, f, fstep, lerp, endy = (inheight - 1);
 	int	inwidth4 = inwidth * 4;
 	int	outwidth4 = outwidth * 4;
 	byte	*out = (byte *)outdata;
@@ -707,8 +893,8 @@ void Image_Resample32Lerp( const void *indata, int inwidth, int inheight, void *
 
 	inrow = (const byte *)indata;
 
-	Image_Resample32LerpLine( inrow, resamplerow1, inwidth, outwidth );
-	Image_Resample32LerpLine( inrow + inwidth4, resamplerow2, inwidth, outwidth );
+	pfnResample32LerpLine( inrow, resamplerow1, inwidth, outwidth );
+	pfnResample32LerpLine( inrow + inwidth4, resamplerow2, inwidth, outwidth );
 
 	for( i = 0, f = 0; i < outheight; i++, f += fstep )
 	{
@@ -721,65 +907,13 @@ void Image_Resample32Lerp( const void *indata, int inwidth, int inheight, void *
 			{
 				inrow = (byte *)indata + inwidth4 * yi;
 				if (yi == oldy+1) Q_memcpy( resamplerow1, resamplerow2, outwidth4 );
-				else Image_Resample32LerpLine( inrow, resamplerow1, inwidth, outwidth );
-				Image_Resample32LerpLine( inrow + inwidth4, resamplerow2, inwidth, outwidth );
+				else pfnResample32LerpLine( inrow, resamplerow1, inwidth, outwidth );
+				pfnResample32LerpLine( inrow + inwidth4, resamplerow2, inwidth, outwidth );
 				oldy = yi;
 			}
 
-			j = outwidth - 4;
-
-			while( j >= 0 )
-			{
-				LERPBYTE( 0);
-				LERPBYTE( 1);
-				LERPBYTE( 2);
-				LERPBYTE( 3);
-				LERPBYTE( 4);
-				LERPBYTE( 5);
-				LERPBYTE( 6);
-				LERPBYTE( 7);
-				LERPBYTE( 8);
-				LERPBYTE( 9);
-				LERPBYTE(10);
-				LERPBYTE(11);
-				LERPBYTE(12);
-				LERPBYTE(13);
-				LERPBYTE(14);
-				LERPBYTE(15);
-				out += 16;
-				resamplerow1 += 16;
-				resamplerow2 += 16;
-				j -= 4;
-			}
-
-			if( j & 2 )
-			{
-				LERPBYTE( 0);
-				LERPBYTE( 1);
-				LERPBYTE( 2);
-				LERPBYTE( 3);
-				LERPBYTE( 4);
-				LERPBYTE( 5);
-				LERPBYTE( 6);
-				LERPBYTE( 7);
-				out += 8;
-				resamplerow1 += 8;
-				resamplerow2 += 8;
-			}
-
-			if( j & 1 )
-			{
-				LERPBYTE( 0);
-				LERPBYTE( 1);
-				LERPBYTE( 2);
-				LERPBYTE( 3);
-				out += 4;
-				resamplerow1 += 4;
-				resamplerow2 += 4;
-			}
-
-			resamplerow1 -= outwidth4;
-			resamplerow2 -= outwidth4;
+			pfnLerpRows( resamplerow1, resamplerow2, out, outwidth4, lerp );
+			out += outwidth4;
 		}
 		else
 		{
@@ -787,7 +921,7 @@ void Image_Resample32Lerp( const void *indata, int inwidth, int inheight, void *
 			{
 				inrow = (byte *)indata + inwidth4*yi;
 				if( yi == oldy + 1 ) Q_memcpy( resamplerow1, resamplerow2, outwidth4 );
-				else Image_Resample32LerpLine( inrow, resamplerow1, inwidth, outwidth);
+				else pfnResample32LerpLine( inrow, resamplerow1, inwidth, outwidth);
 				oldy = yi;
 			}
 
@@ -840,7 +974,7 @@ void Image_Resample32Nolerp( const void *indata, int inwidth, int inheight, void
 void Image_Resample24Lerp( const void *indata, int inwidth, int inheight, void *outdata, int outwidth, int outheight )
 {
 	const byte *inrow;
-	int	i, j, r, yi, oldy, f, fstep, lerp, endy = (inheight - 1);
+	int	i, yi, oldy, f, fstep, lerp, endy = (inheight - 1);
 	int	inwidth3 = inwidth * 3;
 	int	outwidth3 = outwidth * 3;
 	byte	*out = (byte *)outdata;
@@ -873,53 +1007,8 @@ void Image_Resample24Lerp( const void *indata, int inwidth, int inheight, void *
 				oldy = yi;
 			}
 
-			j = outwidth - 4;
-
-			while( j >= 0 )
-			{
-				LERPBYTE( 0);
-				LERPBYTE( 1);
-				LERPBYTE( 2);
-				LERPBYTE( 3);
-				LERPBYTE( 4);
-				LERPBYTE( 5);
-				LERPBYTE( 6);
-				LERPBYTE( 7);
-				LERPBYTE( 8);
-				LERPBYTE( 9);
-				LERPBYTE(10);
-				LERPBYTE(11);
-				out += 12;
-				resamplerow1 += 12;
-				resamplerow2 += 12;
-				j -= 4;
-			}
-
-			if( j & 2 )
-			{
-				LERPBYTE( 0);
-				LERPBYTE( 1);
-				LERPBYTE( 2);
-				LERPBYTE( 3);
-				LERPBYTE( 4);
-				LERPBYTE( 5);
-				out += 6;
-				resamplerow1 += 6;
-				resamplerow2 += 6;
-			}
-
-			if( j & 1 )
-			{
-				LERPBYTE( 0);
-				LERPBYTE( 1);
-				LERPBYTE( 2);
-				out += 3;
-				resamplerow1 += 3;
-				resamplerow2 += 3;
-			}
-
-			resamplerow1 -= outwidth3;
-			resamplerow2 -= outwidth3;
+			pfnLerpRows( resamplerow1, resamplerow2, out, outwidth3, lerp );
+			out += outwidth3;
 		}
 		else
 		{
@@ -1073,6 +1162,136 @@ byte *Image_ResampleInternal( const void *indata, int inwidth, int inheight, int
 	return image.tempbuffer;
 }
 
+/*
+================
+Image_ResampleTest_f
+
+check the selected resample kernels against the scalar ones
+================
+*/
+void Image_ResampleTest_f( void )
+{
+	int	i, j, inw, inh, outw, outh, bpp, failed = 0;
+	byte	*in, *ref, *out;
+	qboolean	simd = Cpu_HasSIMD128();
+
+	if( !simd )
+	{
+		Msg( "resampletest: no SIMD kernels on this cpu, nothing to check\n" );
+		return;
+	}
+
+	for( i = 0; i < 256; i++ )
+	{
+		bpp = ( i & 1 ) ? 3 : 4;
+		inw = Com_RandomLong( 1, 300 );
+		inh = Com_RandomLong( 1, 300 );
+		outw = Com_RandomLong( 1, 300 );
+		outh = Com_RandomLong( 1, 300 );
+
+		in = (byte *)Mem_Alloc( host.imagepool, inw * inh * bpp );
+		ref = (byte *)Mem_Alloc( host.imagepool, outw * outh * bpp );
+		out = (byte *)Mem_Alloc( host.imagepool, outw * outh * bpp );
+
+		for( j = 0; j < inw * inh * bpp; j++ )
+			in[j] = (byte)Com_RandomLong( 0, 255 );
+
+		Image_SetupKernels( false );
+		if( bpp == 4 ) Image_Resample32Lerp( in, inw, inh, ref, outw, outh );
+		else Image_Resample24Lerp( in, inw, inh, ref, outw, outh );
+
+		Image_SetupKernels( true );
+		if( bpp == 4 ) Image_Resample32Lerp( in, inw, inh, out, outw, outh );
+		else Image_Resample24Lerp( in, inw, inh, out, outw, outh );
+
+		if( memcmp( ref, out, outw * outh * bpp ))
+		{
+			Msg( "resampletest: %i bit %ix%i -> %ix%i mismatch\n", bpp * 8, inw, inh, outw, outh );
+			failed++;
+		}
+
+		// luma clear works in place
+		memcpy( ref, in, min( inw * inh, outw * outh ));
+		memcpy( out, in, min( inw * inh, outw * outh ));
+		Image_ClearLuma( ref, min( inw * inh, outw * outh ));
+		pfnClearLuma( out, min( inw * inh, outw * outh ));
+
+		if( memcmp( ref, out, min( inw * inh, outw * outh )))
+		{
+			Msg( "resampletest: luma clear of %i pixels mismatch\n", min( inw * inh, outw * outh ));
+			failed++;
+		}
+
+		Mem_Free( in );
+		Mem_Free( ref );
+		Mem_Free( out );
+	}
+
+	Image_SetupKernels( simd );
+
+	if( failed ) Msg( "resampletest: %i of %i cases FAILED\n", failed, i * 2 );
+	else Msg( "resampletest: %i cases passed\n", i * 2 );
+}
+
+/*
+================
+Image_ResampleBench_f
+
+time the scalar and SIMD kernels on a 1024x1024 upscale
+================
+*/
+void Image_ResampleBench_f( void )
+{
+	int	i, j, k, iterations, pass;
+	double	start, time[2][3];
+	byte	*in, *out;
+	qboolean	simd = Cpu_HasSIMD128();
+
+	iterations = ( Cmd_Argc() > 1 ) ? Q_atoi( Cmd_Argv( 1 )) : 20;
+	iterations = max( iterations, 1 );
+
+	in = (byte *)Mem_Alloc( host.imagepool, 512 * 512 * 4 );
+	out = (byte *)Mem_Alloc( host.imagepool, 1024 * 1024 * 4 );
+
+	for( j = 0; j < 512 * 512 * 4; j++ )
+		in[j] = (byte)Com_RandomLong( 0, 255 );
+
+	for( pass = 0; pass < 2; pass++ )
+	{
+		Image_SetupKernels( pass );
+
+		for( k = 0; k < 3; k++ )
+		{
+			start = Sys_DoubleTime();
+			for( i = 0; i < iterations; i++ )
+			{
+				switch( k )
+				{
+				case 0: Image_Resample32Lerp( in, 512, 512, out, 1024, 1024 ); break;
+				case 1: Image_Resample24Lerp( in, 512, 512, out, 1024, 1024 ); break;
+				case 2: pfnClearLuma( out, 1024 * 1024 * 4 ); break;
+				}
+			}
+			time[pass][k] = ( Sys_DoubleTime() - start ) / iterations;
+		}
+
+		if( !simd ) break;
+	}
+
+	Image_SetupKernels( simd );
+
+	Msg( "resamplebench: 512x512 -> 1024x1024, %i iterations\n", iterations );
+	Msg( "  resample32 scalar: %7.2f msec %8.1f Mpix/s\n", time[0][0] * 1000.0, 1.048576 / time[0][0] );
+	if( simd ) Msg( "  resample32 simd:   %7.2f msec %8.1f Mpix/s (x%.2f)\n", time[1][0] * 1000.0, 1.048576 / time[1][0], time[0][0] / time[1][0] );
+	Msg( "  resample24 scalar: %7.2f msec %8.1f Mpix/s\n", time[0][1] * 1000.0, 1.048576 / time[0][1] );
+	if( simd ) Msg( "  resample24 simd:   %7.2f msec %8.1f Mpix/s (x%.2f)\n", time[1][1] * 1000.0, 1.048576 / time[1][1], time[0][1] / time[1][1] );
+	Msg( "  luma clear scalar: %7.2f msec %8.1f Mpix/s\n", time[0][2] * 1000.0, 4.194304 / time[0][2] );
+	if( simd ) Msg( "  luma clear simd:   %7.2f msec %8.1f Mpix/s (x%.2f)\n", time[1][2] * 1000.0, 4.194304 / time[1][2], time[0][2] / time[1][2] );
+
+	Mem_Free( in );
+	Mem_Free( out );
+}
+
 /*
 ================
 Image_Flood
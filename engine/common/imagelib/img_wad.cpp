@@ -141,7 +141,7 @@ Image_SetMDLPointer
 Transfer buffer pointer before Image_LoadMDL
 ======================
 */
-void *g_mdltexdata;
+thread_local void *g_mdltexdata;
 void Image_SetMDLPointer(byte *p)
 {
 	g_mdltexdata = p;
@@ -27,7 +27,8 @@ static const byte g_pDecryptorKey_22[32] =
 	0xD9, 0x91, 0x07, 0x3A, 0x14, 0x74, 0xFE, 0x22
 };
 
-IceKey g_Decryptor(4);
+// one key schedule per thread, models are decrypted by the precache workers
+static thread_local IceKey g_Decryptor(4);
 
 void DecryptChunk(byte *pData, size_t uDataSize)
 {
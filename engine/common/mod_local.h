@@ -77,6 +77,8 @@ typedef struct
 	size_t		vecdatasize;	// actual size of the deluxdata
 	size_t		entdatasize;	// actual size of the entity string
 	size_t		texdatasize;	// actual size of the textures lump
+	byte		*phsdata;		// compressed PHS of all leafs
+	size_t		phsdatasize;
 	qboolean		loading;		// true if worldmodel is loading
 	qboolean		sky_sphere;	// true when quake sky-sphere is used
 	qboolean		has_mirrors;	// one or more brush models contain reflective textures
@@ -109,6 +111,7 @@ void Mod_SetupHulls( vec3_t mins[MAX_MAP_HULLS], vec3_t maxs[MAX_MAP_HULLS] );
 void Mod_GetBounds( int handle, vec3_t_ref mins, vec3_t_ref maxs );
 void Mod_GetFrames( int handle, int *numFrames );
 void Mod_LoadWorld( const char *name, uint *checksum, qboolean multiplayer );
+qboolean Mod_IsSnapshotData( const void *data );
 void Mod_FreeUnused( void );
 void *Mod_Calloc( int number, size_t size );
 void *Mod_CacheCheck( struct cache_user_s *c );
@@ -118,6 +121,8 @@ model_t *Mod_FindName( const char *name, qboolean create );
 model_t *Mod_LoadModel( model_t *mod, qboolean world );
 model_t *Mod_ForName( const char *name, qboolean world );
 qboolean Mod_RegisterModel( const char *name, int index );
+void Mod_BeginPrecache( void );
+void Mod_EndPrecache( qboolean build );
 int Mod_PointLeafnum( const vec3_t p );
 byte *Mod_LeafPVS( mleaf_t *leaf, model_t *model );
 byte *Mod_LeafPHS( mleaf_t *leaf, model_t *model );
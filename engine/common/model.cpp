@@ -30,6 +30,20 @@ GNU General Public License for more details.
 #include "gl_texlru.h"
 #endif
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <boost/asio.hpp>
+#include <bit>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+
 #define MAX_SIDE_VERTS		512	// per one polygon
 
 world_static_t	world;
@@ -46,6 +60,12 @@ char		modelname[64];		// short model name (without path and ext)
 convar_t		*mod_studiocache;
 convar_t		*mod_allow_materials;
 convar_t		*r_wadtextures;
+static convar_t	*mod_phs;
+static convar_t	*mod_phscache;
+static convar_t	*mod_phsthreads;
+static convar_t	*mod_asyncprecache;
+static convar_t	*mod_colsnapshot;
+static std::unique_ptr<boost::asio::thread_pool>	mod_precachepool;	// see Mod_BeginPrecache
 static wadlist_t	wadlist;
 		
 model_t		*loadmodel;
@@ -555,6 +575,11 @@ void Mod_Init( void )
 		mod_allow_materials = Cvar_Get( "host_allow_materials", "0", CVAR_LATCH|CVAR_ARCHIVE, "allow HD textures" );
 	else mod_allow_materials = NULL; // no reason to load HD-textures for dedicated server
 
+	mod_phs = Cvar_Get( "mod_phs", "0", CVAR_ARCHIVE, "build the potentially hearable set on map load, MSG_PAS messages are culled by it" );
+	mod_phscache = Cvar_Get( "mod_phscache", "1", CVAR_ARCHIVE, "store the potentially hearable set in maps/<mapname>.phs and reuse it" );
+	mod_phsthreads = Cvar_Get( "mod_phsthreads", "0", CVAR_ARCHIVE, "threads used to build the potentially hearable set, 0 is one per core" );
+	mod_asyncprecache = Cvar_Get( "mod_asyncprecache", "1", CVAR_ARCHIVE, "decrypt studio models precached during map load on worker threads" );
+	mod_colsnapshot = Cvar_Get( "mod_colsnapshot", "1", CVAR_ARCHIVE, "dedicated server maps collision data from maps/<mapname>.col, shared between processes" );
 	Cmd_AddCommand( "mapstats", Mod_PrintBSPFileSizes_f, "show stats for currently loaded map" );
 	Cmd_AddCommand( "modellist", Mod_Modellist_f, "display loaded models list" );
 
@@ -573,6 +598,9 @@ void Mod_ClearAll( qboolean keep_playermodel )
 	model_t	*mod;
 	int	i;
 
+	// drop anything still in flight
+	Mod_EndPrecache( false );
+
 	for( i = 0, mod = cm_models; i < cm_nummodels; i++, mod++ )
 	{
 		if( keep_playermodel && mod == plr )
@@ -597,10 +625,288 @@ void Mod_ClearUserData( void )
 void Mod_Shutdown( void )
 {
 	Mod_ClearAll( false );
+	mod_precachepool.reset();
 	Mem_FreePool( &com_studiocache );
 	Mem_FreePool( &mempool_mdl );
 }
 
+/*
+===============================================================================
+
+			COLLISION SNAPSHOT
+
+A dedicated server keeps the visibility, the clipnodes, the PHS and the
+entity string of the world in maps/<mapname>.col, already converted. The file
+is mapped read-only, so servers running the same map on one host share the
+pages instead of holding a private copy each. Nodes and leafs hold pointers
+and are still built by every process.
+===============================================================================
+*/
+#define COLSNAPSHOT_IDENT	(('L'<<24)+('O'<<16)+('C'<<8)+'X') // little-endian "XCOL"
+#define COLSNAPSHOT_VERSION	2
+
+enum
+{
+	COL_VISIBILITY = 0,
+	COL_CLIPNODES,	// dclipnode_t, empty for BSP31
+	COL_PHSOFS,	// int per leaf
+	COL_PHS,
+	COL_ENTITIES,	// with the terminator
+	COL_LUMPS
+};
+
+typedef struct
+{
+	int	ident;
+	int	version;
+	dword	key;		// CRC of the source lumps
+	int	numleafs;
+	dlump_t	lumps[COL_LUMPS];
+} dcolheader_t;
+
+static struct
+{
+	byte	*base;		// NULL if nothing is mapped
+	size_t	size;
+	dword	key;		// of the world being loaded
+	int	numleafs;		// in the BSP leaf lump
+	qboolean	enabled;		// world may use or write a snapshot
+} colsnapshot;
+
+static dword Mod_CollisionSnapshotKey( const dheader_t *header )
+{
+	static const int	lumps[] = { LUMP_ENTITIES, LUMP_PLANES, LUMP_VISIBILITY, LUMP_LEAFS, LUMP_CLIPNODES };
+	dword		key;
+	int		i;
+
+	CRC32_Init( &key );
+	CRC32_ProcessBuffer( &key, &header->version, sizeof( header->version ));
+
+	for( i = 0; i < (int)( sizeof( lumps ) / sizeof( lumps[0] )); i++ )
+	{
+		const dlump_t	*l = &header->lumps[lumps[i]];
+
+		CRC32_ProcessBuffer( &key, l, sizeof( *l ));
+		CRC32_ProcessBuffer( &key, (byte *)header + l->fileofs, l->filelen );
+	}
+	CRC32_Final( &key );
+
+	return key;
+}
+
+static void Mod_CollisionSnapshotName( char *out, size_t size )
+{
+	char	base[64];
+
+	FS_FileBase( loadmodel->name, base );
+	Q_snprintf( out, size, "maps/%s.col", base );
+}
+
+/*
+=================
+Mod_SnapshotLump
+
+mapped lump of the world being loaded, or NULL
+=================
+*/
+static const byte *Mod_SnapshotLump( int lump, size_t *size )
+{
+	const dcolheader_t	*hdr = (const dcolheader_t *)colsnapshot.base;
+
+	if( !hdr || !world.loading || !hdr->lumps[lump].filelen )
+		return NULL;
+
+	if( size ) *size = hdr->lumps[lump].filelen;
+	return colsnapshot.base + hdr->lumps[lump].fileofs;
+}
+
+/*
+=================
+Mod_IsSnapshotData
+
+data points into the mapped snapshot and must not be freed
+=================
+*/
+qboolean Mod_IsSnapshotData( const void *data )
+{
+	return colsnapshot.base && (const byte *)data >= colsnapshot.base && (const byte *)data < colsnapshot.base + colsnapshot.size;
+}
+
+static void Mod_UnmapCollisionSnapshot( void )
+{
+#ifndef _WIN32
+	if( colsnapshot.base )
+		munmap( colsnapshot.base, colsnapshot.size );
+#endif
+	colsnapshot.base = NULL;
+	colsnapshot.size = 0;
+}
+
+/*
+=================
+Mod_MapCollisionSnapshot
+
+map the snapshot of the world if it matches the BSP
+=================
+*/
+static void Mod_MapCollisionSnapshot( const dheader_t *header )
+{
+	Mod_UnmapCollisionSnapshot();
+
+	colsnapshot.enabled = Host_IsDedicated() && mod_colsnapshot->integer;
+	if( !colsnapshot.enabled ) return;
+
+	colsnapshot.key = Mod_CollisionSnapshotKey( header );
+	colsnapshot.numleafs = header->lumps[LUMP_LEAFS].filelen / sizeof( dleaf_t );
+#ifndef _WIN32
+	char		name[MAX_SYSPATH];
+	const char	*path;
+	dcolheader_t	*hdr;
+	struct stat	st;
+	void		*base;
+	int		i, fd;
+
+	Mod_CollisionSnapshotName( name, sizeof( name ));
+	if(( path = FS_GetDiskPath( name, false )) == NULL )
+		return;
+
+	if(( fd = open( path, O_RDONLY )) < 0 )
+		return;
+
+	if( fstat( fd, &st ) < 0 || st.st_size < (off_t)sizeof( dcolheader_t ))
+	{
+		close( fd );
+		return;
+	}
+
+	base = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+	close( fd );
+
+	if( base == MAP_FAILED )
+		return;
+
+	hdr = (dcolheader_t *)base;
+
+	if( hdr->ident == COLSNAPSHOT_IDENT && hdr->version == COLSNAPSHOT_VERSION && hdr->key == colsnapshot.key
+	&& hdr->numleafs == colsnapshot.numleafs )
+	{
+		for( i = 0; i < COL_LUMPS; i++ )
+		{
+			if( hdr->lumps[i].fileofs < 0 || hdr->lumps[i].filelen < 0 || hdr->lumps[i].fileofs + (off_t)hdr->lumps[i].filelen > st.st_size )
+				break;
+		}
+
+		if( i == COL_LUMPS )
+		{
+			colsnapshot.base = (byte *)base;
+			colsnapshot.size = st.st_size;
+			return;
+		}
+	}
+
+	MsgDev( D_NOTE, "%s is out of date\n", name );
+	munmap( base, st.st_size );
+#endif
+}
+
+static void Mod_WriteSnapshotLump( file_t *f, dcolheader_t *hdr, int lump, const void *data, size_t size )
+{
+	static const byte	pad[16] = { 0 };
+	fs_offset_t	ofs = FS_Tell( f );
+
+	// keep every lump 16-byte aligned in the mapping
+	if( ofs & 15 )
+	{
+		FS_Write( f, pad, 16 - ( ofs & 15 ));
+		ofs = FS_Tell( f );
+	}
+
+	hdr->lumps[lump].fileofs = ofs;
+	hdr->lumps[lump].filelen = size;
+	if( size ) FS_Write( f, data, size );
+}
+
+/*
+=================
+Mod_WriteCollisionSnapshot
+
+store the collision data of the world just loaded
+=================
+*/
+static void Mod_WriteCollisionSnapshot( void )
+{
+#ifndef _WIN32
+	char		name[MAX_SYSPATH], tempname[MAX_SYSPATH];
+	dcolheader_t	hdr;
+	int		i, *phsofs;
+	file_t		*f;
+
+	if( !colsnapshot.enabled || colsnapshot.base || !worldmodel->visdata )
+		return;
+
+	Mod_CollisionSnapshotName( name, sizeof( name ));
+	Q_snprintf( tempname, sizeof( tempname ), "%s.%i", name, (int)getpid( ));
+
+	if(( f = FS_Open( tempname, "wb", false )) == NULL )
+		return;
+
+	Q_memset( &hdr, 0, sizeof( hdr ));
+	hdr.ident = COLSNAPSHOT_IDENT;
+	hdr.version = COLSNAPSHOT_VERSION;
+	hdr.key = colsnapshot.key;
+	hdr.numleafs = colsnapshot.numleafs;
+	FS_Write( f, &hdr, sizeof( hdr ));
+
+	Mod_WriteSnapshotLump( f, &hdr, COL_VISIBILITY, worldmodel->visdata, world.visdatasize );
+	if( world.version != XTBSP_VERSION )
+		Mod_WriteSnapshotLump( f, &hdr, COL_CLIPNODES, worldmodel->clipnodes, worldmodel->numclipnodes * sizeof( dclipnode_t ));
+
+	Mod_WriteSnapshotLump( f, &hdr, COL_ENTITIES, worldmodel->entities, world.entdatasize + 1 );
+
+	// PHS lumps stay empty when mod_phs is off
+	if( world.phsdata )
+	{
+		phsofs = (int *)Mem_Alloc( worldmodel->mempool, worldmodel->numleafs * sizeof( int ));
+		for( i = 0; i < worldmodel->numleafs; i++ )
+			phsofs[i] = worldmodel->leafs[i].compressed_pas - world.phsdata;
+
+		Mod_WriteSnapshotLump( f, &hdr, COL_PHSOFS, phsofs, worldmodel->numleafs * sizeof( int ));
+		Mod_WriteSnapshotLump( f, &hdr, COL_PHS, world.phsdata, world.phsdatasize );
+		Mem_Free( phsofs );
+	}
+
+	FS_Seek( f, 0, SEEK_SET );
+	FS_Write( f, &hdr, sizeof( hdr ));
+	FS_Close( f );
+
+	// rename is atomic, other servers keep their mapping of the old file
+	if( !FS_Rename( tempname, name ))
+	{
+		MsgDev( D_WARN, "couldn't write %s\n", name );
+		FS_Delete( tempname );
+	}
+#endif
+}
+
+// resident and shared memory of the process, zero where unknown
+static void Mod_MemoryUsage( size_t *resident, size_t *shared )
+{
+	*resident = *shared = 0;
+#ifdef __linux__
+	long	pages[3];
+	FILE	*f = fopen( "/proc/self/statm", "r" );
+
+	if( !f ) return;
+
+	if( fscanf( f, "%ld %ld %ld", &pages[0], &pages[1], &pages[2] ) == 3 )
+	{
+		*resident = pages[1] * sysconf( _SC_PAGESIZE );
+		*shared = pages[2] * sysconf( _SC_PAGESIZE );
+	}
+	fclose( f );
+#endif
+}
+
 /*
 ===============================================================================
 
@@ -771,6 +1077,9 @@ static void Mod_LoadTextures( const dlump_t *l )
 		tx->width = mt.width;
 		tx->height = mt.height;
 #ifndef XASH_DEDICATED
+		if( Host_IsDedicated( ))
+			continue;	// server never draws them
+
 		// check for multi-layered sky texture
 		if( world.loading && !Q_strncmp( mt.name, "sky", 3 ) && mt.width == 256 && mt.height == 128 )
 		{	
@@ -2011,6 +2320,10 @@ static void Mod_LoadSurfaces( const dlump_t *l )
 		for( j = 0; j < MAXLIGHTMAPS; j++ )
 			out->styles[j] = in->styles[j];
 
+		// server doesn't draw, keep the surface data only
+		if( Host_IsDedicated( ))
+			continue;
+
 		// build polygons for non-lightmapped surfaces
 		if( host.features & ENGINE_BUILD_SURFMESHES && (( out->flags & SURF_DRAWTILED ) || !out->samples ))
 			Mod_BuildSurfacePolygons( out, info );
@@ -2309,6 +2622,9 @@ static void Mod_LoadVisibility( const dlump_t *l )
 		return;
 	}
 
+	if(( loadmodel->visdata = (byte *)Mod_SnapshotLump( COL_VISIBILITY, &world.visdatasize )) != NULL )
+		return;
+
 	loadmodel->visdata = (byte*)Mem_Alloc( loadmodel->mempool, l->filelen );
 	Q_memcpy( loadmodel->visdata, (void *)(mod_base + l->fileofs), l->filelen );
 	world.visdatasize = l->filelen; // save it for PHS allocation
@@ -2324,13 +2640,24 @@ static void Mod_LoadEntities( const dlump_t *l )
 	char	*pfile;
 	string	keyname;
 	char	token[4096] = {0};
+	const byte	*snap;
+	size_t	snapsize;
 
-	// make sure what we really has terminator
-	loadmodel->entities = (char*)Mem_ZeroAlloc( loadmodel->mempool, l->filelen + 1 );
-	Mem_VirtualCopy( loadmodel->entities, mod_base + l->fileofs, l->filelen );
+	// the entity string is only parsed, use the mapped copy
+	if(( snap = Mod_SnapshotLump( COL_ENTITIES, &snapsize )) != NULL && snapsize == (size_t)l->filelen + 1 && !snap[l->filelen] )
+	{
+		loadmodel->entities = (char *)snap;
+	}
+	else
+	{
+		// make sure what we really has terminator
+		loadmodel->entities = (char*)Mem_ZeroAlloc( loadmodel->mempool, l->filelen + 1 );
+		Mem_VirtualCopy( loadmodel->entities, mod_base + l->fileofs, l->filelen );
+	}
 	if( !world.loading ) return;
 
 	world.entdatasize = l->filelen;
+
 	pfile = (char *)loadmodel->entities;
 	world.message[0] = '\0';
 	wadlist.count = 0;
@@ -2400,10 +2727,17 @@ static void Mod_LoadClipnodes( const dlump_t *l )
 	int		i, count;
 	hull_t		*hull;
 
+	const byte	*snap;
+	size_t		snapsize = 0;
+
 	in = (dclipnode_t*)(mod_base + l->fileofs);
 	if( l->filelen % sizeof( *in )) Host_Error( "Mod_LoadClipnodes: funny lump size\n" );
 	count = l->filelen / sizeof( *in );
-	out = (dclipnode_t*)Mem_ZeroAlloc( loadmodel->mempool, count * sizeof( *out ));
+
+	// the snapshot holds them already converted
+	if(( snap = Mod_SnapshotLump( COL_CLIPNODES, &snapsize )) != NULL && snapsize == count * sizeof( *out ))
+		out = (dclipnode_t *)snap;
+	else out = (dclipnode_t*)Mem_ZeroAlloc( loadmodel->mempool, count * sizeof( *out ));
 
 	loadmodel->clipnodes = out;
 	loadmodel->numclipnodes = count;
@@ -2437,6 +2771,9 @@ static void Mod_LoadClipnodes( const dlump_t *l )
 	VectorCopy( GI->client_maxs[3], hull->clip_maxs );
 	VectorSubtract( hull->clip_maxs, hull->clip_mins, world.hull_sizes[3] );
 
+	if( (const byte *)out == snap )
+		return;
+
 	for( i = 0; i < count; i++, out++, in++ )
 	{
 		out->planenum = LittleLong(in->planenum);
@@ -2623,6 +2960,205 @@ static void Mod_MakeHull0( void )
 	}
 }
 
+/*
+=================================================================
+
+POTENTIALLY HEARABLE SET
+
+The PHS row of a leaf is the union of the PVS rows of every leaf it
+can see. Building it is quadratic in leaf count, so the compressed
+result is stored in maps/<mapname>.phs and reused while the vis lump
+of the map stays the same. world.checksum can't be the key because
+it's a constant in singleplayer.
+
+=================================================================
+*/
+#define PHSCACHE_IDENT	(('S'<<24)+('H'<<16)+('P'<<8)+'X') // little-endian "XPHS"
+#define PHSCACHE_VERSION	1
+
+typedef struct
+{
+	int	ident;
+	int	version;
+	int	numleafs;
+	int	visdatasize;
+	dword	viscrc;		// CRC of the compressed PVS
+	int	datasize;		// compressed PHS, follows the row offsets
+	int	vcount;		// leaves visible, summed over all leafs
+	int	hcount;		// leaves audible
+} dphscache_t;
+
+
+/*
+=================
+Mod_CheckPHSRows
+
+every row must expand to exactly one row within the data,
+or Mod_DecompressVis would run past the end of it
+=================
+*/
+static qboolean Mod_CheckPHSRows( const byte *data, size_t datasize, const int *visofs, int numleafs )
+{
+	int	i, out, row = ( numleafs + 7 ) >> 3;
+	size_t	pos;
+
+	for( i = 0; i < numleafs; i++ )
+	{
+		if( visofs[i] < 0 )
+			return false;
+
+		for( pos = visofs[i], out = 0; out < row; )
+		{
+			if( pos >= datasize )
+				return false;
+
+			if( data[pos] )
+			{
+				out++;
+				pos++;
+				continue;
+			}
+
+			if( pos + 1 >= datasize )
+				return false;
+
+			out += data[pos + 1];
+			pos += 2;
+		}
+
+		if( out != row )
+			return false;
+	}
+
+	return true;
+}
+
+static void Mod_PHSCacheName( char *out, size_t size )
+{
+	char	base[64];
+
+	FS_FileBase( worldmodel->name, base );
+	Q_snprintf( out, size, "maps/%s.phs", base );
+}
+
+/*
+=================
+Mod_LoadPHSCache
+
+returns the compressed PHS and fills visofs if the cache matches
+=================
+*/
+static byte *Mod_LoadPHSCache( dphscache_t *hdr, int *visofs )
+{
+	char		name[MAX_SYSPATH];
+	dphscache_t	cached;
+	byte		*data;
+	file_t		*f;
+
+	Mod_PHSCacheName( name, sizeof( name ));
+	f = FS_Open( name, "rb", false );
+	if( !f ) return NULL;
+
+	if( FS_Read( f, &cached, sizeof( cached )) != sizeof( cached ) || cached.ident != hdr->ident || cached.version != hdr->version
+	|| cached.numleafs != hdr->numleafs || cached.visdatasize != hdr->visdatasize || cached.viscrc != hdr->viscrc || cached.datasize <= 0 )
+	{
+		FS_Close( f );
+		return NULL;
+	}
+
+	data = (byte *)Mem_Alloc( worldmodel->mempool, cached.datasize );
+
+	if( FS_Read( f, visofs, hdr->numleafs * sizeof( int )) != (fs_offset_t)( hdr->numleafs * sizeof( int )) || FS_Read( f, data, cached.datasize ) != cached.datasize )
+	{
+		MsgDev( D_WARN, "%s is truncated\n", name );
+		Mem_Free( data );
+		FS_Close( f );
+		return NULL;
+	}
+	FS_Close( f );
+
+	if( !Mod_CheckPHSRows( data, cached.datasize, visofs, hdr->numleafs ))
+	{
+		MsgDev( D_WARN, "%s is corrupted\n", name );
+		Mem_Free( data );
+		return NULL;
+	}
+
+	*hdr = cached;
+
+	return data;
+}
+
+static void Mod_SavePHSCache( const dphscache_t *hdr, const int *visofs, const byte *data )
+{
+	char	name[MAX_SYSPATH];
+	file_t	*f;
+
+	Mod_PHSCacheName( name, sizeof( name ));
+	f = FS_Open( name, "wb", false );
+
+	if( !f )
+	{
+		MsgDev( D_WARN, "couldn't write %s\n", name );
+		return;
+	}
+
+	FS_Write( f, hdr, sizeof( *hdr ));
+	FS_Write( f, visofs, hdr->numleafs * sizeof( int ));
+	FS_Write( f, data, hdr->datasize );
+	FS_Close( f );
+}
+
+/*
+=================
+Mod_BuildPHSRows
+
+OR the PVS row of every visible leaf into the PHS row,
+walks set bits a word at a time
+=================
+*/
+static void Mod_BuildPHSRows( const uint *pvs, uint *phs, int first, int last, int num, int rowwords )
+{
+	const uint	*scan, *src;
+	uint		*dest, bits;
+	int		i, j, l, index;
+
+	for( i = first; i < last; i++ )
+	{
+		scan = pvs + i * rowwords;
+		dest = phs + i * rowwords;
+		Q_memcpy( dest, scan, rowwords * sizeof( uint ));
+
+		for( j = 0; j < rowwords; j++ )
+		{
+			for( bits = LittleLong( scan[j] ); bits; bits &= bits - 1 )
+			{
+				// +1 because pvs is 1 based
+				index = ( j << 5 ) + std::countr_zero( bits ) + 1;
+				if( index >= num ) break;
+
+				src = pvs + index * rowwords;
+				for( l = 0; l < rowwords; l++ )
+					dest[l] |= src[l];
+			}
+		}
+	}
+}
+
+// number of leafs set in a row, ignoring the padding bits
+static int Mod_CountLeafBits( const uint *row, int num )
+{
+	int	i, count = 0;
+
+	for( i = 0; i < ( num >> 5 ); i++ )
+		count += std::popcount( row[i] );
+
+	if( num & 31 )
+		count += std::popcount( LittleLong( row[i] ) & (( 1U << ( num & 31 )) - 1 ));
+
+	return count;
+}
+
 /*
 =================
 Mod_CalcPHS
@@ -2630,25 +3166,25 @@ Mod_CalcPHS
 */
 void Mod_CalcPHS( void )
 {
-	int	hcount, vcount;
-	int	i, j, k, l, index, num;
-	int	rowbytes, rowwords;
-	int	bitbyte, rowsize = 0;
-	int	*visofs, total_size = 0;
-	byte	*vismap, *vismap_p;
-	byte	*uncompressed_vis;
-	byte	*uncompressed_pas;
-	byte	*compressed_pas;
-	byte	*scan, *comp;
-	uint	*dest, *src;
-	double	timestart;
-	size_t	phsdatasize;
+	dphscache_t	hdr;
+	int		i, num, threads;
+	int		rowbytes, rowwords;
+	int		*visofs;
+	uint		*uncompressed_vis;
+	uint		*uncompressed_pas;
+	byte		*compressed_pas;
+	byte		*vismap_p, *comp;
+	size_t		rowsize, phsdatasize;
+	double		timestart;
 
 	// no worldmodel or no visdata
 	if( !world.loading || !worldmodel || !worldmodel->visdata )
 		return;
 
-	MsgDev( D_NOTE, "Building PAS...\n" );
+	// without PHS every PAS lookup is "all visible"
+	if( !mod_phs->integer )
+		return;
+
 	timestart = Sys_DoubleTime();
 
 	// NOTE: first leaf is skipped becuase is a outside leaf. Now all leafs have shift up by 1.
@@ -2658,89 +3194,111 @@ void Mod_CalcPHS( void )
 	rowwords = (num + 31) >> 5;
 	rowbytes = rowwords * 4;
 
-	// typically PHS reqiured more room because RLE fails on multiple 1 not 0
-	phsdatasize = world.visdatasize * 32; // empirically determined
+	Q_memset( &hdr, 0, sizeof( hdr ));
+	hdr.ident = PHSCACHE_IDENT;
+	hdr.version = PHSCACHE_VERSION;
+	hdr.numleafs = num;
+	hdr.visdatasize = world.visdatasize;
+	CRC32_Init( &hdr.viscrc );
+	CRC32_ProcessBuffer( &hdr.viscrc, worldmodel->visdata, world.visdatasize );
+	CRC32_Final( &hdr.viscrc );
+
+	// shared with other servers on this host
+	if(( visofs = (int *)Mod_SnapshotLump( COL_PHSOFS, &rowsize )) != NULL && rowsize == num * sizeof( int )
+	&& ( compressed_pas = (byte *)Mod_SnapshotLump( COL_PHS, &phsdatasize )) != NULL )
+	{
+		if( Mod_CheckPHSRows( compressed_pas, phsdatasize, visofs, num ))
+		{
+			for( i = 0; i < num; i++ )
+				worldmodel->leafs[i].compressed_pas = compressed_pas + visofs[i];
+			world.phsdata = compressed_pas;
+			world.phsdatasize = phsdatasize;
+
+			MsgDev( D_NOTE, "Building PAS... loaded from collision snapshot in %g secs\n", Sys_DoubleTime() - timestart );
+			return;
+		}
+	}
 
-	// allocate pvs and phs data single array
 	visofs = (int*)Mem_Alloc( worldmodel->mempool, num * sizeof( int ));
-	uncompressed_vis = (byte*)Mem_Alloc( worldmodel->mempool, rowbytes * num * 2 );
-	uncompressed_pas = uncompressed_vis + rowbytes * num;
-	compressed_pas = (byte*)Mem_Alloc( worldmodel->mempool, phsdatasize );
-	vismap = vismap_p = compressed_pas; // compressed PHS buffer
-	scan = uncompressed_vis;
-	vcount = 0;
 
-	// uncompress pvs first
-	for( i = 0; i < num; i++, scan += rowbytes )
+	if( mod_phscache->integer && ( compressed_pas = Mod_LoadPHSCache( &hdr, visofs )) != NULL )
 	{
-		Q_memcpy( scan, Mod_LeafPVS( worldmodel->leafs + i, worldmodel ), rowbytes );
-		if( i == 0 ) continue;
-
-		for( j = 0; j < num; j++ )
-		{
-			if( scan[j>>3] & (1<<( j & 7 )))
-				vcount++;
-		}
+		for( i = 0; i < num; i++ )
+			worldmodel->leafs[i].compressed_pas = compressed_pas + visofs[i];
+		world.phsdata = compressed_pas;
+		world.phsdatasize = hdr.datasize;
+		Mem_Free( visofs );
+
+		MsgDev( D_NOTE, "Building PAS... loaded from cache in %g secs\n", Sys_DoubleTime() - timestart );
+		MsgDev( D_NOTE, "Average leaves visible / audible / total: %i / %i / %i\n", hdr.vcount / num, hdr.hcount / num, num );
+		return;
 	}
 
-	scan = uncompressed_vis;
-	hcount = 0;
+	// allocate pvs and phs data single array
+	uncompressed_vis = (uint*)Mem_Alloc( worldmodel->mempool, rowbytes * num * 2 );
+	uncompressed_pas = uncompressed_vis + rowwords * num;
+
+	// uncompress pvs first
+	for( i = 0; i < num; i++ )
+	{
+		Q_memcpy( uncompressed_vis + i * rowwords, Mod_LeafPVS( worldmodel->leafs + i, worldmodel ), rowbytes );
+		if( i != 0 ) hdr.vcount += Mod_CountLeafBits( uncompressed_vis + i * rowwords, num );
+	}
 
-	dest = (uint *)uncompressed_pas;
+	// rows are independent, split them between threads
+	threads = mod_phsthreads->integer;
+	if( threads <= 0 ) threads = std::thread::hardware_concurrency();
+	threads = bound( 1, min( threads, num / 256 ), 64 );
 
-	for( i = 0; i < num; i++, dest += rowwords, scan += rowbytes )
+	if( threads > 1 )
 	{
-		Q_memcpy( dest, scan, rowbytes );
+		boost::asio::thread_pool	pool( threads );
 
-		for( j = 0; j < rowbytes; j++ )
+		for( i = 0; i < threads; i++ )
 		{
-			bitbyte = scan[j];
-			if( !bitbyte ) continue;
+			int	first = (int)((int64_t)num * i / threads);
+			int	last = (int)((int64_t)num * ( i + 1 ) / threads);
 
-			for( k = 0; k < 8; k++ )
-			{
-				if(!( bitbyte & ( 1<<k )))
-					continue;
-				// or this pvs row into the phs
-				// +1 because pvs is 1 based
-				index = ((j<<3) + k + 1);
-				if( index >= num ) continue;
-
-				src = (uint *)uncompressed_vis + index * rowwords;
-				for( l = 0; l < rowwords; l++ )
-					dest[l] |= src[l];
-			}
+			boost::asio::post( pool, [=]() { Mod_BuildPHSRows( uncompressed_vis, uncompressed_pas, first, last, num, rowwords ); });
 		}
+		pool.join();
+	}
+	else Mod_BuildPHSRows( uncompressed_vis, uncompressed_pas, 0, num, num, rowwords );
+
+	// typically PHS reqiured more room because RLE fails on multiple 1 not 0
+	phsdatasize = world.visdatasize * 32; // empirically determined
+	compressed_pas = vismap_p = (byte*)Mem_Alloc( worldmodel->mempool, phsdatasize );
 
-		// compress PHS data back
-		comp = Mod_CompressVis( (byte *)dest, (size_t *)&rowsize );
-		visofs[i] = vismap_p - vismap; // leaf 0 is a common solid 
-		total_size += rowsize;
+	// compress PHS data back
+	for( i = 0; i < num; i++ )
+	{
+		comp = Mod_CompressVis( (byte *)( uncompressed_pas + i * rowwords ), &rowsize );
+		visofs[i] = vismap_p - compressed_pas; // leaf 0 is a common solid
 
-		if( total_size > phsdatasize )
+		if( visofs[i] + rowsize > phsdatasize )
 		{
-			Host_Error( "CalcPHS: vismap expansion overflow %s > %s\n", Q_memprint( total_size ), Q_memprint( phsdatasize ));
+			Host_Error( "CalcPHS: vismap expansion overflow %s > %s\n", Q_memprint( visofs[i] + rowsize ), Q_memprint( phsdatasize ));
 		}
 
 		Q_memcpy( vismap_p, comp, rowsize );
 		vismap_p += rowsize; // move pointer
 
-		if( i == 0 ) continue;
-
-		for( j = 0; j < num; j++ )
-		{
-			if(((byte *)dest)[j>>3] & (1<<( j & 7 )))
-				hcount++;
-		}
+		if( i != 0 ) hdr.hcount += Mod_CountLeafBits( uncompressed_pas + i * rowwords, num );
 	}
 
 	// adjust compressed pas data to fit the size
-	compressed_pas = (byte*)Mem_Realloc( worldmodel->mempool, compressed_pas, total_size );
+	hdr.datasize = vismap_p - compressed_pas;
+	compressed_pas = (byte*)Mem_Realloc( worldmodel->mempool, compressed_pas, hdr.datasize );
+	world.phsdata = compressed_pas;
+	world.phsdatasize = hdr.datasize;
 
 	// apply leaf pointers
 	for( i = 0; i < worldmodel->numleafs; i++ )
 		worldmodel->leafs[i].compressed_pas = compressed_pas + visofs[i];
 
+	if( mod_phscache->integer )
+		Mod_SavePHSCache( &hdr, visofs, compressed_pas );
+
 	// release uncompressed data
 	Mem_Free( uncompressed_vis );
 	Mem_Free( visofs );	// release vis offsets
@@ -2748,8 +3306,8 @@ void Mod_CalcPHS( void )
 	// NOTE: we don't need to store off pointer to compressed pas-data
 	// because this is will be automatiaclly frees by mempool internal pointer
 	// and we never use this pointer after this point
-	MsgDev( D_NOTE, "Average leaves visible / audible / total: %i / %i / %i\n", vcount / num, hcount / num, num );
-	MsgDev( D_NOTE, "PAS building time: %g secs\n", Sys_DoubleTime() - timestart );
+	MsgDev( D_NOTE, "Building PAS... built in %g secs on %i thread%s\n", Sys_DoubleTime() - timestart, threads, threads > 1 ? "s" : "" );
+	MsgDev( D_NOTE, "Average leaves visible / audible / total: %i / %i / %i\n", hdr.vcount / num, hdr.hcount / num, num );
 }
 
 /*
@@ -2785,6 +3343,9 @@ void Mod_UnloadBrushModel( model_t *mod )
 		Mem_FreePool( &mod->mempool );
 	}
 
+	if( mod == cm_models )
+		Mod_UnmapCollisionSnapshot();
+
 	Q_memset( mod, 0, sizeof( *mod ));
 }
 
@@ -2848,6 +3409,9 @@ static void Mod_LoadBrushModel( model_t *mod, const void *buffer, qboolean *load
 
 	loadmodel->mempool = Mem_AllocSubPool( mempool_mdl, va( "^2%s^7", loadmodel->name ));
 
+	if( world.loading )
+		Mod_MapCollisionSnapshot( header );
+
 	// load into heap
 	if( header->lumps[LUMP_ENTITIES].fileofs <= 1024 && (header->lumps[LUMP_ENTITIES].filelen % sizeof( dplane_t )) == 0 )
 	{
@@ -3066,6 +3630,181 @@ model_t *Mod_FindName( const char *filename, qboolean create )
 	return mod;
 }
 
+/*
+===============================================================================
+
+			ASYNC PRECACHE
+
+While the server is loading, studio models are read as soon as they are
+precached and decrypted by worker threads. The main thread builds each one
+when it's first asked for, or when the precache ends. The filesystem, the
+mempools and Mod_LoadExtendSeq are not thread-safe, so reading and building
+stay on the main thread.
+===============================================================================
+*/
+typedef struct
+{
+	byte		*buf;		// file contents, NULL if nothing is pending
+	int		index;		// com_models slot to clear if the load fails
+	double		readtime;
+	std::future<double>	job;		// returns the decryption time
+} mod_pending_t;
+
+static mod_pending_t	mod_pending[MAX_MODELS];
+static qboolean		mod_precaching;
+static double		mod_precachestart;
+
+static struct
+{
+	int	models;		// loaded while the precache was open
+	int	async;		// decrypted on a worker
+	double	readtime;
+	double	decrypttime;	// summed over workers
+	double	buildtime;
+	double	slowest;
+	char	slowestname[64];
+} mod_precachestats;
+
+_inline mod_pending_t *Mod_Pending( model_t *mod )
+{
+	mod_pending_t	*pending = &mod_pending[mod - cm_models];
+
+	return pending->buf ? pending : NULL;
+}
+
+/*
+==================
+Mod_BeginPrecache
+
+models registered from now on may be prepared in background
+==================
+*/
+void Mod_BeginPrecache( void )
+{
+	int	threads;
+
+	Q_memset( &mod_precachestats, 0, sizeof( mod_precachestats ));
+	mod_precachestart = Sys_DoubleTime();
+	mod_precaching = true;
+
+	if( mod_asyncprecache->integer && !mod_precachepool )
+	{
+		threads = max( (int)std::thread::hardware_concurrency() - 1, 1 );
+		mod_precachepool = std::make_unique<boost::asio::thread_pool>( threads );
+	}
+}
+
+/*
+==================
+Mod_QueueModel
+
+read the file now and decrypt it in background,
+returns false if the model should be loaded right away
+==================
+*/
+static qboolean Mod_QueueModel( model_t *mod, int index )
+{
+	mod_pending_t	*pending = &mod_pending[mod - cm_models];
+	char		tempname[64];
+	double		start;
+	byte		*buf;
+
+	if( mod->mempool || mod->name[0] == '*' || pending->buf )
+		return true; // already loaded or queued
+
+	Q_strncpy( tempname, mod->name, sizeof( tempname ));
+	COM_FixSlashes( tempname );
+
+	start = Sys_DoubleTime();
+	buf = FS_LoadFile( tempname, NULL, false );
+
+	if( !buf || LittleLong( *(uint *)buf ) != IDSTUDIOHEADER )
+	{
+		if( buf ) Mem_Free( buf );
+		return false;
+	}
+
+	pending->buf = buf;
+	pending->index = index;
+	pending->readtime = Sys_DoubleTime() - start;
+
+	// keep Mod_FreeUnused away until it's built
+	mod->needload = world.load_sequence;
+	mod->type = mod_bad;
+
+	std::packaged_task<double()> task( [buf, mod]()
+	{
+		auto	begin = std::chrono::steady_clock::now();
+
+		Mod_DecryptModel( mod->name, buf );
+		return std::chrono::duration<double>( std::chrono::steady_clock::now() - begin ).count();
+	});
+
+	pending->job = task.get_future();
+	boost::asio::post( *mod_precachepool, std::move( task ));
+
+	return true;
+}
+
+/*
+==================
+Mod_TakePending
+
+wait for the worker and hand the prepared file to the loader
+==================
+*/
+static byte *Mod_TakePending( mod_pending_t *pending, double *readtime )
+{
+	byte	*buf = pending->buf;
+
+	mod_precachestats.decrypttime += pending->job.get();
+	mod_precachestats.async++;
+	*readtime = pending->readtime;
+	pending->buf = NULL;
+
+	return buf;
+}
+
+/*
+==================
+Mod_EndPrecache
+
+build everything still pending, or throw it away
+==================
+*/
+void Mod_EndPrecache( qboolean build )
+{
+	mod_pending_t	*pending;
+	model_t		*mod;
+	int		i;
+
+	mod_precaching = false;
+
+	for( i = 0, mod = cm_models; i < cm_nummodels; i++, mod++ )
+	{
+		if(( pending = Mod_Pending( mod )) == NULL )
+			continue;
+
+		if( build )
+		{
+			Mod_LoadModel( mod, false );
+			continue;
+		}
+
+		pending->job.wait();
+		Mem_Free( pending->buf );
+		pending->buf = NULL;
+	}
+
+	if( !build || !mod_precachestats.models )
+		return;
+
+	MsgDev( D_INFO, "Precached %i models in %.3f secs (%i decrypted on workers)\n", mod_precachestats.models,
+		Sys_DoubleTime() - mod_precachestart, mod_precachestats.async );
+	MsgDev( D_INFO, "  read %.3f secs, decrypt %.3f secs, build %.3f secs, slowest %s (%.1f ms)\n", mod_precachestats.readtime,
+		mod_precachestats.decrypttime, mod_precachestats.buildtime, mod_precachestats.slowestname, mod_precachestats.slowest * 1000.0 );
+}
+
 /*
 ==================
 Mod_LoadModel
@@ -3075,9 +3814,11 @@ Loads a model into the cache
 */
 model_t *Mod_LoadModel( model_t *mod, qboolean crash )
 {
-	byte	*buf;
-	char	tempname[64];
-	qboolean	loaded;
+	byte		*buf;
+	char		tempname[64];
+	qboolean		loaded;
+	mod_pending_t	*pending;
+	double		start, readtime, total;
 
 	if( !mod )
 	{
@@ -3094,7 +3835,18 @@ model_t *Mod_LoadModel( model_t *mod, qboolean crash )
 	Q_strncpy( tempname, mod->name, sizeof( tempname ));
 	COM_FixSlashes( tempname );
 
-	buf = FS_LoadFile( tempname, NULL, false );
+	start = Sys_DoubleTime();
+
+	if(( pending = Mod_Pending( mod )) != NULL )
+	{
+		buf = Mod_TakePending( pending, &readtime );
+		start -= readtime; // read earlier, count it anyway
+	}
+	else
+	{
+		buf = FS_LoadFile( tempname, NULL, false );
+		readtime = Sys_DoubleTime() - start;
+	}
 
 	if( !buf )
 	{
@@ -3108,7 +3860,6 @@ model_t *Mod_LoadModel( model_t *mod, qboolean crash )
 
 	FS_FileBase( mod->name, modelname );
 
-	MsgDev( D_NOTE, "Mod_LoadModel: %s\n", mod->name );
 	mod->needload = world.load_sequence; // register mod
 	mod->type = mod_bad;
 	loadmodel = mod;
@@ -3137,6 +3888,9 @@ model_t *Mod_LoadModel( model_t *mod, qboolean crash )
 
 	if( !loaded )
 	{
+		if( pending && com_models[pending->index] == mod )
+			com_models[pending->index] = NULL;
+
 		Mod_FreeModel( mod );
 		Mem_Free( buf );
 
@@ -3154,6 +3908,22 @@ model_t *Mod_LoadModel( model_t *mod, qboolean crash )
 #endif
 	Mem_Free( buf );
 
+	total = Sys_DoubleTime() - start;
+	MsgDev( D_NOTE, "Mod_LoadModel: %s (%.1f ms)\n", mod->name, total * 1000.0 );
+
+	if( mod_precaching || pending )
+	{
+		mod_precachestats.models++;
+		mod_precachestats.readtime += readtime;
+		mod_precachestats.buildtime += total - readtime;
+
+		if( total > mod_precachestats.slowest )
+		{
+			mod_precachestats.slowest = total;
+			Q_strncpy( mod_precachestats.slowestname, mod->name, sizeof( mod_precachestats.slowestname ));
+		}
+	}
+
 	return mod;
 }
 
@@ -3181,6 +3951,10 @@ Loads in the map and all submodels
 */
 void Mod_LoadWorld( const char *name, uint *checksum, qboolean multiplayer )
 {
+	size_t	resident, shared;
+	size_t	newresident, newshared;
+	qboolean	snapshot;
+	double	timestart;
 	int	i;
 
 #ifndef XASH_DEDICATED
@@ -3224,16 +3998,31 @@ void Mod_LoadWorld( const char *name, uint *checksum, qboolean multiplayer )
 	Mem_EmptyPool( com_studiocache );
 	world.load_sequence++;	// now all models are invalid
 
+	Mod_MemoryUsage( &resident, &shared );
+	timestart = Sys_DoubleTime();
+
 	// load the newmap
 	world.loading = true;
+	world.phsdata = NULL;
+	world.phsdatasize = 0;
 	worldmodel = Mod_ForName( name, true );
 	CRC32_MapFile( (dword *)&world.checksum, worldmodel->name, multiplayer );
-	world.loading = false;
 
-	if( checksum ) *checksum = world.checksum;
-		
 	// calc Potentially Hearable Set and compress it
 	Mod_CalcPHS();
+	snapshot = ( colsnapshot.base != NULL );
+	Mod_WriteCollisionSnapshot();
+	world.loading = false;
+
+	if( Host_IsDedicated( ))
+	{
+		Mod_MemoryUsage( &newresident, &newshared );
+		MsgDev( D_INFO, "%s loaded in %.1f ms (%s), resident %s, private %+.1f Mb\n", name,
+			( Sys_DoubleTime() - timestart ) * 1000.0, snapshot ? "collision snapshot" : "full",
+			Q_memprint( newresident ), ((double)( newresident - newshared ) - (double)( resident - shared )) / ( 1024.0 * 1024.0 ));
+	}
+
+	if( checksum ) *checksum = world.checksum;
 }
 
 /*
@@ -3394,6 +4183,17 @@ qboolean Mod_RegisterModel( const char *name, int index )
 	if( index < 0 || index > MAX_MODELS )
 		return false;
 
+	if( mod_precaching && mod_precachepool && mod_asyncprecache->integer )
+	{
+		mod = Mod_FindName( name, true );
+
+		if( mod && Mod_QueueModel( mod, index ))
+		{
+			com_models[index] = mod;
+			return true;
+		}
+	}
+
 	// this array used for acess to servermodels
 	mod = Mod_ForName( name, false );
 	com_models[index] = mod;
@@ -3427,6 +4227,11 @@ model_t *GAME_EXPORT Mod_Handle( int handle )
 		MsgDev( D_NOTE, "Mod_Handle: bad handle #%i\n", handle );
 		return NULL;
 	}
+
+	// still being prepared, build it now
+	if( com_models[handle] && Mod_Pending( com_models[handle] ))
+		Mod_LoadModel( com_models[handle], false );
+
 	return com_models[handle];
 }
 
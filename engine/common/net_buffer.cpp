@@ -230,23 +230,37 @@ qboolean BF_WriteBits( sizebuf_t *bf, const void *pData, int nBits )
 {
 	byte	*pOut = (byte *)pData;
 	int	nBitsLeft = nBits;
-#ifndef XASH_BIG_ENDIAN
-	// get output dword-aligned.
-	while((( size_t )pOut & 3 ) != 0 && nBitsLeft >= 8 )
+
+	// byte-aligned cursor: whole bytes can be copied as is
+	if(( bf->iCurBit & 7 ) == 0 && !bf->bOverflow && bf->iCurBit + nBits <= bf->nDataBits )
 	{
-		BF_WriteUBitLongExt( bf, *pOut, 8, false );
+		int	nBytes = nBits >> 3;
 
-		nBitsLeft -= 8;
-		++pOut;
+		Q_memcpy( bf->pData + ( bf->iCurBit >> 3 ), pOut, nBytes );
+		bf->iCurBit += nBytes << 3;
+		nBitsLeft -= nBytes << 3;
+		pOut += nBytes;
 	}
-
-	// read dwords.
-	while( nBitsLeft >= 32 )
+#ifndef XASH_BIG_ENDIAN
+	else
 	{
-		BF_WriteUBitLongExt( bf, *(( dword *)pOut ), 32, false );
+		// get output dword-aligned.
+		while((( size_t )pOut & 3 ) != 0 && nBitsLeft >= 8 )
+		{
+			BF_WriteUBitLongExt( bf, *pOut, 8, false );
 
-		pOut += sizeof( dword );
-		nBitsLeft -= 32;
+			nBitsLeft -= 8;
+			++pOut;
+		}
+
+		// read dwords.
+		while( nBitsLeft >= 32 )
+		{
+			BF_WriteUBitLongExt( bf, *(( dword *)pOut ), 32, false );
+
+			pOut += sizeof( dword );
+			nBitsLeft -= 32;
+		}
 	}
 #endif
 
@@ -18,6 +18,13 @@ GNU General Public License for more details.
 #include "mathlib.h"
 #include "net_encode.h"
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #define MAKE_FRAGID( id, count )	((( id & 0xffff ) << 16 ) | ( count & 0xffff ))
 #define FRAG_GETID( fragid )		(( fragid >> 16 ) & 0xffff )
 #define FRAG_GETCOUNT( fragid )	( fragid & 0xffff )
@@ -32,6 +39,7 @@ GNU General Public License for more details.
 // forward declarations
 void Netchan_FlushIncoming( netchan_t *chan, int stream );
 void Netchan_AddBufferToList( fragbuf_t **pplist, fragbuf_t *pbuf );
+static void Netchan_ReleaseFile( netfile_t *file );
 
 /*
 packet header ( size in bits )
@@ -98,6 +106,7 @@ netadr_t	net_ipv4_local;
 netadr_t	net_ipv6_local;
 sizebuf_t	net_message;
 mempool_t	*net_mempool;
+netfile_t	*net_files;	// files with outgoing fragments
 byte	net_message_buffer[NET_MAX_PAYLOAD];
 
 /*
@@ -116,7 +125,7 @@ Collect fragmrnts with signature 0xFFFFFFFE to single packet
 return true when got full packet
 ======================
 */
-qboolean NetSplit_GetLong( netsplit_t *ns, netadr_t *from, byte *data, size_t *length, qboolean decompress )
+qboolean NetSplit_GetLong( netsplit_t *ns, netadr_t *from, byte *data, size_t *length, int codec )
 {
 	netsplit_packet_t *packet = (netsplit_packet_t*)data;
 	netsplit_chain_packet_t * p;
@@ -182,8 +191,8 @@ qboolean NetSplit_GetLong( netsplit_t *ns, netadr_t *from, byte *data, size_t *l
 
 		ns->total_received += len;
 
-		if( decompress )
-			Huff_DecompressData( p->data, &len );
+		if( codec )
+			Net_DecompressData( codec, p->data, &len );
 
 		ns->total_received_uncompressed += len;
 		*length = len;
@@ -206,13 +215,16 @@ NetSplit_SendLong
 Send parts that are less or equal maxpacket
 ======================
 */
-void NetSplit_SendLong( netsrc_t sock, size_t length, void *data, netadr_t to, unsigned int maxpacket, unsigned int id, qboolean compress )
+void NetSplit_SendLong( netsrc_t sock, size_t length, void *data, netadr_t to, unsigned int maxpacket, unsigned int id, int codec )
 {
 	netsplit_packet_t packet = {0};
 	unsigned int part = maxpacket - NETSPLIT_HEADER_SIZE;
 
-	if( compress )
-		Huff_CompressData( (byte*)data, &length );
+	if( codec && !Net_CompressData( codec, (byte*)data, &length ))
+	{
+		MsgDev( D_ERROR, "NetSplit_SendLong: %s packet to %s doesn't fit, dropped\n", Net_CodecName( codec ), NET_AdrToString( to ));
+		return;
+	}
 
 	packet.signature = LittleLong(0xFFFFFFFE);
 	packet.id = LittleLong(id);
@@ -262,12 +274,22 @@ void Netchan_Init( void )
 
 	net_mempool = Mem_AllocPool( "Network Pool" );
 
-	Huff_Init ();	// initialize huffman compression
+	Net_CompressInit ();	// initialize payload codecs
 	BF_InitMasks ();	// initialize bit-masks
 }
 
 void Netchan_Shutdown( void )
 {
+	netfile_t	*file;
+
+	// channels are gone, drop the mappings that are left
+	while(( file = net_files ) != NULL )
+	{
+		file->refcount = 1;
+		Netchan_ReleaseFile( file );
+	}
+
+	Net_CompressShutdown();
 	Mem_FreePool( &net_mempool );
 }
 
@@ -304,7 +326,7 @@ void Netchan_Setup( netsrc_t sock, netchan_t *chan, netadr_t adr, int qport )
 	chan->incoming_sequence = 0;
 	chan->outgoing_sequence = 1;
 	chan->rate = DEFAULT_RATE;
-	chan->compress = false;	// work but low efficiency
+	chan->compress = NET_CODEC_NONE;	// work but low efficiency
 	chan->qport = qport;
 
 	BF_Init( &chan->message, "NetData", chan->message_buf, sizeof( chan->message_buf ));
@@ -353,6 +375,110 @@ qboolean Netchan_CanPacket( netchan_t *chan )
 	return false;
 }
 
+/*
+==============================
+Netchan_OpenFile
+
+map the file for sending or share the mapping
+of another transfer, load it if it's in a pack
+==============================
+*/
+static netfile_t *Netchan_OpenFile( const char *filename )
+{
+	netfile_t	*file;
+	fs_offset_t	size;
+	byte	*data = NULL;
+	qboolean	mapped = false;
+
+	for( file = net_files; file; file = file->next )
+	{
+		if( !Q_strcmp( file->filename, filename ))
+			return file;
+	}
+#ifndef _WIN32
+	const char	*path;
+	struct stat	st;
+	void		*base;
+	int		fd;
+
+	if(( path = FS_GetDiskPath( filename, false )) != NULL && ( fd = open( path, O_RDONLY )) >= 0 )
+	{
+		if( fstat( fd, &st ) == 0 && st.st_size > 0 )
+		{
+			base = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+			if( base != MAP_FAILED )
+			{
+				data = (byte *)base;
+				size = st.st_size;
+				mapped = true;
+			}
+		}
+		close( fd );
+	}
+#endif
+	if( !data )
+		data = FS_LoadFile( filename, &size, false );
+
+	if( !data || size <= 0 )
+	{
+		if( data ) Mem_Free( data );
+		return NULL;
+	}
+
+	file = (netfile_t *)Mem_ZeroAlloc( net_mempool, sizeof( netfile_t ));
+	Q_strncpy( file->filename, filename, sizeof( file->filename ));
+	file->data = data;
+	file->size = size;
+	file->mapped = mapped;
+	file->next = net_files;
+	net_files = file;
+
+	return file;
+}
+
+/*
+==============================
+Netchan_ReleaseFile
+
+==============================
+*/
+static void Netchan_ReleaseFile( netfile_t *file )
+{
+	netfile_t	**prev;
+
+	if( --file->refcount > 0 )
+		return;
+
+	for( prev = &net_files; *prev; prev = &(*prev)->next )
+	{
+		if( *prev == file )
+		{
+			*prev = file->next;
+			break;
+		}
+	}
+#ifndef _WIN32
+	if( file->mapped )
+		munmap( file->data, file->size );
+	else
+#endif
+	Mem_Free( file->data );
+	Mem_Free( file );
+}
+
+/*
+==============================
+Netchan_FreeFragbuf
+
+==============================
+*/
+static void Netchan_FreeFragbuf( fragbuf_t *buf )
+{
+	if( buf->file )
+		Netchan_ReleaseFile( buf->file );
+	Mem_Free( buf );
+}
+
 /*
 ==============================
 Netchan_UnlinkFragment
@@ -376,7 +502,7 @@ void Netchan_UnlinkFragment( fragbuf_t *buf, fragbuf_t **list )
 		*list = buf->next;
 
 		// destroy remnant
-		Mem_Free( buf );
+		Netchan_FreeFragbuf( buf );
 		return;
 	}
 
@@ -388,7 +514,7 @@ void Netchan_UnlinkFragment( fragbuf_t *buf, fragbuf_t **list )
 			search->next = buf->next;
 
 			// destroy remnant
-			Mem_Free( buf );
+			Netchan_FreeFragbuf( buf );
 			return;
 		}
 		search = search->next;
@@ -414,7 +540,7 @@ void Netchan_ClearFragbufs( fragbuf_t **ppbuf )
 	while( buf )
 	{
 		n = buf->next;
-		Mem_Free( buf );
+		Netchan_FreeFragbuf( buf );
 		buf = n;
 	}
 
@@ -429,7 +555,7 @@ Netchan_ClearFragments
 */
 void Netchan_ClearFragments( netchan_t *chan )
 {
-	fragbufwaiting_t	*wait;
+	fragbufwaiting_t	*wait, *next;
 	int		i;
 
 	for( i = 0; i < MAX_STREAMS; i++ )
@@ -438,8 +564,10 @@ void Netchan_ClearFragments( netchan_t *chan )
 
 		while( wait )
 		{
+			next = wait->next;
 			Netchan_ClearFragbufs( &wait->fragbufs );
-			wait = wait->next;
+			Mem_Free( wait );
+			wait = next;
 		}
 		chan->waitlist[i] = NULL;
 
@@ -544,24 +672,14 @@ Netchan_AddFragbufToTail
 */
 void Netchan_AddFragbufToTail( fragbufwaiting_t *wait, fragbuf_t *buf )
 {
-	fragbuf_t	*p;
-
 	buf->next = NULL;
 	wait->fragbufcount++;
 
 	if( !wait->fragbufs )
-	{
 		wait->fragbufs = buf;
-		return;
-	}
+	else wait->lastfragbuf->next = buf;
 
-	p = wait->fragbufs;
-	while( p->next )
-	{
-		p = p->next;
-	}
-
-	p->next = buf;
+	wait->lastfragbuf = buf;
 }
 
 /*
@@ -660,6 +778,38 @@ void Netchan_FragSend( netchan_t *chan )
 	}
 }
 
+/*
+==============================
+Netchan_NextFragmentSize
+
+bytes of fragment data the next transmit will add,
+lets the server spread downloads over frames
+==============================
+*/
+int Netchan_NextFragmentSize( netchan_t *chan )
+{
+	fragbuf_t	*pbuf;
+	int	i, size = 0;
+
+	// fragments wait for the reliable buffer to be acknowledged
+	if( !chan || chan->reliable_length )
+		return 0;
+
+	for( i = 0; i < MAX_STREAMS; i++ )
+	{
+		pbuf = chan->fragbufs[i];
+		if( !pbuf && chan->waitlist[i] )
+			pbuf = chan->waitlist[i]->fragbufs;
+		if( !pbuf ) continue;
+
+		size += BF_GetNumBytesWritten( &pbuf->frag_message );
+		if( pbuf->isfile && !pbuf->isbuffer )
+			size += pbuf->size;
+	}
+
+	return size;
+}
+
 /*
 ==============================
 Netchan_AddBufferToList
@@ -945,16 +1095,21 @@ int Netchan_CreateFileFragments( qboolean server, netchan_t *chan, const char *f
 	qboolean		firstfragment = true;
 	fragbufwaiting_t	*wait, *p;
 	fragbuf_t		*buf;
+	netfile_t		*file;
 
 	chunksize = bound( 16, net_blocksize->integer, 512 );
-	filesize = FS_FileSize( filename, false );
 
-	if( filesize <= 0 )
+	// fragments are filled from memory at send time, never from disk
+	file = Netchan_OpenFile( filename );
+
+	if( !file )
 	{
 		MsgDev( D_WARN, "Unable to open %s for transfer\n", filename );
 		return 0;
 	}
 
+	filesize = file->size;
+
 	wait = (fragbufwaiting_t *)Mem_ZeroAlloc( net_mempool, sizeof( fragbufwaiting_t ));
 	remaining = filesize;
 	pos = 0;
@@ -983,6 +1138,8 @@ int Netchan_CreateFileFragments( qboolean server, netchan_t *chan, const char *f
 		buf->isfile = true;
 		buf->size = send;
 		buf->foffset = pos;
+		buf->file = file;
+		file->refcount++;
 		Q_strncpy( buf->filename, filename, sizeof( buf->filename ));
 
 		pos += send;
@@ -1434,18 +1591,10 @@ void Netchan_TransmitBits( netchan_t *chan, int length, byte *data )
 				// which buffer are we sending ?
 				chan->reliable_fragid[i] = MAKE_FRAGID( pbuf->bufferid, chan->fragbufcount[i] );
 
-				// if it's not in-memory, then we'll need to copy it in frame the file handle.
+				// file data is appended only now to keep the queued fragments small
 				if( pbuf->isfile && !pbuf->isbuffer )
 				{
-					byte	filebuffer[2048];
-					file_t	*hfile;
-
-					hfile = FS_Open( pbuf->filename, "rb", false );
-					FS_Seek( hfile, pbuf->foffset, SEEK_SET );
-					FS_Read( hfile, filebuffer, pbuf->size );
-
-					BF_WriteBits( &pbuf->frag_message, filebuffer, pbuf->size << 3 );
-					FS_Close( hfile );
+					BF_WriteBits( &pbuf->frag_message, pbuf->file->data + pbuf->foffset, pbuf->size << 3 );
 				}
 
 				// copy frag stuff on top of current buffer
@@ -1471,7 +1620,7 @@ void Netchan_TransmitBits( netchan_t *chan, int length, byte *data )
 	}
 
 	Q_memset( send_buf, 0, NET_MAX_MESSAGE );
-	BF_Init( &send, "NetSend", send_buf, sizeof( send_buf ));
+	BF_Init( &send, "NetSend", send_buf, chan->compress ? NET_MAX_COMPRESSED : sizeof( send_buf ));
 
 	// prepare the packet header
 	w1 = chan->outgoing_sequence | (send_reliable << 31);
@@ -1560,8 +1709,14 @@ void Netchan_TransmitBits( netchan_t *chan, int length, byte *data )
 
 	Netchan_UpdateFlow( chan );
 
+	Net_CapturePacket( &send, hdr_size );
+
 	size1 = BF_GetNumBytesWritten( &send );
-	if( chan->compress ) Huff_CompressPacket( &send, hdr_size );
+	if( chan->compress && !Net_CompressPacket( chan->compress, &send, hdr_size ))
+	{
+		MsgDev( D_ERROR, "Netchan_Transmit: %s packet to %s doesn't fit, dropped\n", Net_CodecName( chan->compress ), NET_AdrToString( chan->remote_address ));
+		return;
+	}
 	size2 = BF_GetNumBytesWritten( &send );
 
 	chan->total_sended += size2;
@@ -1766,7 +1921,7 @@ qboolean Netchan_Process( netchan_t *chan, sizebuf_t *msg )
 	hdr_size = BF_GetNumBytesRead( msg );
 
 	size1 = BF_GetMaxBytes( msg );
-	if( chan->compress ) Huff_DecompressPacket( msg, hdr_size );
+	if( chan->compress ) Net_DecompressPacket( chan->compress, msg, hdr_size );
 	size2 = BF_GetMaxBytes( msg );
 
 	chan->total_received += size1;
@@ -0,0 +1,708 @@
+/*
+net_compress.cpp - pluggable payload compression for netchan
+Copyright (C) 2026 CSMoE
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "common.h"
+#include "netchan.h"
+#include "mathlib.h"
+
+#include <zlib.h>
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+/*
+=================================================
+
+Payload codecs
+
+Every codec works in place on a buffer of NET_MAX_PAYLOAD bytes.
+Deflate payloads start with one byte: 0 - stored as is, 1 - raw deflate
+stream. The preset dictionary is net_dict.bin, trained from captured
+traffic with net_dicttrain, and is only used when both sides have the
+same one (compared by CRC at connect time).
+
+=================================================
+*/
+
+#define NET_DICT_FILE		"net_dict.bin"
+#define NET_DICT_MAXSIZE	32768
+#define NET_DEFLATE_LEVEL	1	// fast, the dictionary gives the ratio
+#define NET_DEFLATE_MEMLEVEL	6	// smaller hash to reset per packet
+
+#define NET_STORED		0
+#define NET_DEFLATED		1
+
+typedef struct
+{
+	const char	*name;
+	qboolean		(*compress)( byte *data, size_t *length, size_t maxsize );
+	qboolean		(*decompress)( byte *data, size_t *length, size_t maxsize );
+} netcodec_t;
+
+static struct
+{
+	z_stream		deflate;
+	z_stream		inflate;
+	qboolean		initialized;
+
+	byte		*dict;
+	size_t		dictsize;
+	dword		dictcrc;
+
+	file_t		*capture;
+	int		capturecount;
+} net_comp;
+
+/*
+====================
+Net_HuffCompress
+
+legacy codec, old clients and servers know only this one
+====================
+*/
+static qboolean Net_HuffCompress( byte *data, size_t *length, size_t maxsize )
+{
+	Huff_CompressData( data, length );
+	return true;
+}
+
+static qboolean Net_HuffDecompress( byte *data, size_t *length, size_t maxsize )
+{
+	Huff_DecompressData( data, length );
+	return *length <= maxsize;
+}
+
+static qboolean Net_Deflate( byte *data, size_t *length, size_t maxsize, qboolean usedict )
+{
+	byte	buffer[NET_MAX_PAYLOAD];
+	z_stream	*zs = &net_comp.deflate;
+	size_t	inLen = *length;
+
+	if( inLen + 1 > maxsize || inLen + 1 > sizeof( buffer ))
+	{
+		MsgDev( D_ERROR, "Net_Deflate: overflow\n" );
+		return false;
+	}
+
+	deflateReset( zs );
+	if( usedict && net_comp.dict )
+		deflateSetDictionary( zs, net_comp.dict, net_comp.dictsize );
+
+	zs->next_in = data;
+	zs->avail_in = inLen;
+	zs->next_out = buffer + 1;
+	zs->avail_out = inLen; // no gain if it does not fit
+
+	if( deflate( zs, Z_FINISH ) == Z_STREAM_END )
+	{
+		*length = zs->total_out + 1;
+		buffer[0] = NET_DEFLATED;
+		Q_memcpy( data, buffer, *length );
+		return true;
+	}
+
+	// store as is
+	memmove( data + 1, data, inLen );
+	data[0] = NET_STORED;
+	*length = inLen + 1;
+
+	return true;
+}
+
+static qboolean Net_Inflate( byte *data, size_t *length, size_t maxsize, qboolean usedict )
+{
+	byte	buffer[NET_MAX_PAYLOAD];
+	z_stream	*zs = &net_comp.inflate;
+	size_t	inLen = *length;
+	int	ret;
+
+	if( inLen < 1 )
+		return false;
+
+	if( data[0] == NET_STORED )
+	{
+		memmove( data, data + 1, inLen - 1 );
+		*length = inLen - 1;
+		return true;
+	}
+
+	if( data[0] != NET_DEFLATED )
+		return false;
+
+	inflateReset( zs );
+	if( usedict && net_comp.dict )
+		inflateSetDictionary( zs, net_comp.dict, net_comp.dictsize );
+
+	zs->next_in = data + 1;
+	zs->avail_in = inLen - 1;
+	zs->next_out = buffer;
+	zs->avail_out = min( maxsize, sizeof( buffer ));
+
+	ret = inflate( zs, Z_FINISH );
+	if( ret != Z_STREAM_END )
+	{
+		MsgDev( D_ERROR, "Net_Inflate: %s\n", ret == Z_BUF_ERROR ? "overflow" : "corrupted data" );
+		return false;
+	}
+
+	*length = zs->total_out;
+	Q_memcpy( data, buffer, *length );
+
+	return true;
+}
+
+static qboolean Net_DeflateCompress( byte *data, size_t *length, size_t maxsize )
+{
+	return Net_Deflate( data, length, maxsize, false );
+}
+
+static qboolean Net_DeflateDecompress( byte *data, size_t *length, size_t maxsize )
+{
+	return Net_Inflate( data, length, maxsize, false );
+}
+
+static qboolean Net_DeflateDictCompress( byte *data, size_t *length, size_t maxsize )
+{
+	return Net_Deflate( data, length, maxsize, true );
+}
+
+static qboolean Net_DeflateDictDecompress( byte *data, size_t *length, size_t maxsize )
+{
+	return Net_Inflate( data, length, maxsize, true );
+}
+
+static const netcodec_t net_codecs[NET_CODEC_COUNT] =
+{
+{ "none", NULL, NULL },
+{ "Huffman", Net_HuffCompress, Net_HuffDecompress },
+{ "deflate", Net_DeflateCompress, Net_DeflateDecompress },
+{ "deflate+dict", Net_DeflateDictCompress, Net_DeflateDictDecompress },
+};
+
+/*
+====================
+Net_CodecName
+====================
+*/
+const char *Net_CodecName( int codec )
+{
+	if( codec < 0 || codec >= NET_CODEC_COUNT )
+		return "unknown";
+	return net_codecs[codec].name;
+}
+
+/*
+====================
+Net_DictionaryCRC
+
+0 if there is no dictionary
+====================
+*/
+uint Net_DictionaryCRC( void )
+{
+	return net_comp.dict ? net_comp.dictcrc : 0;
+}
+
+/*
+====================
+Net_CompressData
+
+returns false if the data can't be sent with this codec
+====================
+*/
+qboolean Net_CompressData( int codec, byte *data, size_t *length )
+{
+	if( codec <= NET_CODEC_NONE || codec >= NET_CODEC_COUNT )
+		return true;
+
+	return net_codecs[codec].compress( data, length, NET_MAX_PAYLOAD );
+}
+
+/*
+====================
+Net_DecompressData
+
+length is set to 0 for broken data
+====================
+*/
+void Net_DecompressData( int codec, byte *data, size_t *length )
+{
+	if( codec <= NET_CODEC_NONE || codec >= NET_CODEC_COUNT )
+		return;
+
+	if( !net_codecs[codec].decompress( data, length, NET_MAX_PAYLOAD ))
+		*length = 0;
+}
+
+/*
+====================
+Net_CompressPacket
+
+compress message beginning from specified offset,
+returns false if the packet can't be sent with this codec
+====================
+*/
+qboolean Net_CompressPacket( int codec, sizebuf_t *msg, int offset )
+{
+	size_t	length;
+	int	inLen;
+
+	if( codec <= NET_CODEC_NONE || codec >= NET_CODEC_COUNT )
+		return true;
+
+	if( codec == NET_CODEC_HUFF )
+	{
+		Huff_CompressPacket( msg, offset );
+		return true;
+	}
+
+	// empty payload goes out without the header, the receiver skips it the same way
+	inLen = BF_GetNumBytesWritten( msg ) - offset;
+	if( inLen <= 0 )
+		return true;
+
+	length = inLen;
+	if( !net_codecs[codec].compress( BF_GetData( msg ) + offset, &length, NET_MAX_PAYLOAD - offset ))
+		return false;
+
+	msg->iCurBit = ( offset + length ) << 3;
+	return true;
+}
+
+/*
+====================
+Net_DecompressPacket
+
+decompress message beginning from specified offset
+====================
+*/
+void Net_DecompressPacket( int codec, sizebuf_t *msg, int offset )
+{
+	size_t	length;
+	int	inLen;
+
+	if( codec <= NET_CODEC_NONE || codec >= NET_CODEC_COUNT )
+		return;
+
+	if( codec == NET_CODEC_HUFF )
+	{
+		Huff_DecompressPacket( msg, offset );
+		return;
+	}
+
+	inLen = BF_GetMaxBytes( msg ) - offset;
+	if( inLen <= 0 )
+		return;
+
+	length = inLen;
+	if( !net_codecs[codec].decompress( BF_GetData( msg ) + offset, &length, NET_MAX_PAYLOAD - offset ))
+		length = 0; // drop the payload, keep the header
+
+	msg->nDataBits = ( offset + length ) << 3;
+}
+
+/*
+====================
+Net_CapturePacket
+
+save uncompressed payload for net_dicttrain and net_compressbench
+====================
+*/
+void Net_CapturePacket( sizebuf_t *msg, int offset )
+{
+	int	length;
+
+	if( !net_comp.capture )
+		return;
+
+	length = BF_GetNumBytesWritten( msg ) - offset;
+	if( length <= 0 )
+		return;
+
+	FS_Write( net_comp.capture, &length, sizeof( length ));
+	FS_Write( net_comp.capture, BF_GetData( msg ) + offset, length );
+	net_comp.capturecount++;
+}
+
+/*
+====================
+Net_LoadCapture
+
+split capture file into packets
+====================
+*/
+static byte *Net_LoadCapture( const char *filename, std::vector<std::pair<byte *, int>> &packets, size_t *total )
+{
+	fs_offset_t	size, pos = 0;
+	byte		*capture;
+	int		length;
+
+	*total = 0;
+	capture = FS_LoadFile( filename, &size, false );
+	if( !capture )
+	{
+		Msg( "can't load %s\n", filename );
+		return NULL;
+	}
+
+	while( pos + (fs_offset_t)sizeof( length ) <= size )
+	{
+		Q_memcpy( &length, capture + pos, sizeof( length ));
+		pos += sizeof( length );
+
+		if( length <= 0 || length >= NET_MAX_PAYLOAD || pos + length > size )
+			break;
+
+		packets.push_back( std::make_pair( capture + pos, length ));
+		*total += length;
+		pos += length;
+	}
+
+	return capture;
+}
+
+/*
+====================
+Net_Capture_f
+====================
+*/
+static void Net_Capture_f( void )
+{
+	if( Cmd_Argc() < 2 )
+	{
+		Msg( "Usage: net_capture <filename|stop>\n" );
+		return;
+	}
+
+	if( net_comp.capture )
+	{
+		FS_Close( net_comp.capture );
+		net_comp.capture = NULL;
+		Msg( "net_capture: %i packets saved\n", net_comp.capturecount );
+	}
+
+	if( !Q_stricmp( Cmd_Argv( 1 ), "stop" ))
+		return;
+
+	net_comp.capture = FS_Open( Cmd_Argv( 1 ), "wb", false );
+	net_comp.capturecount = 0;
+
+	if( !net_comp.capture )
+		Msg( "net_capture: can't open %s\n", Cmd_Argv( 1 ));
+	else Msg( "net_capture: recording outgoing payloads to %s\n", Cmd_Argv( 1 ));
+}
+
+/*
+====================
+Net_DictTrain_f
+
+Greedy segment selection: score every 64 byte segment of the captured
+packets by how many packets share its 8 byte substrings, take the best
+one, forget the substrings it covers and repeat until the dictionary
+is full. Best segments go to the end, where deflate distances are short.
+====================
+*/
+#define DICT_DMER		8
+#define DICT_SEGMENT		64
+#define DICT_STEP		16
+
+static uint64_t Net_DictDmer( const byte *p )
+{
+	uint64_t	v;
+
+	Q_memcpy( &v, p, sizeof( v ));
+	return v;
+}
+
+static void Net_DictTrain_f( void )
+{
+	std::vector<std::pair<byte *, int>>	packets;
+	std::vector<std::pair<const byte *, int>>	candidates, selected;
+	std::unordered_map<uint64_t, std::pair<int, int>>	freq; // dmer -> packet count, last packet
+	std::priority_queue<std::pair<int64_t, int>>	queue;
+	std::vector<byte>			dict;
+	size_t				total, dictsize, used = 0;
+	const char			*outname;
+	byte				*capture;
+	file_t				*f;
+	int				i, j;
+
+	if( Cmd_Argc() < 2 )
+	{
+		Msg( "Usage: net_dicttrain <capture> [size] [output]\n" );
+		return;
+	}
+
+	dictsize = ( Cmd_Argc() > 2 ) ? Q_atoi( Cmd_Argv( 2 )) : 8192;
+	dictsize = bound( (size_t)256, dictsize, (size_t)NET_DICT_MAXSIZE );
+	outname = ( Cmd_Argc() > 3 ) ? Cmd_Argv( 3 ) : NET_DICT_FILE;
+
+	capture = Net_LoadCapture( Cmd_Argv( 1 ), packets, &total );
+	if( !capture ) return;
+
+	// count in how many packets each dmer appears
+	for( i = 0; i < (int)packets.size(); i++ )
+	{
+		const byte	*data = packets[i].first;
+		int		length = packets[i].second;
+
+		for( j = 0; j + DICT_DMER <= length; j++ )
+		{
+			auto	&entry = freq[Net_DictDmer( data + j )];
+
+			if( entry.second == i + 1 )
+				continue;
+			entry.first++;
+			entry.second = i + 1;
+		}
+
+		for( j = 0; j + DICT_SEGMENT <= length; j += DICT_STEP )
+			candidates.push_back( std::make_pair( data + j, DICT_SEGMENT ));
+
+		if( length >= DICT_DMER && ( length < DICT_SEGMENT || ( length - DICT_SEGMENT ) % DICT_STEP ))
+			candidates.push_back( std::make_pair( data + max( 0, length - DICT_SEGMENT ), min( length, DICT_SEGMENT )));
+	}
+
+	// dmers seen in one packet only will not pay off
+	for( auto &entry : freq )
+	{
+		if( entry.second.first < 2 )
+			entry.second.first = 0;
+	}
+
+	auto score = [&freq]( const std::pair<const byte *, int> &seg ) -> int64_t {
+		int64_t	sum = 0;
+
+		for( int k = 0; k + DICT_DMER <= seg.second; k++ )
+		{
+			auto	iter = freq.find( Net_DictDmer( seg.first + k ));
+
+			// count repeated dmers of the segment once
+			if( iter != freq.end() && iter->second.second >= 0 )
+			{
+				sum += iter->second.first;
+				iter->second.second = -1 - iter->second.second;
+			}
+		}
+
+		for( int k = 0; k + DICT_DMER <= seg.second; k++ )
+		{
+			auto	iter = freq.find( Net_DictDmer( seg.first + k ));
+
+			if( iter != freq.end() && iter->second.second < 0 )
+				iter->second.second = -1 - iter->second.second;
+		}
+
+		return sum;
+	};
+
+	for( i = 0; i < (int)candidates.size(); i++ )
+		queue.push( std::make_pair( score( candidates[i] ), i ));
+
+	// lazy greedy, scores only go down when dmers get covered
+	while( !queue.empty() && used < dictsize )
+	{
+		auto	top = queue.top();
+		int64_t	current;
+
+		queue.pop();
+		current = score( candidates[top.second] );
+
+		if( current <= 0 )
+			break;
+
+		if( !queue.empty() && current < queue.top().first )
+		{
+			queue.push( std::make_pair( current, top.second ));
+			continue;
+		}
+
+		auto	&seg = candidates[top.second];
+
+		selected.push_back( seg );
+		used += seg.second;
+
+		for( j = 0; j + DICT_DMER <= seg.second; j++ )
+		{
+			auto	iter = freq.find( Net_DictDmer( seg.first + j ));
+			if( iter != freq.end( )) iter->second.first = 0;
+		}
+	}
+
+	// most valuable segments last
+	for( auto iter = selected.rbegin(); iter != selected.rend(); ++iter )
+		dict.insert( dict.end(), iter->first, iter->first + iter->second );
+
+	if( dict.size() > dictsize )
+		dict.erase( dict.begin(), dict.begin() + ( dict.size() - dictsize ));
+
+	Mem_Free( capture );
+
+	if( dict.empty( ))
+	{
+		Msg( "net_dicttrain: nothing repeats in %i packets\n", (int)packets.size( ));
+		return;
+	}
+
+	f = FS_Open( outname, "wb", false );
+	if( !f )
+	{
+		Msg( "net_dicttrain: can't write %s\n", outname );
+		return;
+	}
+
+	FS_Write( f, dict.data(), dict.size( ));
+	FS_Close( f );
+
+	Msg( "net_dicttrain: %i packets, %s in, %i byte dictionary from %i segments saved to %s\n",
+		(int)packets.size(), Q_memprint( total ), (int)dict.size(), (int)selected.size(), outname );
+	Msg( "net_dicttrain: both server and clients need the same %s, it is loaded at startup\n", NET_DICT_FILE );
+}
+
+/*
+====================
+Net_CompressBench_f
+
+ratio and speed of every codec on captured traffic
+====================
+*/
+static void Net_CompressBench_f( void )
+{
+	std::vector<std::pair<byte *, int>>	packets;
+	static byte	buffer[NET_MAX_PAYLOAD + 16];
+	size_t		total, length, packed;
+	double		start, ctime, dtime;
+	byte		*capture;
+	int		codec, bad;
+
+	if( Cmd_Argc() < 2 )
+	{
+		Msg( "Usage: net_compressbench <capture>\n" );
+		return;
+	}
+
+	capture = Net_LoadCapture( Cmd_Argv( 1 ), packets, &total );
+	if( !capture ) return;
+
+	if( !total )
+	{
+		Mem_Free( capture );
+		return;
+	}
+
+	Msg( "net_compressbench: %i packets, %s, average %i bytes\n", (int)packets.size(), Q_memprint( total ), (int)( total / packets.size( )));
+	Msg( "%-14s %10s %8s %14s %14s\n", "codec", "out", "ratio", "compress", "decompress" );
+
+	for( codec = NET_CODEC_HUFF; codec < NET_CODEC_COUNT; codec++ )
+	{
+		if( codec == NET_CODEC_DEFLATEDICT && !net_comp.dict )
+			continue;
+
+		packed = 0;
+		ctime = dtime = 0.0;
+		bad = 0;
+
+		for( auto &packet : packets )
+		{
+			length = packet.second;
+			Q_memcpy( buffer, packet.first, length );
+
+			start = Sys_DoubleTime();
+			net_codecs[codec].compress( buffer, &length, NET_MAX_PAYLOAD );
+			ctime += Sys_DoubleTime() - start;
+			packed += length;
+
+			start = Sys_DoubleTime();
+			if( !net_codecs[codec].decompress( buffer, &length, NET_MAX_PAYLOAD ))
+				length = 0;
+			dtime += Sys_DoubleTime() - start;
+
+			if( length != (size_t)packet.second || memcmp( buffer, packet.first, length ))
+				bad++;
+		}
+
+		Msg( "%-14s %10s %7.1f%% %9.2f ns/B %9.2f ns/B%s\n", net_codecs[codec].name, Q_memprint( packed ), 100.0 * packed / total,
+			ctime * 1e9 / total, dtime * 1e9 / total, bad ? va( " ^1%i mismatches^7", bad ) : "" );
+	}
+
+	Mem_Free( capture );
+}
+
+/*
+====================
+Net_CompressInit
+====================
+*/
+void Net_CompressInit( void )
+{
+	fs_offset_t	size;
+	byte		*dict;
+
+	Huff_Init();	// initialize huffman compression
+
+	if( !net_comp.initialized )
+	{
+		deflateInit2( &net_comp.deflate, NET_DEFLATE_LEVEL, Z_DEFLATED, -MAX_WBITS, NET_DEFLATE_MEMLEVEL, Z_DEFAULT_STRATEGY );
+		inflateInit2( &net_comp.inflate, -MAX_WBITS );
+		net_comp.initialized = true;
+	}
+
+	dict = FS_LoadFile( NET_DICT_FILE, &size, false );
+	if( dict && size > 0 && size <= NET_DICT_MAXSIZE )
+	{
+		net_comp.dict = (byte *)Mem_Alloc( net_mempool, size );
+		net_comp.dictsize = size;
+		Q_memcpy( net_comp.dict, dict, size );
+
+		CRC32_Init( &net_comp.dictcrc );
+		CRC32_ProcessBuffer( &net_comp.dictcrc, net_comp.dict, size );
+		CRC32_Final( &net_comp.dictcrc );
+
+		MsgDev( D_INFO, "Net: %s loaded, %i bytes, crc %08x\n", NET_DICT_FILE, (int)size, net_comp.dictcrc );
+	}
+	if( dict ) Mem_Free( dict );
+
+	Cmd_AddCommand( "net_capture", Net_Capture_f, "record outgoing netchan payloads: net_capture <filename|stop>" );
+	Cmd_AddCommand( "net_dicttrain", Net_DictTrain_f, "build compression dictionary from captured traffic: net_dicttrain <capture> [size] [output]" );
+	Cmd_AddCommand( "net_compressbench", Net_CompressBench_f, "compare netchan codecs on captured traffic: net_compressbench <capture>" );
+}
+
+/*
+====================
+Net_CompressShutdown
+====================
+*/
+void Net_CompressShutdown( void )
+{
+	if( net_comp.capture )
+		FS_Close( net_comp.capture );
+	net_comp.capture = NULL;
+
+	if( net_comp.initialized )
+	{
+		deflateEnd( &net_comp.deflate );
+		inflateEnd( &net_comp.inflate );
+		net_comp.initialized = false;
+	}
+
+	// freed with net_mempool
+	net_comp.dict = NULL;
+	net_comp.dictsize = 0;
+
+	Cmd_RemoveCommand( "net_capture" );
+	Cmd_RemoveCommand( "net_dicttrain" );
+	Cmd_RemoveCommand( "net_compressbench" );
+}
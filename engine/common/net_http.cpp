@@ -27,10 +27,8 @@ enum connectionstate
 {
     HTTP_FREE = 0,
     HTTP_OPENED,
-    HTTP_SOCKET,
     HTTP_NS_RESOLVED,
     HTTP_CONNECTED,
-    HTTP_REQUEST,
     HTTP_REQUEST_SENT,
     HTTP_RESPONSE_RECEIVED,
 };
@@ -40,9 +38,10 @@ typedef struct httpfile_s
     httpserver_t *server;
     char path[PATH_MAX];
     file_t *file;
-    boost::asio::ip::tcp::socket *socket;
+    struct httptransfer_s *transfer; // request in flight, NULL while queued
     int size;
     int downloaded;
+    int resumed; // bytes that were already in .incomplete file
     int lastchecksize;
     float checktime;
     float blocktime;
@@ -57,10 +56,7 @@ struct http_static_s
     // file and server lists
     httpfile_t *first_file, *last_file;
     httpserver_t *first_server, *last_server;
-
-    // query or response
-    char buf[BUFSIZ];
-    int header_size, query_length, bytes_sent;
+    int next_id;
 } http;
 
 
@@ -70,10 +66,63 @@ int downloadfileid, downloadcount;
 convar_t *http_useragent;
 convar_t *http_autoremove;
 convar_t *http_timeout;
+convar_t *http_maxfiles;
+convar_t *http_maxconnections;
 
 boost::asio::io_context ioc_http;
 std::optional<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> ioc_http_work_guard;
 
+// all handlers run inside ioc_http.poll() from HTTP_Run, so they may touch the filesystem and the lists
+typedef struct httpconn_s
+{
+    boost::asio::ip::tcp::resolver resolver{ ioc_http };
+    boost::asio::ip::tcp::socket socket{ ioc_http };
+    boost::asio::streambuf response;
+    httpserver_t *server = nullptr;
+    bool keepalive = false;
+} httpconn_t;
+
+typedef struct httptransfer_s
+{
+    httpfile_t *file = nullptr; // cleared when file is dropped with the request in flight
+    std::shared_ptr<httpconn_t> conn;
+    std::string request;
+    int remaining = 0;
+    bool reused = false;
+    char buf[BUFSIZ];
+} httptransfer_t;
+
+typedef std::shared_ptr<httpconn_t> httpconn_ref;
+typedef std::shared_ptr<httptransfer_t> httptransfer_ref;
+
+// keep-alive connections waiting for the next request to their server
+static std::vector<httpconn_ref> http_idle;
+
+static void HTTP_Connect( httptransfer_ref t );
+
+/*
+========================
+HTTP_CloseIdle
+
+Close keep-alive connections, all of them when server is NULL
+========================
+*/
+static void HTTP_CloseIdle( httpserver_t *server )
+{
+    boost::system::error_code ec;
+
+    for( auto iter = http_idle.begin(); iter != http_idle.end(); )
+    {
+        if( server && (*iter)->server != server )
+        {
+            ++iter;
+            continue;
+        }
+
+        (*iter)->socket.close( ec );
+        iter = http_idle.erase( iter );
+    }
+}
 
 /*
 ========================
@@ -89,11 +138,97 @@ void HTTP_ClearCustomServers( void )
     {
         httpserver_t *tmp = http.first_server;
 
+        HTTP_CloseIdle( tmp );
         http.first_server = http.first_server->next;
         Mem_Free( tmp );
     }
 }
 
+/*
+==============
+HTTP_ReleaseConnection
+
+Keep connection for the next file on the same server
+==============
+*/
+static void HTTP_ReleaseConnection( const httpconn_ref &conn )
+{
+    boost::system::error_code ec;
+    int count = 0;
+
+    if( conn->keepalive && conn->socket.is_open() && !conn->response.size() )
+    {
+        for( auto &idle : http_idle )
+        {
+            if( idle->server == conn->server )
+                count++;
+        }
+
+        if( count < http_maxconnections->integer )
+        {
+            http_idle.push_back( conn );
+            return;
+        }
+    }
+
+    conn->socket.close( ec );
+}
+
+/*
+==============
+HTTP_DetachTransfer
+
+Forget the request in flight, its handlers will see that file is gone
+==============
+*/
+static void HTTP_DetachTransfer( httpfile_t *file )
+{
+    httptransfer_t *t = file->transfer;
+    boost::system::error_code ec;
+
+    if( !t )
+        return;
+
+    file->transfer = NULL;
+    t->file = NULL;
+
+    // pending operations still use the connection, it dies with the transfer
+    if( t->conn )
+    {
+        t->conn->resolver.cancel();
+        t->conn->socket.close( ec );
+    }
+}
+
+/*
+==============
+HTTP_UnlinkFile
+
+Remove node from queue and free it
+==============
+*/
+static void HTTP_UnlinkFile( httpfile_t *file )
+{
+    httpfile_t **prev = &http.first_file, *last = NULL;
+
+    while( *prev && *prev != file )
+    {
+        last = *prev;
+        prev = &(*prev)->next;
+    }
+
+    ASSERT( *prev );
+
+    *prev = file->next;
+    if( http.last_file == file )
+        http.last_file = last;
+
+    if( !http.first_file )
+        Cvar_SetFloat( "scr_download", -1 );
+
+    Mem_Free( file );
+}
+
 /*
 ==============
 HTTP_FreeFile
@@ -110,17 +245,12 @@ void HTTP_FreeFile( httpfile_t *file, qboolean error )
         FS_Close( file->file );
 
     file->file = NULL;
-
-    if( file->socket )
-        file->socket->close();
-
-    delete file->socket;
-    file->socket = nullptr;
+    HTTP_DetachTransfer( file );
 
     Q_snprintf( incname, 256, "downloaded/%s.incomplete", file->path );
     if( error )
     {
-        // Switch to next fastdl server if present
+        // Switch to next fastdl server if present, it will resume .incomplete file
         if( file->server && ( file->state > HTTP_FREE ) )
         {
             file->server = file->server->next;
@@ -151,308 +281,490 @@ void HTTP_FreeFile( httpfile_t *file, qboolean error )
         else
             Msg ( "HTTP: Successfully downloaded %s, processing disabled!\n", name );
     }
+
     // Now free list node
-    if( http.first_file == file )
-    {
-        // Now only first_file is changing progress
-        Cvar_SetFloat( "scr_download", -1 );
+    HTTP_UnlinkFile( file );
+}
 
-        if( http.last_file == http.first_file )
-            http.last_file = http.first_file = 0;
-        else
-            http.first_file = file->next;
-        Mem_Free( file );
-    }
-    else if( file->next )
-    {
-        httpfile_t *tmp = http.first_file, *tmp2;
+/*
+==============
+HTTP_Fail
 
-        while( tmp && ( tmp->next != file ) )
-            tmp = tmp->next;
+Request failed, reconnect once if it went over a stale keep-alive connection,
+otherwise skip to next server
+==============
+*/
+static void HTTP_Fail( const httptransfer_ref &t, const char *fmt, ... ) _format( 2 );
+static void HTTP_Fail( const httptransfer_ref &t, const char *fmt, ... )
+{
+    httpfile_t *file = t->file;
+    boost::system::error_code ec;
+    char msg[MAX_SYSPATH];
+    va_list args;
 
-        ASSERT( tmp );
+    if( t->reused && file->state < HTTP_RESPONSE_RECEIVED )
+    {
+        t->reused = false;
+        t->conn->socket.close( ec );
+        HTTP_Connect( t );
+        return;
+    }
 
-        tmp2 = tmp->next;
+    va_start( args, fmt );
+    Q_vsnprintf( msg, sizeof( msg ), fmt, args );
+    va_end( args );
 
-        if( tmp2 )
-        {
-            tmp->next = tmp2->next;
-            Mem_Free( tmp2 );
-        }
-        else
-            tmp->next = 0;
-    }
-    else file->id = -1; // Tail file
+    Msg( "HTTP: %s\n", msg );
+    HTTP_FreeFile( file, true );
 }
 
 /*
 ==============
-HTTP_Run
+HTTP_Finish
 
-Download next file block if download quered.
-Call every frame
+Whole body is on disk
 ==============
 */
-void HTTP_Run( void )
+static void HTTP_Finish( const httptransfer_ref &t )
 {
-    int res;
-    char buf[BUFSIZ+1];
-    char *begin = 0;
-    httpfile_t *curfile = http.first_file; // download is single-threaded now, but can be rewrited
-    httpserver_t *server;
-    float frametime;
-    boost::asio::ip::tcp::endpoint addr;
+    httpfile_t *file = t->file;
 
-    ioc_http.poll();
+    HTTP_ReleaseConnection( t->conn );
+    t->conn = nullptr;
+    file->transfer = NULL;
+    t->file = NULL;
 
-    if( !curfile )
-        return;
-
-    if( curfile->id == -1) // Tail file
-        return;
+    HTTP_FreeFile( file, false ); // success
+}
 
-    server = curfile->server;
+/*
+==============
+HTTP_WriteData
+==============
+*/
+static qboolean HTTP_WriteData( const httptransfer_ref &t, const void *data, int size )
+{
+    httpfile_t *file = t->file;
 
-    if( !server )
+    if( FS_Write( file->file, data, size ) != size )
     {
-        Msg( "HTTP: No servers to download %s!\n", curfile->path );
-        HTTP_FreeFile( curfile, true );
-        return;
+        // close it and go to next
+        Msg( "HTTP: Write failed for %s!\n", file->path );
+        file->state = HTTP_FREE;
+        HTTP_FreeFile( file, true );
+        return false;
     }
 
-    if( !curfile->file ) // state == 0
+    file->downloaded += size;
+    file->lastchecksize += size;
+    file->blocktime = 0;
+    t->remaining -= size;
+
+    return true;
+}
+
+/*
+==============
+HTTP_ReadBody
+==============
+*/
+static void HTTP_ReadBody( httptransfer_ref t )
+{
+    if( t->remaining <= 0 )
     {
-        char name[PATH_MAX];
+        HTTP_Finish( t );
+        return;
+    }
 
-        Msg( "HTTP: Starting download %s from %s\n", curfile->path, server->host );
-        Cbuf_AddText( va( "menu_connectionprogress dl \"%s\" \"%s%s\" %d %d \"(starting)\"\n", curfile->path, server->host, server->path, downloadfileid, downloadcount ) );
-        Q_snprintf( name, PATH_MAX, "downloaded/%s.incomplete", curfile->path );
+    t->conn->socket.async_read_some( boost::asio::buffer( t->buf, min( t->remaining, (int)sizeof( t->buf ))),
+        [t]( const boost::system::error_code &ec, size_t bytes ) {
+        if( !t->file )
+            return;
 
-        curfile->file = FS_Open( name, "wb", true );
+        if( bytes > 0 && !HTTP_WriteData( t, t->buf, (int)bytes ))
+            return;
 
-        if( !curfile->file )
+        if( ec && t->remaining > 0 )
         {
-            Msg( "HTTP: Cannot open %s!\n", name );
-            HTTP_FreeFile( curfile, true );
+            HTTP_Fail( t, "Problem downloading %s: %s", t->file->path, ec.message().c_str() );
             return;
         }
 
-        curfile->state = HTTP_OPENED;
-        curfile->blocktime = 0;
-        curfile->downloaded = 0;
-        curfile->lastchecksize = 0;
-        curfile->checktime = 0;
-    }
+        HTTP_ReadBody( t );
+    });
+}
 
-    if( curfile->state < HTTP_SOCKET ) // Socket is not created
-    {
-        dword mode;
+/*
+==============
+HTTP_ReopenFile
 
-        curfile->socket = new boost::asio::ip::tcp::socket(ioc_http);
+Start .incomplete file from scratch
+==============
+*/
+static qboolean HTTP_ReopenFile( httpfile_t *file )
+{
+    char name[PATH_MAX];
 
-        // Now set non-blocking mode
-        // You may skip this if not supported by system,
-        // but download will lock engine, maybe you will need to add manual returns
-        curfile->socket->non_blocking(true);
-        curfile->state = HTTP_SOCKET;
-    }
+    Q_snprintf( name, PATH_MAX, "downloaded/%s.incomplete", file->path );
 
-    if( curfile->state < HTTP_NS_RESOLVED )
+    if( file->file )
+        FS_Close( file->file );
+
+    file->file = FS_Open( name, "wb", true );
+    file->downloaded = file->resumed = 0;
+
+    return file->file != NULL;
+}
+
+/*
+==============
+HTTP_ParseHeader
+==============
+*/
+static void HTTP_ParseHeader( httptransfer_ref t, size_t length )
+{
+    httpfile_t *file = t->file;
+    httpserver_t *server = file->server;
+    std::string header( boost::asio::buffers_begin( t->conn->response.data() ), boost::asio::buffers_begin( t->conn->response.data() ) + length );
+    const char *str = header.c_str();
+    boost::system::error_code ec;
+    const char *value;
+    int status = 0, size;
+
+    t->conn->response.consume( length );
+
+    if( sscanf( str, "HTTP/%*d.%*d %d", &status ) != 1 )
     {
-        boost::system::error_code ec;
-        boost::asio::ip::tcp::resolver resolver(ioc_http);
-        boost::asio::ip::tcp::resolver::results_type results = resolver.resolve(
-                server->host,
-                va("%d", server->port),
-                ec
-        );
+        HTTP_Fail( t, "Bad response from %s", server->host );
+        return;
+    }
+
+    t->conn->keepalive = !Q_stristr( str, "Connection: close" ) && Q_strncmp( str, "HTTP/1.0", 8 );
 
-        if( ec.failed() )
+    if( status == 416 )
+    {
+        // .incomplete file is longer than the resource, it was changed on server
+        MsgDev( D_WARN, "HTTP: %s changed on server, restarting\n", file->path );
+        if( !HTTP_ReopenFile( file ))
         {
-            Msg( "HTTP: Failed to resolve server address for %s!\n", server->host );
-            HTTP_FreeFile( curfile, true ); // Cannot connect
+            HTTP_Fail( t, "Cannot reopen %s!", file->path );
             return;
         }
-        addr = results->endpoint();
-        curfile->state = HTTP_NS_RESOLVED;
-        // fallthrouth
+        t->conn->keepalive = false;
+        t->conn->socket.close( ec );
+        HTTP_Connect( t );
+        return;
     }
 
-    if( curfile->state < HTTP_CONNECTED ) // Connection not enstabilished
+    if( status != 200 && status != 206 )
     {
-        boost::system::error_code ec;
-        curfile->socket->connect(addr, ec);
+        header.resize( header.find( "\r\n" ));
+        HTTP_Fail( t, "Bad response for %s:\n%s", file->path, header.c_str() );
+        return;
+    }
 
-        if( ec.failed() )
+    // Server ignored Range, body starts from the beginning
+    if( status == 200 && file->resumed > 0 )
+    {
+        MsgDev( D_NOTE, "HTTP: %s does not support resume, restarting %s\n", server->host, file->path );
+        if( !HTTP_ReopenFile( file ))
         {
-            Msg( "HTTP: Cannot connect to server: %s\n", ec.message().c_str() );
-            HTTP_FreeFile( curfile, true ); // Cannot connect
+            HTTP_Fail( t, "Cannot reopen %s!", file->path );
             return;
         }
-        curfile->state = HTTP_CONNECTED;
     }
 
-    if( curfile->state < HTTP_REQUEST ) // Request not formatted
+    value = Q_stristr( str, "Content-Length: " );
+    if( !value )
     {
-        http.query_length = Q_snprintf( http.buf, BUFSIZ,
-                                        "GET %s%s HTTP/1.1\r\n"
-                                        "Host: %s\r\n"
-                                        "User-Agent: %s\r\n\r\n", server->path,
-                                        curfile->path, server->host, http_useragent->string );
-        http.header_size = 0;
-        http.bytes_sent = 0;
-        curfile->state = HTTP_REQUEST;
+        // Usually fastdl's reports file size if link is correct
+        HTTP_Fail( t, "File size is unknown!" );
+        return;
     }
 
-    if( curfile->state < HTTP_REQUEST_SENT ) // Request not sent
+    t->remaining = Q_atoi( value + 16 );
+    size = file->resumed + t->remaining;
+
+    Msg( "HTTP: File size is %d\n", size );
+    Cbuf_AddText( va( "menu_connectionprogress dl \"%s\" \"%s%s\" %d %d \"(file size is %s)\"\n", file->path, server->host, server->path, downloadfileid, downloadcount, Q_pretifymem( size, 1 ) ) );
+
+    if( ( file->size != -1 ) && ( file->size != size ) ) // check size if specified, not used
+        MsgDev( D_WARN, "Server reports wrong file size!\n" );
+
+    file->size = size;
+    file->state = HTTP_RESPONSE_RECEIVED; // got response, let's start download
+
+    // Write remaining message part
+    if( t->conn->response.size() > 0 )
     {
-        while( http.bytes_sent < http.query_length )
+        int extra = min( (int)t->conn->response.size(), t->remaining );
+        std::string body( boost::asio::buffers_begin( t->conn->response.data() ), boost::asio::buffers_begin( t->conn->response.data() ) + extra );
+
+        t->conn->response.consume( extra );
+        if( !HTTP_WriteData( t, body.data(), extra ))
+            return;
+    }
+
+    HTTP_ReadBody( t );
+}
+
+/*
+==============
+HTTP_SendRequest
+==============
+*/
+static void HTTP_SendRequest( httptransfer_ref t )
+{
+    httpfile_t *file = t->file;
+    httpserver_t *server = file->server;
+    char range[64] = "";
+
+    if( file->resumed > 0 )
+        Q_snprintf( range, sizeof( range ), "Range: bytes=%d-\r\n", file->resumed );
+
+    t->request = va( "GET %s%s HTTP/1.1\r\n"
+                     "Host: %s\r\n"
+                     "User-Agent: %s\r\n"
+                     "Connection: keep-alive\r\n"
+                     "%s\r\n", server->path, file->path, server->host, http_useragent->string, range );
+    t->conn->response.consume( t->conn->response.size() );
+
+    boost::asio::async_write( t->conn->socket, boost::asio::buffer( t->request ), [t]( const boost::system::error_code &ec, size_t ) {
+        if( !t->file )
+            return;
+
+        if( ec )
         {
-            Cbuf_AddText( va( "menu_connectionprogress dl \"%s\" \"%s%s\" %d %d \"(sending request)\"\n", curfile->path, server->host, server->path, downloadfileid, downloadcount ) );
+            HTTP_Fail( t, "Failed to send request: %s", ec.message().c_str() );
+            return;
+        }
 
-            boost::system::error_code ec;
-            curfile->socket->send(boost::asio::buffer(http.buf + http.bytes_sent, http.query_length - http.bytes_sent), 0, ec);
-            if( ec.failed() )
-            {
-                Msg( "HTTP: Failed to send request: %s\n", ec.message().c_str() );
-                HTTP_FreeFile( curfile, true );
+        t->file->state = HTTP_REQUEST_SENT;
+        t->file->blocktime = 0;
+
+        boost::asio::async_read_until( t->conn->socket, t->conn->response, "\r\n\r\n", [t]( const boost::system::error_code &ec, size_t length ) {
+            if( !t->file )
                 return;
-            }
-            else
+
+            if( ec )
             {
-                http.bytes_sent += res;
-                curfile->blocktime = 0;
+                HTTP_Fail( t, "No response for %s: %s", t->file->path, ec.message().c_str() );
+                return;
             }
-        }
 
-        Msg( "HTTP: Request sent!\n");
-        Q_memset( http.buf, 0, BUFSIZ );
-        curfile->state = HTTP_REQUEST_SENT;
-    }
+            HTTP_ParseHeader( t, length );
+        });
+    });
+}
+
+/*
+==============
+HTTP_Connect
 
-    frametime = host.frametime; // save frametime to reset it after first iteration
+Resolve and connect without blocking the frame
+==============
+*/
+static void HTTP_Connect( httptransfer_ref t )
+{
+    httpserver_t *server = t->file->server;
 
-    boost::system::error_code ec;
+    t->conn = std::make_shared<httpconn_t>();
+    t->conn->server = server;
+    t->file->state = HTTP_OPENED;
 
-    while( curfile->socket->read_some(boost::asio::buffer(buf, BUFSIZ), ec) > 0) // if we got there, we are receiving data
-    {
-        //MsgDev(D_INFO,"res: %d\n", res);
-        curfile->blocktime = 0;
+    t->conn->resolver.async_resolve( server->host, va( "%d", server->port ),
+        [t]( const boost::system::error_code &ec, boost::asio::ip::tcp::resolver::results_type results ) {
+        if( !t->file )
+            return;
 
-        if( curfile->state < HTTP_RESPONSE_RECEIVED ) // Response still not received
+        if( ec )
         {
-            buf[res] = 0; // string break to search \r\n\r\n
-            Q_memcpy( http.buf + http.header_size, buf, res );
-            //MsgDev( D_INFO, "%s\n", buf );
-            begin = Q_strstr( http.buf, "\r\n\r\n" );
-            if( begin ) // Got full header
-            {
-                int cutheadersize = begin - http.buf + 4; // after that begin of data
-                char *length;
-
-                Msg( "HTTP: Got response!\n" );
-
-                if( !Q_strstr(http.buf, "200 OK") )
-                {
-                    *begin = 0; // cut string to print out response
-                    Msg( "HTTP: Bad response:\n%s\n", http.buf );
-                    HTTP_FreeFile( curfile, true );
-                    return;
-                }
-
-                // print size
-                length = Q_stristr(http.buf, "Content-Length: ");
-                if( length )
-                {
-                    int size = Q_atoi( length += 16 );
-
-                    Msg( "HTTP: File size is %d\n", size );
-                    Cbuf_AddText( va( "menu_connectionprogress dl \"%s\" \"%s%s\" %d %d \"(file size is %s)\"\n", curfile->path, server->host, server->path, downloadfileid, downloadcount, Q_pretifymem( size, 1 ) ) );
-
-                    if( ( curfile->size != -1 ) && ( curfile->size != size ) ) // check size if specified, not used
-                        MsgDev( D_WARN, "Server reports wrong file size!\n" );
-
-                    curfile->size = size;
-                }
-
-                if( curfile->size == -1 )
-                {
-                    // Usually fastdl's reports file size if link is correct
-                    Msg( "HTTP: File size is unknown!\n" );
-                    HTTP_FreeFile( curfile, true );
-                    return;
-                }
-
-                curfile->state = HTTP_RESPONSE_RECEIVED; // got response, let's start download
-                begin += 4;
-
-                // Write remaining message part
-                if( res - cutheadersize - http.header_size > 0 )
-                {
-                    int ret = FS_Write( curfile->file, begin, res - cutheadersize - http.header_size );
-
-                    if( ret != res - cutheadersize - http.header_size ) // could not write file
-                    {
-                        // close it and go to next
-                        Msg( "HTTP: Write failed for %s!\n", curfile->path );
-                        curfile->state = HTTP_FREE;
-                        HTTP_FreeFile( curfile, true );
-                        return;
-                    }
-                    curfile->downloaded += ret;
-                }
-            }
-            http.header_size += res;
+            HTTP_Fail( t, "Failed to resolve server address for %s!", t->file->server->host );
+            return;
         }
-        else if( res > 0 )
-        {
-            // data download
-            int ret = FS_Write( curfile->file, buf, res );
 
-            if ( ret != res )
+        t->file->state = HTTP_NS_RESOLVED;
+        boost::asio::async_connect( t->conn->socket, results, [t]( const boost::system::error_code &ec, const boost::asio::ip::tcp::endpoint & ) {
+            if( !t->file )
+                return;
+
+            if( ec )
             {
-                // close it and go to next
-                Msg( "HTTP: Write failed for %s!\n", curfile->path );
-                curfile->state = HTTP_FREE;
-                HTTP_FreeFile( curfile, true );
+                HTTP_Fail( t, "Cannot connect to server: %s", ec.message().c_str() );
                 return;
             }
 
-            curfile->downloaded += ret;
-            curfile->lastchecksize += ret;
-            curfile->checktime += frametime;
-            frametime = 0; // only first iteration increases time,
+            t->file->state = HTTP_CONNECTED;
+            HTTP_SendRequest( t );
+        });
+    });
+}
 
-            // as after it will run in same frame
-            if( curfile->checktime > 5 )
-            {
-                curfile->checktime = 0;
-                Msg( "HTTP: %f KB/s\n", (float)curfile->lastchecksize / ( 5.0 * 1024 ) );
-                Cbuf_AddText( va( "menu_connectionprogress dl \"%s\" \"%s%s\" %d %d \"(file size is %s, speed is %.2f KB/s)\"\n", curfile->path, server->host, server->path, downloadfileid, downloadcount, Q_pretifymem( curfile->size, 1 ), (float)curfile->lastchecksize / ( 5.0 * 1024 ) ) );
-                curfile->lastchecksize = 0;
-            }
-        }
+/*
+==============
+HTTP_StartFile
+
+Open or resume .incomplete file and issue the request
+==============
+*/
+static void HTTP_StartFile( httpfile_t *file )
+{
+    httpserver_t *server = file->server;
+    httptransfer_ref t;
+    char name[PATH_MAX];
+    fs_offset_t resume;
+
+    Msg( "HTTP: Starting download %s from %s\n", file->path, server->host );
+    Cbuf_AddText( va( "menu_connectionprogress dl \"%s\" \"%s%s\" %d %d \"(starting)\"\n", file->path, server->host, server->path, downloadfileid, downloadcount ) );
+    Q_snprintf( name, PATH_MAX, "downloaded/%s.incomplete", file->path );
+
+    // continue partial file left by previous server or session
+    resume = FS_FileExists( name, true ) ? FS_FileSize( name, true ) : 0;
+    if( resume > 0 && ( file->size == -1 || resume < file->size ))
+    {
+        file->file = FS_Open( name, "ab", true );
+        file->resumed = (int)resume;
+    }
+    else
+    {
+        file->file = FS_Open( name, "wb", true );
+        file->resumed = 0;
     }
 
-    if( curfile->size > 0 )
-        Cvar_SetFloat( "scr_download", (float)curfile->downloaded / curfile->size * 100 );
+    file->state = HTTP_OPENED;
 
-    if( curfile->size > 0 && curfile->downloaded >= curfile->size )
+    if( !file->file )
     {
-        HTTP_FreeFile( curfile, false ); // success
+        Msg( "HTTP: Cannot open %s!\n", name );
+        HTTP_FreeFile( file, true );
         return;
     }
-    else // if it is not blocking, inform user about problem
-        Msg( "HTTP: Problem downloading %s:\n%s\n", curfile->path, ec.message().c_str() );
 
-    curfile->checktime += frametime;
+    if( file->resumed )
+        Msg( "HTTP: Resuming %s at %s\n", file->path, Q_pretifymem( file->resumed, 1 ));
+
+    file->blocktime = 0;
+    file->downloaded = file->resumed;
+    file->lastchecksize = 0;
+    file->checktime = 0;
+
+    t = std::make_shared<httptransfer_t>();
+    t->file = file;
+    file->transfer = t.get();
 
-    if( curfile->blocktime > http_timeout->value )
+    // reuse keep-alive connection to this server
+    for( auto iter = http_idle.begin(); iter != http_idle.end(); ++iter )
     {
-        Msg( "HTTP: Timeout on receiving data!\n");
-        HTTP_FreeFile( curfile, true );
+        if( (*iter)->server != server )
+            continue;
+
+        t->conn = *iter;
+        t->reused = true;
+        http_idle.erase( iter );
+        file->state = HTTP_CONNECTED;
+        HTTP_SendRequest( t );
         return;
     }
+
+    HTTP_Connect( t );
+}
+
+/*
+==============
+HTTP_ServerLoad
+
+Number of files in flight from server
+==============
+*/
+static int HTTP_ServerLoad( httpserver_t *server )
+{
+    httpfile_t *file;
+    int count = 0;
+
+    for( file = http.first_file; file; file = file->next )
+    {
+        if( file->transfer && file->server == server )
+            count++;
+    }
+
+    return count;
+}
+
+/*
+==============
+HTTP_Run
+
+Start queued downloads, check timeouts
+Call every frame
+==============
+*/
+void HTTP_Run( void )
+{
+    httpfile_t *file, *next;
+    int active = 0, size = 0, downloaded = 0;
+
+    ioc_http.poll();
+
+    for( file = http.first_file; file; file = next )
+    {
+        next = file->next;
+
+        if( !file->transfer )
+            continue;
+
+        file->blocktime += host.frametime;
+        file->checktime += host.frametime;
+
+        if( file->blocktime > http_timeout->value )
+        {
+            Msg( "HTTP: Timeout on receiving data for %s!\n", file->path );
+            HTTP_FreeFile( file, true );
+            continue;
+        }
+
+        if( file->checktime > 5 )
+        {
+            httpserver_t *server = file->server;
+
+            Msg( "HTTP: %s %f KB/s\n", file->path, (float)file->lastchecksize / ( 5.0 * 1024 ) );
+            Cbuf_AddText( va( "menu_connectionprogress dl \"%s\" \"%s%s\" %d %d \"(file size is %s, speed is %.2f KB/s)\"\n", file->path, server->host, server->path, downloadfileid, downloadcount, Q_pretifymem( file->size, 1 ), (float)file->lastchecksize / ( 5.0 * 1024 ) ) );
+            file->checktime = 0;
+            file->lastchecksize = 0;
+        }
+
+        if( file->size > 0 )
+        {
+            size += file->size;
+            downloaded += file->downloaded;
+        }
+
+        active++;
+    }
+
+    // start queued files up to the limits
+    for( file = http.first_file; file && active < http_maxfiles->integer; file = next )
+    {
+        next = file->next;
+
+        if( file->transfer )
+            continue;
+
+        if( !file->server )
+        {
+            Msg( "HTTP: No servers to download %s!\n", file->path );
+            HTTP_FreeFile( file, true );
+            continue;
+        }
+
+        if( HTTP_ServerLoad( file->server ) >= http_maxconnections->integer )
+            continue;
+
+        HTTP_StartFile( file );
+        active++;
+    }
+
+    if( size > 0 )
+        Cvar_SetFloat( "scr_download", (float)downloaded / size * 100 );
 }
 
 /*
@@ -470,20 +782,19 @@ void HTTP_AddDownload(const char* path, int size, bool process)
 
     httpfile->size = size;
     httpfile->downloaded = 0;
-    httpfile->socket = nullptr;
+    httpfile->transfer = NULL;
+    httpfile->id = http.next_id++;
     Q_strncpy(httpfile->path, path, sizeof(httpfile->path));
 
     if (http.last_file)
     {
         // Add next to last download
-        httpfile->id = http.last_file->id + 1;
         http.last_file->next = httpfile;
         http.last_file = httpfile;
     }
     else
     {
         // It will be the only download
-        httpfile->id = 0;
         http.last_file = http.first_file = httpfile;
     }
 
@@ -611,6 +922,7 @@ Clear all queue
 void HTTP_Clear_f( void )
 {
     http.last_file = NULL;
+    http.next_id = 0;
     downloadfileid = downloadcount = 0;
 
     while( http.first_file )
@@ -622,45 +934,55 @@ void HTTP_Clear_f( void )
         if( file->file )
             FS_Close( file->file );
 
-        if( file->socket )
-        {
-            file->socket->close();
-            delete file->socket;
-            file->socket = nullptr;
-        }
-
+        HTTP_DetachTransfer( file );
         Mem_Free( file );
     }
+
+    HTTP_CloseIdle( NULL );
 }
 
 /*
 ==============
 HTTP_Cancel_f
 
-Stop current download, skip to next file
+Stop current downloads, skip to next files
 ==============
 */
 void HTTP_Cancel_f( void )
 {
-    if( !http.first_file )
-        return;
+    httpfile_t *file, *next;
 
-    // if download even not started, it will be removed completely
-    http.first_file->state = HTTP_FREE;
-    HTTP_FreeFile( http.first_file, true );
+    for( file = http.first_file; file; file = next )
+    {
+        next = file->next;
+
+        if( !file->transfer )
+            continue;
+
+        // if download even not started, it will be removed completely
+        file->state = HTTP_FREE;
+        HTTP_FreeFile( file, true );
+    }
 }
 
 /*
 =============
 HTTP_Skip_f
 
-Stop current download, skip to next server
+Stop current downloads, skip to next server
 =============
 */
 void HTTP_Skip_f( void )
 {
-    if( http.first_file )
-        HTTP_FreeFile( http.first_file, true );
+    httpfile_t *file, *next;
+
+    for( file = http.first_file; file; file = next )
+    {
+        next = file->next;
+
+        if( file->transfer )
+            HTTP_FreeFile( file, true );
+    }
 }
 
 /*
@@ -676,12 +998,10 @@ void HTTP_List_f( void )
 
     while( file )
     {
-        if( file->id == -1 )
-            Msg ( "\t(empty)\n");
-        else if ( file->server )
-            Msg ( "\t%d %d http://%s:%d/%s%s %d\n", file->id, file->state,
+        if ( file->server )
+            Msg ( "\t%d %d http://%s:%d/%s%s %d%s\n", file->id, file->state,
                   file->server->host, file->server->port, file->server->path,
-                  file->path, file->downloaded );
+                  file->path, file->downloaded, file->transfer ? " (active)" : "" );
         else
             Msg ( "\t%d %d (no server) %s\n", file->id, file->state, file->path );
 
@@ -719,18 +1039,19 @@ void HTTP_Init( void )
     http.last_server = NULL;
 
     http.first_file = http.last_file = NULL;
-    http.buf[0] = 0;
-    http.header_size = 0;
+    http.next_id = 0;
 
     Cmd_AddCommand("http_download", &HTTP_Download_f, "Add file to download queue");
-    Cmd_AddCommand("http_skip", &HTTP_Skip_f, "Skip current download server");
-    Cmd_AddCommand("http_cancel", &HTTP_Cancel_f, "Cancel current download");
+    Cmd_AddCommand("http_skip", &HTTP_Skip_f, "Skip current download servers");
+    Cmd_AddCommand("http_cancel", &HTTP_Cancel_f, "Cancel current downloads");
     Cmd_AddCommand("http_clear", &HTTP_Clear_f, "Cancel all downloads");
     Cmd_AddCommand("http_list", &HTTP_List_f, "List all queued downloads");
     Cmd_AddCommand("http_addcustomserver", &HTTP_AddCustomServer_f, "Add custom fastdl server");
     http_useragent = Cvar_Get( "http_useragent", "xash3d", CVAR_ARCHIVE, "User-Agent string" );
     http_autoremove = Cvar_Get( "http_autoremove", "1", CVAR_ARCHIVE, "Remove broken files" );
     http_timeout = Cvar_Get( "http_timeout", "45", CVAR_ARCHIVE, "Timeout for http downloader" );
+    http_maxfiles = Cvar_Get( "http_maxfiles", "8", CVAR_ARCHIVE, "Maximum files downloaded at once" );
+    http_maxconnections = Cvar_Get( "http_maxconnections", "4", CVAR_ARCHIVE, "Maximum connections to one fastdl server" );
 
     // Read servers from fastdl.txt
     line = serverfile = (char *)FS_LoadFile( "fastdl.txt", 0, false );
@@ -59,6 +59,9 @@ GNU General Public License for more details.
 //  bytes will be stripped by the networking channel layer
 #define NET_MAX_MESSAGE		PAD_NUMBER(( NET_MAX_PAYLOAD + HEADER_BYTES ), 16 )
 
+// compressed packets keep one byte for the codec header, so the stored form always fits
+#define NET_MAX_COMPRESSED	( NET_MAX_PAYLOAD - 1 )
+
 #define PORT_MASTER			27010
 #define PORT_CLIENT			27005
 #define PORT_SERVER			27015
@@ -87,6 +90,18 @@ NET
 #define NET_EXT_HUFF		(1U<<0)
 #define NET_EXT_SPLIT		(1U<<1)
 #define NET_EXT_SPLITHUFF	(1U<<2)
+#define NET_EXT_DEFLATE	(1U<<3)	// payloads use deflate instead of Huffman
+#define NET_EXT_DEFLATEDICT	(1U<<4)	// deflate with net_dict.bin, both sides have the same one
+
+// payload codecs, netchan_t.compress holds one of them
+enum
+{
+	NET_CODEC_NONE = 0,
+	NET_CODEC_HUFF,	// legacy, old clients and servers know only this one
+	NET_CODEC_DEFLATE,
+	NET_CODEC_DEFLATEDICT,
+	NET_CODEC_COUNT
+};
 
 // message data
 typedef struct
@@ -105,6 +120,17 @@ typedef struct
 	int		totalbytes;
 } flow_t;
 
+// file sent by fragments, mapped or loaded once and shared by all transfers of it
+typedef struct netfile_s
+{
+	struct netfile_s	*next;
+	char		filename[CS_SIZE];
+	byte		*data;		// read only
+	size_t		size;
+	qboolean		mapped;		// data is mmapped rather than loaded
+	int		refcount;		// one per fragment
+} netfile_t;
+
 // generic fragment structure
 typedef struct fragbuf_s
 {
@@ -115,6 +141,7 @@ typedef struct fragbuf_s
 	qboolean		isfile;		// is this a file buffer?
 	qboolean		isbuffer;		// is this file buffer from memory ( custom decal, etc. ).
 	char		filename[CS_SIZE];	// name of the file to save out on remote host
+	netfile_t		*file;		// where the file data comes from
 	int		foffset;		// offset in file from which to read data  
 	int		size;		// size of data to read at that offset
 } fragbuf_t;
@@ -125,6 +152,7 @@ typedef struct fragbufwaiting_s
 	struct fragbufwaiting_s	*next;	// next chain in waiting list
 	int		fragbufcount;	// number of buffers in this chain
 	fragbuf_t		*fragbufs;	// the actual buffers
+	fragbuf_t		*lastfragbuf;	// tail of the chain, for appending
 } fragbufwaiting_t;
 
 
@@ -171,7 +199,7 @@ typedef struct netchan_s
 	netadr_t		remote_address;	// address this channel is talking to.  
 	int		qport;		// qport value to write when transmitting
 	
-	qboolean		compress;		// enable huffman compression
+	int		compress;		// payload codec, NET_CODEC_NONE to disable
 			
 	double		last_received;	// for timeouts
 	double		last_sent;	// for retransmits		
@@ -230,7 +258,7 @@ typedef struct netchan_s
 	size_t		total_received;
 	size_t		total_received_uncompressed;
 	qboolean	split;
-	qboolean	splitcompress;
+	int	splitcompress;	// codec for whole split packets
 	unsigned int	maxpacket;
 	unsigned int	splitid;
 	netsplit_t netsplit;
@@ -261,11 +289,12 @@ void Netchan_UpdateProgress( netchan_t *chan );
 qboolean Netchan_IncomingReady( netchan_t *chan );
 qboolean Netchan_CanPacket( netchan_t *chan );
 void Netchan_FragSend( netchan_t *chan );
+int Netchan_NextFragmentSize( netchan_t *chan );
 void Netchan_Clear( netchan_t *chan );
 void Netchan_ReportFlow( netchan_t *chan );
 
 // packet splitting
-qboolean NetSplit_GetLong(netsplit_t *ns, netadr_t *from, byte *data, size_t *length , qboolean decompress );
+qboolean NetSplit_GetLong(netsplit_t *ns, netadr_t *from, byte *data, size_t *length , int codec );
 
 // huffman compression
 void Huff_Init( void );
@@ -274,4 +303,15 @@ void Huff_DecompressPacket( sizebuf_t *msg, int offset );
 void Huff_CompressData( byte *data, size_t *length );
 void Huff_DecompressData( byte *data, size_t *length );
 
+// payload compression
+void Net_CompressInit( void );
+void Net_CompressShutdown( void );
+const char *Net_CodecName( int codec );
+uint Net_DictionaryCRC( void );
+qboolean Net_CompressPacket( int codec, sizebuf_t *msg, int offset );
+void Net_DecompressPacket( int codec, sizebuf_t *msg, int offset );
+qboolean Net_CompressData( int codec, byte *data, size_t *length );
+void Net_DecompressData( int codec, byte *data, size_t *length );
+void Net_CapturePacket( sizebuf_t *msg, int offset );
+
 #endif//NET_MSG_H
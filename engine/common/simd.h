@@ -0,0 +1,32 @@
+/*
+simd.h - 128-bit vector intrinsics selection
+Copyright (C) 2026 CSMoE
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef SIMD_H
+#define SIMD_H
+
+// XASH_SIMD_SSE2 is defined when SSE2 intrinsics can be used directly (x86)
+// or through the sse2neon translation layer (ARM NEON). Code using it must
+// keep a scalar path for the remaining targets.
+#if defined( __SSE2__ ) || defined( __x86_64__ ) || defined( _M_X64 ) || defined( _M_AMD64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define XASH_SIMD_SSE2 1
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#include "util/sse2neon.h"
+#define XASH_SIMD_SSE2 2
+#endif
+
+#define SIMD_ALIGN	16
+
+#endif // SIMD_H
@@ -99,6 +99,24 @@ typedef struct
 	vec3_t		mins, maxs;
 } sv_consistency_t;
 
+// precache and resource lists serialized once per level,
+// connecting clients copy them as is
+typedef enum
+{
+	SIGNON_MODELS = 0,
+	SIGNON_SOUNDS,
+	SIGNON_EVENTS,
+	SIGNON_RESOURCES,
+	SIGNON_LISTS
+} signonlist_t;
+
+typedef struct
+{
+	byte		*data;		// immutable, rebuilt when the list changes
+	int		*offsets;		// bit offset of every entry, numentries + 1 items
+	int		numentries;
+} sv_signonlist_t;
+
 // like as entity_state_t in Quake
 typedef struct
 {
@@ -302,11 +320,14 @@ typedef struct
 	qboolean		connected;
 } challenge_t;
 
-typedef struct
+#define MAX_USER_MSG_HASH	(MAX_USER_MESSAGES >> 2)
+
+typedef struct sv_user_message_s
 {
 	char		name[32];	// in GoldSrc max name length is 12
 	int		number;	// svc_ number
 	int		size;	// if size == -1, size come from first byte after svcnum
+	struct sv_user_message_s *hashNext;	// next message with the same name hash
 } sv_user_message_t;
 
 typedef struct
@@ -333,11 +354,19 @@ typedef struct
 	vec3_t		finalpos;
 } sv_interp_t;
 
+typedef struct
+{
+	int		num;			// edict number
+	int		serialnumber;		// edict serialnumber at the time it was freed
+} sv_freeedict_t;
+
 typedef struct
 {
 	// user messages stuff
 	const char	*msg_name;		// just for debug
 	sv_user_message_t	msg[MAX_USER_MESSAGES];	// user messages array
+	sv_user_message_t	*msghash[MAX_USER_MSG_HASH];	// by name, for REG_USER_MSG
+	int		nummsgs;
 	int		msg_size_index;		// write message size at this pos in bitbuf
 	int		msg_realsize;		// left in bytes
 	int		msg_index;		// for debug messages
@@ -358,6 +387,11 @@ typedef struct
 	};
 	int		numEntities;		// actual entities count
 
+	sv_freeedict_t	*freeEdicts;		// [maxEntities] ring of released edicts, oldest first
+	int		freeEdictHead;		// oldest queued edict
+	int		numFreeEdicts;		// queued count, including stale entries
+	word		*privDataPool;		// [maxEntities] size class of pvPrivateData, 0 if zone memory
+
 	movevars_t	movevars;			// curstate
 	movevars_t	oldmovevars;		// oldstate
 	playermove_t	*pmove;			// pmove state
@@ -401,6 +435,9 @@ typedef struct
 
 	double		last_heartbeat;
 	challenge_t	challenges[MAX_CHALLENGES];	// to prevent invalid IPs from connecting
+
+	sv_signonlist_t	signonlists[SIGNON_LISTS];	// shared by all connecting clients
+	int		fragstart;		// client that goes first with fragments next frame
 } server_static_t;
 
 //=============================================================================
@@ -440,6 +477,7 @@ extern	convar_t		*sv_unlagsamples;
 extern	convar_t		*sv_allow_upload;
 extern	convar_t		*sv_allow_download;
 extern	convar_t		*sv_allow_fragment;
+extern	convar_t		*sv_fragment_budget;
 extern	convar_t		*sv_allow_studio_attachment_angles;
 extern	convar_t		*sv_allow_rotate_pushables;
 extern	convar_t		*sv_allow_godmode;
@@ -472,6 +510,7 @@ extern	convar_t		*mp_logfile;
 extern	convar_t		*sv_fixmulticast;
 extern	convar_t		*sv_allow_split;
 extern	convar_t		*sv_allow_compress;
+extern	convar_t		*sv_allow_deflate;
 extern	convar_t		*sv_maxpacket;
 extern	convar_t		*sv_forcesimulating;
 extern  convar_t		*sv_password;
@@ -579,6 +618,9 @@ void SV_EndRedirect( void );
 void SV_RemoteCommand( netadr_t from, sizebuf_t *msg );
 int SV_CalcPing( sv_client_t *cl );
 void SV_UpdateResourceList( void );
+void SV_BuildSignonLists( void );
+void SV_InvalidateSignonList( int list );
+void SV_FreeSignonLists( void );
 //
 // sv_cmds.c
 //
@@ -611,6 +653,12 @@ void SV_FreeEdicts( void );
 edict_t *SV_AllocEdict( void );
 void SV_FreeEdict( edict_t *pEdict );
 void SV_InitEdict( edict_t *pEdict );
+void SV_ClearFreeEdicts( void );
+void SV_EdictStats_f( void );
+void SV_MulticastStats_f( void );
+void SV_SpawnBench_f( void );
+void SV_ReleasePrivateData( edict_t *pEdict );
+void SV_PrivateDataStats_f( void );
 const char *SV_ClassName( const edict_t *e );
 void SV_SetModel( edict_t *ent, const char *name );
 void SV_CopyTraceToGlobal( trace_t *trace );
@@ -698,6 +746,15 @@ const char *SV_GetLightStyle( int style );
 int SV_LightForEntity( edict_t *pEdict );
 void SV_ClearPhysEnts( void );
 
+//
+// sv_demo.c
+//
+void SV_InitDemoRecorder( void );
+void SV_StopServerDemo( void );
+void SV_DemoFrame( void );
+void SV_DemoRecordEvent( int flags, word eventindex, float delay, event_args_t *args );
+void SV_DemoRecordMessage( int dest, const edict_t *ent );
+
 //
 // sv_log.c
 //
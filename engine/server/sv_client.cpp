@@ -331,10 +331,24 @@ gotnewcl:
 	// initailize netchan here because SV_DropClient will clear network buffer
 	Netchan_Setup( NS_SERVER, &newcl->netchan, from, qport );
 
-	if( sv_allow_compress->integer && ( requested_extensions & NET_EXT_HUFF ) )
+	if( sv_allow_compress->integer && sv_allow_deflate->integer && ( requested_extensions & NET_EXT_DEFLATE ))
+	{
+		uint dictcrc = (uint)strtoul( Info_ValueForKey( Cmd_Argv( 6 ), "z" ), NULL, 10 );
+
+		extensions |= NET_EXT_DEFLATE;
+		newcl->netchan.compress = NET_CODEC_DEFLATE;
+
+		// dictionary only helps when both sides have the same one
+		if( dictcrc && dictcrc == Net_DictionaryCRC( ))
+		{
+			extensions |= NET_EXT_DEFLATEDICT;
+			newcl->netchan.compress = NET_CODEC_DEFLATEDICT;
+		}
+	}
+	else if( sv_allow_compress->integer && ( requested_extensions & NET_EXT_HUFF ) )
 	{
 		extensions |= NET_EXT_HUFF;
-		newcl->netchan.compress = true;
+		newcl->netchan.compress = NET_CODEC_HUFF;
 	}
 
 	if( sv_allow_split->integer && ( requested_extensions & NET_EXT_SPLIT ) )
@@ -351,7 +365,7 @@ gotnewcl:
 		if( sv_allow_compress->integer && sv_allow_split->integer
 				&& !( requested_extensions & NET_EXT_HUFF )
 				&& ( requested_extensions & NET_EXT_SPLITHUFF ) )
-			newcl->netchan.splitcompress = true, extensions |= NET_EXT_SPLITHUFF;
+			newcl->netchan.splitcompress = NET_CODEC_HUFF, extensions |= NET_EXT_SPLITHUFF;
 	}
 
 	BF_Init( &newcl->datagram, "Datagram", newcl->datagram_buf, sizeof( newcl->datagram_buf )); // datagram buf
@@ -1306,8 +1320,7 @@ void SV_PutClientInServer( edict_t *ent )
 				svgame.dllFuncs2.pfnOnFreeEntPrivateData( ent );
 
 			// clear any dlls data but keep engine data
-			Mem_Free( ent->pvPrivateData );
-			ent->pvPrivateData = NULL;
+			SV_ReleasePrivateData( ent );
 			//ent->serialnumber++;
 		}
 
@@ -1520,6 +1533,218 @@ void SV_New_f( sv_client_t *cl )
 	}
 }
 
+/*
+============================================================
+
+SIGNON LISTS
+
+============================================================
+*/
+/*
+==================
+SV_FreeSignonList
+==================
+*/
+static void SV_FreeSignonList( sv_signonlist_t *list )
+{
+	if( list->data ) Mem_Free( list->data );
+	if( list->offsets ) Mem_Free( list->offsets );
+	Q_memset( list, 0, sizeof( *list ));
+}
+
+/*
+==================
+SV_InvalidateSignonList
+
+list is rebuilt when the next client asks for it
+==================
+*/
+void SV_InvalidateSignonList( int list )
+{
+	SV_FreeSignonList( &svs.signonlists[list] );
+}
+
+/*
+==================
+SV_FreeSignonLists
+==================
+*/
+void SV_FreeSignonLists( void )
+{
+	int	i;
+
+	for( i = 0; i < SIGNON_LISTS; i++ )
+		SV_FreeSignonList( &svs.signonlists[i] );
+}
+
+/*
+==================
+SV_BeginSignonList
+==================
+*/
+static void SV_BeginSignonList( sv_signonlist_t *list, sizebuf_t *buf, int numentries )
+{
+	int	maxsize = numentries * ( CS_SIZE + 4 ) + 4;
+
+	SV_FreeSignonList( list );
+
+	list->numentries = numentries;
+	list->offsets = (int *)Mem_Alloc( host.mempool, ( numentries + 1 ) * sizeof( int ));
+	BF_Init( buf, "SignonList", Mem_Alloc( host.mempool, maxsize ), maxsize );
+}
+
+/*
+==================
+SV_EndSignonList
+
+keep only the written part of the scratch buffer
+==================
+*/
+static void SV_EndSignonList( sv_signonlist_t *list, sizebuf_t *buf )
+{
+	int	size = BF_GetNumBytesWritten( buf );
+
+	list->offsets[list->numentries] = BF_GetNumBitsWritten( buf );
+	list->data = (byte *)Mem_Alloc( host.mempool, size + 4 );
+	Q_memcpy( list->data, BF_GetData( buf ), size );
+	Mem_Free( BF_GetData( buf ));
+}
+
+/*
+==================
+SV_BuildPrecacheList
+==================
+*/
+static void SV_BuildPrecacheList( sv_signonlist_t *list, int svc, char (*names)[CS_SIZE], int numentries, int numbits )
+{
+	sizebuf_t	buf;
+	int	i;
+
+	SV_BeginSignonList( list, &buf, numentries );
+
+	for( i = 0; i < numentries; i++ )
+	{
+		list->offsets[i] = BF_GetNumBitsWritten( &buf );
+		if( !names[i][0] ) continue;
+
+		BF_WriteByte( &buf, svc );
+		BF_WriteUBitLong( &buf, i, numbits );
+		BF_WriteString( &buf, names[i] );
+	}
+
+	SV_EndSignonList( list, &buf );
+}
+
+/*
+==================
+SV_BuildResourceList
+==================
+*/
+static void SV_BuildResourceList( sv_signonlist_t *list )
+{
+	sizebuf_t	buf;
+	int	i;
+
+	SV_BeginSignonList( list, &buf, sv.reslist.rescount );
+
+	for( i = 0; i < sv.reslist.rescount; i++ )
+	{
+		list->offsets[i] = BF_GetNumBitsWritten( &buf );
+		BF_WriteWord( &buf, sv.reslist.restype[i] );
+		BF_WriteString( &buf, sv.reslist.resnames[i] );
+	}
+
+	SV_EndSignonList( list, &buf );
+}
+
+/*
+==================
+SV_GetSignonList
+==================
+*/
+static const sv_signonlist_t *SV_GetSignonList( int list )
+{
+	sv_signonlist_t	*out = &svs.signonlists[list];
+
+	switch( list )
+	{
+	case SIGNON_MODELS:
+		if( !out->data ) SV_BuildPrecacheList( out, svc_modelindex, sv.model_precache, MAX_MODELS, MAX_MODEL_BITS );
+		break;
+	case SIGNON_SOUNDS:
+		if( !out->data ) SV_BuildPrecacheList( out, svc_soundindex, sv.sound_precache, MAX_SOUNDS, MAX_SOUND_BITS );
+		break;
+	case SIGNON_EVENTS:
+		if( !out->data ) SV_BuildPrecacheList( out, svc_eventindex, sv.event_precache, MAX_EVENTS, MAX_EVENT_BITS );
+		break;
+	case SIGNON_RESOURCES:
+		// SV_UpdateResourceList serializes it again
+		if( !sv.resourcelistcache ) SV_UpdateResourceList();
+		else if( !out->data ) SV_BuildResourceList( out );
+		break;
+	}
+
+	return out;
+}
+
+/*
+==================
+SV_BuildSignonLists
+
+called once the level is loaded, so the first
+clients don't have to wait for it
+==================
+*/
+void SV_BuildSignonLists( void )
+{
+	int	i;
+
+	for( i = 0; i < SIGNON_LISTS; i++ )
+		SV_GetSignonList( i );
+}
+
+/*
+==================
+SV_WriteSignonList
+
+copy entries beginning from start while the message has room,
+returns the first entry that was not written
+==================
+*/
+static int SV_WriteSignonList( sizebuf_t *msg, int list, int start, int maxbytes )
+{
+	const sv_signonlist_t	*in = SV_GetSignonList( list );
+	const byte		*data;
+	int			end, numbits, skip, head;
+
+	start = bound( 0, start, in->numentries );
+
+	// same rule as writing them one by one: add entries until the message is full
+	for( end = start; end < in->numentries; end++ )
+	{
+		if((( BF_GetNumBitsWritten( msg ) + in->offsets[end] - in->offsets[start] + 7 ) >> 3 ) >= maxbytes )
+			break;
+	}
+
+	numbits = in->offsets[end] - in->offsets[start];
+	data = in->data + ( in->offsets[start] >> 3 );
+	skip = in->offsets[start] & 7;
+
+	// entries are bit packed, bring the source to a byte boundary first
+	if( skip && numbits > 0 )
+	{
+		head = min( 8 - skip, numbits );
+		BF_WriteUBitLong( msg, ( *data >> skip ) & (( 1 << head ) - 1 ), head );
+		numbits -= head;
+		data++;
+	}
+
+	if( numbits > 0 )
+		BF_WriteBits( msg, data, numbits );
+
+	return end;
+}
+
 /*
 ==================
 SV_ContinueLoading_f
@@ -1656,6 +1881,7 @@ void SV_UpdateResourceList( void )
 		SV_ParseResListFile( &sv.reslist, mapresfilename );
 
 		sv.resourcelistcache = true;
+		SV_BuildResourceList( &svs.signonlists[SIGNON_RESOURCES] );
 }
 
 /*
@@ -1685,8 +1911,7 @@ void SV_SendResourceList_f( sv_client_t *cl )
 	}
 
 	// generate new resource list, if it's not cached
-	if ( !sv.resourcelistcache )
-		SV_UpdateResourceList();
+	SV_GetSignonList( SIGNON_RESOURCES );
 
 	msg_size = BF_GetRealBytesWritten( &cl->netchan.message ); // start
 
@@ -1695,11 +1920,7 @@ void SV_SendResourceList_f( sv_client_t *cl )
 	msg_start = BF_GetNumBitsWritten( &cl->netchan.message );
 	BF_WriteWord( &cl->netchan.message, sv.reslist.rescount );
 
-	for( ; ( index < sv.reslist.rescount ) && ( BF_GetNumBytesWritten( &cl->netchan.message ) < cl->maxpayload ); index++ )
-	{
-		BF_WriteWord( &cl->netchan.message, sv.reslist.restype[index] );
-		BF_WriteString( &cl->netchan.message, sv.reslist.resnames[index] );
-	}
+	index = SV_WriteSignonList( &cl->netchan.message, SIGNON_RESOURCES, index, cl->maxpayload );
 
 	// change real sent resource count
 	msg_end = BF_GetNumBitsWritten( &cl->netchan.message );
@@ -1741,16 +1962,7 @@ void SV_WriteModels_f( sv_client_t *cl )
 	start = Q_atoi( Cmd_Argv( 2 ));
 
 	// write a packet full of data
-	while( BF_GetNumBytesWritten( &cl->netchan.message ) < ( cl->maxpayload ) && start < MAX_MODELS )
-	{
-		if( sv.model_precache[start][0] )
-		{
-			BF_WriteByte( &cl->netchan.message, svc_modelindex );
-			BF_WriteUBitLong( &cl->netchan.message, start, MAX_MODEL_BITS );
-			BF_WriteString( &cl->netchan.message, sv.model_precache[start] );
-		}
-		start++;
-	}
+	start = SV_WriteSignonList( &cl->netchan.message, SIGNON_MODELS, start, cl->maxpayload );
 
 	if( start == MAX_MODELS ) Q_snprintf( cmd, MAX_STRING, "cmd soundlist %i %i\n", svs.spawncount, 0 );
 	else Q_snprintf( cmd, MAX_STRING, "cmd modellist %i %i\n", svs.spawncount, start );
@@ -1787,16 +1999,7 @@ void SV_WriteSounds_f( sv_client_t *cl )
 	start = Q_atoi( Cmd_Argv( 2 ));
 
 	// write a packet full of data
-	while( BF_GetNumBytesWritten( &cl->netchan.message ) < ( cl->maxpayload ) && start < MAX_SOUNDS )
-	{
-		if( sv.sound_precache[start][0] )
-		{
-			BF_WriteByte( &cl->netchan.message, svc_soundindex );
-			BF_WriteUBitLong( &cl->netchan.message, start, MAX_SOUND_BITS );
-			BF_WriteString( &cl->netchan.message, sv.sound_precache[start] );
-		}
-		start++;
-	}
+	start = SV_WriteSignonList( &cl->netchan.message, SIGNON_SOUNDS, start, cl->maxpayload );
 
 	if( start == MAX_SOUNDS ) Q_snprintf( cmd, MAX_STRING, "cmd eventlist %i %i\n", svs.spawncount, 0 );
 	else Q_snprintf( cmd, MAX_STRING, "cmd soundlist %i %i\n", svs.spawncount, start );
@@ -1833,16 +2036,7 @@ void SV_WriteEvents_f( sv_client_t *cl )
 	start = Q_atoi( Cmd_Argv( 2 ));
 
 	// write a packet full of data
-	while( BF_GetNumBytesWritten( &cl->netchan.message ) < ( cl->maxpayload ) && start < MAX_EVENTS )
-	{
-		if( sv.event_precache[start][0] )
-		{
-			BF_WriteByte( &cl->netchan.message, svc_eventindex );
-			BF_WriteUBitLong( &cl->netchan.message, start, MAX_EVENT_BITS );
-			BF_WriteString( &cl->netchan.message, sv.event_precache[start] );
-		}
-		start++;
-	}
+	start = SV_WriteSignonList( &cl->netchan.message, SIGNON_EVENTS, start, cl->maxpayload );
 
 	if( start == MAX_EVENTS ) Q_snprintf( cmd, MAX_STRING, "cmd lightstyles %i %i\n", svs.spawncount, 0 );
 	else Q_snprintf( cmd, MAX_STRING, "cmd eventlist %i %i\n", svs.spawncount, start );
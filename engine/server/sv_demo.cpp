@@ -0,0 +1,641 @@
+/*
+sv_demo.cpp - server side demo recording
+Copyright (C) 2026 CSMoE
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "common.h"
+#include "server.h"
+#include "net_encode.h"
+
+#include <boost/asio.hpp>
+#include <bit>
+#include <memory>
+#include <vector>
+
+/*
+=============================================================================
+
+Server demo file layout (little-endian)
+
+	svdemoheader_t
+	precache tables: model, sound and event, each as
+		word count, then count * ( word index, string name )
+	frames, each as
+		long length (of the rest of the frame)
+		byte type (svd_frame or svd_keyframe)
+		float time, long frame number
+		word numentities, entity deltas, word 0
+		word numevents, events
+		word nummessages, messages
+	svdemokey_t index[numkeys]
+	svdemotrailer_t
+
+Keyframes are encoded against the baselines, every other frame against
+the previous one, so playback can start at any keyframe.
+=============================================================================
+*/
+#define SVDEMOHEADER	(('D'<<24)+('V'<<16)+('S'<<8)+'X') // little-endian "XSVD"
+#define SVDEMOINDEX		(('I'<<24)+('V'<<16)+('S'<<8)+'X') // little-endian "XSVI"
+#define SVDEMO_PROTOCOL	1
+
+#define SVD_MAX_FRAME	(1024 * 1024)	// entities of one frame
+#define SVD_MAX_QUEUE	(256 * 1024)	// events or messages between two frames
+
+enum
+{
+	svd_frame = 1,
+	svd_keyframe,
+};
+
+typedef struct
+{
+	int		id;		// should be XSVD
+	int		dem_protocol;	// should be SVDEMO_PROTOCOL
+	int		net_protocol;	// should be PROTOCOL_VERSION
+	char		mapname[64];
+	char		gamedir[64];
+	int		maxclients;
+	int		maxentities;
+	float		rate;		// frames per second
+	float		keyframe;		// seconds between keyframes
+} svdemoheader_t;
+
+typedef struct
+{
+	float		time;
+	int		frame;
+	int		offset;		// file offset of the frame length
+} svdemokey_t;
+
+typedef struct
+{
+	int		numkeys;
+	int		offset;		// file offset of the first svdemokey_t
+	int		id;		// should be XSVI
+} svdemotrailer_t;
+
+static struct
+{
+	file_t		*file;
+	string		name;
+	std::unique_ptr<boost::asio::thread_pool> writer;	// keeps FS_Write off the game thread
+	int		offset;		// bytes handed to the writer so far
+
+	int		maxentities;
+	std::vector<uint64_t>	seen;	// entities already taken from another client frame
+	std::vector<entity_state_t *>	bynum;
+	std::vector<entity_state_t>	states[2];	// this and the previously recorded frame
+	int		numstates[2];
+	int		current;
+
+	std::vector<byte>	framedata;
+	std::vector<byte>	eventdata;
+	std::vector<byte>	msgdata;
+	sizebuf_t		events;
+	sizebuf_t		messages;
+	int		numevents;
+	int		nummessages;
+
+	std::vector<svdemokey_t>	keys;
+	int		numframes;
+	double		nextframe;
+	double		nextkeyframe;
+
+	// recorder cost
+	double		starttime;
+	double		encodetime;
+	int		dropped;
+} svdemo;
+
+convar_t	*sv_demo_rate;
+convar_t	*sv_demo_keyframe;
+
+/*
+====================
+SV_DemoWrite
+
+queue data for the writer thread
+====================
+*/
+static void SV_DemoWrite( const void *data, size_t size )
+{
+	std::vector<byte>	buf( (const byte *)data, (const byte *)data + size );
+	file_t		*file = svdemo.file;
+
+	svdemo.offset += size;
+
+	boost::asio::post( *svdemo.writer, [file, buf = std::move( buf )]()
+	{
+		FS_Write( file, buf.data(), buf.size( ));
+	});
+}
+
+/*
+====================
+SV_DemoWritePrecache
+
+====================
+*/
+static void SV_DemoWritePrecache( sizebuf_t *msg, char (*precache)[CS_SIZE], int count )
+{
+	int	i, num = 0;
+
+	for( i = 0; i < count; i++ )
+		if( precache[i][0] ) num++;
+
+	BF_WriteWord( msg, num );
+
+	for( i = 0; i < count; i++ )
+	{
+		if( !precache[i][0] ) continue;
+		BF_WriteWord( msg, i );
+		BF_WriteString( msg, precache[i] );
+	}
+}
+
+/*
+====================
+SV_DemoGatherEntities
+
+merge the latest frame of every spawned client, players see
+everything worth replaying and these states are already built
+====================
+*/
+static int SV_DemoGatherEntities( entity_state_t *out )
+{
+	client_frame_t	*frame;
+	entity_state_t	*state;
+	sv_client_t	*cl;
+	int		i, j, num, count = 0;
+
+	std::fill( svdemo.seen.begin(), svdemo.seen.end(), 0 );
+
+	for( i = 0, cl = svs.clients; i < sv_maxclients->integer; i++, cl++ )
+	{
+		if( cl->state != cs_spawned || cl->fakeclient || !cl->frames )
+			continue;
+
+		frame = &cl->frames[(cl->netchan.outgoing_sequence - 1) & SV_UPDATE_MASK];
+
+		// rolled off the packet_entities buffer
+		if( frame->first_entity <= svs.next_client_entities - svs.num_client_entities )
+			continue;
+
+		for( j = 0; j < frame->num_entities && count < MAX_VISIBLE_PACKET; j++ )
+		{
+			state = &svs.packet_entities[(frame->first_entity + j) % svs.num_client_entities];
+			num = state->number;
+
+			if( num <= 0 || num >= svdemo.maxentities )
+				continue;
+
+			// the first client that sees an entity provides its state
+			if( svdemo.seen[num >> 6] & ( 1ULL << ( num & 63 )))
+				continue;
+
+			svdemo.seen[num >> 6] |= 1ULL << ( num & 63 );
+			svdemo.bynum[num] = state;
+			count++;
+		}
+	}
+
+	// copy out in entity order for delta compression
+	for( i = 0, j = 0; i < (int)svdemo.seen.size(); i++ )
+	{
+		uint64_t	bits = svdemo.seen[i];
+
+		while( bits )
+		{
+			num = ( i << 6 ) + std::countr_zero( bits );
+			bits &= bits - 1;
+			out[j++] = *svdemo.bynum[num];
+		}
+	}
+
+	return j;
+}
+
+/*
+====================
+SV_DemoWriteEntities
+
+same as SV_EmitPacketEntities, keyframes are written from the baselines
+====================
+*/
+static void SV_DemoWriteEntities( sizebuf_t *msg, qboolean keyframe )
+{
+	entity_state_t	*from, *to;
+	entity_state_t	*oldent, *newent;
+	int		oldindex, newindex;
+	int		oldnum, newnum;
+	int		from_count, to_count;
+
+	to = svdemo.states[svdemo.current].data();
+	to_count = svdemo.numstates[svdemo.current];
+	from = svdemo.states[svdemo.current ^ 1].data();
+	from_count = keyframe ? 0 : svdemo.numstates[svdemo.current ^ 1];
+
+	BF_WriteWord( msg, to_count );
+
+	oldindex = newindex = 0;
+
+	while( newindex < to_count || oldindex < from_count )
+	{
+		newent = ( newindex < to_count ) ? &to[newindex] : NULL;
+		newnum = newent ? newent->number : MAX_ENTNUMBER;
+		oldent = ( oldindex < from_count ) ? &from[oldindex] : NULL;
+		oldnum = oldent ? oldent->number : MAX_ENTNUMBER;
+
+		if( newnum == oldnum )
+		{
+			// delta update from the previous frame
+			MSG_WriteDeltaEntity( oldent, newent, msg, false, SV_IsPlayerIndex( newnum ), sv.time );
+			oldindex++;
+			newindex++;
+		}
+		else if( newnum < oldnum )
+		{
+			// new entity, send it from the baseline
+			MSG_WriteDeltaEntity( &svs.baselines[newnum], newent, msg, true, SV_IsPlayerIndex( newnum ), sv.time );
+			newindex++;
+		}
+		else
+		{
+			// removed, or nobody sees it any more
+			MSG_WriteDeltaEntity( oldent, NULL, msg, EDICT_NUM( oldnum )->free, false, sv.time );
+			oldindex++;
+		}
+	}
+
+	BF_WriteWord( msg, 0 ); // end of packetentities
+}
+
+/*
+====================
+SV_DemoFrame
+
+called after the client messages went out
+====================
+*/
+void SV_DemoFrame( void )
+{
+	qboolean	keyframe;
+	sizebuf_t	msg;
+	double	start;
+	int	length;
+
+	if( !svdemo.file || sv.state != ss_active )
+		return;
+
+	if( sv.time < svdemo.nextframe )
+		return;
+
+	start = Sys_DoubleTime();
+
+	svdemo.nextframe = sv.time + 1.0 / bound( 1.0f, sv_demo_rate->value, 1000.0f );
+	keyframe = ( !svdemo.numframes || sv.time >= svdemo.nextkeyframe );
+
+	svdemo.current ^= 1;
+	svdemo.numstates[svdemo.current] = SV_DemoGatherEntities( svdemo.states[svdemo.current].data( ));
+
+	BF_Init( &msg, "ServerDemo", svdemo.framedata.data(), svdemo.framedata.size( ));
+	BF_WriteLong( &msg, 0 ); // length, patched below
+	BF_WriteByte( &msg, keyframe ? svd_keyframe : svd_frame );
+	BF_WriteFloat( &msg, sv.time );
+	BF_WriteLong( &msg, svdemo.numframes );
+
+	SV_DemoWriteEntities( &msg, keyframe );
+
+	if( BF_CheckOverflow( &svdemo.events ) || BF_CheckOverflow( &svdemo.messages ))
+	{
+		svdemo.dropped += svdemo.numevents + svdemo.nummessages;
+		BF_Clear( &svdemo.events );
+		BF_Clear( &svdemo.messages );
+		svdemo.numevents = svdemo.nummessages = 0;
+	}
+
+	BF_WriteWord( &msg, svdemo.numevents );
+	BF_WriteBits( &msg, BF_GetData( &svdemo.events ), BF_GetNumBitsWritten( &svdemo.events ));
+	BF_WriteWord( &msg, svdemo.nummessages );
+	BF_WriteBits( &msg, BF_GetData( &svdemo.messages ), BF_GetNumBitsWritten( &svdemo.messages ));
+
+	BF_Clear( &svdemo.events );
+	BF_Clear( &svdemo.messages );
+	svdemo.numevents = svdemo.nummessages = 0;
+
+	if( BF_CheckOverflow( &msg ))
+	{
+		MsgDev( D_ERROR, "SV_DemoFrame: frame %i overflowed\n", svdemo.numframes );
+		svdemo.nextkeyframe = 0.0; // the next frame can't be a delta
+		svdemo.numstates[svdemo.current] = 0;
+		svdemo.dropped++;
+		return;
+	}
+
+	if( keyframe )
+	{
+		svdemokey_t	key;
+
+		key.time = sv.time;
+		key.frame = svdemo.numframes;
+		key.offset = svdemo.offset;
+		svdemo.keys.push_back( key );
+		svdemo.nextkeyframe = sv.time + max( sv_demo_keyframe->value, 0.1f );
+	}
+
+	length = BF_GetNumBytesWritten( &msg );
+	*(int *)svdemo.framedata.data() = LittleLong( length - 4 );
+	SV_DemoWrite( svdemo.framedata.data(), length );
+	svdemo.numframes++;
+
+	svdemo.encodetime += Sys_DoubleTime() - start;
+}
+
+/*
+====================
+SV_DemoRecordEvent
+
+====================
+*/
+void SV_DemoRecordEvent( int flags, word eventindex, float delay, event_args_t *args )
+{
+	event_args_t	nullargs;
+
+	if( !svdemo.file || sv.state != ss_active )
+		return;
+
+	Q_memset( &nullargs, 0, sizeof( nullargs ));
+
+	BF_WriteWord( &svdemo.events, eventindex );
+	BF_WriteByte( &svdemo.events, flags );
+	BF_WriteWord( &svdemo.events, (int)( delay * 100.0f ));
+	MSG_WriteDeltaEvent( &svdemo.events, &nullargs, args );
+	svdemo.numevents++;
+}
+
+/*
+====================
+SV_DemoRecordMessage
+
+copy sv.multicast with its destination
+====================
+*/
+void SV_DemoRecordMessage( int dest, const edict_t *ent )
+{
+	if( !svdemo.file || sv.state != ss_active )
+		return;
+
+	BF_WriteByte( &svdemo.messages, dest );
+	BF_WriteShort( &svdemo.messages, SV_IsValidEdict( ent ) ? NUM_FOR_EDICT( ent ) : 0 );
+	BF_WriteLong( &svdemo.messages, BF_GetNumBitsWritten( &sv.multicast ));
+	BF_WriteBits( &svdemo.messages, BF_GetData( &sv.multicast ), BF_GetNumBitsWritten( &sv.multicast ));
+	svdemo.nummessages++;
+}
+
+/*
+====================
+SV_StopServerDemo
+
+====================
+*/
+void SV_StopServerDemo( void )
+{
+	svdemotrailer_t	trailer;
+	double		elapsed;
+	int		i;
+
+	if( !svdemo.file )
+		return;
+
+	// let the writer drain before the index goes in
+	svdemo.writer->join();
+	svdemo.writer.reset();
+
+	trailer.numkeys = LittleLong( (int)svdemo.keys.size( ));
+	trailer.offset = LittleLong( svdemo.offset );
+	trailer.id = LittleLong( SVDEMOINDEX );
+
+	for( i = 0; i < (int)svdemo.keys.size(); i++ )
+	{
+		svdemokey_t	key = svdemo.keys[i];
+
+		key.time = LittleFloat( key.time );
+		key.frame = LittleLong( key.frame );
+		key.offset = LittleLong( key.offset );
+		FS_Write( svdemo.file, &key, sizeof( key ));
+	}
+	FS_Write( svdemo.file, &trailer, sizeof( trailer ));
+	FS_Close( svdemo.file );
+	svdemo.file = NULL;
+
+	elapsed = max( Sys_DoubleTime() - svdemo.starttime, 0.001 );
+
+	Msg( "Completed server demo %s: %i frames, %i keyframes, %s in %.1f sec\n", svdemo.name, svdemo.numframes,
+		(int)svdemo.keys.size(), Q_memprint( svdemo.offset ), elapsed );
+	Msg( "recorder: %.3f ms per frame, %.2f%% of server time, %i dropped\n", svdemo.encodetime * 1000.0 / max( svdemo.numframes, 1 ),
+		svdemo.encodetime * 100.0 / elapsed, svdemo.dropped );
+
+	svdemo.keys.clear();
+	svdemo.seen.clear();
+	svdemo.bynum.clear();
+	svdemo.states[0].clear();
+	svdemo.states[1].clear();
+	svdemo.framedata.clear();
+	svdemo.eventdata.clear();
+	svdemo.msgdata.clear();
+}
+
+/*
+====================
+SV_Record_f
+
+sv_record <demoname>
+====================
+*/
+static void SV_Record_f( void )
+{
+	svdemoheader_t	header;
+	sizebuf_t		msg;
+	string		name;
+	file_t		*f;
+
+	if( Cmd_Argc() != 2 )
+	{
+		Msg( "Usage: sv_record <demoname>\n" );
+		return;
+	}
+
+	if( svdemo.file )
+	{
+		Msg( "Already recording %s\n", svdemo.name );
+		return;
+	}
+
+	if( sv.state != ss_active )
+	{
+		Msg( "sv_record: server is not running\n" );
+		return;
+	}
+
+	Q_snprintf( name, sizeof( name ), "demos/%s", Cmd_Argv( 1 ));
+	FS_StripExtension( name );
+	FS_DefaultExtension( name, ".svd" );
+
+	if(( f = FS_Open( name, "wb", true )) == NULL )
+	{
+		MsgDev( D_ERROR, "sv_record: couldn't open %s\n", name );
+		return;
+	}
+
+	Q_strncpy( svdemo.name, name, sizeof( svdemo.name ));
+	svdemo.file = f;
+	svdemo.writer = std::make_unique<boost::asio::thread_pool>( 1 );
+	svdemo.offset = 0;
+
+	svdemo.maxentities = svgame.globals->maxEntities;
+	svdemo.seen.assign(( svdemo.maxentities + 63 ) >> 6, 0 );
+	svdemo.bynum.assign( svdemo.maxentities, NULL );
+	svdemo.states[0].resize( MAX_VISIBLE_PACKET );
+	svdemo.states[1].resize( MAX_VISIBLE_PACKET );
+	svdemo.numstates[0] = svdemo.numstates[1] = 0;
+	svdemo.framedata.resize( SVD_MAX_FRAME );
+	svdemo.eventdata.resize( SVD_MAX_QUEUE );
+	svdemo.msgdata.resize( SVD_MAX_QUEUE );
+	BF_Init( &svdemo.events, "DemoEvents", svdemo.eventdata.data(), svdemo.eventdata.size( ));
+	BF_Init( &svdemo.messages, "DemoMessages", svdemo.msgdata.data(), svdemo.msgdata.size( ));
+	svdemo.numevents = svdemo.nummessages = 0;
+
+	svdemo.keys.clear();
+	svdemo.numframes = 0;
+	svdemo.nextframe = svdemo.nextkeyframe = 0.0;
+	svdemo.starttime = Sys_DoubleTime();
+	svdemo.encodetime = 0.0;
+	svdemo.dropped = 0;
+
+	Q_memset( &header, 0, sizeof( header ));
+	header.id = LittleLong( SVDEMOHEADER );
+	header.dem_protocol = LittleLong( SVDEMO_PROTOCOL );
+	header.net_protocol = LittleLong( PROTOCOL_VERSION );
+	Q_strncpy( header.mapname, sv.name, sizeof( header.mapname ));
+	Q_strncpy( header.gamedir, FS_Gamedir(), sizeof( header.gamedir ));
+	header.maxclients = LittleLong( sv_maxclients->integer );
+	header.maxentities = LittleLong( svdemo.maxentities );
+	header.rate = LittleFloat( sv_demo_rate->value );
+	header.keyframe = LittleFloat( sv_demo_keyframe->value );
+	SV_DemoWrite( &header, sizeof( header ));
+
+	// indices in the frames are meaningless without the names
+	BF_Init( &msg, "DemoPrecache", svdemo.framedata.data(), svdemo.framedata.size( ));
+	SV_DemoWritePrecache( &msg, sv.model_precache, MAX_MODELS );
+	SV_DemoWritePrecache( &msg, sv.sound_precache, MAX_SOUNDS );
+	SV_DemoWritePrecache( &msg, sv.event_precache, MAX_EVENTS );
+	SV_DemoWrite( BF_GetData( &msg ), BF_GetNumBytesWritten( &msg ));
+
+	Msg( "recording server demo to %s\n", svdemo.name );
+}
+
+/*
+====================
+SV_StopRecord_f
+
+====================
+*/
+static void SV_StopRecord_f( void )
+{
+	if( !svdemo.file )
+	{
+		Msg( "Not recording a server demo\n" );
+		return;
+	}
+	SV_StopServerDemo();
+}
+
+/*
+====================
+SV_DemoInfo_f
+
+sv_demoinfo <demoname>, reads the keyframe index back
+====================
+*/
+static void SV_DemoInfo_f( void )
+{
+	svdemoheader_t	header;
+	svdemotrailer_t	trailer;
+	svdemokey_t	key;
+	string		name;
+	file_t		*f;
+	int		i;
+
+	if( Cmd_Argc() != 2 )
+	{
+		Msg( "Usage: sv_demoinfo <demoname>\n" );
+		return;
+	}
+
+	Q_snprintf( name, sizeof( name ), "demos/%s", Cmd_Argv( 1 ));
+	FS_DefaultExtension( name, ".svd" );
+
+	if(( f = FS_Open( name, "rb", true )) == NULL )
+	{
+		Msg( "sv_demoinfo: couldn't open %s\n", name );
+		return;
+	}
+
+	FS_Read( f, &header, sizeof( header ));
+	FS_Seek( f, -(int)sizeof( trailer ), SEEK_END );
+	FS_Read( f, &trailer, sizeof( trailer ));
+
+	if( LittleLong( header.id ) != SVDEMOHEADER || LittleLong( header.dem_protocol ) != SVDEMO_PROTOCOL )
+	{
+		Msg( "sv_demoinfo: %s is not a server demo\n", name );
+		FS_Close( f );
+		return;
+	}
+
+	if( LittleLong( trailer.id ) != SVDEMOINDEX )
+	{
+		Msg( "sv_demoinfo: %s has no index, recording was interrupted\n", name );
+		FS_Close( f );
+		return;
+	}
+
+	Msg( "%s: map %s, game %s, %i clients, %.0f fps, keyframe every %.1f sec\n", name, header.mapname, header.gamedir,
+		LittleLong( header.maxclients ), LittleFloat( header.rate ), LittleFloat( header.keyframe ));
+
+	FS_Seek( f, LittleLong( trailer.offset ), SEEK_SET );
+
+	for( i = 0; i < LittleLong( trailer.numkeys ); i++ )
+	{
+		if( FS_Read( f, &key, sizeof( key )) != sizeof( key ))
+			break;
+		Msg( "  keyframe %3i: time %8.2f, frame %6i, offset %i\n", i, LittleFloat( key.time ), LittleLong( key.frame ), LittleLong( key.offset ));
+	}
+
+	FS_Close( f );
+}
+
+/*
+====================
+SV_InitDemoRecorder
+
+====================
+*/
+void SV_InitDemoRecorder( void )
+{
+	sv_demo_rate = Cvar_Get( "sv_demo_rate", "30", CVAR_ARCHIVE, "server demo frames per second" );
+	sv_demo_keyframe = Cvar_Get( "sv_demo_keyframe", "10", CVAR_ARCHIVE, "seconds between server demo keyframes" );
+
+	Cmd_AddCommand( "sv_record", SV_Record_f, "record a server side demo of the whole match" );
+	Cmd_AddCommand( "sv_stoprecord", SV_StopRecord_f, "stop recording a server side demo" );
+	Cmd_AddCommand( "sv_demoinfo", SV_DemoInfo_f, "print header and keyframe index of a server demo" );
+}
@@ -735,7 +735,9 @@ SV_SendClientMessages
 void SV_SendClientMessages( void )
 {
 	sv_client_t	*cl;
-	int		i;
+	int		i, j, fragsize;
+	int		fragbytes = 0;
+	qboolean		deferred = false;
 
 	svs.currentPlayer = NULL;
 	svs.currentPlayerNum = 0;
@@ -745,9 +747,13 @@ void SV_SendClientMessages( void )
 
 	SV_UpdateToReliableMessages ();
 
-	// send a message to each connected client
-	for( i = 0, cl = svs.clients; i < sv_maxclients->integer; i++, cl++ )
+	// send a message to each connected client, starting from the one
+	// that ran out of fragment budget last frame
+	for( j = 0; j < sv_maxclients->integer; j++ )
 	{
+		i = ( svs.fragstart + j ) % sv_maxclients->integer;
+		cl = svs.clients + i;
+
 		if( !cl->state || cl->fakeclient )
 			continue;
 
@@ -807,6 +813,18 @@ void SV_SendClientMessages( void )
 			continue;
 		}
 
+		// spread downloads and signon fragments of joining clients over frames
+		if( cl->state != cs_spawned && sv_fragment_budget->integer > 0 && ( fragsize = Netchan_NextFragmentSize( &cl->netchan )) > 0 )
+		{
+			if( fragbytes >= sv_fragment_budget->integer )
+			{
+				if( !deferred ) svs.fragstart = i;
+				deferred = true;
+				continue;
+			}
+			fragbytes += fragsize;
+		}
+
 		cl->send_message = false;
 
 		// Now that we were able to send, reset timer to point to next possible send time.
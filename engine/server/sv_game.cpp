@@ -213,6 +213,178 @@ void SV_ConvertTrace( TraceResult *dst, trace_t *src )
 	svgame.globals->trace_flags = 0;
 }
 
+/*
+=============================================================================
+
+MULTICAST
+
+A frame full of effects sends hundreds of PAS messages, mostly from a
+few origins. The visibility row of the last origin is kept for PVS and
+PHS each, and the leaf of every client viewpoint is kept until it moves,
+so neither the BSP walk nor the decompression repeats per message.
+
+=============================================================================
+*/
+typedef struct
+{
+	int	spawncount;
+	vec3_t	origin;
+	mleaf_t	*leaf;
+	dword	bits[(MAX_MAP_LEAFS+31)/32];
+} sv_multicastmask_t;
+
+typedef struct
+{
+	int	spawncount;
+	vec3_t	origin;
+	int	leafnum;
+} sv_viewleaf_t;
+
+static sv_multicastmask_t	sv_multicastmasks[2];	// PVS, PHS
+static sv_viewleaf_t	sv_viewleafs[MAX_CLIENTS];
+
+static struct sv_multicaststats_s
+{
+	int	messages;		// SV_Send calls
+	int	sends;		// copies to a client buffer
+	int	maskhits;		// origin row served from the cache
+	int	maskmisses;
+	int	leafhits;		// client viewpoint leaf served from the cache
+	int	leafmisses;
+	size_t	alignedbytes;	// copied by BF_WriteBits byte-aligned path
+	size_t	unalignedbytes;	// bit-packed into the destination
+	uint	startframe;	// host.framecount of the last reset
+} mcstats;
+
+static void SV_ResetMulticastStats( void )
+{
+	Q_memset( &mcstats, 0, sizeof( mcstats ));
+	mcstats.startframe = host.framecount;
+}
+
+/*
+=============
+SV_ViewLeafnum
+
+leaf of a client viewpoint, recomputed only when it moves
+=============
+*/
+static int SV_ViewLeafnum( int clientnum, const vec3_t viewOrg )
+{
+	sv_viewleaf_t	*view = &sv_viewleafs[clientnum];
+
+	if( view->spawncount == svs.spawncount && VectorCompare( view->origin, viewOrg ))
+	{
+		mcstats.leafhits++;
+		return view->leafnum;
+	}
+
+	view->spawncount = svs.spawncount;
+	VectorCopy( viewOrg, view->origin );
+	view->leafnum = Mod_PointLeafnum( viewOrg );
+	mcstats.leafmisses++;
+
+	return view->leafnum;
+}
+
+/*
+=============
+SV_MulticastMask
+
+visibility row for a multicast origin
+=============
+*/
+static const byte *SV_MulticastMask( const vec3_t origin, qboolean phs )
+{
+	sv_multicastmask_t	*cache = &sv_multicastmasks[phs ? 1 : 0];
+	mleaf_t		*leaf;
+	byte		*row;
+
+	if( cache->spawncount == svs.spawncount && VectorCompare( cache->origin, origin ))
+	{
+		mcstats.maskhits++;
+		return (byte *)cache->bits;
+	}
+
+	leaf = Mod_PointInLeaf( origin, sv.worldmodel->nodes );
+	VectorCopy( origin, cache->origin );
+
+	if( cache->spawncount == svs.spawncount && cache->leaf == leaf )
+	{
+		// another origin in the same leaf
+		mcstats.maskhits++;
+		return (byte *)cache->bits;
+	}
+
+	// Mod_DecompressVis shares one buffer, keep a private copy
+	row = phs ? Mod_LeafPHS( leaf, sv.worldmodel ) : Mod_LeafPVS( leaf, sv.worldmodel );
+	if( !row ) return NULL;
+
+	Q_memcpy( cache->bits, row, ( sv.worldmodel->numleafs + 7 ) >> 3 );
+	cache->spawncount = svs.spawncount;
+	cache->leaf = leaf;
+	mcstats.maskmisses++;
+
+	return (byte *)cache->bits;
+}
+
+/*
+=============
+SV_WriteMulticast
+
+append sv.multicast to a client or signon buffer
+=============
+*/
+static void SV_WriteMulticast( sizebuf_t *dst, sizebuf_t *src )
+{
+	int	nBits = BF_GetNumBitsWritten( src );
+
+	if( BF_GetNumBitsWritten( dst ) & 7 )
+		mcstats.unalignedbytes += nBits >> 3;
+	else mcstats.alignedbytes += nBits >> 3;
+
+	BF_WriteBits( dst, BF_GetData( src ), nBits );
+}
+
+/*
+=============
+SV_MulticastStats_f
+
+show multicast fan-out statistics
+=============
+*/
+void SV_MulticastStats_f( void )
+{
+	uint	frames;
+	size_t	total;
+
+	if( sv.state != ss_active )
+	{
+		Msg( "^3No server running.\n" );
+		return;
+	}
+
+	if( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ))
+	{
+		SV_ResetMulticastStats();
+		return;
+	}
+
+	frames = max( host.framecount - mcstats.startframe, 1 );
+	total = mcstats.alignedbytes + mcstats.unalignedbytes;
+
+	Msg( "====================\n" );
+	Msg( "multicast statistics over %u frames\n", frames );
+	Msg( "====================\n" );
+	Msg( "messages: %i (%.1f/frame), client copies: %i (%.1f/frame)\n", mcstats.messages,
+		(float)mcstats.messages / frames, mcstats.sends, (float)mcstats.sends / frames );
+	Msg( "bytes copied: %s (%.1f/frame)\n", Q_memprint( total ), (float)total / frames );
+	Msg( "  byte-aligned: %s (%.1f%%), bit-packed: %s\n", Q_memprint( mcstats.alignedbytes ),
+		total ? mcstats.alignedbytes * 100.0f / total : 0.0f, Q_memprint( mcstats.unalignedbytes ));
+	Msg( "origin rows: %i cached, %i decompressed\n", mcstats.maskhits, mcstats.maskmisses );
+	Msg( "viewpoint leafs: %i cached, %i traced\n", mcstats.leafhits, mcstats.leafmisses );
+}
+
 /*
 =============
 SV_CheckClientVisiblity
@@ -235,7 +407,7 @@ qboolean SV_CheckClientVisiblity( sv_client_t *cl, const byte *mask )
 		VectorCopy(cl->pViewEntity->v.origin, viewOrg);
 
 	// -1 is because pvs rows are 1 based, not 0 based like leafs
-	leafnum = Mod_PointLeafnum( viewOrg ) - 1;
+	leafnum = SV_ViewLeafnum( clientnum, viewOrg ) - 1;
 	if( leafnum == -1 || (mask[leafnum>>3] & (1U << ( leafnum & 7 ))))
 		return true; // visible from player view or camera view
 
@@ -274,13 +446,14 @@ if excludeSource is true, ent can't be NULL, dest should not be MSG_ONE
 */
 qboolean SV_Send( int dest, const vec3_t origin, const edict_t *ent, qboolean excludeSource )
 {
-	byte		*mask = NULL;
+	const byte	*mask = NULL;
 	int		j, numclients = sv_maxclients->integer;
 	sv_client_t	*cl, *current = svs.clients;
 	qboolean		reliable = false;
 	qboolean		specproxy = false;
 	int		numsends = 0;
-	mleaf_t		*leaf;
+
+	SV_DemoRecordMessage( dest, ent );
 
 	switch( dest )
 	{
@@ -288,7 +461,7 @@ qboolean SV_Send( int dest, const vec3_t origin, const edict_t *ent, qboolean ex
 		if( sv.state == ss_loading )
 		{
 			// copy to signon buffer
-			BF_WriteBits( &sv.signon, BF_GetData( &sv.multicast ), BF_GetNumBitsWritten( &sv.multicast ));
+			SV_WriteMulticast( &sv.signon, &sv.multicast );
 			BF_Clear( &sv.multicast );
 			return true;
 		}
@@ -303,15 +476,13 @@ qboolean SV_Send( int dest, const vec3_t origin, const edict_t *ent, qboolean ex
 		reliable = true;
 		// intentional fallthrough
 	case MSG_PAS:
-		leaf = Mod_PointInLeaf( origin, sv.worldmodel->nodes );
-		mask = Mod_LeafPHS( leaf, sv.worldmodel );
+		mask = SV_MulticastMask( origin, true );
 		break;
 	case MSG_PVS_R:
 		reliable = true;
 		// intentional fallthrough
 	case MSG_PVS:
-		leaf = Mod_PointInLeaf( origin, sv.worldmodel->nodes );
-		mask = Mod_LeafPVS( leaf, sv.worldmodel );
+		mask = SV_MulticastMask( origin, false );
 		break;
 	case MSG_ONE:
 		reliable = true;
@@ -345,6 +516,8 @@ qboolean SV_Send( int dest, const vec3_t origin, const edict_t *ent, qboolean ex
 		return false;
 	}
 
+	mcstats.messages++;
+
 	// send the data to all relevent clients (or once only)
 	for( j = 0, cl = current; j < numclients; j++, cl++ )
 	{
@@ -382,9 +555,10 @@ qboolean SV_Send( int dest, const vec3_t origin, const edict_t *ent, qboolean ex
 		if( !SV_CheckClientVisiblity( cl, mask ))
 			continue;
 
-		if( specproxy ) BF_WriteBits( &sv.spectator_datagram, BF_GetData( &sv.multicast ), BF_GetNumBitsWritten( &sv.multicast ));
-		else if( reliable ) BF_WriteBits( &cl->netchan.message, BF_GetData( &sv.multicast ), BF_GetNumBitsWritten( &sv.multicast ));
-		else BF_WriteBits( &cl->datagram, BF_GetData( &sv.multicast ), BF_GetNumBitsWritten( &sv.multicast ));
+		if( specproxy ) SV_WriteMulticast( &sv.spectator_datagram, &sv.multicast );
+		else if( reliable ) SV_WriteMulticast( &cl->netchan.message, &sv.multicast );
+		else SV_WriteMulticast( &cl->datagram, &sv.multicast );
+		mcstats.sends++;
 		numsends++;
 	}
 
@@ -835,6 +1009,162 @@ int SV_MapIsValid( const char *filename, const char *spawn_entity, const char *l
 	return flags;
 }
 
+/*
+=======================================================================
+
+		ENTITY PRIVATE DATA POOLS
+
+Every entity class allocates private data of the same size, so it's
+carved from slabs of equally sized, cache line aligned slots and
+recycled through a free list instead of hitting the zone allocator
+on each spawn. Slabs live in svgame.mempool until the game dll is
+unloaded, so memory stays flat across map changes.
+=======================================================================
+*/
+#define PRIVPOOL_SLOT_ALIGN	64	// one cache line
+#define PRIVPOOL_MAX_SLOT	16384	// bigger private data goes to the zone
+#define PRIVPOOL_SLAB_SIZE	65536
+#define PRIVPOOL_MIN_SLOTS	8	// per slab
+#define PRIVPOOL_NUM_SIZES	( PRIVPOOL_MAX_SLOT / PRIVPOOL_SLOT_ALIGN )
+
+typedef struct privslot_s
+{
+	struct privslot_s	*next;
+} privslot_t;
+
+typedef struct
+{
+	privslot_t	*freelist;
+	int		live;
+	int		peak;
+	int		slabs;
+	int		allocs;		// total allocations served
+} privpool_t;
+
+static privpool_t	sv_privpools[PRIVPOOL_NUM_SIZES + 1];	// [0] is zone memory
+static int		sv_privzonealloc;
+
+static void SV_ClearPrivatePools( void )
+{
+	Q_memset( sv_privpools, 0, sizeof( sv_privpools ));
+	sv_privzonealloc = 0;
+}
+
+static void *SV_AllocPrivateMemory( edict_t *pEdict, long cb )
+{
+	int		i, size, slots, sizeclass;
+	privpool_t	*pool;
+	privslot_t	*slot;
+	byte		*slab;
+
+	sizeclass = ( cb + PRIVPOOL_SLOT_ALIGN - 1 ) / PRIVPOOL_SLOT_ALIGN;
+
+	if( sizeclass > PRIVPOOL_NUM_SIZES || !svgame.privDataPool )
+	{
+		// a poke646 have memory corrupt in somewhere - this is trashed last four bytes :(
+		sv_privzonealloc++;
+		if( svgame.privDataPool ) svgame.privDataPool[NUM_FOR_EDICT( pEdict )] = 0;
+		return Mem_AlignedAlloc( svgame.mempool, (cb + 15) & ~15, 16 );
+	}
+
+	pool = &sv_privpools[sizeclass];
+	size = sizeclass * PRIVPOOL_SLOT_ALIGN;
+
+	if( !pool->freelist )
+	{
+		slots = max( PRIVPOOL_SLAB_SIZE / size, PRIVPOOL_MIN_SLOTS );
+		slab = (byte *)Mem_AlignedAlloc( svgame.mempool, size * slots, PRIVPOOL_SLOT_ALIGN );
+
+		for( i = slots - 1; i >= 0; i-- )
+		{
+			slot = (privslot_t *)( slab + i * size );
+			slot->next = pool->freelist;
+			pool->freelist = slot;
+		}
+
+		pool->slabs++;
+	}
+
+	slot = pool->freelist;
+	pool->freelist = slot->next;
+	pool->allocs++;
+	pool->live++;
+	pool->peak = max( pool->peak, pool->live );
+
+	svgame.privDataPool[NUM_FOR_EDICT( pEdict )] = sizeclass;
+
+	// game dlls expect zeroed private data
+	Q_memset( slot, 0, size );
+
+	return slot;
+}
+
+/*
+=============
+SV_ReleasePrivateData
+
+return private memory to its pool without notifying the game dll
+=============
+*/
+void SV_ReleasePrivateData( edict_t *pEdict )
+{
+	privslot_t	*slot;
+	privpool_t	*pool;
+	int		sizeclass;
+
+	if( !pEdict || !pEdict->pvPrivateData )
+		return;
+
+	sizeclass = svgame.privDataPool ? svgame.privDataPool[NUM_FOR_EDICT( pEdict )] : 0;
+
+	if( sizeclass )
+	{
+		pool = &sv_privpools[sizeclass];
+		slot = (privslot_t *)pEdict->pvPrivateData;
+		slot->next = pool->freelist;
+		pool->freelist = slot;
+		pool->live--;
+		svgame.privDataPool[NUM_FOR_EDICT( pEdict )] = 0;
+	}
+	else
+	{
+		Mem_Free( pEdict->pvPrivateData );
+	}
+
+	pEdict->pvPrivateData = NULL;
+}
+
+void SV_PrivateDataStats_f( void )
+{
+	int	i, live = 0, peak = 0, slabs = 0, allocs = 0;
+	size_t	reserved = 0;
+
+	Msg( "====================\n" );
+	Msg( "entity private data pools\n" );
+	Msg( "====================\n" );
+	Msg( " size  live  peak slabs    allocs\n" );
+
+	for( i = 1; i <= PRIVPOOL_NUM_SIZES; i++ )
+	{
+		privpool_t	*pool = &sv_privpools[i];
+		int		size = i * PRIVPOOL_SLOT_ALIGN;
+
+		if( !pool->slabs )
+			continue;
+
+		Msg( "%5i %5i %5i %5i %9i\n", size, pool->live, pool->peak, pool->slabs, pool->allocs );
+
+		live += pool->live;
+		peak += pool->peak;
+		slabs += pool->slabs;
+		allocs += pool->allocs;
+		reserved += (size_t)pool->slabs * size * max( PRIVPOOL_SLAB_SIZE / size, PRIVPOOL_MIN_SLOTS );
+	}
+
+	Msg( "%i live, %i peak, %i allocations from %i slabs (%s reserved)\n", live, peak, allocs, slabs, Q_memprint( reserved ));
+	Msg( "%i allocations too large for a pool\n", sv_privzonealloc );
+}
+
 void SV_FreePrivateData( edict_t *pEdict )
 {
 	if( !pEdict || !pEdict->pvPrivateData )
@@ -844,9 +1174,164 @@ void SV_FreePrivateData( edict_t *pEdict )
 	if( svgame.dllFuncs2.pfnOnFreeEntPrivateData != NULL )
 		svgame.dllFuncs2.pfnOnFreeEntPrivateData( pEdict );
 
-    Mem_Free( pEdict->pvPrivateData );
+	SV_ReleasePrivateData( pEdict );
+}
+
+#define SPAWNFUNC_CACHE_BITS	10
+#define SPAWNFUNC_CACHE_SIZE	(1 << SPAWNFUNC_CACHE_BITS)
 
-	pEdict->pvPrivateData = NULL;
+typedef struct
+{
+	string_t		classname;
+	char		name[64];		// string_t offsets are reused when the pool wraps
+	LINK_ENTITY_FUNC	func;		// NULL if the dll doesn't export it
+	qboolean		valid;
+} sv_spawnfunc_t;
+
+static sv_spawnfunc_t	sv_spawnfuncs[SPAWNFUNC_CACHE_SIZE];
+static int		sv_spawnfunc_hits;
+static int		sv_spawnfunc_misses;
+static qboolean		sv_spawnfunc_nocache;	// sv_spawnbench baseline
+
+static struct sv_edictstats_s
+{
+	int	allocs;		// total allocations
+	int	reused;		// served from the free queue
+	int	appended;		// grew svgame.numEntities
+	int	stale;		// queue entries dropped as reallocated or trimmed
+	double	latency;		// sum of reuse delays
+	double	maxlatency;
+	int	highwater;	// highest svgame.numEntities
+	double	starttime;	// host.realtime of the last reset
+	double	secondstart;
+	int	secondallocs;
+	int	lastsecond;	// allocations during the last full second
+} edictstats;
+
+static void SV_ResetEdictStats( void )
+{
+	Q_memset( &edictstats, 0, sizeof( edictstats ));
+	edictstats.highwater = svgame.numEntities;
+	edictstats.starttime = edictstats.secondstart = host.realtime;
+}
+
+/*
+=============
+SV_ClearFreeEdicts
+
+forget all released edicts,
+must be called whenever svgame.numEntities is reset
+=============
+*/
+void SV_ClearFreeEdicts( void )
+{
+	svgame.freeEdictHead = 0;
+	svgame.numFreeEdicts = 0;
+
+	SV_ResetEdictStats();
+}
+
+/*
+=============
+SV_IsQueuedEdict
+
+queue entry still describes a free edict below numEntities
+=============
+*/
+static qboolean SV_IsQueuedEdict( const sv_freeedict_t *queued )
+{
+	edict_t	*pEdict;
+
+	if( queued->num >= svgame.numEntities )
+		return false; // trimmed, will be reused by growing numEntities
+
+	pEdict = EDICT_NUM( queued->num );
+
+	// reallocated (and maybe freed again) since it was queued
+	return pEdict->free && pEdict->serialnumber == queued->serialnumber;
+}
+
+static void SV_CompactFreeEdicts( void )
+{
+	int	i, count, max;
+
+	max = svgame.globals->maxEntities;
+
+	for( i = count = 0; i < svgame.numFreeEdicts; i++ )
+	{
+		sv_freeedict_t	*queued = &svgame.freeEdicts[(svgame.freeEdictHead + i) % max];
+
+		if( SV_IsQueuedEdict( queued ))
+			svgame.freeEdicts[(svgame.freeEdictHead + count++) % max] = *queued;
+	}
+
+	edictstats.stale += svgame.numFreeEdicts - count;
+	svgame.numFreeEdicts = count;
+}
+
+static void SV_QueueFreeEdict( edict_t *pEdict )
+{
+	sv_freeedict_t	*queued;
+	int		num, max;
+
+	num = NUM_FOR_EDICT( pEdict );
+	max = svgame.globals->maxEntities;
+
+	// world and clients are never handed out by SV_AllocEdict
+	if( !svgame.freeEdicts || num <= svgame.globals->maxClients )
+		return;
+
+	// every free edict has exactly one live entry, so this always makes room
+	if( svgame.numFreeEdicts == max )
+		SV_CompactFreeEdicts();
+
+	queued = &svgame.freeEdicts[(svgame.freeEdictHead + svgame.numFreeEdicts) % max];
+	queued->num = num;
+	queued->serialnumber = pEdict->serialnumber;
+	svgame.numFreeEdicts++;
+}
+
+static void SV_EdictAllocated( void )
+{
+	edictstats.allocs++;
+
+	if( host.realtime - edictstats.secondstart >= 1.0 )
+	{
+		edictstats.lastsecond = edictstats.secondallocs;
+		edictstats.secondallocs = 0;
+		edictstats.secondstart = host.realtime;
+	}
+
+	edictstats.secondallocs++;
+}
+
+void SV_EdictStats_f( void )
+{
+	double	elapsed;
+
+	if( sv.state != ss_active )
+	{
+		Msg( "^3No server running.\n" );
+		return;
+	}
+
+	if( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ))
+	{
+		SV_ResetEdictStats();
+		return;
+	}
+
+	elapsed = max( host.realtime - edictstats.starttime, 0.001 );
+
+	Msg( "====================\n" );
+	Msg( "edict allocator statistics\n" );
+	Msg( "====================\n" );
+	Msg( "allocations: %i (%.1f/sec, %i last second)\n", edictstats.allocs, edictstats.allocs / elapsed,
+		( host.realtime - edictstats.secondstart < 2.0 ) ? edictstats.lastsecond : 0 );
+	Msg( "reused: %i, appended: %i\n", edictstats.reused, edictstats.appended );
+	Msg( "reuse latency: avg %.3f sec, max %.3f sec\n", edictstats.reused ? edictstats.latency / edictstats.reused : 0.0, edictstats.maxlatency );
+	Msg( "free queue: %i entries, %i stale dropped\n", svgame.numFreeEdicts, edictstats.stale );
+	Msg( "high-water mark: %i of %i edicts (%i in use now)\n", edictstats.highwater, svgame.globals->maxEntities, svgame.numEntities );
 }
 
 void SV_InitEdict( edict_t *pEdict )
@@ -909,35 +1394,109 @@ void SV_FreeEdict( edict_t *pEdict )
 	VectorClear(pEdict->v.angles);
 	VectorClear(pEdict->v.origin);
 	pEdict->free = true;
+
+	SV_QueueFreeEdict( pEdict );
 }
 
 edict_t *GAME_EXPORT SV_AllocEdict( void )
 {
-	edict_t	*pEdict;
-	int	i;
+	sv_freeedict_t	*queued;
+	edict_t		*pEdict;
+	int		i;
 
-	for( i = svgame.globals->maxClients + 1; i < svgame.numEntities; i++ )
+	// released edicts are queued in the order they were freed,
+	// so only the head has to be checked against the reuse delay
+	while( svgame.numFreeEdicts > 0 )
 	{
-		pEdict = EDICT_NUM( i );
-		// the first couple seconds of server time can involve a lot of
-		// freeing and allocating, so relax the replacement policy
-		if( pEdict->free && ( pEdict->freetime < 2.0f || ( sv.time - pEdict->freetime ) > 0.5f ))
+		queued = &svgame.freeEdicts[svgame.freeEdictHead];
+
+		if( SV_IsQueuedEdict( queued ))
+		{
+			pEdict = EDICT_NUM( queued->num );
+
+			// the first couple seconds of server time can involve a lot of
+			// freeing and allocating, so relax the replacement policy
+			if( pEdict->freetime >= 2.0f && ( sv.time - pEdict->freetime ) <= 0.5f )
+				break;
+
+			edictstats.reused++;
+			edictstats.latency += sv.time - pEdict->freetime;
+			edictstats.maxlatency = max( edictstats.maxlatency, sv.time - pEdict->freetime );
+		}
+		else
 		{
+			pEdict = NULL;
+			edictstats.stale++;
+		}
+
+		svgame.freeEdictHead = ( svgame.freeEdictHead + 1 ) % svgame.globals->maxEntities;
+		svgame.numFreeEdicts--;
+
+		if( pEdict )
+		{
+			SV_EdictAllocated();
 			SV_InitEdict( pEdict );
 			return pEdict;
 		}
 	}
 
+	i = svgame.numEntities;
+
 	if( i >= svgame.globals->maxEntities )
 		Sys_Error( "ED_AllocEdict: no free edicts\n" );
 
 	svgame.numEntities++;
+	edictstats.appended++;
+	edictstats.highwater = max( edictstats.highwater, svgame.numEntities );
+	SV_EdictAllocated();
+
 	pEdict = EDICT_NUM( i );
 	SV_InitEdict( pEdict );
 
 	return pEdict;
 }
 
+/*
+=============
+SV_GetSpawnFunc
+
+resolving a classname through the dll export table
+is a string search, remember the result per string_t.
+the name is checked on a hit too, a wrapped or game
+managed string pool can reuse the offset for another class
+=============
+*/
+static LINK_ENTITY_FUNC SV_GetSpawnFunc( string_t className, const char *pszClassName )
+{
+	sv_spawnfunc_t	*cached;
+	uint		slot;
+
+	if( sv_spawnfunc_nocache || Q_strlen( pszClassName ) >= sizeof( cached->name ))
+		return (LINK_ENTITY_FUNC)Com_GetProcAddress( svgame.hInstance, pszClassName );
+
+	slot = ((uint)className * 2654435761U) >> ( 32 - SPAWNFUNC_CACHE_BITS );
+	cached = &sv_spawnfuncs[slot];
+
+	if( cached->valid && cached->classname == className && !Q_strcmp( cached->name, pszClassName ))
+	{
+		sv_spawnfunc_hits++;
+		return cached->func;
+	}
+
+	sv_spawnfunc_misses++;
+	cached->classname = className;
+	Q_strncpy( cached->name, pszClassName, sizeof( cached->name ));
+	cached->func = (LINK_ENTITY_FUNC)Com_GetProcAddress( svgame.hInstance, pszClassName );
+	cached->valid = true;
+
+	return cached->func;
+}
+
+static void SV_ClearSpawnFuncCache( void )
+{
+	Q_memset( sv_spawnfuncs, 0, sizeof( sv_spawnfuncs ));
+}
+
 edict_t* SV_AllocPrivateData( edict_t *ent, string_t className )
 {
 	const char	*pszClassName = NULL;
@@ -961,7 +1520,7 @@ edict_t* SV_AllocPrivateData( edict_t *ent, string_t className )
 	
 	// allocate edict private memory (passed by dlls)
 	if( pszClassName )
-		SpawnEdict = (LINK_ENTITY_FUNC)Com_GetProcAddress( svgame.hInstance, pszClassName );
+		SpawnEdict = SV_GetSpawnFunc( className, pszClassName );
 
 	if( !SpawnEdict )
 	{
@@ -981,6 +1540,92 @@ edict_t* SV_AllocPrivateData( edict_t *ent, string_t className )
 	return ent;
 }
 
+/*
+=============
+SV_SpawnBench_f
+
+create and remove entities of the classes
+used by the current map, with and without
+the spawn function cache
+=============
+*/
+void SV_SpawnBench_f( void )
+{
+	string_t	classnames[64];
+	edict_t	**spawned, *ent;
+	int	i, j, n, pass, count, batch, numclasses;
+	double	start, elapsed[2];
+	int	hits, misses;
+
+	if( sv.state != ss_active )
+	{
+		Msg( "^3No server running.\n" );
+		return;
+	}
+
+	count = ( Cmd_Argc() > 1 ) ? max( Q_atoi( Cmd_Argv( 1 )), 1 ) : 100000;
+
+	for( i = svgame.globals->maxClients + 1, numclasses = 0; i < svgame.numEntities && numclasses < 64; i++ )
+	{
+		ent = EDICT_NUM( i );
+		if( !SV_IsValidEdict( ent ) || !ent->v.classname )
+			continue;
+
+		for( j = 0; j < numclasses && Q_strcmp( STRING( classnames[j] ), STRING( ent->v.classname )); j++ );
+		if( j == numclasses ) classnames[numclasses++] = ent->v.classname;
+	}
+
+	if( !numclasses )
+	{
+		Msg( "sv_spawnbench: no entities on this map\n" );
+		return;
+	}
+
+	// leave some room for the game itself
+	batch = min( svgame.globals->maxEntities - svgame.numEntities - 64, 1024 );
+
+	if( batch <= 0 )
+	{
+		Msg( "sv_spawnbench: no free edicts\n" );
+		return;
+	}
+
+	spawned = (edict_t **)Z_Malloc( sizeof( edict_t* ) * batch );
+	hits = sv_spawnfunc_hits;
+	misses = sv_spawnfunc_misses;
+
+	for( pass = 0; pass < 2; pass++ )
+	{
+		sv_spawnfunc_nocache = ( pass == 0 );
+		start = Sys_DoubleTime();
+
+		for( i = 0; i < count; )
+		{
+			for( n = 0; n < batch && i < count; n++, i++ )
+				spawned[n] = SV_AllocPrivateData( NULL, classnames[i % numclasses] );
+
+			for( j = 0; j < n; j++ )
+			{
+				if( spawned[j] && !spawned[j]->free )
+					SV_FreeEdict( spawned[j] );
+			}
+
+			// give the batch back, its edicts are too fresh to be reused
+			for( ; EDICT_NUM( svgame.numEntities - 1 )->free; svgame.numEntities-- );
+		}
+
+		elapsed[pass] = max( Sys_DoubleTime() - start, 0.000001 );
+	}
+
+	sv_spawnfunc_nocache = false;
+	Mem_Free( spawned );
+
+	Msg( "sv_spawnbench: %i spawns of %i classes, batches of %i\n", count, numclasses, batch );
+	Msg( "uncached: %.3f sec, %.0f spawns/sec\n", elapsed[0], count / elapsed[0] );
+	Msg( "  cached: %.3f sec, %.0f spawns/sec (%i hits, %i misses)\n", elapsed[1], count / elapsed[1],
+		sv_spawnfunc_hits - hits, sv_spawnfunc_misses - misses );
+}
+
 void SV_FreeEdicts( void )
 {
 	int	i = 0;
@@ -2531,14 +3176,10 @@ void GAME_EXPORT pfnMessageBegin( int msg_dest, int msg_num, const vec3_t pOrigi
 	}
 	else
 	{
-		// check for existing
-		for( i = 0; i < MAX_USER_MESSAGES && svgame.msg[i].name[0]; i++ )
-		{
-			if( svgame.msg[i].number == msg_num )
-				break; // found
-		}
+		// user messages are numbered in registration order
+		i = msg_num - svc_lastmsg;
 
-		if( i == MAX_USER_MESSAGES )
+		if( i >= svgame.nummsgs )
 		{
 			Host_Error( "MessageBegin: tried to send unregistered message %i\n", msg_num );
 			return;
@@ -2939,10 +3580,7 @@ void *GAME_EXPORT pfnPvAllocEntPrivateData( edict_t *pEdict, long cb )
 	SV_FreePrivateData( pEdict );
 
 	if( cb > 0 )
-	{
-		// a poke646 have memory corrupt in somewhere - this is trashed last four bytes :(
-		pEdict->pvPrivateData = Mem_AlignedAlloc( svgame.mempool, (cb + 15) & ~15, 16 );
-	}
+		pEdict->pvPrivateData = SV_AllocPrivateMemory( pEdict, cb );
 
 	return pEdict->pvPrivateData;
 }
@@ -3011,6 +3649,8 @@ void SV_EmptyStringPool( void )
 #else
 	Mem_EmptyPool( svgame.stringspool );
 #endif
+	// string_t values are going to be reused
+	SV_ClearSpawnFuncCache();
 }
 
 /*
@@ -3179,6 +3819,7 @@ string_t GAME_EXPORT SV_AllocString( const char *szValue )
 			str64.plast = str64.pstringbase + 1;
 			str64.poldstringbase = str64.pstringbase;
 			str64.numoverflows++;
+			SV_ClearSpawnFuncCache();
 		}
 
 		//MsgDev( D_NOTE, "SV_AllocString: %ld %s\n", str64.plast - svgame.globals->pStringBase, szValue );
@@ -3377,7 +4018,9 @@ pfnRegUserMsg
 */
 int GAME_EXPORT pfnRegUserMsg( const char *pszName, int iSize )
 {
-	int	i;
+	sv_user_message_t	*msg;
+	uint		hash;
+	int		i;
 	
 	if( !pszName || !pszName[0] )
 		return svc_bad;
@@ -3397,25 +4040,31 @@ int GAME_EXPORT pfnRegUserMsg( const char *pszName, int iSize )
 	// make sure what size inrange
 	iSize = bound( -1, iSize, 255 );
 
-	// message 0 is reserved for svc_bad
-	for( i = 0; i < MAX_USER_MESSAGES && svgame.msg[i].name[0]; i++ )
+	// see if already registered
+	hash = Com_HashKey( pszName, MAX_USER_MSG_HASH );
+	for( msg = svgame.msghash[hash]; msg; msg = msg->hashNext )
 	{
-		// see if already registered
-		if( !Q_strcmp( svgame.msg[i].name, pszName ))
-			return svc_lastmsg + i; // offset
+		if( !Q_strcmp( msg->name, pszName ))
+			return msg->number;
 	}
 
-	if( i == MAX_USER_MESSAGES ) 
+	if( svgame.nummsgs == MAX_USER_MESSAGES ) 
 	{
 		MsgDev( D_ERROR, "REG_USER_MSG: user messages limit exceeded\n" );
 		return svc_bad;
 	}
 
 	// register new message
+	// message 0 is reserved for svc_bad
+	i = svgame.nummsgs++;
 	Q_strncpy( svgame.msg[i].name, pszName, sizeof( svgame.msg[i].name ));
 	svgame.msg[i].number = svc_lastmsg + i;
 	svgame.msg[i].size = iSize;
 
+	// link it in
+	svgame.msg[i].hashNext = svgame.msghash[hash];
+	svgame.msghash[hash] = &svgame.msg[i];
+
 	// catch some user messages
 	if( !Q_strcmp( pszName, "HudText" ))
 		svgame.gmsgHudText = svc_lastmsg + i;
@@ -4102,6 +4751,8 @@ void GAME_EXPORT SV_PlaybackEventFull( int flags, const edict_t *pInvoker, word
 	flags |= FEV_SERVER;		// it's a server event!
 	if( delay < 0.0f ) delay = 0.0f;	// fixup negative delays
 
+	SV_DemoRecordEvent( flags, eventindex, delay, &args );
+
 	if(!( flags & FEV_GLOBAL ))
 	{
 		mleaf_t	*leaf;
@@ -5281,7 +5932,11 @@ qboolean SV_LoadProgs( const char *name )
 	svgame.globals->maxEntities = GI->max_edicts;
 	svgame.globals->maxClients = sv_maxclients->integer;
 	svgame.edicts = (edict_t*)Mem_AlignedAlloc( svgame.mempool, sizeof( edict_t ) * svgame.globals->maxEntities, alignof(edict_t) );
+	svgame.freeEdicts = (sv_freeedict_t*)Mem_Alloc( svgame.mempool, sizeof( sv_freeedict_t ) * svgame.globals->maxEntities );
+	svgame.privDataPool = (word*)Mem_Alloc( svgame.mempool, sizeof( word ) * svgame.globals->maxEntities );
+	SV_ClearPrivatePools();
 	svgame.numEntities = svgame.globals->maxClients + 1; // clients + world
+	SV_ClearFreeEdicts();
 
 	for( i = 0, e = svgame.edicts; i < svgame.globals->maxEntities; i++, e++ )
 		e->free = true; // mark all edicts as freed
@@ -51,6 +51,7 @@ int SV_ModelIndex( const char *filename )
 
 	// register new model
 	Q_strncpy( sv.model_precache[i], name, sizeof( sv.model_precache[i] ));
+	SV_InvalidateSignonList( SIGNON_MODELS );
 
 	if( sv.state != ss_loading )
 	{	
@@ -92,6 +93,7 @@ int GAME_EXPORT SV_SoundIndex( const char *filename )
 
 	// register new sound
 	Q_strncpy( sv.sound_precache[i], name, sizeof( sv.sound_precache[i] ));
+	SV_InvalidateSignonList( SIGNON_SOUNDS );
 
 	if( sv.state != ss_loading )
 	{	
@@ -129,6 +131,7 @@ int SV_EventIndex( const char *filename )
 
 	// register new event
 	Q_strncpy( sv.event_precache[i], name, sizeof( sv.event_precache[i] ));
+	SV_InvalidateSignonList( SIGNON_EVENTS );
 
 	if( sv.state != ss_loading )
 	{
@@ -215,11 +218,20 @@ char *SV_EntityScript( void )
 		{
 			MsgDev( D_INFO, "^2Read entity patch:^7 %s\n", entfilename );
 			//return ents;
-			Mem_Free(sv.worldmodel->entities);
+			if( !Mod_IsSnapshotData( sv.worldmodel->entities ))
+				Mem_Free(sv.worldmodel->entities);
 			sv.worldmodel->entities = ents;
 		}
 	}
 
+	// the snapshot is mapped read-only, give a game parser its own copy
+	if( svgame.physFuncs.SV_LoadEntities && Mod_IsSnapshotData( sv.worldmodel->entities ))
+	{
+		ents = (char *)Mem_Alloc( sv.worldmodel->mempool, world.entdatasize + 1 );
+		Q_memcpy( ents, sv.worldmodel->entities, world.entdatasize + 1 );
+		sv.worldmodel->entities = ents;
+	}
+
 	// use internal entities
 	return sv.worldmodel->entities;
 }
@@ -318,6 +330,9 @@ void SV_ActivateServer( void )
 	// Activate the DLL server code
 	svgame.dllFuncs.pfnServerActivate( svgame.edicts, svgame.numEntities, svgame.globals->maxClients );
 
+	// everything must be built before the first frame
+	Mod_EndPrecache( true );
+
 	SV_SetStringArrayMode( true );
 
 	// create a baseline for more efficient communications
@@ -326,6 +341,9 @@ void SV_ActivateServer( void )
 	// check and count all files that marked by user as unmodified (typically is a player models etc)
 	sv.num_consistency_resources = SV_TransferConsistencyInfo();
 
+	// serialize precache lists before anybody asks for them
+	SV_BuildSignonLists();
+
 	// send serverinfo to all connected clients
 	for( i = 0; i < sv_maxclients->integer; i++ )
 	{
@@ -424,6 +442,8 @@ void SV_DeactivateServer( void )
 	if( !svs.initialized || sv.state == ss_dead )
 		return;
 
+	SV_StopServerDemo();
+
 	svgame.dllFuncs.pfnServerDeactivate();
 
 	sv.state = ss_dead;
@@ -434,6 +454,8 @@ void SV_DeactivateServer( void )
 
 	SV_EmptyStringPool();
 
+	SV_FreeSignonLists();
+
 	if( sv_maxclients->integer > 32 )
 		Cvar_SetFloat( "maxplayers", 32.0f );
 
@@ -448,6 +470,7 @@ void SV_DeactivateServer( void )
 	svgame.globals->maxEntities = GI->max_edicts;
 	svgame.globals->maxClients = sv_maxclients->integer;
 	svgame.numEntities = svgame.globals->maxClients + 1; // clients + world
+	SV_ClearFreeEdicts();
 	svgame.globals->startspot = 0;
 	svgame.globals->mapname = 0;
 }
@@ -628,6 +651,9 @@ qboolean SV_SpawnServer( const char *mapname, const char *startspot )
 
 	Host_SetServerState( sv.state );
 
+	// studio models precached from now on are prepared in background
+	Mod_BeginPrecache();
+
 	// clear physics interaction links
 	SV_ClearWorld();
 
@@ -758,6 +784,7 @@ void SV_InitGame( void )
 	SV_UpdateMovevars( true );
 
 	svgame.numEntities = svgame.globals->maxClients + 1; // clients + world
+	SV_ClearFreeEdicts();
 	svs.initialized = true;
 }
 
@@ -64,6 +64,7 @@ convar_t	*sv_failuretime;
 convar_t	*sv_allow_upload;
 convar_t	*sv_allow_download;
 convar_t	*sv_allow_fragment;
+convar_t	*sv_fragment_budget;
 convar_t	*sv_downloadurl;
 convar_t	*sv_allow_studio_attachment_angles;
 convar_t	*sv_allow_rotate_pushables;
@@ -91,6 +92,7 @@ convar_t	*sv_corpse_solid;
 convar_t	*sv_fixmulticast;
 convar_t	*sv_allow_split;
 convar_t	*sv_allow_compress;
+convar_t	*sv_allow_deflate;
 convar_t	*sv_maxpacket;
 convar_t	*sv_forcesimulating;
 convar_t	*sv_nat;
@@ -701,6 +703,9 @@ void Host_ServerFrame( void )
 	// send messages back to the clients that had packets read this frame
 	SV_SendClientMessages ();
 
+	// record what they have been sent
+	SV_DemoFrame ();
+
 	// clear edict flags for next frame
 	SV_PrepWorldFrame ();
 
@@ -893,6 +898,8 @@ void SV_Init( void )
 
 	Log_InitCvars();
 
+	SV_InitDemoRecorder();
+
 	skill = Cvar_Get ("skill", "1", CVAR_LATCH, "game skill level" );
 	deathmatch = Cvar_Get ("deathmatch", SI.GameInfo->gamemode == 2 ? "1" : "0", CVAR_LATCH|CVAR_SERVERINFO, "displays deathmatch state" );
 	teamplay = Cvar_Get ("teamplay", "0", CVAR_LATCH|CVAR_SERVERINFO, "displays teamplay state" );
@@ -983,6 +990,7 @@ void SV_Init( void )
 	sv_allow_upload = Cvar_Get( "sv_allow_upload", "1", 0, "allow uploading custom resources from clients" );
 	sv_allow_download = Cvar_Get( "sv_allow_download", "0", CVAR_ARCHIVE, "allow clients to download missing resources" );
 	sv_allow_fragment = Cvar_Get( "sv_allow_fragment", "0", CVAR_ARCHIVE, "allow direct download from server" );
+	sv_fragment_budget = Cvar_Get( "sv_fragment_budget", "32768", CVAR_ARCHIVE, "bytes of fragments sent to connecting clients per frame, 0 - no limit" );
 	sv_downloadurl = Cvar_Get( "sv_downloadurl", "", CVAR_ARCHIVE, "custom fastdl server to pass to client" );
 	sv_send_logos = Cvar_Get( "sv_send_logos", "1", 0, "send custom player decals to other clients" );
 	sv_send_resources = Cvar_Get( "sv_send_resources", "1", 0, "send generic resources that are specified in 'mapname.res'" );
@@ -996,6 +1004,7 @@ void SV_Init( void )
 	sv_corpse_solid = Cvar_Get( "sv_corpse_solid", "0", CVAR_ARCHIVE, "make corpses solid" );
 	sv_fixmulticast = Cvar_Get( "sv_fixmulticast", "1", CVAR_ARCHIVE, "do not send multicast to not spawned clients" );
 	sv_allow_compress = Cvar_Get( "sv_allow_compress", "1", CVAR_ARCHIVE, "allow Huffman compression on server" );
+	sv_allow_deflate = Cvar_Get( "sv_allow_deflate", "1", CVAR_ARCHIVE, "allow deflate compression for clients that ask for it" );
 	sv_allow_split= Cvar_Get( "sv_allow_split", "1", CVAR_ARCHIVE, "allow splitting packets on server" );
 	sv_maxpacket = Cvar_Get( "sv_maxpacket", "2000", CVAR_ARCHIVE, "limit cl_maxpacket for all clients" );
 	sv_forcesimulating = Cvar_Get( "sv_forcesimulating", DEFAULT_SV_FORCESIMULATING, 0, "forcing world simulating when server don't have active players" );
@@ -1023,6 +1032,10 @@ void SV_Init( void )
 
 	Cmd_AddCommand( "logaddress", SV_SetLogAddress_f, "sets address and port for remote logging host" );
 	Cmd_AddCommand( "log", SV_ServerLog_f, "enables logging to file" );
+	Cmd_AddCommand( "sv_edictstats", SV_EdictStats_f, "show edict allocator statistics, 'reset' to clear them" );
+	Cmd_AddCommand( "sv_multicaststats", SV_MulticastStats_f, "show multicast fan-out statistics, 'reset' to clear them" );
+	Cmd_AddCommand( "sv_spawnbench", SV_SpawnBench_f, "create and remove entities to measure spawn rate: sv_spawnbench [count]" );
+	Cmd_AddCommand( "sv_privdatastats", SV_PrivateDataStats_f, "show entity private data pool usage" );
 
 #ifdef XASH_64BIT
 	Cmd_AddCommand( "str64stats", SV_PrintStr64Stats_f, "show 64 bit string pool stats" );